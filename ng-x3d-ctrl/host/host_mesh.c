@@ -0,0 +1,298 @@
+/**
+ * @file host_mesh.c
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief simulated X3D mesh devices answering the controller in the host build
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "x3d.h"
+
+#include "host_mesh.h"
+#include "host_sim.h"
+
+// registers kept per simulated device
+#define HOST_MESH_REGISTERS 8
+
+// pin of the first device in pairing mode, the others follow with the step
+#define HOST_MESH_PAIR_PIN      0x1234
+#define HOST_MESH_PAIR_PIN_STEP 0x0101
+
+typedef struct {
+    uint16_t reg;
+    uint16_t value;
+} host_mesh_register_t;
+
+static host_mesh_config_t host_mesh_config;
+static bool host_mesh_enabled = true;
+static uint32_t host_mesh_random;
+static host_mesh_register_t host_mesh_registers[X3D_MAX_NET_DEVICES][HOST_MESH_REGISTERS];
+static uint8_t host_mesh_paired = 0; // mask of the devices in pairing mode which are paired
+
+static uint32_t host_mesh_rand(void)
+{
+    // xorshift32
+    host_mesh_random ^= host_mesh_random << 13;
+    host_mesh_random ^= host_mesh_random >> 17;
+    host_mesh_random ^= host_mesh_random << 5;
+    return host_mesh_random;
+}
+
+static bool host_mesh_chance(uint8_t pct)
+{
+    return pct > 0 && host_mesh_rand() % 100 < pct;
+}
+
+static inline uint16_t read_le_u16(const uint8_t *buffer, int index)
+{
+    return buffer[index] | buffer[index + 1] << 8;
+}
+
+static inline void set_le_bit(uint8_t *buffer, int index, uint8_t slot)
+{
+    buffer[index + (slot >> 3)] |= 1 << (slot & 0x07);
+}
+
+void host_mesh_init(const host_mesh_config_t *config)
+{
+    host_mesh_config = *config;
+    if (host_mesh_config.rounds == 0)
+    {
+        host_mesh_config.rounds = 3;
+    }
+    host_mesh_random = config->seed != 0 ? config->seed : 1;
+    host_mesh_paired = 0;
+    memset(host_mesh_registers, 0, sizeof(host_mesh_registers));
+}
+
+void host_mesh_enable(bool enable)
+{
+    host_mesh_enabled = enable;
+}
+
+uint16_t host_mesh_register(uint8_t slot, uint16_t reg)
+{
+    for (int i = 0; i < HOST_MESH_REGISTERS; i++)
+    {
+        if (host_mesh_registers[slot][i].reg == reg)
+        {
+            return host_mesh_registers[slot][i].value;
+        }
+    }
+    // deterministic default value per device and register
+    return (reg & 0x0fff) ^ (slot << 12);
+}
+
+static void host_mesh_set_register(uint8_t slot, uint16_t reg, uint16_t value)
+{
+    int free_index = -1;
+    for (int i = 0; i < HOST_MESH_REGISTERS; i++)
+    {
+        if (host_mesh_registers[slot][i].reg == reg)
+        {
+            host_mesh_registers[slot][i].value = value;
+            return;
+        }
+        if (free_index < 0 && host_mesh_registers[slot][i].reg == 0)
+        {
+            free_index = i;
+        }
+    }
+    if (free_index >= 0)
+    {
+        host_mesh_registers[slot][free_index].reg   = reg;
+        host_mesh_registers[slot][free_index].value = value;
+    }
+}
+
+/**
+ * @brief Applies the answer of a device to the response frame
+ *
+ * @param frame response frame
+ * @param payload_index index of the payload
+ * @param slot device slot
+ */
+static void host_mesh_answer(uint8_t *frame, int payload_index, uint8_t slot)
+{
+    int end = frame[X3D_IDX_PKT_LEN] - X3D_CRC_SIZE;
+    set_le_bit(frame, payload_index + X3D_OFF_RETRANS_ACK_SLOT, slot);
+    if (frame[X3D_IDX_MSG_TYPE] != X3D_MSG_TYPE_STANDARD || payload_index + X3D_OFF_REGISTER_ACK + 2 > end)
+    {
+        return;
+    }
+
+    uint16_t target = read_le_u16(frame, payload_index + X3D_OFF_REGISTER_TARGET);
+    if ((target & (1 << slot)) == 0)
+    {
+        return;
+    }
+    set_le_bit(frame, payload_index + X3D_OFF_REGISTER_ACK, slot);
+
+    uint8_t action = frame[payload_index + X3D_OFF_REGISTER_ACTION] & 0x0f;
+    uint16_t reg   = frame[payload_index + X3D_OFF_REGISTER_HIGH] << 8 | frame[payload_index + X3D_OFF_REGISTER_LOW];
+    int data_index = payload_index + X3D_OFF_REGISTER_ACK + 2 + slot * 2;
+    if (data_index + 2 > end)
+    {
+        return;
+    }
+    if (action == X3D_REGISTER_ACTION_READ)
+    {
+        uint16_t value        = host_mesh_register(slot, reg);
+        frame[data_index]     = value & 0xff;
+        frame[data_index + 1] = value >> 8;
+    }
+    else if (action == X3D_REGISTER_ACTION_WRITE)
+    {
+        host_mesh_set_register(slot, reg, read_le_u16(frame, data_index));
+    }
+}
+
+/**
+ * @brief Answers of the devices in pairing mode, every device answers once with the same retry count
+ *
+ * @param frame pairing frame
+ * @param payload_index index of the payload
+ * @param end_ts end of transmission in us
+ */
+static void host_mesh_pairing(const uint8_t *frame, int payload_index, uint64_t end_ts)
+{
+    uint16_t state = read_le_u16(frame, payload_index + X3D_OFF_PAIR_STATE);
+    uint16_t pin   = read_le_u16(frame, payload_index + X3D_OFF_PAIR_PIN);
+    uint8_t slot   = frame[payload_index + X3D_OFF_PAIR_TARGET_SLOT_NO] & 0x0f;
+    int index      = 0;
+    for (uint8_t i = 0; i < host_mesh_config.pairing && i < 8; i++)
+    {
+        uint16_t device_pin = HOST_MESH_PAIR_PIN + i * HOST_MESH_PAIR_PIN_STEP;
+        if ((host_mesh_paired & (1 << i)) || (state == X3D_PAIR_STATE_PINNED && pin != device_pin))
+        {
+            continue;
+        }
+
+        uint8_t out[65];
+        memcpy(out, frame, frame[X3D_IDX_PKT_LEN] + 1);
+        out[payload_index] = 1 << 4;
+        if (state == X3D_PAIR_STATE_OPEN)
+        {
+            out[payload_index + X3D_OFF_PAIR_PIN]     = device_pin & 0xff;
+            out[payload_index + X3D_OFF_PAIR_PIN + 1] = device_pin >> 8;
+        }
+        else
+        {
+            set_le_bit(out, payload_index + X3D_OFF_RETRANS_ACK_SLOT, slot);
+            host_mesh_paired |= 1 << i;
+        }
+        x3d_set_crc(out);
+        host_sim_schedule(end_ts + (uint64_t)++index * X3D_MSG_DELAY_MS * 1000, out);
+    }
+}
+
+/**
+ * @brief Checks if two stations of the chain reach each other, the controller is station 0
+ *
+ * @param a slot of the first device, X3D_MAX_NET_DEVICES for the controller
+ * @param b slot of the second device
+ * @return bool
+ */
+static bool host_mesh_in_range(uint8_t a, uint8_t b)
+{
+    if (host_mesh_config.range == 0)
+    {
+        return true;
+    }
+
+    // position of a device is the number of present devices up to its slot
+    int pos_a = a < X3D_MAX_NET_DEVICES ? __builtin_popcount(host_mesh_config.present & ((2 << a) - 1)) : 0;
+    int pos_b = __builtin_popcount(host_mesh_config.present & ((2 << b) - 1));
+    return abs(pos_a - pos_b) <= host_mesh_config.range;
+}
+
+void host_mesh_on_transmit(const uint8_t *frame, uint64_t end_ts)
+{
+    int payload_index = (frame[X3D_IDX_HEADER_LEN] & X3D_HEADER_LENGTH_MASK) + X3D_IDX_HEADER_LEN;
+    if (host_mesh_enabled && frame[payload_index] == 0 && frame[X3D_IDX_MSG_TYPE] == X3D_MSG_TYPE_PAIRING)
+    {
+        host_mesh_pairing(frame, payload_index, end_ts);
+        return;
+    }
+    if (!host_mesh_enabled || frame[payload_index] != 0 || frame[X3D_IDX_MSG_TYPE] != X3D_MSG_TYPE_STANDARD)
+    {
+        // only the last frame of the countdown is answered
+        return;
+    }
+
+    uint16_t transfer = read_le_u16(frame, payload_index + X3D_OFF_RETRANS_SLOT);
+    uint16_t devices  = transfer & host_mesh_config.present;
+    for (uint8_t slot = 0; slot < X3D_MAX_NET_DEVICES; slot++)
+    {
+        if ((devices & (1 << slot)) && host_mesh_chance(host_mesh_config.miss_pct))
+        {
+            devices &= ~(1 << slot);
+        }
+    }
+
+    // every device keeps its own response, it merges the relays in range and joins on the first one
+    static uint8_t response[X3D_MAX_NET_DEVICES][65];
+    uint16_t reached = 0;
+    for (uint8_t slot = 0; slot < X3D_MAX_NET_DEVICES; slot++)
+    {
+        if ((devices & (1 << slot)) && host_mesh_in_range(X3D_MAX_NET_DEVICES, slot))
+        {
+            memcpy(response[slot], frame, frame[X3D_IDX_PKT_LEN] + 1);
+            reached |= 1 << slot;
+        }
+    }
+
+    // every device adds its answer and relays once per round in slot order
+    int index = 0;
+    for (uint8_t round = 1; round <= host_mesh_config.rounds; round++)
+    {
+        for (uint8_t slot = 0; slot < X3D_MAX_NET_DEVICES; slot++)
+        {
+            if ((reached & (1 << slot)) == 0)
+            {
+                continue;
+            }
+            index++;
+            host_mesh_answer(response[slot], payload_index, slot);
+            response[slot][payload_index] = (round << 4) | slot;
+            x3d_set_crc(response[slot]);
+
+            for (uint8_t other = 0; other < X3D_MAX_NET_DEVICES; other++)
+            {
+                if (other == slot || (devices & (1 << other)) == 0 || !host_mesh_in_range(slot, other))
+                {
+                    continue;
+                }
+                if (reached & (1 << other))
+                {
+                    for (int i = payload_index + 1; i < frame[X3D_IDX_PKT_LEN] - X3D_CRC_SIZE; i++)
+                    {
+                        response[other][i] |= response[slot][i];
+                    }
+                }
+                else
+                {
+                    memcpy(response[other], response[slot], frame[X3D_IDX_PKT_LEN] + 1);
+                    reached |= 1 << other;
+                }
+            }
+
+            if (!host_mesh_in_range(X3D_MAX_NET_DEVICES, slot))
+            {
+                continue;
+            }
+            uint8_t out[65];
+            memcpy(out, response[slot], frame[X3D_IDX_PKT_LEN] + 1);
+            if (host_mesh_chance(host_mesh_config.crc_error_pct))
+            {
+                out[payload_index + X3D_OFF_RETRANS_ACK_SLOT] ^= 0x5a;
+            }
+            host_sim_schedule(end_ts + (uint64_t)index * X3D_MSG_DELAY_MS * 1000, out);
+        }
+    }
+}
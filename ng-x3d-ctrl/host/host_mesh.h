@@ -0,0 +1,59 @@
+/**
+ * @file host_mesh.h
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief simulated X3D mesh devices answering the controller in the host build
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/// @brief Simulated mesh configuration
+typedef struct {
+    uint16_t present;      ///< slot mask of simulated devices
+    uint8_t rounds;        ///< number of response rounds
+    uint8_t miss_pct;      ///< probability a device misses a request
+    uint8_t crc_error_pct; ///< probability a response frame is corrupted
+    uint8_t pairing;       ///< number of devices in pairing mode, all answer the open pairing message at once
+    uint8_t range;         ///< devices form a chain behind the controller in slot order, each reaches the next range
+                           ///< stations in both directions, 0 if all devices reach each other
+    uint32_t seed;         ///< random seed, runs with the same seed are identical
+} host_mesh_config_t;
+
+/**
+ * @brief Sets up the simulated devices
+ *
+ * @param config mesh configuration
+ */
+void host_mesh_init(const host_mesh_config_t *config);
+
+/**
+ * @brief Enables or disables the simulated devices, disabled during capture replay
+ *
+ * @param enable
+ */
+void host_mesh_enable(bool enable);
+
+/**
+ * @brief Called by the radio shim for every transmitted frame.
+ * The last frame of the initiator countdown schedules the responses.
+ * Devices in pairing mode answer the open pairing message with their pin and the pinned message with the acknowledge.
+ *
+ * @param frame transmitted frame
+ * @param end_ts end of transmission in us
+ */
+void host_mesh_on_transmit(const uint8_t *frame, uint64_t end_ts);
+
+/**
+ * @brief Returns the register value of a simulated device
+ *
+ * @param slot device slot
+ * @param reg register address
+ * @return uint16_t register value
+ */
+uint16_t host_mesh_register(uint8_t slot, uint16_t reg);
@@ -0,0 +1,306 @@
+/**
+ * @file host_replay.c
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief replay of a recorded capture against the controller transaction handler in the host build
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <errno.h>
+#include <string.h>
+
+#include "x3d.h"
+#include "x3d_capture.h"
+#include "x3d_handler.h"
+
+#include "host_replay.h"
+#include "host_sim.h"
+
+// largest frame the simulation delivers, length byte excluded
+#define HOST_REPLAY_FRAME_MAX 64
+
+static x3d_capture_reader_t host_replay_reader;
+static bool host_replay_active    = false;
+static bool host_replay_fast      = false;
+static bool host_replay_tx_marked = false; // the controller frames are flagged as transmitted
+static uint32_t host_replay_device;
+static size_t host_replay_offset;          // next record not consumed yet
+static int64_t host_replay_shift;          // simulation time minus capture time
+static uint16_t host_replay_msg_id;        // message id of the last consumed controller frame, 0 before the first
+static host_replay_stats_t host_replay_stats;
+
+static bool host_replay_frame_valid(const x3d_capture_record_t *record)
+{
+    return record->length > X3D_IDX_NETWORK && record->frame[X3D_IDX_PKT_LEN] < record->length
+           && record->frame[X3D_IDX_PKT_LEN] <= HOST_REPLAY_FRAME_MAX;
+}
+
+static bool host_replay_msg_id_of(const uint8_t *frame, uint16_t *msg_id)
+{
+    uint16_t enc_msg_id;
+    if (x3d_get_msg_id((uint8_t *)frame, &enc_msg_id) != 0)
+    {
+        return false;
+    }
+    *msg_id = x3d_dec_msg_id(enc_msg_id, x3d_get_device_id((uint8_t *)frame));
+    return true;
+}
+
+/**
+ * @brief Checks if a frame is an initiator frame, they count down with a zero high nibble,
+ * relays carry the response counter there
+ */
+static bool host_replay_initiator(const x3d_capture_record_t *record)
+{
+    const uint8_t *frame  = record->frame;
+    uint8_t payload_index = (frame[X3D_IDX_HEADER_LEN] & X3D_HEADER_LENGTH_MASK) + X3D_IDX_HEADER_LEN;
+    uint16_t msg_id;
+    return host_replay_frame_valid(record) && payload_index < frame[X3D_IDX_PKT_LEN] && (frame[payload_index] & 0xf0) == 0
+           && (record->flags & (X3D_CAPTURE_FLAG_CRC_CHECKED | X3D_CAPTURE_FLAG_CRC_OK)) != X3D_CAPTURE_FLAG_CRC_CHECKED
+           && host_replay_msg_id_of(frame, &msg_id);
+}
+
+/**
+ * @brief Checks if a record was sent by the controller
+ */
+static bool host_replay_own(const x3d_capture_record_t *record)
+{
+    if (host_replay_tx_marked)
+    {
+        return (record->flags & X3D_CAPTURE_FLAG_TX) && host_replay_frame_valid(record);
+    }
+    return host_replay_initiator(record) && x3d_get_device_id((uint8_t *)record->frame) == host_replay_device;
+}
+
+/**
+ * @brief Schedules the recorded frames of the other stations up to the next frame of the controller
+ */
+static void host_replay_schedule(void)
+{
+    x3d_capture_record_t record;
+    size_t offset = host_replay_offset;
+    while (x3d_capture_next(&host_replay_reader, &offset, &record) && !host_replay_own(&record))
+    {
+        host_replay_offset = offset;
+        if (!host_replay_frame_valid(&record))
+        {
+            continue;
+        }
+
+        int64_t ts = (int64_t)record.time_us + host_replay_shift;
+        if (ts < (int64_t)host_sim_now())
+        {
+            ts = host_sim_now();
+        }
+        if (host_sim_schedule(ts, record.frame))
+        {
+            host_replay_stats.rx_frames++;
+        }
+    }
+}
+
+/**
+ * @brief Reconstructs the transaction of the first controller frame
+ *
+ * @param frame first frame of the transaction
+ * @param transaction parsed transaction
+ * @return bool false if the frame starts no transaction of the handler
+ */
+static bool host_replay_parse(const uint8_t *frame, host_replay_transaction_t *transaction)
+{
+    uint8_t payload_index = (frame[X3D_IDX_HEADER_LEN] & X3D_HEADER_LENGTH_MASK) + X3D_IDX_HEADER_LEN;
+    int payload_length    = frame[X3D_IDX_PKT_LEN] - X3D_CRC_SIZE - payload_index;
+    if (payload_length <= X3D_OFF_RETRANS_SLOT + 1)
+    {
+        return false;
+    }
+
+    // zero padded, the data fields end with the frame
+    x3d_standard_msg_payload_t payload = {0};
+    memcpy(&payload, &frame[payload_index + 1], payload_length - 1 < (int)sizeof(payload) ? payload_length - 1 : (int)sizeof(payload));
+
+    memset(transaction, 0, sizeof(*transaction));
+    transaction->network  = frame[X3D_IDX_NETWORK] & 0x7f;
+    transaction->transfer = payload.retransmit;
+
+    if (frame[X3D_IDX_MSG_TYPE] == X3D_MSG_TYPE_PAIRING)
+    {
+        // the pinned message is sent by the pairing process itself
+        transaction->action = HOST_REPLAY_PAIR;
+        return payload_length > X3D_OFF_PAIR_STATE + 1
+               && (frame[payload_index + X3D_OFF_PAIR_STATE] | frame[payload_index + X3D_OFF_PAIR_STATE + 1] << 8) == X3D_PAIR_STATE_OPEN;
+    }
+    if (frame[X3D_IDX_MSG_TYPE] != X3D_MSG_TYPE_STANDARD || payload_length <= X3D_OFF_REGISTER_ACK + 1)
+    {
+        return false;
+    }
+
+    transaction->target        = payload.target;
+    transaction->register_high = payload.reg_high;
+    transaction->register_low  = payload.reg_low;
+
+    const uint8_t *ext_header = &frame[X3D_IDX_NETWORK + X3D_OFF_HEADER_EXT];
+    if (ext_header[1] == X3D_HEADER_EXT_TEMP && payload_index > X3D_IDX_NETWORK + X3D_OFF_HEADER_EXT + 4)
+    {
+        transaction->action  = HOST_REPLAY_TEMP;
+        transaction->outdoor = ext_header[2];
+        transaction->temp    = ext_header[3] | ext_header[4] << 8;
+        return true;
+    }
+
+    switch (payload.action & 0x0f)
+    {
+    case X3D_REGISTER_ACTION_READ:
+        transaction->action = HOST_REPLAY_READ;
+        return true;
+    case X3D_REGISTER_ACTION_WRITE:
+        transaction->action = HOST_REPLAY_WRITE;
+        memcpy(transaction->values, payload.data, sizeof(transaction->values));
+        return true;
+    case X3D_REGISTER_ACTION_RESET:
+        transaction->action = HOST_REPLAY_UNPAIR;
+        return true;
+    default:
+        return false;
+    }
+}
+
+int host_replay_open(const char *path, bool fast)
+{
+    if (x3d_capture_open(&host_replay_reader, path) != 0)
+    {
+        return -1;
+    }
+
+    // the controller is the station flagged as transmitting, otherwise the first initiator
+    x3d_capture_record_t record;
+    size_t offset         = 0;
+    bool found            = false;
+    host_replay_tx_marked = false;
+    while (!found && x3d_capture_next(&host_replay_reader, &offset, &record))
+    {
+        host_replay_tx_marked = (record.flags & X3D_CAPTURE_FLAG_TX) && host_replay_frame_valid(&record);
+        found                 = host_replay_tx_marked;
+    }
+    offset = 0;
+    while (!found && x3d_capture_next(&host_replay_reader, &offset, &record))
+    {
+        found = host_replay_initiator(&record);
+    }
+    if (!found)
+    {
+        x3d_capture_close(&host_replay_reader);
+        errno = ENOMSG;
+        return -1;
+    }
+    host_replay_device = x3d_get_device_id((uint8_t *)record.frame);
+
+    // the first record is at the current simulation time
+    offset = 0;
+    x3d_capture_next(&host_replay_reader, &offset, &record);
+    host_replay_shift  = (int64_t)host_sim_now() - (int64_t)record.time_us;
+    host_replay_offset = 0;
+    host_replay_msg_id = 0;
+    host_replay_fast   = fast;
+    host_replay_active = true;
+    memset(&host_replay_stats, 0, sizeof(host_replay_stats));
+    return 0;
+}
+
+uint32_t host_replay_device_id(void)
+{
+    return host_replay_device;
+}
+
+bool host_replay_next(host_replay_transaction_t *transaction)
+{
+    x3d_capture_record_t record;
+    uint16_t msg_id;
+    for (;;)
+    {
+        host_replay_schedule();
+        size_t offset = host_replay_offset;
+        if (!x3d_capture_next(&host_replay_reader, &offset, &record))
+        {
+            return false;
+        }
+        bool has_id = host_replay_msg_id_of(record.frame, &msg_id);
+        if (has_id && msg_id == host_replay_msg_id)
+        {
+            // retries of the last message the handler did not send
+            host_replay_stats.tx_missing++;
+        }
+        else if (!has_id || !host_replay_parse(record.frame, transaction))
+        {
+            host_replay_stats.skipped++;
+        }
+        else
+        {
+            break;
+        }
+        host_replay_offset = offset;
+    }
+
+    // the handler sends the first frame one message delay after the start
+    int64_t start = (int64_t)record.time_us + host_replay_shift - host_sim_airtime(record.frame[X3D_IDX_PKT_LEN]) - X3D_MSG_DELAY_MS * 1000;
+    if (host_replay_fast)
+    {
+        // deliver the traffic still scheduled, the idle time up to the transaction is skipped
+        host_sim_flush();
+    }
+    else if (start > (int64_t)host_sim_now())
+    {
+        host_sim_run(start);
+    }
+
+    // the handler increments the counters before the message is prepared
+    x3d_set_counters(record.frame[X3D_IDX_MSG_NO] - 1, msg_id - 1, NULL);
+    host_replay_stats.transactions++;
+    return true;
+}
+
+void host_replay_on_transmit(const uint8_t *frame, uint64_t end_ts)
+{
+    if (!host_replay_active)
+    {
+        return;
+    }
+    host_replay_stats.tx_frames++;
+
+    x3d_capture_record_t record;
+    size_t offset = host_replay_offset;
+    uint16_t sent_id, recorded_id;
+    if (!x3d_capture_next(&host_replay_reader, &offset, &record) || !host_replay_own(&record)
+            || !host_replay_msg_id_of(record.frame, &recorded_id) || !host_replay_msg_id_of(frame, &sent_id)
+            || sent_id != recorded_id)
+    {
+        // not recorded, the recorded frame is left for the next transaction
+        host_replay_stats.tx_mismatch++;
+        return;
+    }
+    if (record.length < frame[X3D_IDX_PKT_LEN] + 1 || memcmp(record.frame, frame, frame[X3D_IDX_PKT_LEN] + 1) != 0)
+    {
+        host_replay_stats.tx_mismatch++;
+    }
+
+    // the responses follow with their recorded distance to the frame
+    host_replay_offset = offset;
+    host_replay_msg_id = recorded_id;
+    host_replay_shift  = (int64_t)end_ts - (int64_t)record.time_us;
+    host_replay_schedule();
+}
+
+void host_replay_close(host_replay_stats_t *stats)
+{
+    if (stats != NULL)
+    {
+        *stats = host_replay_stats;
+    }
+    if (host_replay_active)
+    {
+        x3d_capture_close(&host_replay_reader);
+    }
+    host_replay_active = false;
+}
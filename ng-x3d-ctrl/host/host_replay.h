@@ -0,0 +1,95 @@
+/**
+ * @file host_replay.h
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief replay of a recorded capture against the controller transaction handler in the host build
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * The transactions are reconstructed from the initiator frames of the controller in the capture and
+ * run by the real handler. Every frame the handler sends is compared with the recorded one, the
+ * recorded frames of the other stations following it are scheduled with their recorded distance to
+ * it, so the receive path sees the same traffic as the recording station.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "x3d.h"
+
+/// @brief Transaction types found in a capture
+typedef enum {
+    HOST_REPLAY_READ = 0,
+    HOST_REPLAY_WRITE,
+    HOST_REPLAY_TEMP,
+    HOST_REPLAY_PAIR,
+    HOST_REPLAY_UNPAIR,
+} host_replay_action_t;
+
+/// @brief Transaction reconstructed from the first recorded frame of the controller
+typedef struct {
+    host_replay_action_t action;
+    uint8_t network;
+    uint16_t transfer;
+    uint16_t target;
+    uint8_t register_high;
+    uint8_t register_low;
+    uint16_t values[X3D_MAX_PAYLOAD_DATA_FIELDS];
+    uint8_t outdoor;
+    uint16_t temp;
+} host_replay_transaction_t;
+
+/// @brief Replay statistics
+typedef struct {
+    uint32_t transactions;  ///< transactions started
+    uint32_t tx_frames;     ///< frames sent by the handler
+    uint32_t tx_mismatch;   ///< sent frames which differ from the recorded ones or were not recorded
+    uint32_t tx_missing;    ///< recorded frames of the controller the handler did not send
+    uint32_t rx_frames;     ///< recorded frames of other stations fed to the receive path
+    uint32_t skipped;       ///< recorded initiator frames of unknown transactions
+} host_replay_stats_t;
+
+/**
+ * @brief Opens a capture for replay.
+ * The controller is the sender of the frames flagged as transmitted, in a capture of a sniffer it is
+ * the first initiator.
+ *
+ * @param path capture file
+ * @param fast skip the idle time between transactions instead of keeping the recorded start times
+ * @return int 0 on success, -1 with errno set on error
+ */
+int host_replay_open(const char *path, bool fast);
+
+/**
+ * @brief Returns the device id of the recorded controller
+ *
+ * @return uint32_t device id
+ */
+uint32_t host_replay_device_id(void);
+
+/**
+ * @brief Advances the simulation to the start of the next recorded transaction.
+ * The message counters of the handler are set to the recorded ones.
+ *
+ * @param transaction next transaction
+ * @return bool false at the end of the capture
+ */
+bool host_replay_next(host_replay_transaction_t *transaction);
+
+/**
+ * @brief Called by the radio shim for every transmitted frame, compares it with the recorded frame
+ * and schedules the recorded responses
+ *
+ * @param frame transmitted frame
+ * @param end_ts end of transmission in us
+ */
+void host_replay_on_transmit(const uint8_t *frame, uint64_t end_ts);
+
+/**
+ * @brief Closes the capture
+ *
+ * @param stats replay statistics, may be NULL
+ */
+void host_replay_close(host_replay_stats_t *stats);
@@ -0,0 +1,138 @@
+/**
+ * @file host_rfm.c
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief host shim of the RFM radio functions, frames go through the simulation
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "x3d.h"
+#include "x3d_capture.h"
+#include "rfm.h"
+#include "x3d_airtime.h"
+#include "x3d_trace.h"
+
+#include "host_mesh.h"
+#include "host_replay.h"
+#include "host_sim.h"
+
+// RSSI reported by the shim for a busy and a free channel
+#define HOST_RFM_RSSI_BUSY  -70
+#define HOST_RFM_RSSI_FREE  -120
+
+static bool host_rfm_listening = true;
+static x3d_capture_writer_t *host_rfm_writer = NULL;
+
+extern void x3d_processor(uint8_t *buffer);
+
+/**
+ * @brief Same check as in rfm.c, the CRC is calculated by the x3d-lib software implementation
+ *
+ * @param buffer received frame
+ * @return esp_err_t
+ */
+static esp_err_t check_message(uint8_t *buffer)
+{
+    uint8_t length = buffer[0];
+    if (length < 3)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint8_t copy[65];
+    memcpy(copy, buffer, length + 1);
+    x3d_set_crc(copy);
+    if (memcmp(&copy[length - 2], &buffer[length - 2], 2) != 0)
+    {
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    return ESP_OK;
+}
+
+static void host_rfm_write(const uint8_t *frame, uint8_t flags)
+{
+    if (host_rfm_writer == NULL)
+    {
+        return;
+    }
+    x3d_capture_record_t record = {
+        .time_us = host_sim_now(),
+        .rssi    = flags & X3D_CAPTURE_FLAG_TX ? X3D_CAPTURE_RSSI_NONE : HOST_RFM_RSSI_BUSY,
+        .flags   = flags,
+        .length  = frame[0] + 1,
+        .frame   = frame,
+    };
+    x3d_capture_write(host_rfm_writer, &record);
+}
+
+void host_rfm_record(x3d_capture_writer_t *writer)
+{
+    host_rfm_writer = writer;
+}
+
+void host_rfm_deliver(uint8_t *frame)
+{
+    uint8_t buffer[65];
+    memcpy(buffer, frame, frame[0] + 1);
+    esp_err_t res = check_message(buffer);
+
+    // the capture has every frame on air, also the ones missed while transmitting
+    host_rfm_write(frame, X3D_CAPTURE_FLAG_CRC_CHECKED | (res == ESP_OK ? X3D_CAPTURE_FLAG_CRC_OK : 0));
+    if (!host_rfm_listening)
+    {
+        // radio is transmitting, the frame is lost
+        return;
+    }
+
+    x3d_airtime_frame(buffer, false, res == ESP_OK);
+    if (res != ESP_OK)
+    {
+        X3D_TRACE(X3D_TRACE_RX_REJECT, res == ESP_ERR_INVALID_CRC ? X3D_TRACE_REJECT_CRC : X3D_TRACE_REJECT_SIZE, buffer[0]);
+        return;
+    }
+    x3d_processor(buffer);
+}
+
+esp_err_t rfm_init(void)
+{
+    host_rfm_listening = true;
+    return ESP_OK;
+}
+
+esp_err_t rfm_receive(void)
+{
+    host_rfm_listening = true;
+    return ESP_OK;
+}
+
+esp_err_t rfm_transfer(uint8_t *buffer, size_t size)
+{
+    host_rfm_listening = false;
+    host_sim_run(host_sim_now() + host_sim_airtime(size));
+    host_rfm_write(buffer, X3D_CAPTURE_FLAG_TX);
+    host_mesh_on_transmit(buffer, host_sim_now());
+    host_replay_on_transmit(buffer, host_sim_now());
+    return ESP_OK;
+}
+
+int16_t rfm_rssi(void)
+{
+    if (!host_rfm_listening)
+    {
+        return RFM_RSSI_INVALID;
+    }
+    return host_sim_on_air() ? HOST_RFM_RSSI_BUSY : HOST_RFM_RSSI_FREE;
+}
+
+int16_t rfm_packet_rssi(void)
+{
+    return HOST_RFM_RSSI_BUSY;
+}
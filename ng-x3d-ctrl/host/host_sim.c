@@ -0,0 +1,220 @@
+/**
+ * @file host_sim.c
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief discrete event simulation backing the FreeRTOS and radio shims of the host build
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+
+#include "host_sim.h"
+
+#define HOST_SIM_TICK_US (1000000 / CONFIG_FREERTOS_HZ)
+
+typedef struct {
+    uint64_t ts;
+    uint32_t seq;
+    uint8_t data[65];
+} host_sim_frame_t;
+
+static uint64_t host_sim_time;
+static uint32_t host_sim_seq;
+static uint32_t host_sim_notify;
+
+// min heap ordered by delivery time and schedule order
+static host_sim_frame_t host_sim_frames[HOST_SIM_MAX_FRAMES];
+static int host_sim_count;
+
+static inline bool host_sim_before(const host_sim_frame_t *a, const host_sim_frame_t *b)
+{
+    return a->ts < b->ts || (a->ts == b->ts && a->seq < b->seq);
+}
+
+static void host_sim_swap(int a, int b)
+{
+    host_sim_frame_t tmp = host_sim_frames[a];
+    host_sim_frames[a]   = host_sim_frames[b];
+    host_sim_frames[b]   = tmp;
+}
+
+static void host_sim_pop(host_sim_frame_t *frame)
+{
+    *frame             = host_sim_frames[0];
+    host_sim_frames[0] = host_sim_frames[--host_sim_count];
+    int i              = 0;
+    for (;;)
+    {
+        int left     = 2 * i + 1;
+        int smallest = i;
+        if (left < host_sim_count && host_sim_before(&host_sim_frames[left], &host_sim_frames[smallest]))
+        {
+            smallest = left;
+        }
+        if (left + 1 < host_sim_count && host_sim_before(&host_sim_frames[left + 1], &host_sim_frames[smallest]))
+        {
+            smallest = left + 1;
+        }
+        if (smallest == i)
+        {
+            break;
+        }
+        host_sim_swap(i, smallest);
+        i = smallest;
+    }
+}
+
+void host_sim_reset(void)
+{
+    host_sim_time   = 0;
+    host_sim_seq    = 0;
+    host_sim_notify = 0;
+    host_sim_count  = 0;
+}
+
+uint64_t host_sim_now(void)
+{
+    return host_sim_time;
+}
+
+uint32_t host_sim_airtime(uint8_t len)
+{
+    return (HOST_SIM_FRAME_OVERHEAD + len) * 8 * HOST_SIM_BIT_US;
+}
+
+bool host_sim_schedule(uint64_t ts, const uint8_t *frame)
+{
+    if (host_sim_count >= HOST_SIM_MAX_FRAMES || frame[0] > 64)
+    {
+        return false;
+    }
+
+    int i                  = host_sim_count++;
+    host_sim_frames[i].ts  = ts;
+    host_sim_frames[i].seq = host_sim_seq++;
+    memcpy(host_sim_frames[i].data, frame, frame[0] + 1);
+    while (i > 0 && host_sim_before(&host_sim_frames[i], &host_sim_frames[(i - 1) / 2]))
+    {
+        host_sim_swap(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+    return true;
+}
+
+bool host_sim_on_air(void)
+{
+    return host_sim_count > 0 && host_sim_frames[0].ts - host_sim_airtime(host_sim_frames[0].data[0]) <= host_sim_time;
+}
+
+/**
+ * @brief Delivers frames up to the given time
+ *
+ * @param until time in us
+ * @param notify stop at the first task notification
+ * @return bool true if stopped by a notification
+ */
+static bool host_sim_deliver(uint64_t until, bool notify)
+{
+    while (host_sim_count > 0 && host_sim_frames[0].ts <= until)
+    {
+        host_sim_frame_t frame;
+        host_sim_pop(&frame);
+        if (frame.ts > host_sim_time)
+        {
+            host_sim_time = frame.ts;
+        }
+        host_rfm_deliver(frame.data);
+        if (notify && host_sim_notify > 0)
+        {
+            return true;
+        }
+    }
+    if (until > host_sim_time)
+    {
+        host_sim_time = until;
+    }
+    return false;
+}
+
+void host_sim_run(uint64_t until)
+{
+    host_sim_deliver(until, false);
+}
+
+void host_sim_flush(void)
+{
+    while (host_sim_count > 0)
+    {
+        host_sim_deliver(host_sim_frames[0].ts, false);
+    }
+}
+
+/***********************************************
+ * FreeRTOS and ESP timer shim
+ */
+
+int64_t esp_timer_get_time(void)
+{
+    return host_sim_time;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return host_sim_time / HOST_SIM_TICK_US;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    // single simulated task
+    return (TaskHandle_t)&host_sim_notify;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    host_sim_deliver((uint64_t)(xTaskGetTickCount() + ticks) * HOST_SIM_TICK_US, false);
+}
+
+void vTaskDelayUntil(TickType_t *previous_wake, TickType_t increment)
+{
+    *previous_wake += increment;
+    if ((int32_t)(*previous_wake - xTaskGetTickCount()) > 0)
+    {
+        host_sim_deliver((uint64_t)*previous_wake * HOST_SIM_TICK_US, false);
+    }
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    host_sim_notify++;
+    return pdTRUE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks)
+{
+    if (host_sim_notify == 0)
+    {
+        if (ticks == portMAX_DELAY)
+        {
+            while (host_sim_count > 0 && !host_sim_deliver(host_sim_frames[0].ts, true))
+            {
+            }
+        }
+        else
+        {
+            host_sim_deliver((uint64_t)(xTaskGetTickCount() + ticks) * HOST_SIM_TICK_US, true);
+        }
+    }
+
+    uint32_t value = host_sim_notify;
+    if (value > 0)
+    {
+        host_sim_notify = clear_on_exit ? 0 : value - 1;
+    }
+    return value;
+}
@@ -0,0 +1,87 @@
+/**
+ * @file host_sim.h
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief discrete event simulation backing the FreeRTOS and radio shims of the host build
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "x3d_capture.h"
+
+// maximum number of frames waiting for delivery
+#define HOST_SIM_MAX_FRAMES 1024
+
+// bit time of the X3D radio in us
+#define HOST_SIM_BIT_US     25
+
+// preamble, sync word and length byte in front of the frame
+#define HOST_SIM_FRAME_OVERHEAD 9
+
+/**
+ * @brief Resets the virtual time and drops all pending frames
+ */
+void host_sim_reset(void);
+
+/**
+ * @brief Returns the virtual time
+ *
+ * @return uint64_t time in us
+ */
+uint64_t host_sim_now(void);
+
+/**
+ * @brief Returns the time a frame occupies the air
+ *
+ * @param len frame length byte
+ * @return uint32_t airtime in us
+ */
+uint32_t host_sim_airtime(uint8_t len);
+
+/**
+ * @brief Schedules a frame for reception
+ *
+ * @param ts time the frame is completely received in us
+ * @param frame frame, first byte is the length
+ * @return bool false if the queue is full
+ */
+bool host_sim_schedule(uint64_t ts, const uint8_t *frame);
+
+/**
+ * @brief Returns true if a scheduled frame is on air at the current time
+ *
+ * @return bool
+ */
+bool host_sim_on_air(void);
+
+/**
+ * @brief Delivers all frames up to the given time and advances the virtual time
+ *
+ * @param until time in us
+ */
+void host_sim_run(uint64_t until);
+
+/**
+ * @brief Delivers all pending frames
+ */
+void host_sim_flush(void);
+
+/**
+ * @brief Receive path of the radio shim, called for every delivered frame
+ *
+ * @param frame received frame
+ */
+void host_rfm_deliver(uint8_t *frame);
+
+/**
+ * @brief Records the frames on air to a capture, received frames with their crc state and transmitted frames flagged
+ *
+ * @param writer open capture, NULL to stop recording
+ */
+void host_rfm_record(x3d_capture_writer_t *writer);
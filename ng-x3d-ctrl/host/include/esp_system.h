@@ -0,0 +1,16 @@
+/**
+ * @file esp_system.h
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief host shim of the ESP-IDF system header
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
@@ -0,0 +1,15 @@
+/**
+ * @file esp_timer.h
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief host shim of the ESP-IDF timer, returns the virtual time of the simulation
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
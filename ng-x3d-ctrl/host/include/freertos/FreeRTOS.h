@@ -0,0 +1,34 @@
+/**
+ * @file FreeRTOS.h
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief host shim of the FreeRTOS types, time is virtual and advanced by the simulation
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef void *TaskHandle_t;
+
+// the simulation runs in one thread, critical sections have nothing to lock
+typedef int portMUX_TYPE;
+
+#define pdTRUE                     1
+#define pdFALSE                    0
+#define portMAX_DELAY              ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(ms)          ((TickType_t)(((uint64_t)(ms) * CONFIG_FREERTOS_HZ) / 1000))
+#define pdTICKS_TO_MS(ticks)       ((uint32_t)(((uint64_t)(ticks) * 1000) / CONFIG_FREERTOS_HZ))
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux)    ((void)(mux))
+#define portEXIT_CRITICAL(mux)     ((void)(mux))
@@ -0,0 +1,15 @@
+/**
+ * @file sdkconfig.h
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief host build configuration
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#define CONFIG_FREERTOS_HZ       1000
+#define CONFIG_X3D_TRACE         1
+#define CONFIG_X3D_TRACE_ENTRIES 4096
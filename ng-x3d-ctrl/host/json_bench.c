@@ -0,0 +1,189 @@
+/**
+ * @file json_bench.c
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief host benchmark of the streaming json writer against cJSON for a 16 device status sweep
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "x3d.h"
+#include "x3d_device.h"
+#include "x3d_schema.h"
+#include "json_writer.h"
+
+#ifdef JSON_BENCH_CJSON
+#include "cJSON.h"
+#endif
+
+#define BENCH_ROUNDS 20000
+
+static x3d_device_store_t store;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void init_devices(void)
+{
+    for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+    {
+        x3d_device_set_type(&store, i, X3D_DEVICE_TYPE_RF66XX);
+        store.room_temp[i]         = 1800 + i * 37;
+        store.power[i]             = 20 + i;
+        store.set_point[i]         = 38 + i % 5;
+        store.set_point_day[i]     = 42;
+        store.set_point_night[i]   = 35;
+        store.set_point_defrost[i] = 15;
+        store.flags[i]             = X3D_SCHEMA_FLAG_ON_AIR | (i % 3 != 0 ? X3D_SCHEMA_FLAG_ENABLED : 0)
+                                     | (i % 2 ? X3D_SCHEMA_FLAG_HEATER_ON : 0) | (i == 5 ? X3D_SCHEMA_FLAG_WINDOW_OPEN : 0)
+                                     | (i == 7 ? X3D_SCHEMA_FLAG_BATTERY_LOW : 0);
+    }
+}
+
+static size_t sweep_writer(char outputs[][320])
+{
+    size_t bytes = 0;
+    for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+    {
+        json_writer_t writer;
+        json_writer_init(&writer, outputs[i], 320);
+        x3d_device_to_json(&store, i, &writer, NULL);
+        bytes += json_writer_length(&writer);
+    }
+    return bytes;
+}
+
+#ifdef JSON_BENCH_CJSON
+
+static unsigned long allocations;
+
+static void *count_malloc(size_t size)
+{
+    allocations++;
+    return malloc(size);
+}
+
+/**
+ * @brief Previous cJSON tree based implementation of the rf66xx json
+ */
+static cJSON *rf66xx_to_cjson(const x3d_device_store_t *store, uint8_t slot)
+{
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "type", "rf66xx");
+    cJSON_AddNumberToObject(root, "roomTemp", (double)store->room_temp[slot] / 100.0);
+    cJSON_AddNumberToObject(root, "power", (uint16_t)store->power[slot] * 50);
+    cJSON_AddNumberToObject(root, "setPoint", (double)store->set_point[slot] * 0.5);
+    cJSON_AddNumberToObject(root, "setPointDay", (double)store->set_point_day[slot] * 0.5);
+    cJSON_AddNumberToObject(root, "setPointNight", (double)store->set_point_night[slot] * 0.5);
+    cJSON_AddNumberToObject(root, "setPointDefrost", (double)store->set_point_defrost[slot] * 0.5);
+    cJSON_AddBoolToObject(root, "enabled", (store->flags[slot] & X3D_SCHEMA_FLAG_ENABLED) != 0);
+    cJSON_AddBoolToObject(root, "onAir", (store->flags[slot] & X3D_SCHEMA_FLAG_ON_AIR) != 0);
+    cJSON *flags = cJSON_AddArrayToObject(root, "flags");
+    if ((store->flags[slot] & X3D_SCHEMA_FLAG_DEFROST) != 0)
+    {
+        cJSON_AddItemToArray(flags, cJSON_CreateString("defrost"));
+    }
+    if ((store->flags[slot] & X3D_SCHEMA_FLAG_TIMED) != 0)
+    {
+        cJSON_AddItemToArray(flags, cJSON_CreateString("timed"));
+    }
+    if ((store->flags[slot] & X3D_SCHEMA_FLAG_HEATER_ON) != 0)
+    {
+        cJSON_AddItemToArray(flags, cJSON_CreateString("heaterOn"));
+    }
+    if ((store->flags[slot] & X3D_SCHEMA_FLAG_HEATER_STOPPED) != 0)
+    {
+        cJSON_AddItemToArray(flags, cJSON_CreateString("heaterStopped"));
+    }
+    if ((store->flags[slot] & X3D_SCHEMA_FLAG_WINDOW_OPEN) != 0)
+    {
+        cJSON_AddItemToArray(flags, cJSON_CreateString("windowOpen"));
+    }
+    if ((store->flags[slot] & X3D_SCHEMA_FLAG_NO_TEMP_SENSOR) != 0)
+    {
+        cJSON_AddItemToArray(flags, cJSON_CreateString("noTempSensor"));
+    }
+    if ((store->flags[slot] & X3D_SCHEMA_FLAG_BATTERY_LOW) != 0)
+    {
+        cJSON_AddItemToArray(flags, cJSON_CreateString("batteryLow"));
+    }
+    return root;
+}
+
+static size_t sweep_cjson(char outputs[][320])
+{
+    size_t bytes = 0;
+    for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+    {
+        cJSON *root       = rf66xx_to_cjson(&store, i);
+        char *json_string = cJSON_PrintUnformatted(root);
+        cJSON_Delete(root);
+        if (outputs != NULL)
+        {
+            snprintf(outputs[i], 320, "%s", json_string);
+        }
+        bytes += strlen(json_string);
+        free(json_string);
+    }
+    return bytes;
+}
+
+#endif
+
+int main(int argc, char **argv)
+{
+    static char writer_out[X3D_MAX_NET_DEVICES][320];
+    init_devices();
+
+    size_t bytes   = 0;
+    uint64_t start = now_ns();
+    for (int r = 0; r < BENCH_ROUNDS; r++)
+    {
+        bytes += sweep_writer(writer_out);
+    }
+    uint64_t writer_ns = now_ns() - start;
+    printf("json_writer: %8.0f ns per sweep, %zu bytes per sweep, 0 allocations\n",
+            (double)writer_ns / BENCH_ROUNDS, bytes / BENCH_ROUNDS);
+    printf("example: %s\n", writer_out[5]);
+
+#ifdef JSON_BENCH_CJSON
+    static char cjson_out[X3D_MAX_NET_DEVICES][320];
+    cJSON_Hooks hooks = {.malloc_fn = count_malloc, .free_fn = free};
+    cJSON_InitHooks(&hooks);
+
+    sweep_cjson(cjson_out);
+    for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+    {
+        if (strcmp(writer_out[i], cjson_out[i]) != 0)
+        {
+            printf("output mismatch on device %d\n  writer: %s\n  cJSON:  %s\n", i, writer_out[i], cjson_out[i]);
+            return 1;
+        }
+    }
+
+    bytes       = 0;
+    allocations = 0;
+    start       = now_ns();
+    for (int r = 0; r < BENCH_ROUNDS; r++)
+    {
+        bytes += sweep_cjson(NULL);
+    }
+    uint64_t cjson_ns = now_ns() - start;
+    printf("cJSON:       %8.0f ns per sweep, %zu bytes per sweep, %lu allocations\n",
+            (double)cjson_ns / BENCH_ROUNDS, bytes / BENCH_ROUNDS, allocations / BENCH_ROUNDS);
+    printf("speedup:     %.1fx, output identical\n", (double)cjson_ns / writer_ns);
+#else
+    printf("cJSON comparison skipped, build with CJSON_DIR=<path to cJSON sources>\n");
+#endif
+    return 0;
+}
@@ -0,0 +1,179 @@
+/**
+ * @file payload_bench.c
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief host benchmark of the CBOR payload mode against JSON, with decoder round trip check
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "x3d_payload.h"
+#include "x3d_decode.h"
+
+#define BENCH_ROUNDS  20000
+#define PAYLOAD_SIZE  320
+
+static x3d_device_store_t store;
+static x3d_standard_msg_payload_t results[X3D_MAX_NET_DEVICES];
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void init_data(void)
+{
+    for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+    {
+        x3d_device_set_type(&store, i, X3D_DEVICE_TYPE_RF66XX);
+        store.room_temp[i]         = 1800 + i * 37;
+        store.power[i]             = 20 + i;
+        store.set_point[i]         = 38 + i % 5;
+        store.set_point_day[i]     = 42;
+        store.set_point_night[i]   = 35;
+        store.set_point_defrost[i] = 15;
+        store.flags[i]             = X3D_SCHEMA_FLAG_ON_AIR | (i % 3 != 0 ? X3D_SCHEMA_FLAG_ENABLED : 0)
+                                     | (i % 2 ? X3D_SCHEMA_FLAG_HEATER_ON : 0) | (i == 5 ? X3D_SCHEMA_FLAG_WINDOW_OPEN : 0)
+                                     | (i == 7 ? X3D_SCHEMA_FLAG_BATTERY_LOW : 0);
+
+        // register read of i + 1 devices
+        results[i].action     = i << 4;
+        results[i].reg_high   = 0x16;
+        results[i].reg_low    = 0x11;
+        results[i].target_ack = (1 << (i + 1)) - 1;
+        for (int s = 0; s <= i; s++)
+        {
+            results[i].data[s] = 1900 + s * 13;
+        }
+    }
+}
+
+typedef struct {
+    size_t bytes;
+    uint64_t ns;
+} bench_t;
+
+static void print_bench(const char *name, bench_t *bench, int items)
+{
+    printf("%-14s %8.0f ns per sweep, %6zu bytes per sweep, %5.1f bytes per message\n",
+            name, (double)bench->ns / BENCH_ROUNDS, bench->bytes / BENCH_ROUNDS, (double)bench->bytes / BENCH_ROUNDS / items);
+}
+
+int main(int argc, char **argv)
+{
+    static char json_out[X3D_MAX_NET_DEVICES][PAYLOAD_SIZE];
+    static uint8_t cbor_out[X3D_MAX_NET_DEVICES][PAYLOAD_SIZE];
+    static int cbor_len[X3D_MAX_NET_DEVICES];
+    init_data();
+
+    bench_t json_device = {0}, cbor_device = {0}, decode_device = {0};
+    bench_t json_result = {0}, cbor_result = {0}, decode_result = {0};
+    static x3d_device_store_t decoded;
+    x3d_schema_action_t action;
+    uint8_t network;
+    x3d_standard_msg_payload_t payload;
+
+    // device status sweep
+    uint64_t start = now_ns();
+    for (int r = 0; r < BENCH_ROUNDS; r++)
+    {
+        for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+        {
+            json_device.bytes += x3d_payload_device_json(&store, i, json_out[i], PAYLOAD_SIZE);
+        }
+    }
+    json_device.ns = now_ns() - start;
+
+    start = now_ns();
+    for (int r = 0; r < BENCH_ROUNDS; r++)
+    {
+        for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+        {
+            cbor_len[i]        = x3d_payload_device_cbor(&store, i, cbor_out[i], PAYLOAD_SIZE);
+            cbor_device.bytes += cbor_len[i];
+        }
+    }
+    cbor_device.ns = now_ns() - start;
+
+    start = now_ns();
+    for (int r = 0; r < BENCH_ROUNDS; r++)
+    {
+        for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+        {
+            decode_device.bytes += x3d_decode_device(cbor_out[i], cbor_len[i], &decoded, i) == 0 ? cbor_len[i] : 0;
+        }
+    }
+    decode_device.ns = now_ns() - start;
+
+    // round trip, the decoded device encodes to the same output
+    for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+    {
+        char json[PAYLOAD_SIZE];
+        if (x3d_decode_device(cbor_out[i], cbor_len[i], &decoded, i) != 0 || decoded.type[i] != X3D_DEVICE_TYPE_RF66XX
+                || x3d_payload_device_json(&decoded, i, json, sizeof(json)) < 0 || strcmp(json, json_out[i]) != 0)
+        {
+            printf("device %d round trip mismatch\n", i);
+            return 1;
+        }
+    }
+
+    // result of reads with 1 to 16 values
+    start = now_ns();
+    for (int r = 0; r < BENCH_ROUNDS; r++)
+    {
+        for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+        {
+            json_result.bytes += x3d_payload_result_json(X3D_SCHEMA_ACTION_READ, 4, &results[i], json_out[i], PAYLOAD_SIZE);
+        }
+    }
+    json_result.ns = now_ns() - start;
+
+    start = now_ns();
+    for (int r = 0; r < BENCH_ROUNDS; r++)
+    {
+        for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+        {
+            cbor_len[i]        = x3d_payload_result_cbor(X3D_SCHEMA_ACTION_READ, 4, &results[i], cbor_out[i], PAYLOAD_SIZE);
+            cbor_result.bytes += cbor_len[i];
+        }
+    }
+    cbor_result.ns = now_ns() - start;
+
+    start = now_ns();
+    for (int r = 0; r < BENCH_ROUNDS; r++)
+    {
+        for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+        {
+            decode_result.bytes += x3d_decode_result(cbor_out[i], cbor_len[i], &action, &network, &payload) == 0 ? cbor_len[i] : 0;
+        }
+    }
+    decode_result.ns = now_ns() - start;
+
+    for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+    {
+        char json[PAYLOAD_SIZE];
+        if (x3d_decode_result(cbor_out[i], cbor_len[i], &action, &network, &payload) != 0
+                || x3d_payload_result_json(action, network, &payload, json, sizeof(json)) < 0 || strcmp(json, json_out[i]) != 0)
+        {
+            printf("result %d round trip mismatch\n", i);
+            return 1;
+        }
+    }
+
+    print_bench("json status:", &json_device, X3D_MAX_NET_DEVICES);
+    print_bench("cbor status:", &cbor_device, X3D_MAX_NET_DEVICES);
+    print_bench("cbor decode:", &decode_device, X3D_MAX_NET_DEVICES);
+    print_bench("json result:", &json_result, X3D_MAX_NET_DEVICES);
+    print_bench("cbor result:", &cbor_result, X3D_MAX_NET_DEVICES);
+    print_bench("cbor decode:", &decode_result, X3D_MAX_NET_DEVICES);
+    printf("size ratio:    status %.2f, result %.2f, round trip identical\n",
+            (double)cbor_device.bytes / json_device.bytes, (double)cbor_result.bytes / json_result.bytes);
+    return 0;
+}
@@ -0,0 +1,248 @@
+/**
+ * @file router_bench.c
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief host benchmark of the mqtt router against the previous strcmp/strtok dispatch
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mqtt_router.h"
+
+#define BENCH_ROUNDS 200000
+
+static const char prefix[] = "device/x3d/a1b2c3";
+
+/// @brief Command mix of a home automation, status polling dominates
+static const struct {
+    const char *topic;
+    const char *data;
+    int weight;
+} mix[] = {
+    {"device/x3d/a1b2c3/net-4/cmd",                "device-status-short",          20},
+    {"device/x3d/a1b2c3/net-5/cmd",                "device-status",                 5},
+    {"device/x3d/a1b2c3/net-4/dest/3/cmd",         "read 22 17",                   15},
+    {"device/x3d/a1b2c3/net-4/dest/0,1,2,5/cmd",   "write 22 17 38 40 42 36",      10},
+    {"device/x3d/a1b2c3/net-5/dest/7/cmd",         "enable timed 21.5 120",         5},
+    {"device/x3d/a1b2c3/net-4/dest/2,3/cmd",       "enable day",                    5},
+    {"device/x3d/a1b2c3/cmd",                      "outdoor-temp -4.5",            10},
+    {"device/x3d/a1b2c3/cmd",                      "channel-stats",                 5},
+    {"device/x3d/a1b2c3/net-4/dest/4/cmd",         "disable",                       5},
+    {"device/x3d/a1b2c3/net-4/cmd",                "unknown-command",               5},
+    {"device/x3d/d4e5f6/net-4/cmd",                "device-status",                15}, // other controller
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief Previous dispatch of mqtt_data, returns a command id instead of starting tasks
+ */
+static int legacy_dispatch(const char *in_topic, int topic_len, const char *in_data, int data_len)
+{
+    // copies of the event handler
+    char topic_buffer[128];
+    char data[128];
+    sprintf(topic_buffer, "%.*s", topic_len, in_topic);
+    sprintf(data, "%.*s", data_len, in_data);
+    char *topic = topic_buffer;
+
+    if (strncmp(topic, prefix, sizeof(prefix) - 1) != 0)
+    {
+        return 0;
+    }
+    topic += sizeof(prefix) - 1;
+    if (strcmp(topic, "/cmd") == 0)
+    {
+        if (strcmp(data, "reset") == 0) { return MQTT_COMMAND_RESET; }
+        else if (strcmp(data, "channel-stats") == 0) { return MQTT_COMMAND_CHANNEL_STATS; }
+        else if (strcmp(data, "trace-start") == 0) { return MQTT_COMMAND_TRACE_START; }
+        else if (strcmp(data, "trace-stop") == 0) { return MQTT_COMMAND_TRACE_STOP; }
+        else if (strcmp(data, "trace-dump") == 0) { return MQTT_COMMAND_TRACE_DUMP; }
+        else if (strcmp(data, "trace-print") == 0) { return MQTT_COMMAND_TRACE_PRINT; }
+        else if (strcmp(data, "airtime") == 0) { return MQTT_COMMAND_AIRTIME; }
+        else if (strncmp(data, "outdoor-temp ", 13) == 0)
+        {
+            char *args = strdup(&data[13]);
+            volatile double temp = strtod(args, NULL);
+            (void)temp;
+            free(args);
+            return MQTT_COMMAND_OUTDOOR_TEMP;
+        }
+        return 0;
+    }
+    if (strncmp(topic, "/net-", 5) != 0)
+    {
+        return 0;
+    }
+    topic += 5;
+    uint8_t network = strtoul(topic, &topic, 10);
+    if (network != 4 && network != 5)
+    {
+        return 0;
+    }
+    if (strcmp(topic, "/cmd") == 0)
+    {
+        if (strncmp(data, "pair ", 5) == 0)
+        {
+            free(strdup(&data[5]));
+            return MQTT_COMMAND_PAIR_NET;
+        }
+        else if (strcmp(data, "device-status") == 0) { return MQTT_COMMAND_DEVICE_STATUS; }
+        else if (strcmp(data, "device-status-short") == 0) { return MQTT_COMMAND_DEVICE_STATUS_SHORT; }
+        else if (strcmp(data, "timing-model") == 0) { return MQTT_COMMAND_TIMING_MODEL; }
+        else if (strcmp(data, "device-refresh") == 0) { return MQTT_COMMAND_DEVICE_REFRESH; }
+        else if (strcmp(data, "topology") == 0) { return MQTT_COMMAND_TOPOLOGY; }
+        return 0;
+    }
+    if (strncmp(topic, "/dest/", 6) != 0)
+    {
+        return 0;
+    }
+    topic += 6;
+    char *device_ids = strtok_r(topic, "/", &topic);
+    char *end = ",";
+    uint16_t target_mask = 0;
+    for (const char *p = device_ids; *end == ','; p = end + 1)
+    {
+        long target_number = strtol(p, &end, 10);
+        if (end == p)
+        {
+            break;
+        }
+        if (target_number < 16)
+        {
+            target_mask |= 1 << target_number;
+        }
+    }
+    if (target_mask == 0)
+    {
+        return 0;
+    }
+    *(--topic) = '/';
+    if (strcmp(topic, "/cmd") != 0)
+    {
+        return 0;
+    }
+
+    // allocation of the task arguments
+    int id = 0;
+    char *args = NULL;
+    void *task_args = calloc(1, 16);
+    if (strcmp(data, "pair") == 0) { id = MQTT_COMMAND_PAIR; }
+    else if (strcmp(data, "unpair") == 0) { id = MQTT_COMMAND_UNPAIR; }
+    else if (strncmp(data, "read ", 5) == 0) { id = MQTT_COMMAND_READ; args = strdup(&data[5]); }
+    else if (strncmp(data, "write ", 6) == 0) { id = MQTT_COMMAND_WRITE; args = strdup(&data[6]); }
+    else if (strncmp(data, "enable ", 7) == 0) { id = MQTT_COMMAND_ENABLE; args = strdup(&data[7]); }
+    else if (strcmp(data, "disable") == 0) { id = MQTT_COMMAND_DISABLE; }
+
+    // argument parsing of the tasks
+    if (args != NULL)
+    {
+        char *p = args;
+        volatile unsigned long value;
+        while (*p != '\0')
+        {
+            char *next;
+            value = strtoul(p, &next, 10);
+            if (next == p)
+            {
+                next = strchr(p, ' ');
+                if (next == NULL)
+                {
+                    break;
+                }
+                next++;
+            }
+            p = next;
+        }
+        (void)value;
+        free(args);
+    }
+    free(task_args);
+    return id;
+}
+
+int main(int argc, char **argv)
+{
+    // expand the weighted mix
+    int count = 0;
+    for (size_t i = 0; i < sizeof(mix) / sizeof(mix[0]); i++)
+    {
+        count += mix[i].weight;
+    }
+    int *order = malloc(count * sizeof(int));
+    int n      = 0;
+    for (size_t i = 0; i < sizeof(mix) / sizeof(mix[0]); i++)
+    {
+        for (int w = 0; w < mix[i].weight; w++)
+        {
+            order[n++] = i;
+        }
+    }
+    srand(1);
+    for (int i = count - 1; i > 0; i--)
+    {
+        int j    = rand() % (i + 1);
+        int t    = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+
+    // both implementations accept the same messages
+    for (size_t i = 0; i < sizeof(mix) / sizeof(mix[0]); i++)
+    {
+        mqtt_command_t command;
+        bool parsed = mqtt_router_parse(prefix, sizeof(prefix) - 1, mix[i].topic, strlen(mix[i].topic), mix[i].data, strlen(mix[i].data), &command);
+        int legacy  = legacy_dispatch(mix[i].topic, strlen(mix[i].topic), mix[i].data, strlen(mix[i].data));
+        if ((parsed ? (int)command.id : 0) != legacy)
+        {
+            printf("dispatch mismatch: %s %s: router %d legacy %d\n", mix[i].topic, mix[i].data, parsed ? (int)command.id : 0, legacy);
+            return 1;
+        }
+    }
+
+    int accepted   = 0;
+    uint64_t start = now_ns();
+    for (int r = 0; r < BENCH_ROUNDS; r++)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            mqtt_command_t command;
+            const char *topic = mix[order[i]].topic;
+            const char *data  = mix[order[i]].data;
+            accepted += mqtt_router_parse(prefix, sizeof(prefix) - 1, topic, strlen(topic), data, strlen(data), &command);
+        }
+    }
+    uint64_t router_ns = now_ns() - start;
+
+    int legacy_accepted = 0;
+    start               = now_ns();
+    for (int r = 0; r < BENCH_ROUNDS; r++)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            const char *topic = mix[order[i]].topic;
+            const char *data  = mix[order[i]].data;
+            legacy_accepted += legacy_dispatch(topic, strlen(topic), data, strlen(data)) != 0;
+        }
+    }
+    uint64_t legacy_ns = now_ns() - start;
+
+    double messages = (double)BENCH_ROUNDS * count;
+    printf("router: %6.1f ns per message, %d of %d accepted, 0 allocations\n", router_ns / messages, accepted / BENCH_ROUNDS, count);
+    printf("legacy: %6.1f ns per message, %d of %d accepted, up to 2 allocations\n", legacy_ns / messages, legacy_accepted / BENCH_ROUNDS, count);
+    printf("speedup: %.1fx\n", (double)legacy_ns / router_ns);
+    free(order);
+    return 0;
+}
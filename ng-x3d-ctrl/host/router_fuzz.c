@@ -0,0 +1,193 @@
+/**
+ * @file router_fuzz.c
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief fuzz target of the mqtt router
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * The first byte of the input is the length of the topic, the rest after the topic is the payload.
+ * Built with -DLIBFUZZER it is a libFuzzer target, otherwise a standalone driver which replays
+ * the given files or mutates a built in corpus.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mqtt_router.h"
+
+static const char prefix[] = "device/x3d/a1b2c3";
+
+#define FUZZ_CHECK(cond)                                             \
+    do                                                               \
+    {                                                                \
+        if (!(cond))                                                 \
+        {                                                            \
+            fprintf(stderr, "check failed: %s:%d %s\n", __FILE__, __LINE__, #cond); \
+            abort();                                                 \
+        }                                                            \
+    } while (0)
+
+int LLVMFuzzerTestOneInput(const uint8_t *input, size_t size)
+{
+    if (size == 0)
+    {
+        return 0;
+    }
+    size_t topic_len = input[0] < size - 1 ? input[0] : size - 1;
+
+    // exact sized copies, so the sanitizer catches reads beyond the input
+    char *topic = malloc(topic_len + 1);
+    char *data  = malloc(size - 1 - topic_len + 1);
+    memcpy(topic, &input[1], topic_len);
+    memcpy(data, &input[1 + topic_len], size - 1 - topic_len);
+
+    mqtt_command_t command;
+    if (mqtt_router_parse(prefix, sizeof(prefix) - 1, topic, topic_len, data, size - 1 - topic_len, &command))
+    {
+        FUZZ_CHECK(command.id != MQTT_COMMAND_NONE);
+        switch (command.scope)
+        {
+            case MQTT_SCOPE_DEVICE:
+                FUZZ_CHECK(command.id >= MQTT_COMMAND_RESET && command.id <= MQTT_COMMAND_OUTDOOR_TEMP);
+                break;
+            case MQTT_SCOPE_NETWORK:
+                FUZZ_CHECK(command.id >= MQTT_COMMAND_PAIR_NET && command.id <= MQTT_COMMAND_TOPOLOGY);
+                break;
+            case MQTT_SCOPE_DEST:
+                FUZZ_CHECK(command.id >= MQTT_COMMAND_PAIR && command.id <= MQTT_COMMAND_QUERY);
+                FUZZ_CHECK(command.target_mask != 0);
+                break;
+            default:
+                FUZZ_CHECK(0);
+        }
+        if (command.id == MQTT_COMMAND_WRITE)
+        {
+            FUZZ_CHECK(command.value_count > 0 && command.value_count <= MQTT_ROUTER_MAX_VALUES);
+        }
+        if (command.id == MQTT_COMMAND_ENABLE)
+        {
+            FUZZ_CHECK(command.mode >= ENABLE_DAY && command.mode <= ENABLE_TIMED);
+            FUZZ_CHECK(command.mode != ENABLE_TIMED || command.time > 0);
+        }
+        if (command.id == MQTT_COMMAND_PAIR_NET)
+        {
+            FUZZ_CHECK(command.device_type != X3D_DEVICE_TYPE_NONE);
+        }
+    }
+    else
+    {
+        FUZZ_CHECK(command.id == MQTT_COMMAND_NONE);
+    }
+
+    free(topic);
+    free(data);
+    return 0;
+}
+
+#ifndef LIBFUZZER
+
+#define FUZZ_ITERATIONS 1000000
+#define FUZZ_MAX_INPUT  256
+
+static const char *corpus[][2] = {
+    {"device/x3d/a1b2c3/cmd",                      "outdoor-temp -4.5"},
+    {"device/x3d/a1b2c3/cmd",                      "trace-start"},
+    {"device/x3d/a1b2c3/net-4/cmd",                "pair rf66xx"},
+    {"device/x3d/a1b2c3/net-5/cmd",                "device-status-short"},
+    {"device/x3d/a1b2c3/net-4/dest/3/cmd",         "read 22 17"},
+    {"device/x3d/a1b2c3/net-4/dest/0,1,2,15/cmd",  "write 22 17 38 40 42 36"},
+    {"device/x3d/a1b2c3/net-5/dest/7/cmd",         "enable timed 21.5 120"},
+    {"device/x3d/a1b2c3/net-5/dest/7,9/cmd",       "enable custom 19"},
+};
+
+static size_t fuzz_input(uint8_t *input, const char *topic, const char *data)
+{
+    size_t topic_len = strlen(topic);
+    size_t data_len  = strlen(data);
+    input[0]         = topic_len;
+    memcpy(&input[1], topic, topic_len);
+    memcpy(&input[1 + topic_len], data, data_len);
+    return 1 + topic_len + data_len;
+}
+
+static size_t fuzz_mutate(uint8_t *input, size_t size)
+{
+    static const char tokens[] = "0123456789 ,./-abcdefnprstuvwx\r\n";
+    int mutations              = 1 + rand() % 4;
+    for (int m = 0; m < mutations; m++)
+    {
+        size_t pos = 1 + rand() % (size > 1 ? size - 1 : 1);
+        switch (rand() % 5)
+        {
+            case 0: // replace by interesting character
+                input[pos] = tokens[rand() % (sizeof(tokens) - 1)];
+                break;
+            case 1: // random byte
+                input[pos] = rand();
+                break;
+            case 2: // insert
+                if (size < FUZZ_MAX_INPUT)
+                {
+                    memmove(&input[pos + 1], &input[pos], size - pos);
+                    input[pos] = tokens[rand() % (sizeof(tokens) - 1)];
+                    size++;
+                }
+                break;
+            case 3: // delete
+                if (size > 2)
+                {
+                    memmove(&input[pos], &input[pos + 1], size - pos - 1);
+                    size--;
+                }
+                break;
+            default: // move the split between topic and payload
+                input[0] += rand() % 5 - 2;
+                break;
+        }
+    }
+    return size;
+}
+
+int main(int argc, char **argv)
+{
+    uint8_t input[FUZZ_MAX_INPUT + 1];
+
+    // replay files
+    if (argc > 1)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            FILE *f = fopen(argv[i], "rb");
+            if (f == NULL)
+            {
+                perror(argv[i]);
+                return 1;
+            }
+            size_t size = fread(input, 1, sizeof(input), f);
+            fclose(f);
+            LLVMFuzzerTestOneInput(input, size);
+        }
+        printf("%d inputs replayed\n", argc - 1);
+        return 0;
+    }
+
+    srand(1);
+    int accepted = 0;
+    for (int i = 0; i < FUZZ_ITERATIONS; i++)
+    {
+        const char **seed = corpus[i % (sizeof(corpus) / sizeof(corpus[0]))];
+        size_t size       = fuzz_input(input, seed[0], seed[1]);
+        size              = fuzz_mutate(input, size);
+
+        mqtt_command_t command;
+        size_t topic_len = input[0] < size - 1 ? input[0] : size - 1;
+        accepted += mqtt_router_parse(prefix, sizeof(prefix) - 1, (char *)&input[1], topic_len, (char *)&input[1 + topic_len], size - 1 - topic_len, &command);
+        LLVMFuzzerTestOneInput(input, size);
+    }
+    printf("%d mutated inputs, %d accepted, no check failed\n", FUZZ_ITERATIONS, accepted);
+    return 0;
+}
+
+#endif
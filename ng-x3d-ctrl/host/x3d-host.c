@@ -0,0 +1,577 @@
+/**
+ * @file x3d-host.c
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief runs the controller transaction handler against simulated mesh devices on the host
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "x3d.h"
+#include "x3d_capture.h"
+#include "x3d_device.h"
+#include "x3d_handler.h"
+#include "x3d_payload.h"
+#include "x3d_airtime.h"
+#include "x3d_topology.h"
+#include "x3d_trace.h"
+
+#include "host_mesh.h"
+#include "host_replay.h"
+#include "host_sim.h"
+
+#define HOST_DEVICE_ID 0x123456
+#define HOST_NETWORK   4
+
+// initiator of the foreign transactions, like a Tydom on the network
+#define HOST_FOREIGN_DEVICE_ID 0x654321
+
+// set point written by the foreign initiator, 20.5 °C in 0.5 °C steps
+#define HOST_FOREIGN_SET_POINT 0x29
+
+// result payload buffer as in main.c
+#define HOST_RESULT_PAYLOAD_SIZE 256
+
+// expected output of a replay
+static FILE *expected_file     = NULL;
+static int expected_mismatches = 0;
+
+static void trace_write_file(void *ctx, const char *data, size_t len)
+{
+    fwrite(data, 1, len, (FILE *)ctx);
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [options]\n"
+                    "  -a read|write|temp|pair|foreign  transaction type, default read, foreign replays a room temperature\n"
+                    "                      read and a set point write of another initiator and checks the mirrored devices\n"
+                    "  -m mask             slot mask of simulated devices, default 0x0003\n"
+                    "  -x mask             transfer mask, default the simulated devices\n"
+                    "  -t mask             target mask, default the transfer mask\n"
+                    "  -r reg              register, default 0x1511\n"
+                    "  -v value            value to write\n"
+                    "  -n count            number of transactions, default 1\n"
+                    "  -l pct              probability a device misses a request\n"
+                    "  -c pct              probability a response frame is corrupted\n"
+                    "  -p count            number of devices in pairing mode\n"
+                    "  -L range            devices form a chain in slot order, each reaches the next range devices\n"
+                    "  -T                  print the topology inferred from the relays\n"
+                    "  -A                  print the airtime per initiator and message type\n"
+                    "  -s seed             random seed\n"
+                    "  -o file             write Chrome trace JSON\n"
+                    "  -w file             record the frames on air to a capture\n"
+                    "  -R file             replay the transactions of a capture instead of simulated devices\n"
+                    "  -f                  replay without the idle time between transactions\n"
+                    "  -e file             compare the replay results with the output of the recording run\n",
+            name);
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief Prints a result line and compares it with the next result line of the expected output.
+ * The elapsed time is not compared, it includes the wait for free air before the transaction.
+ *
+ * @param line result line
+ */
+static void emit_result(const char *line)
+{
+    fputs(line, stdout);
+    if (expected_file == NULL)
+    {
+        return;
+    }
+
+    char expected[512] = "";
+    while (fgets(expected, sizeof(expected), expected_file) != NULL && expected[0] != '#')
+    {
+    }
+    const char *result = strstr(line, " ms");
+    const char *other  = expected[0] == '#' ? strstr(expected, " ms") : NULL;
+    if (other == NULL || atoi(&line[1]) != atoi(&expected[1]) || strcmp(result, other) != 0)
+    {
+        expected_mismatches++;
+        fprintf(stderr, "expected %sreplayed %s", other != NULL ? expected : "no result\n", line);
+    }
+}
+
+static void print_result(int no, uint64_t start, x3d_standard_msg_payload_t *payload, uint16_t target)
+{
+    char line[256];
+    int len = snprintf(line, sizeof(line), "#%d %6lu ms ack 0x%04x/0x%04x", no, (unsigned long)((host_sim_now() - start) / 1000),
+            payload->target_ack, target);
+    for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+    {
+        if (payload->target_ack & (1 << i))
+        {
+            len += snprintf(&line[len], sizeof(line) - len, " %d:0x%04x", i, payload->data[i]);
+        }
+    }
+    snprintf(&line[len], sizeof(line) - len, "\n");
+    emit_result(line);
+}
+
+static void print_pair_result(int no, uint64_t start, int slot, uint16_t transfer)
+{
+    char line[64];
+    snprintf(line, sizeof(line), "#%d %6lu ms slot %d transfer 0x%04x\n", no, (unsigned long)((host_sim_now() - start) / 1000), slot, transfer);
+    emit_result(line);
+}
+
+static void print_elapsed(int no, uint64_t start)
+{
+    char line[64];
+    snprintf(line, sizeof(line), "#%d %6lu ms\n", no, (unsigned long)((host_sim_now() - start) / 1000));
+    emit_result(line);
+}
+
+static void print_pairing(const x3d_pairing_progress_t *progress)
+{
+    static const char *const phases[] = {"open", "pin", "pinned", "done", "failed"};
+    printf("   %6lu ms %-6s slot %d pin 0x%04x pins %d\n", (unsigned long)progress->elapsed_ms, phases[progress->phase],
+            progress->slot, progress->pin, progress->pins);
+}
+
+// devices mirrored from the foreign transactions as in main.c
+static x3d_device_store_t foreign_store;
+static uint32_t foreign_read_time[X3D_MAX_NET_DEVICES][X3D_DEVICE_FIELDS];
+static uint32_t foreign_now;
+static uint16_t foreign_acked;
+
+static void foreign_result(uint8_t network, const x3d_standard_msg_payload_t *payload, uint16_t acked)
+{
+    if (network != HOST_NETWORK)
+    {
+        printf("foreign result of unknown net %d\n", network);
+        return;
+    }
+    foreign_acked |= acked;
+    x3d_device_apply_register(&foreign_store, foreign_read_time, foreign_now, payload, acked);
+}
+
+/**
+ * @brief Sends a register transaction of the foreign initiator to the simulated devices, the handler only listens
+ *
+ * @param transfer transfer mask
+ * @param target target mask
+ * @param reg register
+ * @param values values to write, NULL to read
+ * @return uint16_t targets reported by the handler
+ */
+static uint16_t foreign_transaction(uint16_t transfer, uint16_t target, uint16_t reg, uint16_t *values)
+{
+    static uint8_t msg_no  = 0;
+    static uint16_t msg_id = 0x100;
+    uint8_t ext_header[]   = {0x98, X3D_HEADER_EXT_NONE};
+    uint8_t frame[65]      = {0};
+    x3d_init_message(frame, HOST_FOREIGN_DEVICE_ID, 0x80 | HOST_NETWORK);
+    int payload_index = x3d_prepare_message_header(frame, &msg_no, X3D_MSG_TYPE_STANDARD, 0, 0x05, ext_header, sizeof(ext_header),
+            x3d_enc_msg_id(&msg_id, HOST_FOREIGN_DEVICE_ID));
+    x3d_set_message_retrans(frame, payload_index, 0, transfer);
+    if (values != NULL)
+    {
+        x3d_set_register_write(frame, payload_index, target, X3D_REG_H(reg), X3D_REG_L(reg), values);
+    }
+    else
+    {
+        x3d_set_register_read(frame, payload_index, target, X3D_REG_H(reg), X3D_REG_L(reg));
+    }
+    x3d_set_crc(frame);
+
+    // only the last frame of the countdown, the devices answer it
+    uint64_t end_ts = host_sim_now() + host_sim_airtime(frame[X3D_IDX_PKT_LEN]);
+    foreign_acked   = 0;
+    host_sim_schedule(end_ts, frame);
+    host_mesh_on_transmit(frame, end_ts);
+    host_sim_flush();
+    return foreign_acked;
+}
+
+/**
+ * @brief Replays a room temperature read and a set point write of a foreign initiator, the handler merges their
+ * frames and the results are mirrored into the devices as in main.c
+ *
+ * @param present simulated devices
+ * @return bool true if every device and its read time were updated
+ */
+static bool foreign_check(uint16_t present)
+{
+    x3d_set_foreign_callback(foreign_result);
+    memset(&foreign_store, 0, sizeof(foreign_store));
+    memset(foreign_read_time, 0, sizeof(foreign_read_time));
+    for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+    {
+        if (present & (1 << i))
+        {
+            x3d_device_set_type(&foreign_store, i, X3D_DEVICE_TYPE_RF66XX);
+        }
+    }
+
+    bool ok        = true;
+    foreign_now    = 100;
+    uint16_t acked = foreign_transaction(present, present, X3D_REG_ROOM_TEMP, NULL);
+    printf("foreign read  0x%04x ack 0x%04x/0x%04x\n", X3D_REG_ROOM_TEMP, acked, present);
+    ok &= acked == present;
+    for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+    {
+        if (present & (1 << i))
+        {
+            uint16_t expected = host_mesh_register(i, X3D_REG_ROOM_TEMP);
+            uint32_t time     = foreign_read_time[i][X3D_DEVICE_FIELD_ROOM_TEMP];
+            printf(" %d: room temp 0x%04x/0x%04x read at %lu\n", i, foreign_store.room_temp[i], expected, (unsigned long)time);
+            ok &= foreign_store.room_temp[i] == expected && time == foreign_now;
+        }
+    }
+
+    foreign_now = 200;
+    uint16_t values[X3D_MAX_PAYLOAD_DATA_FIELDS];
+    for (int i = 0; i < X3D_MAX_PAYLOAD_DATA_FIELDS; i++)
+    {
+        values[i] = HOST_FOREIGN_SET_POINT;
+    }
+    acked = foreign_transaction(present, present, X3D_REG_SET_MODE_TEMP, values);
+    printf("foreign write 0x%04x ack 0x%04x/0x%04x\n", X3D_REG_SET_MODE_TEMP, acked, present);
+    ok &= acked == present;
+    for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+    {
+        if (present & (1 << i))
+        {
+            // the written register has no status field, the read time of the room temperature is kept
+            printf(" %d: set point 0x%02x/0x%02x\n", i, foreign_store.set_point[i], HOST_FOREIGN_SET_POINT);
+            ok &= foreign_store.set_point[i] == HOST_FOREIGN_SET_POINT && foreign_read_time[i][X3D_DEVICE_FIELD_ROOM_TEMP] == 100;
+        }
+    }
+    printf("foreign %s\n", ok ? "ok" : "failed");
+    x3d_set_foreign_callback(NULL);
+    return ok;
+}
+
+/**
+ * @brief Prints the inferred links, the rate a device hears the others in % and the derived transaction parameters
+ *
+ * @param network network number
+ * @param transfer transfer mask
+ */
+static void print_topology(uint8_t network, uint16_t transfer)
+{
+    printf("topology depth %d wait %lu ms transmissions %d\n", x3d_topology_depth(network, transfer),
+            (unsigned long)x3d_topology_wait_ms(network, transfer, 0), x3d_topology_retry_count(network, transfer, 0));
+    printf("slot depth  rssi station hears\n");
+    for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+    {
+        x3d_topology_row_t row;
+        if ((transfer & (1 << i)) == 0 || !x3d_topology_get_row(network, i, &row))
+        {
+            continue;
+        }
+        printf("%4d %5d %5d %7d", row.slot, row.depth == X3D_TOPOLOGY_DEPTH_UNKNOWN ? -1 : row.depth, row.rssi, row.station);
+        for (int j = 0; j < X3D_MAX_NET_DEVICES; j++)
+        {
+            if (row.hears[j] != X3D_TOPOLOGY_RATE_UNKNOWN)
+            {
+                printf(" %d:%d", j, row.hears[j]);
+            }
+        }
+        printf("\n");
+    }
+}
+
+/**
+ * @brief Prints the airtime statistics, the duty cycles in %
+ */
+static void print_airtime(void)
+{
+    x3d_airtime_entry_t entries[X3D_AIRTIME_ENTRIES];
+    x3d_airtime_summary_t summary;
+    int count        = x3d_airtime_get(entries, X3D_AIRTIME_ENTRIES, &summary);
+    uint32_t channel = x3d_airtime_duty(summary.channel_us, summary.window_s);
+    uint32_t tx      = x3d_airtime_duty(summary.tx_us, summary.window_s);
+    printf("airtime window %lu s channel %lu.%02lu %% tx %lu.%02lu %% evicted %lu overflow %lu\n", (unsigned long)summary.window_s,
+            (unsigned long)channel / 100, (unsigned long)channel % 100, (unsigned long)tx / 100, (unsigned long)tx % 100,
+            (unsigned long)summary.evicted, (unsigned long)summary.overflow);
+    printf("initiator type tx frames  bytes airtime_ms  duty\n");
+    for (int i = 0; i < count; i++)
+    {
+        uint32_t duty = x3d_airtime_duty(entries[i].window_us, summary.window_s);
+        printf(" %08lx %4d %2d %6lu %6lu %10lu %2lu.%02lu\n", (unsigned long)entries[i].device_id, entries[i].msg_type == 0xff ? -1 : entries[i].msg_type,
+                entries[i].tx, (unsigned long)entries[i].frames, (unsigned long)entries[i].bytes, (unsigned long)(entries[i].airtime_us / 1000),
+                (unsigned long)duty / 100, (unsigned long)duty % 100);
+    }
+}
+
+/**
+ * @brief Replays the transactions of a capture and publishes the results with the payload encoder of the controller
+ *
+ * @param path capture file
+ * @param fast skip the idle time between transactions
+ * @return int 0 if all frames of the handler match the recorded ones
+ */
+static int replay(const char *path, bool fast)
+{
+    if (host_replay_open(path, fast) != 0)
+    {
+        perror(path);
+        return 1;
+    }
+    host_mesh_enable(false);
+    x3d_set_device_id(host_replay_device_id());
+
+    char payload_buffer[HOST_RESULT_PAYLOAD_SIZE];
+    uint64_t published = 0;
+    uint64_t wall      = now_ns();
+    host_replay_transaction_t transaction;
+    for (int i = 0; host_replay_next(&transaction); i++)
+    {
+        uint64_t start                      = host_sim_now();
+        x3d_standard_msg_payload_t *payload = NULL;
+        x3d_schema_action_t action          = X3D_SCHEMA_ACTION_READ;
+        switch (transaction.action)
+        {
+        case HOST_REPLAY_READ:
+        {
+            x3d_read_data_t data = {transaction.network, transaction.transfer, transaction.target,
+                                    transaction.register_high, transaction.register_low};
+            payload              = x3d_reading_proc(&data);
+            break;
+        }
+        case HOST_REPLAY_WRITE:
+        {
+            x3d_write_data_t data = {transaction.network, transaction.transfer, transaction.target,
+                                     transaction.register_high, transaction.register_low};
+            memcpy(data.values, transaction.values, sizeof(data.values));
+            payload = x3d_writing_proc(&data);
+            action  = X3D_SCHEMA_ACTION_WRITE;
+            break;
+        }
+        case HOST_REPLAY_TEMP:
+        {
+            x3d_temp_data_t data = {transaction.network, transaction.transfer, transaction.target, transaction.outdoor, transaction.temp};
+            x3d_temp_proc(&data);
+            print_elapsed(i, start);
+            break;
+        }
+        case HOST_REPLAY_PAIR:
+        {
+            x3d_pairing_data_t data = {transaction.network, transaction.transfer, print_pairing};
+            int slot                = x3d_pairing_proc(&data);
+            print_pair_result(i, start, slot, data.transfer);
+            break;
+        }
+        case HOST_REPLAY_UNPAIR:
+        {
+            x3d_unpairing_data_t data = {transaction.network, transaction.transfer, transaction.target};
+            x3d_unpairing_proc(&data);
+            print_pair_result(i, start, -1, data.transfer);
+            break;
+        }
+        }
+
+        if (payload != NULL)
+        {
+            print_result(i, start, payload, transaction.target);
+            int len = x3d_payload_result_json(action, transaction.network, payload, payload_buffer, sizeof(payload_buffer));
+            if (len > 0)
+            {
+                published += len;
+            }
+        }
+    }
+    host_sim_flush();
+    uint64_t ns = now_ns() - wall;
+
+    // results of the recording run which were not replayed
+    char line[512];
+    while (expected_file != NULL && fgets(line, sizeof(line), expected_file) != NULL)
+    {
+        if (line[0] == '#')
+        {
+            expected_mismatches++;
+            fprintf(stderr, "expected %sreplayed no result\n", line);
+        }
+    }
+
+    host_replay_stats_t stats;
+    host_replay_close(&stats);
+    uint32_t frames = stats.tx_frames + stats.rx_frames;
+    fprintf(stderr, "%" PRIu32 " transactions, %" PRIu32 " frames sent, %" PRIu32 " differ from the capture, %" PRIu32 " recorded not sent, "
+            "%" PRIu32 " frames received, %" PRIu32 " skipped, %d results differ\n",
+            stats.transactions, stats.tx_frames, stats.tx_mismatch, stats.tx_missing, stats.rx_frames, stats.skipped, expected_mismatches);
+    fprintf(stderr, "%.1f s on air replayed in %.1f ms, %.0f frames/s, %.0f transactions/s, %" PRIu64 " bytes published\n",
+            host_sim_now() / 1e6, ns / 1e6, frames * 1e9 / ns, stats.transactions * 1e9 / ns, published);
+    return stats.tx_mismatch == 0 && stats.tx_missing == 0 && expected_mismatches == 0 ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    host_mesh_config_t mesh = {.present = 0x0003};
+    const char *action      = "read";
+    const char *trace_file  = NULL;
+    const char *capture     = NULL;
+    const char *replay_file = NULL;
+    const char *expected    = NULL;
+    bool fast               = false;
+    int transfer            = -1;
+    int target              = -1;
+    uint16_t reg            = X3D_REG_ROOM_TEMP;
+    uint16_t value          = 0;
+    int count               = 1;
+    bool topology           = false;
+    bool airtime            = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "a:m:x:t:r:v:n:l:c:p:L:TAs:o:w:R:fe:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'a': action = optarg; break;
+        case 'm': mesh.present = strtoul(optarg, NULL, 0); break;
+        case 'x': transfer = strtoul(optarg, NULL, 0); break;
+        case 't': target = strtoul(optarg, NULL, 0); break;
+        case 'r': reg = strtoul(optarg, NULL, 0); break;
+        case 'v': value = strtoul(optarg, NULL, 0); break;
+        case 'n': count = atoi(optarg); break;
+        case 'l': mesh.miss_pct = atoi(optarg); break;
+        case 'c': mesh.crc_error_pct = atoi(optarg); break;
+        case 'p': mesh.pairing = atoi(optarg); break;
+        case 'L': mesh.range = atoi(optarg); break;
+        case 'T': topology = true; break;
+        case 'A': airtime = true; break;
+        case 's': mesh.seed = strtoul(optarg, NULL, 0); break;
+        case 'o': trace_file = optarg; break;
+        case 'w': capture = optarg; break;
+        case 'R': replay_file = optarg; break;
+        case 'f': fast = true; break;
+        case 'e': expected = optarg; break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (transfer < 0)
+    {
+        transfer = mesh.present;
+    }
+    if (target < 0)
+    {
+        target = transfer;
+    }
+
+    host_sim_reset();
+    host_mesh_init(&mesh);
+    x3d_set_device_id(HOST_DEVICE_ID);
+    x3d_trace_enable(true);
+
+    x3d_capture_writer_t writer;
+    if (capture != NULL)
+    {
+        if (x3d_capture_writer_open(&writer, capture, false) != 0)
+        {
+            perror(capture);
+            return 1;
+        }
+        host_rfm_record(&writer);
+    }
+    if (expected != NULL && (expected_file = fopen(expected, "r")) == NULL)
+    {
+        perror(expected);
+        return 1;
+    }
+
+    int res = 0;
+    for (int i = 0; replay_file == NULL && i < count; i++)
+    {
+        uint64_t start = host_sim_now();
+        if (strcmp(action, "read") == 0)
+        {
+            x3d_read_data_t data = {HOST_NETWORK, transfer, target, X3D_REG_H(reg), X3D_REG_L(reg)};
+            print_result(i, start, x3d_reading_proc(&data), target);
+        }
+        else if (strcmp(action, "write") == 0)
+        {
+            x3d_write_data_t data = {HOST_NETWORK, transfer, target, X3D_REG_H(reg), X3D_REG_L(reg)};
+            for (int j = 0; j < X3D_MAX_PAYLOAD_DATA_FIELDS; j++)
+            {
+                data.values[j] = value;
+            }
+            print_result(i, start, x3d_writing_proc(&data), target);
+        }
+        else if (strcmp(action, "pair") == 0)
+        {
+            x3d_pairing_data_t data = {HOST_NETWORK, transfer, print_pairing};
+            int slot                = x3d_pairing_proc(&data);
+            print_pair_result(i, start, slot, data.transfer);
+            transfer = data.transfer;
+        }
+        else if (strcmp(action, "foreign") == 0)
+        {
+            res |= foreign_check(mesh.present) ? 0 : 1;
+        }
+        else if (strcmp(action, "temp") == 0)
+        {
+            x3d_temp_data_t data = {HOST_NETWORK, transfer, target, X3D_HEADER_EXT_TEMP_ROOM, value};
+            x3d_temp_proc(&data);
+            print_elapsed(i, start);
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+
+        // let the mesh finish before the next transaction
+        host_sim_flush();
+    }
+    if (replay_file != NULL)
+    {
+        res = replay(replay_file, fast);
+    }
+    if (topology)
+    {
+        print_topology(HOST_NETWORK, transfer);
+    }
+    if (airtime)
+    {
+        print_airtime();
+    }
+
+    if (capture != NULL)
+    {
+        host_rfm_record(NULL);
+        if (x3d_capture_writer_close(&writer) != 0)
+        {
+            perror(capture);
+            return 1;
+        }
+    }
+    if (expected_file != NULL)
+    {
+        fclose(expected_file);
+    }
+
+    if (trace_file != NULL)
+    {
+        FILE *f = fopen(trace_file, "w");
+        if (f == NULL)
+        {
+            perror(trace_file);
+            return 1;
+        }
+        x3d_trace_export(trace_write_file, f);
+        fclose(f);
+    }
+    return res;
+}
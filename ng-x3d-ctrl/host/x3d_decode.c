@@ -0,0 +1,259 @@
+/**
+ * @file x3d_decode.c
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief host side decoder of the CBOR device status and result payloads
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <stdbool.h>
+#include <string.h>
+
+#include "cbor_writer.h"
+#include "x3d_decode.h"
+
+// nesting limit when skipping unknown values
+#define CBOR_MAX_DEPTH 8
+
+typedef struct {
+    const uint8_t *data;
+    size_t len;
+    size_t pos;
+} cbor_reader_t;
+
+/**
+ * @brief Reads the initial byte and argument of a data item
+ *
+ * @param reader pointer to reader state
+ * @param major major type
+ * @param value argument, simple value for major type 7
+ * @return bool false if truncated or indefinite length
+ */
+static bool cbor_read_head(cbor_reader_t *reader, uint8_t *major, uint32_t *value)
+{
+    if (reader->pos >= reader->len)
+    {
+        return false;
+    }
+    uint8_t head = reader->data[reader->pos++];
+    uint8_t info = head & 0x1f;
+    *major       = head >> 5;
+
+    size_t bytes;
+    if (info < 24)
+    {
+        *value = info;
+        return true;
+    }
+    switch (info)
+    {
+        case 24: bytes = 1; break;
+        case 25: bytes = 2; break;
+        case 26: bytes = 4; break;
+        default: return false; // 64 bit and indefinite length are not used by the schema
+    }
+    if (reader->len - reader->pos < bytes)
+    {
+        return false;
+    }
+    *value = 0;
+    for (size_t i = 0; i < bytes; i++)
+    {
+        *value = (*value << 8) | reader->data[reader->pos++];
+    }
+    return true;
+}
+
+static bool cbor_read_uint(cbor_reader_t *reader, uint32_t *value)
+{
+    uint8_t major;
+    return cbor_read_head(reader, &major, value) && major == CBOR_MAJOR_UINT;
+}
+
+/**
+ * @brief Skips a complete data item including nested items
+ *
+ * @param reader pointer to reader state
+ * @param depth current nesting depth
+ * @return bool false if malformed
+ */
+static bool cbor_skip(cbor_reader_t *reader, int depth)
+{
+    uint8_t major;
+    uint32_t value;
+    if (depth > CBOR_MAX_DEPTH || !cbor_read_head(reader, &major, &value))
+    {
+        return false;
+    }
+    switch (major)
+    {
+        case CBOR_MAJOR_BYTES:
+        case CBOR_MAJOR_TEXT:
+            if (reader->len - reader->pos < value)
+            {
+                return false;
+            }
+            reader->pos += value;
+            return true;
+        case CBOR_MAJOR_MAP:
+            if (value > (reader->len - reader->pos) / 2)
+            {
+                return false;
+            }
+            value *= 2;
+            // fall through
+        case CBOR_MAJOR_ARRAY:
+            for (uint32_t i = 0; i < value; i++)
+            {
+                if (!cbor_skip(reader, depth + 1))
+                {
+                    return false;
+                }
+            }
+            return true;
+        case CBOR_MAJOR_TAG:
+            return cbor_skip(reader, depth + 1);
+        default:
+            return true;
+    }
+}
+
+int x3d_decode_device(const uint8_t *data, size_t len, x3d_device_store_t *store, uint8_t slot)
+{
+    x3d_device_set_type(store, slot, X3D_DEVICE_TYPE_NONE);
+    if (len == 0)
+    {
+        // cleared topic of a removed device
+        return 0;
+    }
+
+    cbor_reader_t reader = {.data = data, .len = len};
+    uint8_t major;
+    uint32_t count;
+    if (!cbor_read_head(&reader, &major, &count) || major != CBOR_MAJOR_MAP)
+    {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t key, value;
+        if (!cbor_read_uint(&reader, &key))
+        {
+            return -1;
+        }
+        if (key > X3D_SCHEMA_DEVICE_FLAGS)
+        {
+            if (!cbor_skip(&reader, 0))
+            {
+                return -1;
+            }
+            continue;
+        }
+        if (!cbor_read_uint(&reader, &value))
+        {
+            return -1;
+        }
+        switch (key)
+        {
+            case X3D_SCHEMA_DEVICE_TYPE:
+                store->type[slot] = value;
+                break;
+            case X3D_SCHEMA_DEVICE_ROOM_TEMP:
+                store->room_temp[slot] = value;
+                break;
+            case X3D_SCHEMA_DEVICE_POWER:
+                store->power[slot] = value;
+                break;
+            case X3D_SCHEMA_DEVICE_SET_POINT:
+                store->set_point[slot] = value;
+                break;
+            case X3D_SCHEMA_DEVICE_SET_POINT_DAY:
+                store->set_point_day[slot] = value;
+                break;
+            case X3D_SCHEMA_DEVICE_SET_POINT_NIGHT:
+                store->set_point_night[slot] = value;
+                break;
+            case X3D_SCHEMA_DEVICE_SET_POINT_DEFROST:
+                store->set_point_defrost[slot] = value;
+                break;
+            case X3D_SCHEMA_DEVICE_FLAGS:
+                store->flags[slot] = value;
+                break;
+        }
+    }
+    return 0;
+}
+
+int x3d_decode_result(const uint8_t *data, size_t len, x3d_schema_action_t *action, uint8_t *network, x3d_standard_msg_payload_t *payload)
+{
+    memset(payload, 0, sizeof(x3d_standard_msg_payload_t));
+
+    cbor_reader_t reader = {.data = data, .len = len};
+    uint8_t major;
+    uint32_t count;
+    if (!cbor_read_head(&reader, &major, &count) || major != CBOR_MAJOR_MAP)
+    {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t key, value;
+        if (!cbor_read_uint(&reader, &key))
+        {
+            return -1;
+        }
+        if (key == X3D_SCHEMA_RESULT_VALUES)
+        {
+            uint32_t slots;
+            if (!cbor_read_head(&reader, &major, &slots) || major != CBOR_MAJOR_ARRAY || slots == 0 || slots > X3D_MAX_PAYLOAD_DATA_FIELDS)
+            {
+                return -1;
+            }
+            for (uint32_t s = 0; s < slots; s++)
+            {
+                if (!cbor_read_uint(&reader, &value))
+                {
+                    return -1;
+                }
+                payload->data[s] = value;
+            }
+            payload->action = (payload->action & 0x0f) | ((slots - 1) << 4);
+            continue;
+        }
+        if (key >= X3D_SCHEMA_RESULT_KEYS)
+        {
+            if (!cbor_skip(&reader, 0))
+            {
+                return -1;
+            }
+            continue;
+        }
+        if (!cbor_read_uint(&reader, &value))
+        {
+            return -1;
+        }
+        switch (key)
+        {
+            case X3D_SCHEMA_RESULT_ACTION:
+                *action = value;
+                break;
+            case X3D_SCHEMA_RESULT_NETWORK:
+                *network = value;
+                break;
+            case X3D_SCHEMA_RESULT_ACK:
+                payload->target_ack = value;
+                break;
+            case X3D_SCHEMA_RESULT_REG_HIGH:
+                payload->reg_high = value;
+                break;
+            case X3D_SCHEMA_RESULT_REG_LOW:
+                payload->reg_low = value;
+                break;
+        }
+    }
+    return 0;
+}
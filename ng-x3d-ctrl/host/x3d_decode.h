@@ -0,0 +1,41 @@
+/**
+ * @file x3d_decode.h
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief host side decoder of the CBOR device status and result payloads
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "x3d.h"
+#include "x3d_device.h"
+#include "x3d_schema.h"
+
+/**
+ * @brief Decodes a device status payload, unknown keys are skipped
+ *
+ * @param data payload
+ * @param len length of the payload
+ * @param store device store, the type is X3D_DEVICE_TYPE_NONE for an empty payload
+ * @param slot device slot to decode into
+ * @return int 0 on success, -1 on malformed payload
+ */
+int x3d_decode_device(const uint8_t *data, size_t len, x3d_device_store_t *store, uint8_t slot);
+
+/**
+ * @brief Decodes a read or write result payload, unknown keys are skipped
+ *
+ * @param data payload
+ * @param len length of the payload
+ * @param action decoded action
+ * @param network decoded network number
+ * @param payload decoded payload, the number of values is stored in the upper nibble of action like in the message
+ * @return int 0 on success, -1 on malformed payload
+ */
+int x3d_decode_result(const uint8_t *data, size_t len, x3d_schema_action_t *action, uint8_t *network, x3d_standard_msg_payload_t *payload);
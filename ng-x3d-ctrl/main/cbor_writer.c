@@ -0,0 +1,119 @@
+/**
+ * @file cbor_writer.c
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief allocation free CBOR (RFC 8949) writer into a fixed buffer
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <string.h>
+
+#include "cbor_writer.h"
+
+static void cbor_put(cbor_writer_t *writer, const uint8_t *data, size_t len)
+{
+    if (writer->overflow || writer->len + len > writer->size)
+    {
+        writer->overflow = true;
+        return;
+    }
+    memcpy(&writer->buffer[writer->len], data, len);
+    writer->len += len;
+}
+
+/**
+ * @brief Writes the initial byte with the shortest argument encoding
+ *
+ * @param writer pointer to writer state
+ * @param major major type
+ * @param value argument
+ */
+static void cbor_put_head(cbor_writer_t *writer, cbor_major_t major, uint32_t value)
+{
+    uint8_t head[5];
+    size_t len = 1;
+    head[0]    = major << 5;
+    if (value < 24)
+    {
+        head[0] |= value;
+    }
+    else if (value <= 0xff)
+    {
+        head[0] |= 24;
+        head[1]  = value;
+        len      = 2;
+    }
+    else if (value <= 0xffff)
+    {
+        head[0] |= 25;
+        head[1]  = value >> 8;
+        head[2]  = value;
+        len      = 3;
+    }
+    else
+    {
+        head[0] |= 26;
+        head[1]  = value >> 24;
+        head[2]  = value >> 16;
+        head[3]  = value >> 8;
+        head[4]  = value;
+        len      = 5;
+    }
+    cbor_put(writer, head, len);
+}
+
+void cbor_writer_init(cbor_writer_t *writer, uint8_t *buffer, size_t size)
+{
+    writer->buffer   = buffer;
+    writer->size     = size;
+    writer->len      = 0;
+    writer->overflow = false;
+}
+
+void cbor_writer_map(cbor_writer_t *writer, uint32_t count)
+{
+    cbor_put_head(writer, CBOR_MAJOR_MAP, count);
+}
+
+void cbor_writer_array(cbor_writer_t *writer, uint32_t count)
+{
+    cbor_put_head(writer, CBOR_MAJOR_ARRAY, count);
+}
+
+void cbor_writer_uint(cbor_writer_t *writer, uint32_t value)
+{
+    cbor_put_head(writer, CBOR_MAJOR_UINT, value);
+}
+
+void cbor_writer_int(cbor_writer_t *writer, int32_t value)
+{
+    if (value < 0)
+    {
+        // negative integers are encoded as -1 - n
+        cbor_put_head(writer, CBOR_MAJOR_NEGINT, (uint32_t)(-1 - value));
+    }
+    else
+    {
+        cbor_put_head(writer, CBOR_MAJOR_UINT, value);
+    }
+}
+
+void cbor_writer_bool(cbor_writer_t *writer, bool value)
+{
+    uint8_t simple = value ? CBOR_TRUE : CBOR_FALSE;
+    cbor_put(writer, &simple, 1);
+}
+
+void cbor_writer_text(cbor_writer_t *writer, const char *value)
+{
+    size_t len = strlen(value);
+    cbor_put_head(writer, CBOR_MAJOR_TEXT, len);
+    cbor_put(writer, (const uint8_t *)value, len);
+}
+
+int cbor_writer_length(cbor_writer_t *writer)
+{
+    return writer->overflow ? -1 : (int)writer->len;
+}
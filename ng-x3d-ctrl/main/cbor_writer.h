@@ -0,0 +1,103 @@
+/**
+ * @file cbor_writer.h
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief allocation free CBOR (RFC 8949) writer into a fixed buffer
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// @brief CBOR major types
+typedef enum {
+    CBOR_MAJOR_UINT   = 0,
+    CBOR_MAJOR_NEGINT = 1,
+    CBOR_MAJOR_BYTES  = 2,
+    CBOR_MAJOR_TEXT   = 3,
+    CBOR_MAJOR_ARRAY  = 4,
+    CBOR_MAJOR_MAP    = 5,
+    CBOR_MAJOR_TAG    = 6,
+    CBOR_MAJOR_SIMPLE = 7,
+} cbor_major_t;
+
+#define CBOR_FALSE 0xf4
+#define CBOR_TRUE  0xf5
+
+/// @brief Writer state, containers have a definite length
+typedef struct {
+    uint8_t *buffer;
+    size_t size;
+    size_t len;
+    bool overflow; ///< buffer was too small, output is invalid
+} cbor_writer_t;
+
+/**
+ * @brief Initialize the writer
+ *
+ * @param writer pointer to writer state
+ * @param buffer output buffer
+ * @param size size of the output buffer
+ */
+void cbor_writer_init(cbor_writer_t *writer, uint8_t *buffer, size_t size);
+
+/**
+ * @brief Starts a map, followed by count key value pairs
+ *
+ * @param writer pointer to writer state
+ * @param count number of pairs
+ */
+void cbor_writer_map(cbor_writer_t *writer, uint32_t count);
+
+/**
+ * @brief Starts an array, followed by count items
+ *
+ * @param writer pointer to writer state
+ * @param count number of items
+ */
+void cbor_writer_array(cbor_writer_t *writer, uint32_t count);
+
+/**
+ * @brief Writes an unsigned integer, also used for map keys
+ *
+ * @param writer pointer to writer state
+ * @param value integer
+ */
+void cbor_writer_uint(cbor_writer_t *writer, uint32_t value);
+
+/**
+ * @brief Writes a signed integer
+ *
+ * @param writer pointer to writer state
+ * @param value integer
+ */
+void cbor_writer_int(cbor_writer_t *writer, int32_t value);
+
+/**
+ * @brief Writes a boolean
+ *
+ * @param writer pointer to writer state
+ * @param value boolean
+ */
+void cbor_writer_bool(cbor_writer_t *writer, bool value);
+
+/**
+ * @brief Writes a text string
+ *
+ * @param writer pointer to writer state
+ * @param value string
+ */
+void cbor_writer_text(cbor_writer_t *writer, const char *value);
+
+/**
+ * @brief Returns the length of the output
+ *
+ * @param writer pointer to writer state
+ * @return int length of the output, -1 if the buffer was too small
+ */
+int cbor_writer_length(cbor_writer_t *writer);
@@ -0,0 +1,195 @@
+/**
+ * @file json_writer.c
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief allocation free streaming JSON writer into a fixed buffer
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <string.h>
+
+#include "json_writer.h"
+
+static const uint32_t json_pow10[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+static void json_put(json_writer_t *writer, const char *data, size_t len)
+{
+    if (writer->overflow || writer->len + len >= writer->size)
+    {
+        writer->overflow = true;
+        return;
+    }
+    memcpy(&writer->buffer[writer->len], data, len);
+    writer->len += len;
+    writer->buffer[writer->len] = '\0';
+}
+
+static inline void json_put_char(json_writer_t *writer, char c)
+{
+    json_put(writer, &c, 1);
+}
+
+static void json_put_escaped(json_writer_t *writer, const char *value)
+{
+    static const char hex[] = "0123456789abcdef";
+    json_put_char(writer, '"');
+    for (const char *p = value; *p != '\0'; p++)
+    {
+        unsigned char c = *p;
+        if (c == '"' || c == '\\')
+        {
+            char esc[2] = {'\\', c};
+            json_put(writer, esc, 2);
+        }
+        else if (c < 0x20)
+        {
+            char esc[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0x0f]};
+            json_put(writer, esc, 6);
+        }
+        else
+        {
+            json_put_char(writer, c);
+        }
+    }
+    json_put_char(writer, '"');
+}
+
+static void json_put_uint(json_writer_t *writer, uint32_t value, int min_digits)
+{
+    char digits[10];
+    int pos = sizeof(digits);
+    do
+    {
+        digits[--pos] = '0' + value % 10;
+        value /= 10;
+        min_digits--;
+    } while (value != 0 || min_digits > 0);
+    json_put(writer, &digits[pos], sizeof(digits) - pos);
+}
+
+/**
+ * @brief Writes the separator and the key in front of a value
+ *
+ * @param writer pointer to writer state
+ * @param key key in the parent object, NULL for root or array item
+ */
+static void json_put_key(json_writer_t *writer, const char *key)
+{
+    if (!writer->first)
+    {
+        json_put_char(writer, ',');
+    }
+    writer->first = false;
+    if (key != NULL)
+    {
+        json_put_escaped(writer, key);
+        json_put_char(writer, ':');
+    }
+}
+
+void json_writer_init(json_writer_t *writer, char *buffer, size_t size)
+{
+    writer->buffer   = buffer;
+    writer->size     = size;
+    writer->len      = 0;
+    writer->first    = true;
+    writer->overflow = size == 0;
+    if (size > 0)
+    {
+        buffer[0] = '\0';
+    }
+}
+
+void json_writer_object_begin(json_writer_t *writer, const char *key)
+{
+    json_put_key(writer, key);
+    json_put_char(writer, '{');
+    writer->first = true;
+}
+
+void json_writer_object_end(json_writer_t *writer)
+{
+    json_put_char(writer, '}');
+    writer->first = false;
+}
+
+void json_writer_array_begin(json_writer_t *writer, const char *key)
+{
+    json_put_key(writer, key);
+    json_put_char(writer, '[');
+    writer->first = true;
+}
+
+void json_writer_array_end(json_writer_t *writer)
+{
+    json_put_char(writer, ']');
+    writer->first = false;
+}
+
+void json_writer_string(json_writer_t *writer, const char *key, const char *value)
+{
+    json_put_key(writer, key);
+    json_put_escaped(writer, value);
+}
+
+void json_writer_int(json_writer_t *writer, const char *key, int32_t value)
+{
+    json_writer_fixed(writer, key, value, 0);
+}
+
+void json_writer_uint(json_writer_t *writer, const char *key, uint32_t value)
+{
+    json_put_key(writer, key);
+    json_put_uint(writer, value, 1);
+}
+
+void json_writer_fixed(json_writer_t *writer, const char *key, int32_t value, uint8_t decimals)
+{
+    json_put_key(writer, key);
+    if (decimals > 9)
+    {
+        decimals = 9;
+    }
+
+    uint32_t abs_value = value < 0 ? -(uint32_t)value : (uint32_t)value;
+    uint32_t integer   = abs_value / json_pow10[decimals];
+    uint32_t fraction  = abs_value % json_pow10[decimals];
+    if (value < 0)
+    {
+        json_put_char(writer, '-');
+    }
+    json_put_uint(writer, integer, 1);
+    if (fraction == 0)
+    {
+        return;
+    }
+
+    // drop trailing zeros, like the shortest number representation
+    while (fraction % 10 == 0)
+    {
+        fraction /= 10;
+        decimals--;
+    }
+    json_put_char(writer, '.');
+    json_put_uint(writer, fraction, decimals);
+}
+
+void json_writer_bool(json_writer_t *writer, const char *key, bool value)
+{
+    json_put_key(writer, key);
+    if (value)
+    {
+        json_put(writer, "true", 4);
+    }
+    else
+    {
+        json_put(writer, "false", 5);
+    }
+}
+
+int json_writer_length(json_writer_t *writer)
+{
+    return writer->overflow ? -1 : (int)writer->len;
+}
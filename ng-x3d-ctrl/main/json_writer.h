@@ -0,0 +1,117 @@
+/**
+ * @file json_writer.h
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief allocation free streaming JSON writer into a fixed buffer
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// @brief Writer state, the output is always terminated
+typedef struct {
+    char *buffer;
+    size_t size;
+    size_t len;
+    bool first;    ///< no separator required before the next value
+    bool overflow; ///< buffer was too small, output is invalid
+} json_writer_t;
+
+/**
+ * @brief Initialize the writer
+ *
+ * @param writer pointer to writer state
+ * @param buffer output buffer
+ * @param size size of the output buffer
+ */
+void json_writer_init(json_writer_t *writer, char *buffer, size_t size);
+
+/**
+ * @brief Starts an object
+ *
+ * @param writer pointer to writer state
+ * @param key key in the parent object, NULL for root or array item
+ */
+void json_writer_object_begin(json_writer_t *writer, const char *key);
+
+/**
+ * @brief Ends an object
+ *
+ * @param writer pointer to writer state
+ */
+void json_writer_object_end(json_writer_t *writer);
+
+/**
+ * @brief Starts an array
+ *
+ * @param writer pointer to writer state
+ * @param key key in the parent object, NULL for root or array item
+ */
+void json_writer_array_begin(json_writer_t *writer, const char *key);
+
+/**
+ * @brief Ends an array
+ *
+ * @param writer pointer to writer state
+ */
+void json_writer_array_end(json_writer_t *writer);
+
+/**
+ * @brief Writes an escaped string value
+ *
+ * @param writer pointer to writer state
+ * @param key key in the parent object, NULL for array item
+ * @param value string
+ */
+void json_writer_string(json_writer_t *writer, const char *key, const char *value);
+
+/**
+ * @brief Writes an integer value
+ *
+ * @param writer pointer to writer state
+ * @param key key in the parent object, NULL for array item
+ * @param value integer
+ */
+void json_writer_int(json_writer_t *writer, const char *key, int32_t value);
+
+/**
+ * @brief Writes an unsigned integer value, for counters beyond the int32 range
+ *
+ * @param writer pointer to writer state
+ * @param key key in the parent object, NULL for array item
+ * @param value unsigned integer
+ */
+void json_writer_uint(json_writer_t *writer, const char *key, uint32_t value);
+
+/**
+ * @brief Writes a fixed point value, trailing zeros of the fraction are omitted, ex.: 2150 with 2 decimals is 21.5
+ *
+ * @param writer pointer to writer state
+ * @param key key in the parent object, NULL for array item
+ * @param value value scaled by 10^decimals
+ * @param decimals number of decimals, max 9
+ */
+void json_writer_fixed(json_writer_t *writer, const char *key, int32_t value, uint8_t decimals);
+
+/**
+ * @brief Writes a boolean value
+ *
+ * @param writer pointer to writer state
+ * @param key key in the parent object, NULL for array item
+ * @param value boolean
+ */
+void json_writer_bool(json_writer_t *writer, const char *key, bool value);
+
+/**
+ * @brief Returns the length of the output
+ *
+ * @param writer pointer to writer state
+ * @return int length of the output, -1 if the buffer was too small
+ */
+int json_writer_length(json_writer_t *writer);
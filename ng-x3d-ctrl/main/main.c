@@ -9,11 +9,14 @@
  *
  */
 
+#include <stdio.h>
 #include <string.h>
 #include <stdarg.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "freertos/timers.h"
 
 #include "esp_system.h"
@@ -24,14 +27,22 @@
 
 #include "nvs_flash.h"
 #include "cJSON.h"
+#include "json_writer.h"
 
 #include "wifi.h"
 #include "rfm.h"
 #include "mqtt.h"
+#include "mqtt_router.h"
 #include "led.h"
 #include "ota.h"
+#include "x3d_airtime.h"
 #include "x3d_handler.h"
 #include "x3d_device.h"
+#include "x3d_payload.h"
+#include "x3d_scheduler.h"
+#include "x3d_timing.h"
+#include "x3d_topology.h"
+#include "x3d_trace.h"
 
 #define NET_4                          4
 #define NET_5                          5
@@ -39,48 +50,90 @@
 #define X3D_REG_ON_OFF_ON              0x0739
 #define X3D_REG_ON_OFF_OFF             0x0738
 
-// task execution args
-typedef struct {
-    uint8_t network;
-    uint16_t target_mask;
-    char *args;
-} task_arg_t;
-
-// type of X3D message
-typedef enum {
-    ENABLE_UNKNOWN = -1,
-    ENABLE_DAY = 0,
-    ENABLE_NIGHT = 1,
-    ENABLE_DEFROST = 2,
-    ENABLE_CUSTOM = 3,
-    ENABLE_TIMED = 4,
-} enable_mode_t;
-
-static const char JSON_ACTION[] =                    "action";
+// check interval of the background status reads
+#define X3D_SCHEDULER_TICK_MS          5000
+
+// results of foreign register transactions waiting to be applied
+#define FOREIGN_QUEUE_LENGTH           4
+
+// initiators listed in the airtime statistics
+#define AIRTIME_PUBLISH_ENTRIES        16
+
+// layout version of the device snapshot, raise on changes of x3d_device_store_t
+#define SNAPSHOT_VERSION               3
+
+
 static const char JSON_NETWORK[] =                   "net";
-static const char JSON_ACK[] =                       "ack";
-static const char JSON_REGISTER_HIGH[] =             "regHigh";
-static const char JSON_REGISTER_LOW[] =              "regLow";
-static const char JSON_VALUES[] =                    "values";
+static const char JSON_TRANSMISSIONS[] =             "transmissions";
+static const char JSON_DEFERRED[] =                  "deferred";
+static const char JSON_DEFERRALS[] =                 "deferrals";
+static const char JSON_DEFERRED_MS[] =               "deferredMs";
+static const char JSON_FORCED[] =                    "forced";
+static const char JSON_RSSI_BUSY[] =                 "rssiBusy";
+static const char JSON_FOREIGN_FRAMES[] =            "foreignFrames";
+static const char JSON_COLLISIONS[] =                "collisions";
+static const char JSON_LAST_RX_AGE[] =               "lastRxAge";
+static const char JSON_STALE_FRAMES[] =              "staleFrames";
+static const char JSON_TARGET[] =                    "target";
+static const char JSON_SAMPLES[] =                   "samples";
+static const char JSON_MISSES[] =                    "misses";
+static const char JSON_EWMA[] =                      "ewma";
+static const char JSON_P95[] =                       "p95";
+static const char JSON_WAIT[] =                      "wait";
+static const char JSON_RETRIES[] =                   "retries";
+static const char JSON_MODELS[] =                    "models";
+static const char JSON_SWEEPS[] =                    "sweeps";
+static const char JSON_READS[] =                     "reads";
+static const char JSON_PENDING[] =                   "pending";
+static const char JSON_RADIO_MS[] =                  "radioMs";
+static const char JSON_BUDGET_MS[] =                 "budgetMs";
+static const char JSON_READ_COST_MS[] =              "readCostMs";
+static const char JSON_AGE[] =                       "age";
+static const char JSON_PHASE[] =                     "phase";
+static const char JSON_SLOT[] =                      "slot";
+static const char JSON_PIN[] =                       "pin";
+static const char JSON_PINS[] =                      "pins";
+static const char JSON_ELAPSED_MS[] =                "elapsedMs";
+static const char JSON_DEPTH[] =                     "depth";
+static const char JSON_RSSI[] =                      "rssi";
+static const char JSON_STATION[] =                   "station";
+static const char JSON_HEARS[] =                     "hears";
+static const char JSON_ID[] =                        "id";
+static const char JSON_TYPE[] =                      "type";
+static const char JSON_TX[] =                        "tx";
+static const char JSON_FRAMES[] =                    "frames";
+static const char JSON_BYTES[] =                     "bytes";
+static const char JSON_AIRTIME_MS[] =                "airtimeMs";
+static const char JSON_WINDOW_MS[] =                 "windowMs";
+static const char JSON_DUTY[] =                      "duty";
+static const char JSON_WINDOW_S[] =                  "windowS";
+static const char JSON_CHANNEL_DUTY[] =              "channelDuty";
+static const char JSON_TX_DUTY[] =                   "txDuty";
+static const char JSON_TX_BUDGET[] =                 "txBudget";
+static const char JSON_EVICTED[] =                   "evicted";
+static const char JSON_OVERFLOW[] =                  "overflow";
+static const char JSON_INITIATORS[] =                "initiators";
+static const char JSON_OPEN[] =                      "open";
 
 // using string constants instead of defines to save flash memory
 static const char NVS_NET_4_DEVICES[] =              "net_4_devices";
 static const char NVS_NET_5_DEVICES[] =              "net_5_devices";
+static const char NVS_MSG_NO[] =                     "msg_no";
+static const char NVS_MSG_ID[] =                     "msg_id";
+static const char NVS_NET_4_SNAPSHOT[] =             "net_4_snapshot";
+static const char NVS_NET_5_SNAPSHOT[] =             "net_5_snapshot";
 
 static const char MQTT_TOPIC_CMD[] =                 "/cmd";
 static const char MQTT_TOPIC_RESULT[] =              "/result";
+static const char MQTT_TOPIC_CHANNEL[] =             "/channel";
+static const char MQTT_TOPIC_TIMING[] =              "/timing";
+static const char MQTT_TOPIC_TRACE[] =               "/trace";
+static const char MQTT_TOPIC_SCHEDULE[] =            "/schedule";
+static const char MQTT_TOPIC_PAIRING[] =             "/pairing";
+static const char MQTT_TOPIC_TOPOLOGY[] =            "/topology";
+static const char MQTT_TOPIC_AIRTIME[] =             "/airtime";
+static const char MQTT_TOPIC_WINDOW[] =              "/window";
 
-static const char COMMAND_RESET[] =                  "reset";
-static const char COMMAND_OUTDOOR_TEMP[] =           "outdoor-temp "; // include space because of command arguments
-static const char COMMAND_PAIR[] =                   "pair";
-static const char COMMAND_PAIR_NET[] =               "pair ";
-static const char COMMAND_DEVICE_STATUS[] =          "device-status";
-static const char COMMAND_DEVICE_STATUS_SHORT[] =    "device-status-short";
-static const char COMMAND_READ[] =                   "read "; // include space because of command arguments
-static const char COMMAND_ENABLE[] =                 "enable "; // include space because of command arguments
-static const char COMMAND_DISABLE[] =                "disable";
-static const char COMMAND_WRITE[] =                  "write "; // include space because of command arguments
-static const char COMMAND_UNPAIR[] =                 "unpair";
 
 static const char MQTT_STATUS_OFF[] =                "off";
 static const char MQTT_STATUS_IDLE[] =               "idle";
@@ -98,6 +151,32 @@ static const char MQTT_STATUS_START[] =              "start";
 
 static const char TAG[] = "MAIN";
 
+// fixed output buffers of the payload writers
+#ifdef CONFIG_X3D_PAYLOAD_CBOR
+#define DEVICE_PAYLOAD_SIZE     48
+#define RESULT_PAYLOAD_SIZE     96
+#define QUERY_PAYLOAD_SIZE      96
+#define encode_device(store, slot, buffer, size)                 x3d_payload_device_cbor(store, slot, (uint8_t *)(buffer), size)
+#define encode_result(action, network, payload, buffer, size)    x3d_payload_result_cbor(action, network, payload, (uint8_t *)(buffer), size)
+#define encode_query(store, slot, age, buffer, size)             x3d_payload_query_cbor(store, slot, age, (uint8_t *)(buffer), size)
+#else
+#define DEVICE_PAYLOAD_SIZE     320
+#define RESULT_PAYLOAD_SIZE     256
+#define QUERY_PAYLOAD_SIZE      480
+#define encode_device(store, slot, buffer, size)                 x3d_payload_device_json(store, slot, buffer, size)
+#define encode_result(action, network, payload, buffer, size)    x3d_payload_result_json(action, network, payload, buffer, size)
+#define encode_query(store, slot, age, buffer, size)             x3d_payload_query_json(store, slot, age, buffer, size)
+#endif
+
+// fixed output buffers of the statistics, always json
+#define CHANNEL_PAYLOAD_SIZE    256
+#define TOPOLOGY_PAYLOAD_SIZE   160
+#define SCHEDULE_PAYLOAD_SIZE   384
+// X3D_TIMING_ENTRIES models with every counter at its maximum
+#define TIMING_PAYLOAD_SIZE     960
+// AIRTIME_PUBLISH_ENTRIES initiators with every counter at its maximum
+#define AIRTIME_PAYLOAD_SIZE    2304
+
 #define MQTT_TOPIC_PREFIX_LEN   17
 #define MQTT_TOPIC_PREFIX_SIZE  (MQTT_TOPIC_PREFIX_LEN + 1)
 
@@ -110,25 +189,60 @@ static char mqtt_topic_prefix[MQTT_TOPIC_PREFIX_SIZE]; // strlen("device/x3d/aab
 // status topic
 static char mqtt_topic_status[MQTT_TOPIC_STATUS_SIZE]; // strlen("device/x3d/aabbcc/status") = 24 + 1
 
-// list of devices
-static x3d_device_t net_4_devices[X3D_MAX_NET_DEVICES] = {0};
-static x3d_device_t net_5_devices[X3D_MAX_NET_DEVICES] = {0};
+// device state stores
+static x3d_device_store_t net_4_devices = {0};
+static x3d_device_store_t net_5_devices = {0};
 
 // transfer masks
 static uint16_t net_4_transfer_mask = 0;
 static uint16_t net_5_transfer_mask = 0;
 
+// time of the last successful read per device and status field in s since boot, 0 if not read
+static uint32_t net_4_read_time[X3D_MAX_NET_DEVICES][X3D_DEVICE_FIELDS] = {0};
+static uint32_t net_5_read_time[X3D_MAX_NET_DEVICES][X3D_DEVICE_FIELDS] = {0};
+
 TaskHandle_t processing_task_handle = NULL;
+static TaskHandle_t airtime_task_handle = NULL;
 
-enable_mode_t str_to_enabe_mode(const char *str)
-{
-    if (strcmp(str, "day") == 0) { return ENABLE_DAY; }
-    else if (strcmp(str, "night") == 0) { return ENABLE_NIGHT; }
-    else if (strcmp(str, "defrost") == 0) { return ENABLE_DEFROST; }
-    else if (strcmp(str, "custom") == 0) { return ENABLE_CUSTOM; }
-    else if (strcmp(str, "timed") == 0) { return ENABLE_TIMED; }
-    return ENABLE_UNKNOWN;
-}
+// claim of the processing task, the mqtt handler and the scheduler start tasks
+static portMUX_TYPE processing_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool processing              = false;
+
+/// @brief Acknowledged targets of a foreign register transaction
+typedef struct {
+    uint8_t network;
+    uint16_t acked;
+    x3d_standard_msg_payload_t payload;
+} foreign_result_t;
+
+static QueueHandle_t foreign_queue = NULL;
+
+// the device stores are owned by a processing task from its start to its end, the foreign results are applied and published in between
+static SemaphoreHandle_t store_lock = NULL;
+
+// command function of the processing task, started by processing_entry
+static TaskFunction_t task_code = NULL;
+
+/// @brief Header of the device snapshot blob, followed by the columns of the device store
+typedef struct {
+    uint8_t version;
+    uint8_t reserved;
+    uint16_t mask;
+} snapshot_header_t;
+
+#define SNAPSHOT_SIZE           (sizeof(snapshot_header_t) + X3D_DEVICE_STORE_DATA_SIZE)
+
+/// @brief Last written device snapshot of a network
+typedef struct {
+    uint32_t hash;
+    uint32_t time;
+} snapshot_state_t;
+
+static snapshot_state_t net_4_snapshot = {0};
+static snapshot_state_t net_5_snapshot = {0};
+
+// arguments of the processing task, only one task is executed at a time
+static mqtt_command_t task_command;
 
 static inline int valid_network(uint8_t network)
 {
@@ -153,14 +267,14 @@ static inline uint16_t get_network_mask(uint8_t network)
     }
 }
 
-static inline x3d_device_t *get_devices_list(uint8_t network)
+static inline x3d_device_store_t *get_device_store(uint8_t network)
 {
     switch (network)
     {
     case NET_4:
-        return net_4_devices;
+        return &net_4_devices;
     case NET_5:
-        return net_5_devices;
+        return &net_5_devices;
     default:
         return NULL;
     }
@@ -170,15 +284,15 @@ static inline x3d_device_t *get_devices_list(uint8_t network)
  * @brief Initialize device data list
  *
  * @param nvs_devices
- * @param devices
+ * @param store
  * @return uint16_t device transfer mask
  */
-uint16_t init_device_data(x3d_device_type_t *nvs_devices, x3d_device_t *devices)
+uint16_t init_device_data(x3d_device_type_t *nvs_devices, x3d_device_store_t *store)
 {
     uint16_t mask = 0;
     for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
     {
-        if (x3d_device_from_type(&devices[i], nvs_devices[i]))
+        if (x3d_device_set_type(store, i, nvs_devices[i]))
         {
             mask |= (1 << i);
         }
@@ -189,16 +303,16 @@ uint16_t init_device_data(x3d_device_type_t *nvs_devices, x3d_device_t *devices)
 /**
  * @brief Get the target device mask by feature
  *
- * @param devices
+ * @param store
  * @param feature
  * @return uint16_t
  */
-uint16_t get_target_mask_by_feature(x3d_device_t *devices, x3d_device_feature_t feature)
+uint16_t get_target_mask_by_feature(x3d_device_store_t *store, x3d_device_feature_t feature)
 {
     uint16_t mask = 0;
     for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
     {
-        if (x3d_device_feature_list[devices[i].type] & feature)
+        if (x3d_device_features(store->type[i]) & feature)
         {
             mask |= (1 << i);
         }
@@ -207,39 +321,173 @@ uint16_t get_target_mask_by_feature(x3d_device_t *devices, x3d_device_feature_t
 }
 
 /**
- * @brief Publishes a device to its topic
+ * @brief Returns the read time list of the network
+ *
+ * @param network
+ * @return uint32_t (*)[X3D_DEVICE_FIELDS] NULL if network is invalid
+ */
+static uint32_t (*get_read_time_list(uint8_t network))[X3D_DEVICE_FIELDS]
+{
+    switch (network)
+    {
+        case NET_4:
+            return net_4_read_time;
+        case NET_5:
+            return net_5_read_time;
+        default:
+            return NULL;
+    }
+}
+
+/**
+ * @brief Returns the time for the cached values, never the not read marker 0
+ *
+ * @return uint32_t time since boot in s
+ */
+static inline uint32_t cache_time(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000000) + 1;
+}
+
+/**
+ * @brief Marks the cached status of devices as outdated, so the next status read reads all registers
+ *
+ * @param network
+ * @param mask device mask
+ */
+static void invalidate_cache(uint8_t network, uint16_t mask)
+{
+    uint32_t (*read_time)[X3D_DEVICE_FIELDS] = get_read_time_list(network);
+    if (read_time == NULL)
+    {
+        return;
+    }
+
+    for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+    {
+        if (mask & (1 << i))
+        {
+            memset(read_time[i], 0, sizeof(read_time[i]));
+        }
+    }
+}
+
+/**
+ * @brief FNV-1a hash of a payload, never returns the unknown marker 0
+ *
+ * @param data
+ * @param len
+ * @return uint32_t
+ */
+static uint32_t payload_hash(const char *data, int len)
+{
+    uint32_t hash = 2166136261U;
+    for (int i = 0; i < len; i++)
+    {
+        hash ^= (uint8_t)data[i];
+        hash *= 16777619U;
+    }
+    return hash == 0 ? 1 : hash;
+}
+
+/**
+ * @brief Publishes a device to its topic, if the status has changed since the last publish
  *
- * @param device
  * @param network
  * @param id
- * @param force
+ * @param force publish even if the status is unchanged
  */
-void publish_device(x3d_device_t *device, uint8_t network, uint8_t id, bool force)
+void publish_device(uint8_t network, uint8_t id, bool force)
 {
+    x3d_device_store_t *store = get_device_store(network);
+    if (store == NULL || id >= X3D_MAX_NET_DEVICES || (!force && (x3d_device_dirty(store) & (1 << id)) == 0))
+    {
+        return;
+    }
+
+    char status[DEVICE_PAYLOAD_SIZE];
+    int len = encode_device(store, id, status, sizeof(status));
+    if (len < 0)
+    {
+        ESP_LOGE(TAG, "device status exceeds buffer");
+        return;
+    }
+
     char topic[64];
     snprintf(topic, 64, "%s/net-%d/dest/%d/status", mqtt_topic_prefix, network, id);
-    cJSON *root = NULL;
+    ESP_LOGI(TAG, "topic: %s", topic);
 
-    switch (device->type)
+    // keep the device dirty if the client is not connected, so it is published on connect
+    if (mqtt_publish(topic, len > 0 ? status : NULL, len, 0, 1) >= 0)
     {
-        case X3D_DEVICE_TYPE_RF66XX:
-            root = x3d_rf66xx_to_json((x3d_rf66xx_t *)device->data);
-            break;
-        default:
-            if (force)
-            {
-                mqtt_publish(topic, NULL, 0, 0, 1);
-            }
-            return;
+        x3d_device_clean(store, 1 << id);
     }
+}
 
-    ESP_LOGI(TAG, "topic: %s", topic);
-    if (root != NULL)
+/**
+ * @brief Publishes the changed devices of a network
+ *
+ * @param network
+ * @param force publish all devices even if the status is unchanged
+ */
+void publish_devices(uint8_t network, bool force)
+{
+    x3d_device_store_t *store = get_device_store(network);
+    if (store == NULL)
+    {
+        return;
+    }
+
+    uint16_t mask = force ? 0xffff : x3d_device_dirty(store);
+    for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
     {
-        char *json_string = cJSON_PrintUnformatted(root);
-        cJSON_Delete(root);
-        mqtt_publish(topic, json_string, strlen(json_string), 0, 1);
-        free(json_string);
+        if (mask & (1 << i))
+        {
+            publish_device(network, i, force);
+        }
+    }
+}
+
+/**
+ * @brief Publishes the cached status of devices with the age of each status field, without radio transfer
+ *
+ * @param network
+ * @param mask device mask
+ */
+void publish_query(uint8_t network, uint16_t mask)
+{
+    x3d_device_store_t *store                = get_device_store(network);
+    uint32_t (*read_time)[X3D_DEVICE_FIELDS] = get_read_time_list(network);
+    if (store == NULL || read_time == NULL)
+    {
+        return;
+    }
+
+    uint32_t now = cache_time();
+    for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+    {
+        if ((mask & (1 << i)) == 0 || store->type[i] == X3D_DEVICE_TYPE_NONE)
+        {
+            continue;
+        }
+
+        int32_t age[X3D_DEVICE_FIELDS];
+        for (int f = 0; f < X3D_DEVICE_FIELDS; f++)
+        {
+            age[f] = read_time[i][f] == 0 ? -1 : (int32_t)(now - read_time[i][f]);
+        }
+
+        char response[QUERY_PAYLOAD_SIZE];
+        int len = encode_query(store, i, age, response, sizeof(response));
+        if (len <= 0)
+        {
+            ESP_LOGE(TAG, "query response exceeds buffer");
+            continue;
+        }
+
+        char topic[64];
+        snprintf(topic, 64, "%s/net-%d/dest/%d/query", mqtt_topic_prefix, network, i);
+        mqtt_publish(topic, response, len, 0, 0);
     }
 }
 
@@ -315,9 +563,9 @@ int mqtt_subscribe_net_device_subtopic(const char *subtopic, int net)
  * @brief saves the devices type list to nvs
  *
  * @param network target network
- * @param devices list of devices
+ * @param store device store
  */
-void save_devices_to_nvs(uint8_t network, x3d_device_t *devices)
+void save_devices_to_nvs(uint8_t network, x3d_device_store_t *store)
 {
     const char *key;
     switch (network)
@@ -332,35 +580,147 @@ void save_devices_to_nvs(uint8_t network, x3d_device_t *devices)
         return;
     }
 
-    // build storage blob
-    x3d_device_type_t nvs_devices[X3D_MAX_NET_DEVICES] = { X3D_DEVICE_TYPE_NONE };
+    // the type column is the storage blob
+    nvs_handle_t nvs_ctx_handle;
+    if (nvs_open("ctx", NVS_READWRITE, &nvs_ctx_handle) == ESP_OK)
+    {
+        nvs_set_blob(nvs_ctx_handle, key, store->type, X3D_MAX_NET_DEVICES);
+        nvs_commit(nvs_ctx_handle);
+        nvs_close(nvs_ctx_handle);
+    }
+}
+
+/**
+ * @brief saves the reserved message counters to nvs, called by the x3d handler once per block of messages
+ *
+ * @param msg_no reserved message number
+ * @param msg_id reserved message id
+ */
+void save_msg_counters_to_nvs(uint8_t msg_no, uint16_t msg_id)
+{
+    nvs_handle_t nvs_ctx_handle;
+    if (nvs_open("ctx", NVS_READWRITE, &nvs_ctx_handle) == ESP_OK)
+    {
+        nvs_set_u8(nvs_ctx_handle, NVS_MSG_NO, msg_no);
+        nvs_set_u16(nvs_ctx_handle, NVS_MSG_ID, msg_id);
+        nvs_commit(nvs_ctx_handle);
+        nvs_close(nvs_ctx_handle);
+    }
+}
+
+/**
+ * @brief Saves the state of all devices of a network to nvs, if changed since the last write.
+ * Unless forced, the writes are limited to one per CONFIG_X3D_SNAPSHOT_INTERVAL to save the flash.
+ *
+ * @param network
+ * @param force write also within the interval
+ */
+void save_snapshot_to_nvs(uint8_t network, bool force)
+{
+    const char *key;
+    snapshot_state_t *state;
+    switch (network)
+    {
+    case NET_4:
+        key   = NVS_NET_4_SNAPSHOT;
+        state = &net_4_snapshot;
+        break;
+    case NET_5:
+        key   = NVS_NET_5_SNAPSHOT;
+        state = &net_5_snapshot;
+        break;
+    default:
+        return;
+    }
+
+    x3d_device_store_t *store = get_device_store(network);
+    // cleared, the reserved header bytes are stored and hashed as well
+    char blob[SNAPSHOT_SIZE] __attribute__((aligned(4))) = {0};
+    snapshot_header_t *header = (snapshot_header_t *)blob;
+    header->version           = SNAPSHOT_VERSION;
+    header->mask              = 0;
+    size_t len                = sizeof(blob);
     for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
     {
-        nvs_devices[i] = devices[i].type;
+        if (store->type[i] != X3D_DEVICE_TYPE_NONE)
+        {
+            header->mask |= (1 << i);
+        }
+    }
+    memcpy(&blob[sizeof(snapshot_header_t)], store, X3D_DEVICE_STORE_DATA_SIZE);
+
+    uint32_t hash = payload_hash(blob, len);
+    uint32_t now  = cache_time();
+    if (hash == state->hash || (!force && now - state->time < CONFIG_X3D_SNAPSHOT_INTERVAL))
+    {
+        return;
     }
 
     nvs_handle_t nvs_ctx_handle;
     if (nvs_open("ctx", NVS_READWRITE, &nvs_ctx_handle) == ESP_OK)
     {
-        nvs_set_blob(nvs_ctx_handle, key, nvs_devices, X3D_MAX_NET_DEVICES);
+        nvs_set_blob(nvs_ctx_handle, key, blob, len);
         nvs_commit(nvs_ctx_handle);
         nvs_close(nvs_ctx_handle);
+        state->hash = hash;
+        state->time = now;
+    }
+}
+
+/**
+ * @brief Restores the device state of a network from the snapshot, the devices are marked as stale until read
+ *
+ * @param nvs_ctx_handle
+ * @param network
+ */
+void load_snapshot_from_nvs(nvs_handle_t nvs_ctx_handle, uint8_t network)
+{
+    const char *key           = network == NET_4 ? NVS_NET_4_SNAPSHOT : NVS_NET_5_SNAPSHOT;
+    snapshot_state_t *state   = network == NET_4 ? &net_4_snapshot : &net_5_snapshot;
+    x3d_device_store_t *store = get_device_store(network);
+    static x3d_device_store_t snapshot;
+    // cleared, the reserved header bytes are stored and hashed as well
+    char blob[SNAPSHOT_SIZE] __attribute__((aligned(4))) = {0};
+    snapshot_header_t *header = (snapshot_header_t *)blob;
+    size_t len                = sizeof(blob);
+
+    if (nvs_get_blob(nvs_ctx_handle, key, blob, &len) != ESP_OK || len != sizeof(blob)
+            || header->version != SNAPSHOT_VERSION)
+    {
+        ESP_LOGI(TAG, "No device snapshot of net %d", network);
+        return;
     }
+
+    memcpy(&snapshot, &blob[sizeof(snapshot_header_t)], X3D_DEVICE_STORE_DATA_SIZE);
+    for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+    {
+        // a device paired with another type since the snapshot keeps its empty values
+        if ((header->mask & (1 << i)) && store->type[i] == snapshot.type[i])
+        {
+            x3d_device_copy(store, &snapshot, i);
+            x3d_device_set_flags(store, i, X3D_SCHEMA_FLAG_STALE, true);
+        }
+    }
+
+    // a reboot loop must not bypass the write interval
+    state->hash = payload_hash(blob, len);
+    state->time = cache_time();
+    ESP_LOGI(TAG, "Restored device snapshot of net %d with mask 0x%04x", network, header->mask);
 }
 
 void remove_device_data(uint8_t network, uint16_t remove_mask)
 {
-    x3d_device_t *devices = NULL;
+    x3d_device_store_t *store = NULL;
 
-    // get devices list and remove from transfer mask
+    // get device store and remove from transfer mask
     switch (network)
     {
     case NET_4:
-        devices = net_4_devices;
+        store = &net_4_devices;
         net_4_transfer_mask &= ~(remove_mask);
         break;
     case NET_5:
-        devices = net_5_devices;
+        store = &net_5_devices;
         net_5_transfer_mask &= ~(remove_mask);
         break;
     default:
@@ -370,118 +730,547 @@ void remove_device_data(uint8_t network, uint16_t remove_mask)
     // remove device data
     for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
     {
-        if (remove_mask & (1 << i) && devices[i].data != NULL)
+        if (remove_mask & (1 << i) && store->type[i] != X3D_DEVICE_TYPE_NONE)
         {
-            free(devices[i].data);
-            devices[i].type = X3D_DEVICE_TYPE_NONE;
-            publish_device(NULL, network, i, true);
+            x3d_device_set_type(store, i, X3D_DEVICE_TYPE_NONE);
+            publish_device(network, i, false);
         }
     }
-
-    save_devices_to_nvs(network, devices);
+
+    save_devices_to_nvs(network, store);
+    save_snapshot_to_nvs(network, true);
+}
+
+void create_device_data(uint8_t network, x3d_device_type_t type, uint8_t target_no)
+{
+    if (target_no >= X3D_MAX_NET_DEVICES || type == X3D_DEVICE_TYPE_NONE)
+    {
+        return;
+    }
+
+    x3d_device_store_t *store = NULL;
+
+    // get device store and add to transfer mask
+    switch (network)
+    {
+    case NET_4:
+        store = &net_4_devices;
+        net_4_transfer_mask |= (1 << target_no);
+        break;
+    case NET_5:
+        store = &net_5_devices;
+        net_5_transfer_mask |= (1 << target_no);
+        break;
+    default:
+        return;
+    }
+
+    x3d_device_set_type(store, target_no, type);
+    save_devices_to_nvs(network, store);
+    save_snapshot_to_nvs(network, true);
+    publish_device(network, target_no, false);
+}
+
+/**
+ * @brief Reads a status register from the devices and updates the cached values.
+ * Devices with a cached value younger than CONFIG_X3D_CACHE_TTL are skipped.
+ *
+ * @param store
+ * @param data
+ * @param reg
+ * @return bool true if the register was read by radio transfer
+ */
+bool read_reg_to_devices(x3d_device_store_t *store, x3d_read_data_t *data, uint16_t reg)
+{
+    uint32_t (*read_time)[X3D_DEVICE_FIELDS] = get_read_time_list(data->network);
+    int field                                = x3d_device_field_from_reg(reg);
+    uint32_t now                             = cache_time();
+    uint16_t target                          = data->target;
+
+    if (field < 0)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+    {
+        // device type without the register or cached value still valid
+        if ((target & (1 << i)) && (!x3d_device_has_field(store, i, field)
+                || (read_time != NULL && read_time[i][field] != 0 && now - read_time[i][field] < CONFIG_X3D_CACHE_TTL)))
+        {
+            target &= ~(1 << i);
+        }
+    }
+
+    // all cached values are valid, no airtime required
+    if (target == 0)
+    {
+        return false;
+    }
+
+    x3d_read_data_t stale_data          = *data;
+    stale_data.target                   = target;
+    stale_data.register_high            = X3D_REG_H(reg);
+    stale_data.register_low             = X3D_REG_L(reg);
+    x3d_standard_msg_payload_t *payload = x3d_reading_proc(&stale_data);
+    for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+    {
+        int req = payload->target & (1 << i);
+        int ack = payload->target_ack & (1 << i);
+
+        if (read_time != NULL && req && ack)
+        {
+            read_time[i][field] = now;
+        }
+
+        x3d_device_set_from_reg(store, i, req, ack, field, payload->data[i]);
+        if (read_time != NULL && ack && x3d_device_fields_read(store, i, read_time[i]))
+        {
+            x3d_device_set_flags(store, i, X3D_SCHEMA_FLAG_STALE, false);
+        }
+    }
+    return true;
+}
+
+void set_reg_same(x3d_write_data_t * data, uint16_t reg, uint16_t value)
+{
+    data->register_high = X3D_REG_H(reg);
+    data->register_low  = X3D_REG_L(reg);
+    for (int i = 0; i < X3D_MAX_PAYLOAD_DATA_FIELDS; i++)
+    {
+        if (data->target & (1 << i))
+        {
+            data->values[i] = value;
+        }
+        else
+        {
+            data->values[i] = 0;
+        }
+    }
+}
+
+/**
+ * @brief Publishes the channel occupancy statistics
+ *
+ */
+void publish_channel_stats(void)
+{
+    x3d_channel_stats_t stats;
+    x3d_get_channel_stats(&stats);
+
+    char buf[CHANNEL_PAYLOAD_SIZE];
+    json_writer_t writer;
+    json_writer_init(&writer, buf, sizeof(buf));
+    json_writer_object_begin(&writer, NULL);
+    json_writer_uint(&writer, JSON_TRANSMISSIONS, stats.transmissions);
+    json_writer_uint(&writer, JSON_DEFERRED, stats.deferred_transmissions);
+    json_writer_uint(&writer, JSON_DEFERRALS, stats.deferrals);
+    json_writer_uint(&writer, JSON_DEFERRED_MS, stats.deferred_ms);
+    json_writer_uint(&writer, JSON_FORCED, stats.forced);
+    json_writer_uint(&writer, JSON_RSSI_BUSY, stats.rssi_busy);
+    json_writer_uint(&writer, JSON_FOREIGN_FRAMES, stats.foreign_frames);
+    json_writer_uint(&writer, JSON_COLLISIONS, stats.collisions);
+    json_writer_uint(&writer, JSON_LAST_RX_AGE, stats.last_rx_age);
+    json_writer_uint(&writer, JSON_STALE_FRAMES, stats.stale_frames);
+    json_writer_object_end(&writer);
+    int len = json_writer_length(&writer);
+    if (len < 0)
+    {
+        ESP_LOGE(TAG, "channel statistics exceed buffer");
+        return;
+    }
+
+    mqtt_publish_subtopic(MQTT_TOPIC_CHANNEL, buf, len, 0, 0);
+}
+
+/**
+ * @brief Publishes the airtime of the initiators on the channel and the duty cycle of the last hour.
+ * The duty cycles are in %, txBudget is the share of the configured duty cycle limit used by the own frames.
+ * Only called by the airtime task, the airtime command wakes it.
+ *
+ */
+static void publish_airtime(void)
+{
+    x3d_airtime_entry_t entries[AIRTIME_PUBLISH_ENTRIES];
+    x3d_airtime_summary_t summary;
+    int count       = x3d_airtime_get(entries, AIRTIME_PUBLISH_ENTRIES, &summary);
+    uint32_t tx_duty = x3d_airtime_duty(summary.tx_us, summary.window_s);
+    if (tx_duty > CONFIG_X3D_AIRTIME_DUTY_LIMIT)
+    {
+        ESP_LOGW(TAG, "Duty cycle %lu.%02lu %% above limit", (unsigned long)tx_duty / 100, (unsigned long)tx_duty % 100);
+    }
+
+    // only written by the airtime task, too large for its stack
+    static char airtime[AIRTIME_PAYLOAD_SIZE];
+    json_writer_t writer;
+    json_writer_init(&writer, airtime, sizeof(airtime));
+    json_writer_object_begin(&writer, NULL);
+    json_writer_uint(&writer, JSON_WINDOW_S, summary.window_s);
+    json_writer_fixed(&writer, JSON_CHANNEL_DUTY, x3d_airtime_duty(summary.channel_us, summary.window_s), 2);
+    json_writer_fixed(&writer, JSON_TX_DUTY, tx_duty, 2);
+    json_writer_uint(&writer, JSON_TX_BUDGET, tx_duty * 100 / CONFIG_X3D_AIRTIME_DUTY_LIMIT);
+    json_writer_uint(&writer, JSON_EVICTED, summary.evicted);
+    json_writer_uint(&writer, JSON_OVERFLOW, summary.overflow);
+    json_writer_array_begin(&writer, JSON_INITIATORS);
+    for (int i = 0; i < count; i++)
+    {
+        json_writer_object_begin(&writer, NULL);
+        json_writer_uint(&writer, JSON_ID, entries[i].device_id);
+        json_writer_int(&writer, JSON_TYPE, entries[i].msg_type);
+        json_writer_bool(&writer, JSON_TX, entries[i].tx);
+        json_writer_uint(&writer, JSON_FRAMES, entries[i].frames);
+        json_writer_uint(&writer, JSON_BYTES, entries[i].bytes);
+        json_writer_uint(&writer, JSON_AIRTIME_MS, entries[i].airtime_us / 1000);
+        json_writer_uint(&writer, JSON_WINDOW_MS, entries[i].window_us / 1000);
+        json_writer_fixed(&writer, JSON_DUTY, x3d_airtime_duty(entries[i].window_us, summary.window_s), 2);
+        json_writer_object_end(&writer);
+    }
+    json_writer_array_end(&writer);
+    json_writer_object_end(&writer);
+    int len = json_writer_length(&writer);
+    if (len < 0)
+    {
+        ESP_LOGE(TAG, "airtime exceeds buffer");
+        return;
+    }
+
+    mqtt_publish_subtopic(MQTT_TOPIC_AIRTIME, airtime, len, 0, 0);
+}
+
+/**
+ * @brief Publishes a window sensor event retained, called from the receive task.
+ * The message is only queued, the mqtt client task sends it.
+ *
+ * @param device_id device id of the sensor
+ * @param open window state
+ * @param rssi RSSI of the frame in dBm
+ */
+void publish_window_event(uint32_t device_id, bool open, int16_t rssi)
+{
+    char topic[64];
+    char data[32];
+    snprintf(topic, sizeof(topic), "%s%s/%06lx", mqtt_topic_prefix, MQTT_TOPIC_WINDOW, (unsigned long)device_id);
+    int len = snprintf(data, sizeof(data), "{\"%s\":%s,\"%s\":%d}", JSON_OPEN, open ? "true" : "false", JSON_RSSI, rssi);
+    mqtt_enqueue(topic, data, len, 0, 1);
+    ESP_LOGI(TAG, "Window %06lx %s", (unsigned long)device_id, open ? "opened" : "closed");
+}
+
+/**
+ * @brief Publishes the observed response timing model of a network
+ *
+ * @param network
+ */
+void publish_timing_model(uint8_t network)
+{
+    x3d_timing_model_t models[X3D_TIMING_ENTRIES];
+    int count = x3d_timing_get_models(network, models, X3D_TIMING_ENTRIES);
+
+    char buf[TIMING_PAYLOAD_SIZE];
+    json_writer_t writer;
+    json_writer_init(&writer, buf, sizeof(buf));
+    json_writer_object_begin(&writer, NULL);
+    json_writer_uint(&writer, JSON_NETWORK, network);
+    json_writer_array_begin(&writer, JSON_MODELS);
+    for (int i = 0; i < count; i++)
+    {
+        json_writer_object_begin(&writer, NULL);
+        json_writer_uint(&writer, JSON_TARGET, models[i].target);
+        json_writer_uint(&writer, JSON_SAMPLES, models[i].samples);
+        json_writer_uint(&writer, JSON_MISSES, models[i].misses);
+        json_writer_uint(&writer, JSON_EWMA, models[i].ewma_ms);
+        json_writer_uint(&writer, JSON_P95, models[i].p95_ms);
+        json_writer_uint(&writer, JSON_WAIT, models[i].wait_ms);
+        json_writer_uint(&writer, JSON_RETRIES, models[i].retry_count);
+        json_writer_object_end(&writer);
+    }
+    json_writer_array_end(&writer);
+    json_writer_object_end(&writer);
+    int len = json_writer_length(&writer);
+    if (len < 0)
+    {
+        ESP_LOGE(TAG, "timing model exceeds buffer");
+        return;
+    }
+
+    char topic[64];
+    snprintf(topic, 64, "%s/net-%d%s", mqtt_topic_prefix, network, MQTT_TOPIC_TIMING);
+    mqtt_publish(topic, buf, len, 0, 1);
+}
+
+/**
+ * @brief Publishes the inferred links of the devices of a network which changed since the last publish
+ *
+ * @param network
+ * @param force publish the links of all paired devices
+ */
+void publish_topology(uint8_t network, bool force)
+{
+    uint16_t mask = get_network_mask(network);
+    if (!force)
+    {
+        mask &= x3d_topology_changed(network);
+    }
+
+    for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+    {
+        x3d_topology_row_t row;
+        if ((mask & (1 << i)) == 0 || !x3d_topology_get_row(network, i, &row))
+        {
+            continue;
+        }
+
+        char links[TOPOLOGY_PAYLOAD_SIZE];
+        json_writer_t writer;
+        json_writer_init(&writer, links, sizeof(links));
+        json_writer_object_begin(&writer, NULL);
+        json_writer_int(&writer, JSON_NETWORK, network);
+        json_writer_int(&writer, JSON_SLOT, row.slot);
+        json_writer_int(&writer, JSON_DEPTH, row.depth == X3D_TOPOLOGY_DEPTH_UNKNOWN ? -1 : row.depth);
+        json_writer_int(&writer, JSON_RSSI, row.rssi);
+        json_writer_int(&writer, JSON_STATION, row.station);
+        json_writer_array_begin(&writer, JSON_HEARS);
+        for (int j = 0; j < X3D_MAX_NET_DEVICES; j++)
+        {
+            json_writer_int(&writer, NULL, row.hears[j]);
+        }
+        json_writer_array_end(&writer);
+        json_writer_object_end(&writer);
+        int len = json_writer_length(&writer);
+        if (len < 0)
+        {
+            ESP_LOGE(TAG, "topology exceeds buffer");
+            continue;
+        }
+
+        char topic[64];
+        snprintf(topic, 64, "%s/net-%d/dest/%d%s", mqtt_topic_prefix, network, i, MQTT_TOPIC_TOPOLOGY);
+        mqtt_publish(topic, links, len, 0, 1);
+    }
+}
+
+/**
+ * @brief Publishes the background read statistics and the oldest value per status field of a network
+ *
+ * @param network
+ */
+void publish_schedule(uint8_t network)
+{
+    x3d_scheduler_stats_t stats;
+    uint32_t (*read_time)[X3D_DEVICE_FIELDS] = get_read_time_list(network);
+    if (read_time == NULL || !x3d_scheduler_get_stats(network, &stats))
+    {
+        return;
+    }
+
+    char schedule[SCHEDULE_PAYLOAD_SIZE];
+    json_writer_t writer;
+    json_writer_init(&writer, schedule, sizeof(schedule));
+    json_writer_object_begin(&writer, NULL);
+    json_writer_int(&writer, JSON_NETWORK, network);
+    json_writer_uint(&writer, JSON_SWEEPS, stats.sweeps);
+    json_writer_uint(&writer, JSON_READS, stats.reads);
+    json_writer_int(&writer, JSON_PENDING, stats.pending);
+    json_writer_uint(&writer, JSON_RADIO_MS, stats.radio_ms);
+    json_writer_uint(&writer, JSON_BUDGET_MS, stats.budget_ms);
+    json_writer_uint(&writer, JSON_READ_COST_MS, stats.read_cost_ms);
+
+    // age of the oldest value of the paired devices, -1 if a device was not read yet
+    uint16_t mask = get_network_mask(network);
+    uint32_t now  = cache_time();
+    json_writer_object_begin(&writer, JSON_AGE);
+    for (int f = 0; f < X3D_DEVICE_FIELDS; f++)
+    {
+        int32_t oldest = 0;
+        for (int i = 0; i < X3D_MAX_NET_DEVICES && oldest >= 0; i++)
+        {
+            if (mask & (1 << i))
+            {
+                int32_t field_age = read_time[i][f] == 0 ? -1 : (int32_t)(now - read_time[i][f]);
+                oldest            = field_age < 0 || field_age > oldest ? field_age : oldest;
+            }
+        }
+        json_writer_int(&writer, x3d_device_field(f)->key, oldest);
+    }
+    json_writer_object_end(&writer);
+    json_writer_object_end(&writer);
+    int len = json_writer_length(&writer);
+    if (len < 0)
+    {
+        ESP_LOGE(TAG, "schedule exceeds buffer");
+        return;
+    }
+
+    char topic[64];
+    snprintf(topic, 64, "%s/net-%d%s", mqtt_topic_prefix, network, MQTT_TOPIC_SCHEDULE);
+    mqtt_publish(topic, schedule, len, 0, 1);
+}
+
+/**
+ * @brief Publishes a phase of the pairing process, not retained
+ *
+ * @param progress
+ */
+void publish_pairing_progress(const x3d_pairing_progress_t *progress)
+{
+    static const char *const phases[] = {"open", "pin", "pinned", "done", "failed"};
+
+    char event[128];
+    json_writer_t writer;
+    json_writer_init(&writer, event, sizeof(event));
+    json_writer_object_begin(&writer, NULL);
+    json_writer_string(&writer, JSON_PHASE, phases[progress->phase]);
+    json_writer_int(&writer, JSON_SLOT, progress->slot);
+    json_writer_int(&writer, JSON_PIN, progress->pin);
+    json_writer_int(&writer, JSON_PINS, progress->pins);
+    json_writer_int(&writer, JSON_ELAPSED_MS, progress->elapsed_ms);
+    json_writer_object_end(&writer);
+    int len = json_writer_length(&writer);
+    if (len < 0)
+    {
+        return;
+    }
+
+    char topic[64];
+    snprintf(topic, 64, "%s/net-%d%s", mqtt_topic_prefix, progress->network, MQTT_TOPIC_PAIRING);
+    mqtt_publish(topic, event, len, 0, 0);
+}
+
+/**
+ * @brief Publishes the result of a register read or write
+ *
+ * @param action result action
+ * @param network network number
+ * @param payload merged payload of the transaction
+ */
+void publish_result(x3d_schema_action_t action, uint8_t network, x3d_standard_msg_payload_t *payload)
+{
+    char result[RESULT_PAYLOAD_SIZE];
+    int len = encode_result(action, network, payload, result, sizeof(result));
+    if (len > 0)
+    {
+        mqtt_publish_subtopic(MQTT_TOPIC_RESULT, result, len, 0, 0);
+    }
 }
 
-void create_device_data(uint8_t network, x3d_device_type_t type, uint8_t target_no)
+/// @brief Output buffer of the trace export
+typedef struct {
+    char *buffer;
+    size_t size;
+    size_t len;
+    bool full;      ///< a chunk did not fit, the output is cut there
+} trace_buffer_t;
+
+static void trace_write_buffer(void *ctx, const char *data, size_t len)
 {
-    if (target_no >= X3D_MAX_NET_DEVICES || type == X3D_DEVICE_TYPE_NONE)
+    trace_buffer_t *out = (trace_buffer_t *)ctx;
+    if (out->buffer == NULL)
     {
+        out->len += len;
         return;
     }
-
-    x3d_device_t *devices = NULL;
-
-    // get devices list and remove from transfer mask
-    switch (network)
+    if (out->full || out->len + len > out->size)
     {
-    case NET_4:
-        devices = net_4_devices;
-        net_4_transfer_mask |= (1 << target_no);
-        break;
-    case NET_5:
-        devices = net_5_devices;
-        net_5_transfer_mask |= (1 << target_no);
-        break;
-    default:
+        out->full = true;
         return;
     }
+    memcpy(&out->buffer[out->len], data, len);
+    out->len += len;
+}
 
-    x3d_device_from_type(&devices[target_no], type);
-    save_devices_to_nvs(network, devices);
-    publish_device(&devices[target_no], network, target_no, true);
+static void trace_write_stdout(void *ctx, const char *data, size_t len)
+{
+    fwrite(data, 1, len, stdout);
 }
 
-void read_reg_to_devices(x3d_device_t *devices, x3d_read_data_t *data, uint16_t reg)
+/**
+ * @brief Publishes the transaction trace as Chrome trace JSON.
+ * The first export pass only counts the size of the output, recording is paused until the second
+ * pass is done, so both export the same events.
+ *
+ */
+void publish_trace(void)
 {
-    data->register_high                 = X3D_REG_H(reg);
-    data->register_low                  = X3D_REG_L(reg);
-    x3d_standard_msg_payload_t *payload = x3d_reading_proc(data);
-    for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
-    {
-        int req = payload->target & (1 << i);
-        int ack = payload->target_ack & (1 << i);
+    bool enabled = x3d_trace_is_enabled();
+    x3d_trace_enable(false);
 
-        switch (devices[i].type)
-        {
-            case X3D_DEVICE_TYPE_RF66XX:
-                x3d_rf66xx_set_from_reg((x3d_rf66xx_t *)devices[i].data, req, ack, reg, payload->data[i]);
-                break;
-            default:
-                break;
-        }
+    trace_buffer_t out = {0};
+    out.size           = x3d_trace_export(trace_write_buffer, &out);
+    out.buffer         = malloc(out.size);
+    if (out.buffer == NULL)
+    {
+        ESP_LOGE(TAG, "No memory for trace export of %zu bytes", out.size);
+        x3d_trace_enable(enabled);
+        return;
+    }
+    out.len = 0;
+    x3d_trace_export(trace_write_buffer, &out);
+    x3d_trace_enable(enabled);
+    if (out.full)
+    {
+        ESP_LOGE(TAG, "Trace export grew beyond %zu bytes", out.size);
     }
+    else
+    {
+        mqtt_publish_subtopic(MQTT_TOPIC_TRACE, out.buffer, out.len, 0, 0);
+    }
+    free(out.buffer);
 }
 
-void set_reg_same(x3d_write_data_t * data, uint16_t reg, uint16_t value)
+/**
+ * @brief Prints the transaction trace as Chrome trace JSON on the console
+ *
+ */
+void print_trace(void)
 {
-    data->register_high = X3D_REG_H(reg);
-    data->register_low  = X3D_REG_L(reg);
-    for (int i = 0; i < X3D_MAX_PAYLOAD_DATA_FIELDS; i++)
-    {
-        if (data->target & (1 << i))
-        {
-            data->values[i] = value;
-        }
-        else
-        {
-            data->values[i] = 0;
-        }
-    }
+    x3d_trace_export(trace_write_stdout, NULL);
+    fputc('\n', stdout);
+    fflush(stdout);
 }
 
 /*********************************************
  * Task Region
  */
 
+/**
+ * @brief Releases the processing claimed by execute_task
+ */
+static void release_processing(void)
+{
+    portENTER_CRITICAL(&processing_lock);
+    processing = false;
+    portEXIT_CRITICAL(&processing_lock);
+}
+
 /**
  * @brief Task end funktion.
- * Set status to idle, optional frees arg pointer and deletes task.
+ * Set status to idle and deletes task.
  *
- * @param arg optional pointer to data to free
  */
-static void __attribute__((noreturn)) end_task(void *arg)
+static void __attribute__((noreturn)) end_task(void)
 {
-    if (arg != NULL)
-    {
-        free(arg);
-    }
+    // the links learned from the relays of the transaction
+    publish_topology(NET_4, false);
+    publish_topology(NET_5, false);
     set_status(MQTT_STATUS_IDLE);
     processing_task_handle = NULL;
+    xSemaphoreGive(store_lock);
+    release_processing();
     vTaskDelete(NULL);
     while (1); // should not be reached
 }
 
 void outdoor_temp_task(void *arg)
 {
-    double temp = strtod(arg, NULL);
+    mqtt_command_t *command = arg;
     set_status(MQTT_STATUS_TEMP);
     x3d_temp_data_t data = {
             .outdoor = X3D_HEADER_EXT_TEMP_OUTDOOR,
-            .temp    = temp * 100.0,
+            .temp    = (uint16_t)command->temp,
     };
 
     data.network  = NET_4;
     data.transfer = net_4_transfer_mask;
-    data.target = get_target_mask_by_feature(net_4_devices, X3D_DEVICE_FEATURE_OUTDOOR_TEMP);
+    data.target = get_target_mask_by_feature(&net_4_devices, X3D_DEVICE_FEATURE_OUTDOOR_TEMP);
     if (data.target != 0)
     {
         x3d_temp_proc(&data);
@@ -489,21 +1278,21 @@ void outdoor_temp_task(void *arg)
 
     data.network  = NET_5;
     data.transfer = net_5_transfer_mask;
-    data.target = get_target_mask_by_feature(net_5_devices, X3D_DEVICE_FEATURE_OUTDOOR_TEMP);
+    data.target = get_target_mask_by_feature(&net_5_devices, X3D_DEVICE_FEATURE_OUTDOOR_TEMP);
     if (data.target != 0)
     {
         x3d_temp_proc(&data);
     }
 
-    end_task(arg);
+    end_task();
 }
 
 void device_status_task(void *arg)
 {
-    uint8_t network = (uintptr_t)arg;
+    uint8_t network = ((mqtt_command_t *)arg)->network;
     if (!valid_network(network))
     {
-        end_task(NULL); // arg is not a pointer
+        end_task();
     }
 
     set_status(MQTT_STATUS_STATUS);
@@ -516,30 +1305,25 @@ void device_status_task(void *arg)
 
     if (no_of_devices(device_mask))
     {
-        x3d_device_t *devices = get_devices_list(network);
-        read_reg_to_devices(devices, &data, X3D_REG_ROOM_TEMP);
-        read_reg_to_devices(devices, &data, X3D_REG_SETPOINT_STATUS);
-        read_reg_to_devices(devices, &data, X3D_REG_ERROR_STATUS);
-        read_reg_to_devices(devices, &data, X3D_REG_ON_OFF);
-        read_reg_to_devices(devices, &data, X3D_REG_SETPOINT_DEFROST);
-        read_reg_to_devices(devices, &data, X3D_REG_SETPOINT_NIGHT_DAY);
-        read_reg_to_devices(devices, &data, X3D_REG_ATT_POWER);
-
-        for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+        x3d_device_store_t *store = get_device_store(network);
+        for (int f = 0; f < X3D_DEVICE_FIELDS; f++)
         {
-            publish_device(&devices[i], network, i, false);
+            read_reg_to_devices(store, &data, x3d_device_field(f)->reg);
         }
+
+        publish_devices(network, false);
+        save_snapshot_to_nvs(network, false);
     }
 
-    end_task(NULL); // arg is not a pointer
+    end_task();
 }
 
 void device_status_short_task(void *arg)
 {
-    uint8_t network = (uintptr_t)arg;
+    uint8_t network = ((mqtt_command_t *)arg)->network;
     if (!valid_network(network))
     {
-        end_task(NULL); // arg is not a pointer
+        end_task();
     }
 
     set_status(MQTT_STATUS_STATUS);
@@ -552,46 +1336,90 @@ void device_status_short_task(void *arg)
 
     if (no_of_devices(device_mask))
     {
-        x3d_device_t *devices = get_devices_list(network);
-        read_reg_to_devices(devices, &data, X3D_REG_ROOM_TEMP);
-        read_reg_to_devices(devices, &data, X3D_REG_SETPOINT_STATUS);
-        read_reg_to_devices(devices, &data, X3D_REG_ERROR_STATUS);
-        read_reg_to_devices(devices, &data, X3D_REG_ON_OFF);
-
-        for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+        x3d_device_store_t *store = get_device_store(network);
+        for (int f = 0; f < X3D_DEVICE_FIELDS; f++)
         {
-            publish_device(&devices[i], network, i, false);
+            if (x3d_device_field(f)->short_status)
+            {
+                read_reg_to_devices(store, &data, x3d_device_field(f)->reg);
+            }
         }
+
+        publish_devices(network, false);
+        save_snapshot_to_nvs(network, false);
     }
 
-    end_task(NULL); // arg is not a pointer
+    end_task();
 }
 
-void network_pairing_task(void *arg)
+/**
+ * @brief Background status read, reads the due status registers of all devices in one sweep
+ * within the radio time budget of the network
+ *
+ * @param arg
+ */
+void scheduled_status_task(void *arg)
 {
-    task_arg_t *args = arg;
-    if (!valid_network(args->network))
+    uint8_t network                          = ((mqtt_command_t *)arg)->network;
+    uint16_t device_mask                     = get_network_mask(network);
+    x3d_device_store_t *store                = get_device_store(network);
+    uint32_t (*read_time)[X3D_DEVICE_FIELDS] = get_read_time_list(network);
+    if (store == NULL || read_time == NULL || no_of_devices(device_mask) == 0)
+    {
+        end_task();
+    }
+
+    uint32_t now   = cache_time();
+    uint8_t fields = x3d_scheduler_plan(network, x3d_scheduler_due(store, device_mask, read_time, now), now);
+    if (fields == 0)
+    {
+        end_task();
+    }
+
+    set_status(MQTT_STATUS_STATUS);
+    x3d_read_data_t data = {
+            .network  = network,
+            .transfer = device_mask,
+            .target   = device_mask,
+    };
+
+    int reads     = 0;
+    int64_t start = esp_timer_get_time();
+    for (int f = 0; f < X3D_DEVICE_FIELDS; f++)
     {
-        free(args->args);
-        end_task(args);
+        if (fields & (1 << f))
+        {
+            reads += read_reg_to_devices(store, &data, x3d_device_field(f)->reg);
+        }
     }
+    x3d_scheduler_account(network, reads, (esp_timer_get_time() - start) / 1000);
 
-    x3d_device_type_t type = x3d_device_type_from_string(args->args);
-    if (type == X3D_DEVICE_TYPE_NONE)
+    publish_devices(network, false);
+    publish_schedule(network);
+    save_snapshot_to_nvs(network, false);
+
+    end_task();
+}
+
+void network_pairing_task(void *arg)
+{
+    mqtt_command_t *command = arg;
+    if (!valid_network(command->network))
     {
-        free(args->args);
-        end_task(args);
+        end_task();
     }
 
+    x3d_device_type_t type = command->device_type;
+
     x3d_pairing_data_t data = {
-            .network  = args->network,
-            .transfer = get_network_mask(args->network),
+            .network  = command->network,
+            .transfer = get_network_mask(command->network),
+            .progress = publish_pairing_progress,
     };
 
     if (no_of_devices(data.transfer) >= X3D_MAX_NET_DEVICES)
     {
-        free(args->args);
-        end_task(args);
+        end_task();
     }
 
     // OPTIONAL: depending on device type could be diffrent pairing proc
@@ -608,30 +1436,24 @@ void network_pairing_task(void *arg)
         create_device_data(data.network, type, target_device_no);
     }
 
-    free(args->args);
-    end_task(args);
+    end_task();
 }
 
 void reading_task(void *arg)
 {
-    task_arg_t *args = arg;
-
-    char *pArg = NULL, *pEnd = NULL;
-    uint8_t register_high = strtoul(args->args, &pArg, 10);
-    uint8_t register_low  = strtoul(pArg, &pEnd, 10);
+    mqtt_command_t *command = arg;
 
     x3d_read_data_t data = {
-            .network       = args->network,
-            .transfer      = get_network_mask(args->network),
-            .target        = args->target_mask,
-            .register_high = register_high,
-            .register_low  = register_low,
+            .network       = command->network,
+            .transfer      = get_network_mask(command->network),
+            .target        = command->target_mask,
+            .register_high = command->register_high,
+            .register_low  = command->register_low,
     };
 
     if (data.transfer == 0 || (data.transfer & data.target) == 0)
     {
-        free(args->args);
-        end_task(arg);
+        end_task();
     }
 
     set_status(MQTT_STATUS_READING);
@@ -639,61 +1461,39 @@ void reading_task(void *arg)
 
     ESP_LOGI(TAG, "read register %02x - %02x from %04x", payload->reg_high, payload->reg_low, payload->target_ack);
 
-    int data_slots = ((payload->action & 0xf0) >> 4) + 1;
-    cJSON *root    = cJSON_CreateObject();
-    cJSON_AddStringToObject(root, JSON_ACTION, "read");
-    cJSON_AddNumberToObject(root, JSON_NETWORK, data.network);
-    cJSON_AddNumberToObject(root, JSON_ACK, payload->target_ack);
-    cJSON_AddNumberToObject(root, JSON_REGISTER_HIGH, payload->reg_high);
-    cJSON_AddNumberToObject(root, JSON_REGISTER_LOW, payload->reg_low);
-    cJSON *values = cJSON_AddArrayToObject(root, JSON_VALUES);
-    for (int i = 0; i < data_slots; i++)
-    {
-        cJSON_AddItemToArray(values, cJSON_CreateNumber(payload->data[i]));
-    }
-    char *json_string = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-
-    mqtt_publish_subtopic(MQTT_TOPIC_RESULT, json_string, strlen(json_string), 0, 0);
-    free(json_string);
+    publish_result(X3D_SCHEMA_ACTION_READ, data.network, payload);
 
-    free(args->args);
-    end_task(arg);
+    end_task();
 }
 
 void writing_task(void *arg)
 {
-    task_arg_t *args = arg;
-
-    char *pArg = NULL, *pEnd = NULL;
-    uint8_t register_high = strtoul(args->args, &pArg, 10);
-    uint8_t register_low  = strtoul(pArg, &pArg, 10);
+    mqtt_command_t *command = arg;
 
     x3d_write_data_t data = {
-            .network       = args->network,
-            .transfer      = get_network_mask(args->network),
-            .target        = args->target_mask,
-            .register_high = register_high,
-            .register_low  = register_low,
+            .network       = command->network,
+            .transfer      = get_network_mask(command->network),
+            .target        = command->target_mask,
+            .register_high = command->register_high,
+            .register_low  = command->register_low,
             .values        = {0}
     };
 
     if (data.transfer == 0 || (data.transfer & data.target) == 0)
     {
-        free(args->args);
-        end_task(arg);
+        end_task();
     }
 
+    // the last value is repeated for the remaining targets
     uint16_t curr_value = 0;
+    uint8_t value_index = 0;
     for (int i = 0; i < X3D_MAX_PAYLOAD_DATA_FIELDS; i++)
     {
-        if (args->target_mask & (1 << i))
+        if (command->target_mask & (1 << i))
         {
-            uint16_t tmp_val = strtoul(pArg, &pEnd, 10);
-            if (pArg != pEnd)
+            if (value_index < command->value_count)
             {
-                curr_value = tmp_val;
-                pArg = pEnd;
+                curr_value = command->values[value_index++];
             }
             data.values[i] = curr_value;
         }
@@ -704,41 +1504,25 @@ void writing_task(void *arg)
 
     ESP_LOGI(TAG, "write register %02x - %02x to %04x", payload->reg_high, payload->reg_low, payload->target_ack);
 
-    int data_slots = ((payload->action & 0xf0) >> 4) + 1;
-    cJSON *root    = cJSON_CreateObject();
-    cJSON_AddStringToObject(root, JSON_ACTION, "write");
-    cJSON_AddNumberToObject(root, JSON_NETWORK, data.network);
-    cJSON_AddNumberToObject(root, JSON_ACK, payload->target_ack);
-    cJSON_AddNumberToObject(root, JSON_REGISTER_HIGH, payload->reg_high);
-    cJSON_AddNumberToObject(root, JSON_REGISTER_LOW, payload->reg_low);
-    cJSON *values = cJSON_AddArrayToObject(root, JSON_VALUES);
-    for (int i = 0; i < data_slots; i++)
-    {
-        cJSON_AddItemToArray(values, cJSON_CreateNumber(payload->data[i]));
-    }
-    char *json_string = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-
-    mqtt_publish_subtopic(MQTT_TOPIC_RESULT, json_string, strlen(json_string), 0, 0);
-    free(json_string);
+    invalidate_cache(data.network, data.target);
+    publish_result(X3D_SCHEMA_ACTION_WRITE, data.network, payload);
 
-    free(args->args);
-    end_task(arg);
+    end_task();
 }
 
 void device_disable_task(void *arg)
 {
-    task_arg_t *args = arg;
+    mqtt_command_t *command = arg;
     x3d_write_data_t data = {
-            .network  = args->network,
-            .transfer = get_network_mask(args->network),
-            .target   = args->target_mask,
+            .network  = command->network,
+            .transfer = get_network_mask(command->network),
+            .target   = command->target_mask,
             .values   = {0},
     };
 
     if (data.transfer == 0 || (data.transfer & data.target) == 0)
     {
-        end_task(arg);
+        end_task();
     }
 
     // switch device off
@@ -753,23 +1537,22 @@ void device_disable_task(void *arg)
     set_reg_same(&data, X3D_REG_SET_MODE_TEMP, 0);
     x3d_writing_proc(&data);
 
-    end_task(arg);
+    invalidate_cache(data.network, data.target);
+    end_task();
 }
 
 void device_enable_task(void *arg)
 {
-    task_arg_t *args = arg;
+    mqtt_command_t *command = arg;
 
-    char *pArg = NULL;
-    double temp;
     uint16_t outValue;
     uint16_t time = 0;
-    enable_mode_t mode = str_to_enabe_mode(strtok_r(args->args, " ", &pArg));
-    x3d_device_t *devices = get_devices_list(args->network);
+    enable_mode_t mode = command->mode;
+    x3d_device_store_t *store = get_device_store(command->network);
     x3d_write_data_t data = {
-            .network  = args->network,
-            .transfer = get_network_mask(args->network),
-            .target   = get_target_mask_by_feature(devices, X3D_DEVICE_FEATURE_TEMP_ACTOR) & args->target_mask,
+            .network  = command->network,
+            .transfer = get_network_mask(command->network),
+            .target   = get_target_mask_by_feature(store, X3D_DEVICE_FEATURE_TEMP_ACTOR) & command->target_mask,
             .register_high = X3D_REG_H(X3D_REG_SET_MODE_TEMP),
             .register_low  = X3D_REG_L(X3D_REG_SET_MODE_TEMP),
             .values   = {0},
@@ -777,8 +1560,7 @@ void device_enable_task(void *arg)
 
     if (data.transfer == 0 || (data.transfer & data.target) == 0)
     {
-        free(args->args);
-        end_task(arg);
+        end_task();
     }
 
     // prepare mode and setpoint register
@@ -791,20 +1573,13 @@ void device_enable_task(void *arg)
             {
                 if (data.target & (1 << i))
                 {
-                    uint8_t set_point_day = 0;
-                    uint8_t set_point_night = 0;
-                    uint8_t set_point_defrost = 0;
+                    uint16_t set_point_day = 0;
+                    uint16_t set_point_night = 0;
+                    uint16_t set_point_defrost = 0;
 
-                    switch (devices[i].type)
-                    {
-                        case X3D_DEVICE_TYPE_RF66XX:
-                            set_point_day = ((x3d_rf66xx_t *)devices[i].data)->set_point_day;
-                            set_point_night = ((x3d_rf66xx_t *)devices[i].data)->set_point_night;
-                            set_point_defrost = ((x3d_rf66xx_t *)devices[i].data)->set_point_defrost;
-                            break;
-                        default:
-                            break;
-                    }
+                    x3d_device_get_value(store, i, X3D_SCHEMA_DEVICE_SET_POINT_DAY, &set_point_day);
+                    x3d_device_get_value(store, i, X3D_SCHEMA_DEVICE_SET_POINT_NIGHT, &set_point_night);
+                    x3d_device_get_value(store, i, X3D_SCHEMA_DEVICE_SET_POINT_DEFROST, &set_point_defrost);
 
                     switch (mode)
                     {
@@ -825,33 +1600,22 @@ void device_enable_task(void *arg)
             break;
 
         case ENABLE_CUSTOM:
-            temp = strtod(pArg, &pArg);
-            if (temp == 0)
-            {
-                end_task(arg);
-            }
-
-            // set mode and temperature
-            outValue = (uint16_t)(temp * 2.0);
+            // set mode and temperature, the temperature is in 0.01 °C
+            outValue = command->temp * 2 / 100;
             set_reg_same(&data, X3D_REG_SET_MODE_TEMP, outValue);
             break;
 
         case ENABLE_TIMED:
-            temp = strtod(pArg, &pArg);
-            time = strtoul(pArg, &pArg, 10);
-            if (temp == 0 || time == 0)
-            {
-                end_task(arg);
-            }
+            time = command->time;
 
             // set mode and temperature
-            outValue = (uint16_t)(temp * 2.0) | X3D_FLAG_TIMED;
+            outValue = (command->temp * 2 / 100) | X3D_FLAG_TIMED;
             set_reg_same(&data, X3D_REG_SET_MODE_TEMP, outValue);
             break;
 
         case ENABLE_UNKNOWN:
         default:
-            end_task(arg);
+            end_task();
             break;
     }
     // write setpoint and mode
@@ -865,22 +1629,23 @@ void device_enable_task(void *arg)
     set_reg_same(&data, X3D_REG_ON_OFF, X3D_REG_ON_OFF_ON);
     x3d_writing_proc(&data);
 
-    end_task(arg);
+    invalidate_cache(data.network, data.target);
+    end_task();
 }
 
 void unpairing_task(void *arg)
 {
-    task_arg_t *args = arg;
+    mqtt_command_t *command = arg;
 
     x3d_unpairing_data_t data = {
-            .network  = args->network,
-            .target   = args->target_mask,
-            .transfer = get_network_mask(args->network),
+            .network  = command->network,
+            .target   = command->target_mask,
+            .transfer = get_network_mask(command->network),
     };
 
     if (data.transfer == 0 || (data.transfer & data.target) == 0)
     {
-        end_task(arg);
+        end_task();
     }
 
     set_status(MQTT_STATUS_UNPAIRING);
@@ -888,17 +1653,17 @@ void unpairing_task(void *arg)
 
     remove_device_data(data.network, data.target);
 
-    end_task(arg);
+    end_task();
 }
 
 void device_pairing_task(void *arg)
 {
-    task_arg_t *args = arg;
+    mqtt_command_t *command = arg;
 
     x3d_write_data_t data = {
-            .network       = args->network,
-            .transfer      = get_network_mask(args->network),
-            .target        = args->target_mask,
+            .network       = command->network,
+            .transfer      = get_network_mask(command->network),
+            .target        = command->target_mask,
             .register_high = X3D_REG_H(X3D_REG_START_PAIR),
             .register_low  = X3D_REG_L(X3D_REG_START_PAIR),
             .values        = {0},
@@ -906,199 +1671,318 @@ void device_pairing_task(void *arg)
 
     if (data.transfer == 0 || (data.transfer & data.target) == 0)
     {
-        end_task(arg);
+        end_task();
     }
 
     set_status(MQTT_STATUS_PAIRING);
     x3d_writing_proc(&data);
 
-    end_task(arg);
+    end_task();
 }
 
+/**
+ * @brief Claims the processing, only one task may use the radio and the device stores
+ *
+ * @return bool false if already claimed
+ */
+static bool claim_processing(void)
+{
+    portENTER_CRITICAL(&processing_lock);
+    bool busy  = processing;
+    processing = true;
+    portEXIT_CRITICAL(&processing_lock);
+    return !busy;
+}
 
+/**
+ * @brief Entry of the processing tasks, waits for the device stores before the command is executed.
+ * The wait is not done by the caller, the mqtt task must not block while a foreign result is published.
+ *
+ * @param arg task command
+ */
+static void processing_entry(void *arg)
+{
+    xSemaphoreTake(store_lock, portMAX_DELAY);
+    task_code(arg);
+}
 
 /**
- * @brief Wrapper for xTaskCreate to check if a processing task is already executed
+ * @brief Wrapper for xTaskCreate to check if a processing task is already executed.
+ * The command is copied to the task arguments.
  *
  * @param pxTaskCode
  * @param pcName
  * @param usStackDepth
- * @param pvParameters
+ * @param command parsed command
  */
-void execute_task(TaskFunction_t pxTaskCode, const char *const pcName, const configSTACK_DEPTH_TYPE usStackDepth, void *const pvParameters)
+void execute_task(TaskFunction_t pxTaskCode, const char *const pcName, const configSTACK_DEPTH_TYPE usStackDepth, const mqtt_command_t *command)
 {
-    if (processing_task_handle != NULL)
+    if (!claim_processing())
     {
         ESP_LOGE(TAG, "X3D message processing in progress");
         return;
     }
     ESP_LOGI(TAG, "Start: %s", pcName);
-    xTaskCreate(pxTaskCode, pcName, usStackDepth, pvParameters, 10, &processing_task_handle);
+    task_command = *command;
+    task_code    = pxTaskCode;
+    if (xTaskCreate(processing_entry, pcName, usStackDepth, &task_command, 10, &processing_task_handle) != pdPASS)
+    {
+        // the store lock is only taken by the task, the claim is the only thing to hand back
+        ESP_LOGE(TAG, "Start of %s failed", pcName);
+        processing_task_handle = NULL;
+        release_processing();
+    }
 }
 
-/*********************************************
- * MQTT Handler Region
- */
-
+#if CONFIG_X3D_SCHEDULER
 /**
- * @brief Executes device based commands
+ * @brief Starts a background status read on a network with due registers, alternating the networks.
+ * Skipped while a command is processed.
  *
- * @param data
+ * @param arg
  */
-void handle_device_command(char *data)
+void scheduler_task(void *arg)
 {
-    if (strcmp(data, COMMAND_RESET) == 0)
-    {
-        set_status(MQTT_STATUS_RESET);
-        ESP_LOGI(TAG, "Prepare to restart system!");
-        esp_restart();
-    }
-    else if (strncmp(data, COMMAND_OUTDOOR_TEMP, strlen(COMMAND_OUTDOOR_TEMP)) == 0)
+    static const uint32_t interval[X3D_DEVICE_POLL_CLASSES] = {
+            [X3D_DEVICE_POLL_FAST] = CONFIG_X3D_SCHEDULER_FAST_INTERVAL,
+            [X3D_DEVICE_POLL_SLOW] = CONFIG_X3D_SCHEDULER_SLOW_INTERVAL,
+            [X3D_DEVICE_POLL_RARE] = CONFIG_X3D_SCHEDULER_RARE_INTERVAL,
+    };
+    x3d_scheduler_init(interval, CONFIG_X3D_SCHEDULER_BUDGET_MS, 3600);
+
+    uint8_t network = NET_4;
+    while (1)
     {
-        execute_task(outdoor_temp_task, "outdoor_temp_task", 2048, strdup(&data[strlen(COMMAND_OUTDOOR_TEMP)]));
+        vTaskDelay(pdMS_TO_TICKS(X3D_SCHEDULER_TICK_MS));
+        if (processing)
+        {
+            continue;
+        }
+
+        for (int n = 0; n < 2; n++)
+        {
+            network                                  = network == NET_4 ? NET_5 : NET_4;
+            uint16_t mask                            = get_network_mask(network);
+            uint32_t (*read_time)[X3D_DEVICE_FIELDS] = get_read_time_list(network);
+            uint32_t now                             = cache_time();
+            if (mask != 0 && x3d_scheduler_plan(network, x3d_scheduler_due(get_device_store(network), mask, read_time, now), now) != 0)
+            {
+                mqtt_command_t command = {
+                        .id      = MQTT_COMMAND_DEVICE_STATUS,
+                        .scope   = MQTT_SCOPE_NETWORK,
+                        .network = network,
+                };
+                execute_task(scheduled_status_task, "scheduled_status_task", 4096, &command);
+                break;
+            }
+        }
     }
 }
+#endif
 
 /**
- * @brief Executes network based commands
+ * @brief Queues the acknowledged targets of a foreign register transaction, called from the receive task
  *
- * @param network
- * @param data
+ * @param network network number
+ * @param payload merged payload
+ * @param acked targets acknowledged since the last call
  */
-void handle_network_command(uint8_t network, char *data)
+void queue_foreign_result(uint8_t network, const x3d_standard_msg_payload_t *payload, uint16_t acked)
 {
-    if (strncmp(data, COMMAND_PAIR_NET, strlen(COMMAND_PAIR_NET)) == 0)
-    {
-        task_arg_t *args = calloc(1, sizeof(task_arg_t));
-        args->network = network;
-        args->args = strdup(&data[strlen(COMMAND_PAIR_NET)]);
-        execute_task(network_pairing_task, "network_pairing_task", 4096, args);
-    }
-    else if (strcmp(data, COMMAND_DEVICE_STATUS) == 0)
-    {
-        uintptr_t network_arg = network;
-        execute_task(device_status_task, "device_status_task", 4096, (uintptr_t *)network_arg);
-    }
-    else if (strcmp(data, COMMAND_DEVICE_STATUS_SHORT) == 0)
+    foreign_result_t result = {
+            .network = network,
+            .acked   = acked,
+            .payload = *payload,
+    };
+    if (get_device_store(network) != NULL && xQueueSend(foreign_queue, &result, 0) != pdTRUE)
     {
-        uintptr_t network_arg = network;
-        execute_task(device_status_short_task, "device_status_short_task", 4096, (uintptr_t *)network_arg);
+        ESP_LOGW(TAG, "Foreign result of net %d dropped", network);
     }
 }
 
 /**
- * @brief Executes destination based commands
+ * @brief Mirrors a foreign register read or write into the device cache and publishes the changed devices
  *
- * @param network
- * @param target_mask
- * @param data
+ * @param result acknowledged targets and merged payload
  */
-void handle_dest_command(uint8_t network, uint16_t target_mask, char *data)
+static void apply_foreign_result(const foreign_result_t *result)
 {
-    task_arg_t *args = calloc(1, sizeof(task_arg_t));
-    args->network = network;
-    args->target_mask = target_mask;
-
-    if (strcmp(data, COMMAND_PAIR) == 0)
+    x3d_device_store_t *store = get_device_store(result->network);
+    uint16_t reg              = result->payload.reg_high << 8 | result->payload.reg_low;
+    uint16_t acked            = result->acked & get_network_mask(result->network);
+    if (store == NULL)
     {
-        if (no_of_devices(target_mask) > 1)
-        {
-            return;
-        }
-        execute_task(device_pairing_task, "device_pairing_task", 2048, args);
+        return;
     }
-    else if (strcmp(data, COMMAND_UNPAIR) == 0)
+
+    x3d_device_apply_register(store, get_read_time_list(result->network), cache_time(), &result->payload, acked);
+    ESP_LOGI(TAG, "Foreign %s %04x net %d to %04x", (result->payload.action & X3D_REGISTER_ACTION_MASK) == X3D_REGISTER_ACTION_WRITE ? "write" : "read",
+            reg, result->network, acked);
+    publish_devices(result->network, false);
+    save_snapshot_to_nvs(result->network, false);
+}
+
+/**
+ * @brief Applies the foreign results between the own transactions, the device stores are owned by the processing task.
+ * The processing is not claimed, a command arriving meanwhile is accepted and its task waits for the stores in
+ * processing_entry, the mqtt task never waits for them.
+ *
+ * @param arg
+ */
+void foreign_task(void *arg)
+{
+    foreign_result_t result;
+    while (1)
     {
-        if (no_of_devices(target_mask) > 1)
+        if (xQueueReceive(foreign_queue, &result, portMAX_DELAY) != pdTRUE)
         {
-            return;
+            continue;
         }
-        execute_task(unpairing_task, "unpairing_task", 2048, args);
+        xSemaphoreTake(store_lock, portMAX_DELAY);
+        apply_foreign_result(&result);
+        xSemaphoreGive(store_lock);
     }
-    else if (strncmp(data, COMMAND_READ, strlen(COMMAND_READ)) == 0)
-    {
-        args->args = strdup(&data[strlen(COMMAND_READ)]);
-        execute_task(reading_task, "reading_task", 4096, args);
-    }
-    else if (strncmp(data, COMMAND_WRITE, strlen(COMMAND_WRITE)) == 0)
-    {
-        args->args = strdup(&data[strlen(COMMAND_WRITE)]);
-        execute_task(writing_task, "writing_task", 4096, args);
-    }
-    else if (strncmp(data, COMMAND_ENABLE, strlen(COMMAND_ENABLE)) == 0)
-    {
-        args->args = strdup(&data[strlen(COMMAND_ENABLE)]);
-        execute_task(device_enable_task, "device_enable_task", 2048, args);
-    }
-    else if (strcmp(data, COMMAND_DISABLE) == 0)
-    {
-        execute_task(device_disable_task, "device_disable_task", 2048, args);
-    }
-    else
+}
+
+/**
+ * @brief Publishes the airtime statistics periodically and when the airtime command notifies the task
+ *
+ * @param arg
+ */
+void airtime_task(void *arg)
+{
+#if CONFIG_X3D_AIRTIME_INTERVAL > 0
+    const TickType_t interval = pdMS_TO_TICKS(CONFIG_X3D_AIRTIME_INTERVAL * 1000);
+#else
+    const TickType_t interval = portMAX_DELAY;
+#endif
+    while (1)
     {
-        free(args);
+        ulTaskNotifyTake(pdTRUE, interval);
+        publish_airtime();
     }
 }
 
-void handle_dest_topic(uint8_t network, uint16_t target_mask, char *topic, char *data)
+/*********************************************
+ * MQTT Handler Region
+ */
+
+/**
+ * @brief Executes device based commands
+ *
+ * @param command
+ */
+void handle_device_command(const mqtt_command_t *command)
 {
-    ESP_LOGI(TAG, "network: %d dest: %04x subtopic: %s", network, target_mask, topic);
-    if (strcmp(topic, MQTT_TOPIC_CMD) == 0)
+    switch (command->id)
     {
-        handle_dest_command(network, target_mask, data);
+        case MQTT_COMMAND_RESET:
+            set_status(MQTT_STATUS_RESET);
+            ESP_LOGI(TAG, "Prepare to restart system!");
+            save_snapshot_to_nvs(NET_4, true);
+            save_snapshot_to_nvs(NET_5, true);
+            esp_restart();
+            break;
+        case MQTT_COMMAND_CHANNEL_STATS:
+            publish_channel_stats();
+            break;
+        case MQTT_COMMAND_TRACE_START:
+            x3d_trace_clear();
+            if (!x3d_trace_enable(true))
+            {
+                ESP_LOGW(TAG, "Trace not enabled in config");
+            }
+            break;
+        case MQTT_COMMAND_TRACE_STOP:
+            x3d_trace_enable(false);
+            break;
+        case MQTT_COMMAND_TRACE_DUMP:
+            publish_trace();
+            break;
+        case MQTT_COMMAND_TRACE_PRINT:
+            print_trace();
+            break;
+        case MQTT_COMMAND_AIRTIME:
+            xTaskNotifyGive(airtime_task_handle);
+            break;
+        case MQTT_COMMAND_OUTDOOR_TEMP:
+            execute_task(outdoor_temp_task, "outdoor_temp_task", 4096, command);
+            break;
+        default:
+            break;
     }
 }
 
 /**
- * @brief
+ * @brief Executes network based commands
  *
- * @param network
- * @param topic
- * @param data
+ * @param command
  */
-
-void handle_network_topic(uint8_t network, char *topic, char *data)
+void handle_network_command(const mqtt_command_t *command)
 {
-    ESP_LOGI(TAG, "network: %d subtopic: %s", network, topic);
-    if (strcmp(topic, MQTT_TOPIC_CMD) == 0)
+    switch (command->id)
     {
-        handle_network_command(network, data);
+        case MQTT_COMMAND_PAIR_NET:
+            execute_task(network_pairing_task, "network_pairing_task", 4096, command);
+            break;
+        case MQTT_COMMAND_DEVICE_STATUS:
+            execute_task(device_status_task, "device_status_task", 4096, command);
+            break;
+        case MQTT_COMMAND_DEVICE_STATUS_SHORT:
+            execute_task(device_status_short_task, "device_status_short_task", 4096, command);
+            break;
+        case MQTT_COMMAND_TIMING_MODEL:
+            publish_timing_model(command->network);
+            break;
+        case MQTT_COMMAND_DEVICE_REFRESH:
+            publish_devices(command->network, true);
+            break;
+        case MQTT_COMMAND_TOPOLOGY:
+            publish_topology(command->network, true);
+            break;
+        default:
+            break;
     }
-    else if (strncmp(topic, "/dest/", 6) == 0)
-    {
-        // move after dest;
-        topic += 6;
-
-        char *device_ids = strtok_r(topic, "/", &topic);
-        if (strlen(device_ids) == 0)
-        {
-            return;
-        }
+}
 
-        // parse list of device ids
-        char* end = ",";
-        uint16_t target_mask = 0;
-        for (const char* p = device_ids; *end == ','; p = end + 1)
-        {
-            long target_number = strtol(p, &end, 10);
-            if (end == p)
+/**
+ * @brief Executes destination based commands
+ *
+ * @param command
+ */
+void handle_dest_command(const mqtt_command_t *command)
+{
+    switch (command->id)
+    {
+        case MQTT_COMMAND_PAIR:
+            if (no_of_devices(command->target_mask) == 1)
             {
-                break;
+                execute_task(device_pairing_task, "device_pairing_task", 4096, command);
             }
-            if (target_number < 16)
+            break;
+        case MQTT_COMMAND_UNPAIR:
+            if (no_of_devices(command->target_mask) == 1)
             {
-                target_mask |= 1 << target_number;
+                execute_task(unpairing_task, "unpairing_task", 4096, command);
             }
-        }
-
-        if (target_mask == 0)
-        {
-            return;
-        }
-
-        // move one step back for sub topic and include leading slash, restore strtok_r change
-        *(--topic) = '/';
-        handle_dest_topic(network, target_mask, topic, data);
+            break;
+        case MQTT_COMMAND_READ:
+            execute_task(reading_task, "reading_task", 4096, command);
+            break;
+        case MQTT_COMMAND_WRITE:
+            execute_task(writing_task, "writing_task", 4096, command);
+            break;
+        case MQTT_COMMAND_ENABLE:
+            execute_task(device_enable_task, "device_enable_task", 4096, command);
+            break;
+        case MQTT_COMMAND_DISABLE:
+            execute_task(device_disable_task, "device_disable_task", 4096, command);
+            break;
+        case MQTT_COMMAND_QUERY:
+            publish_query(command->network, command->target_mask);
+            break;
+        default:
+            break;
     }
 }
 
@@ -1106,36 +1990,37 @@ void handle_network_topic(uint8_t network, char *topic, char *data)
  * @brief MQTT Message data handler callback
  *
  * @param topic
+ * @param topic_len
  * @param data
+ * @param data_len
  */
-void mqtt_data(char *topic, char *data)
+void mqtt_data(const char *topic, int topic_len, const char *data, int data_len)
 {
-    // match device
-    if (strncmp(topic, mqtt_topic_prefix, MQTT_TOPIC_PREFIX_LEN) != 0)
+    mqtt_command_t command;
+    if (!mqtt_router_parse(mqtt_topic_prefix, MQTT_TOPIC_PREFIX_LEN, topic, topic_len, data, data_len, &command))
     {
+        ESP_LOGI(TAG, "ignored: %.*s", topic_len, topic);
         return;
     }
 
-    // move pointer to remove prefix
-    topic += MQTT_TOPIC_PREFIX_LEN;
-    ESP_LOGI(TAG, "subtopic: %s", topic);
-    if (strcmp(topic, MQTT_TOPIC_CMD) == 0)
-    {
-        handle_device_command(data);
-    }
-    else if (strncmp(topic, "/net-", 5) == 0)
+    ESP_LOGI(TAG, "command: %d network: %d dest: %04x", command.id, command.network, command.target_mask);
+    switch (command.scope)
     {
-        // move after net;
-        topic += 5;
-
-        // parse network number
-        uint8_t network = strtoul(topic, &topic, 10);
-        if (!valid_network(network))
-        {
-            return;
-        }
-
-        handle_network_topic(network, topic, data);
+        case MQTT_SCOPE_DEVICE:
+            handle_device_command(&command);
+            break;
+        case MQTT_SCOPE_NETWORK:
+            if (valid_network(command.network))
+            {
+                handle_network_command(&command);
+            }
+            break;
+        case MQTT_SCOPE_DEST:
+            if (valid_network(command.network))
+            {
+                handle_dest_command(&command);
+            }
+            break;
     }
 }
 
@@ -1169,12 +2054,9 @@ void mqtt_connected(void)
     snprintf(topic, 128, "%s/net-%d/dest/+%s", mqtt_topic_prefix, NET_5, MQTT_TOPIC_CMD);
     mqtt_subscribe(topic, 0);
 
-    // prepare destination device topics
-    for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
-    {
-        publish_device(&net_4_devices[i], NET_4, i, true);
-        publish_device(&net_5_devices[i], NET_5, i, true);
-    }
+    // prepare destination device topics, retained topics unchanged since the last publish are kept
+    publish_devices(NET_4, false);
+    publish_devices(NET_5, false);
 
     set_status(MQTT_STATUS_IDLE);
     led_color(0, 20, 0);
@@ -1207,6 +2089,8 @@ void app_main(void)
     // execute OTA Update
     ota_execute();
 
+    uint8_t msg_no  = 0;
+    uint16_t msg_id = 0;
     nvs_handle_t nvs_ctx_handle;
     if (nvs_open("ctx", NVS_READONLY, &nvs_ctx_handle) == ESP_OK)
     {
@@ -1214,18 +2098,26 @@ void app_main(void)
         size_t number_of_devices = X3D_MAX_NET_DEVICES;
         if (nvs_get_blob(nvs_ctx_handle, NVS_NET_4_DEVICES, &devices, &number_of_devices) == ESP_OK)
         {
-            net_4_transfer_mask = init_device_data(devices, net_4_devices);
+            net_4_transfer_mask = init_device_data(devices, &net_4_devices);
             ESP_LOGI(TAG, "Init Net 4 device data with mask 0x%04x", net_4_transfer_mask);
+            load_snapshot_from_nvs(nvs_ctx_handle, NET_4);
         }
         number_of_devices = X3D_MAX_NET_DEVICES;
         if (nvs_get_blob(nvs_ctx_handle, NVS_NET_5_DEVICES, &devices, &number_of_devices) == ESP_OK)
         {
-            net_5_transfer_mask = init_device_data(devices, net_5_devices);
+            net_5_transfer_mask = init_device_data(devices, &net_5_devices);
             ESP_LOGI(TAG, "Init Net 5 device data with mask 0x%04x", net_5_transfer_mask);
+            load_snapshot_from_nvs(nvs_ctx_handle, NET_5);
         }
+        nvs_get_u8(nvs_ctx_handle, NVS_MSG_NO, &msg_no);
+        nvs_get_u16(nvs_ctx_handle, NVS_MSG_ID, &msg_id);
         nvs_close(nvs_ctx_handle);
     }
 
+    // continue the message counters, so the actors accept the messages after restart
+    x3d_set_counters(msg_no, msg_id, save_msg_counters_to_nvs);
+    ESP_LOGI(TAG, "Continue with message id %d", msg_id);
+
     // load MAC address
     uint8_t mac[6];
     esp_read_mac(mac, ESP_MAC_WIFI_STA);
@@ -1235,9 +2127,25 @@ void app_main(void)
     snprintf(mqtt_topic_prefix, MQTT_TOPIC_PREFIX_SIZE, "device/x3d/%02x%02x%02x", mac[3], mac[4], mac[5]);
     snprintf(mqtt_topic_status, MQTT_TOPIC_STATUS_SIZE, "%s/status", mqtt_topic_prefix);
 
+    // window events are published by the receive task
+    x3d_set_window_callback(publish_window_event);
+
+    // register transactions of other initiators are mirrored into the device cache
+    store_lock    = xSemaphoreCreateMutex();
+    foreign_queue = xQueueCreate(FOREIGN_QUEUE_LENGTH, sizeof(foreign_result_t));
+    xTaskCreate(foreign_task, "foreign_task", 3072, NULL, 5, NULL);
+    x3d_set_foreign_callback(queue_foreign_result);
+
     // init RFM device
     ESP_ERROR_CHECK(rfm_init());
 
+    // airtime statistics, also on request of the airtime command
+    xTaskCreate(airtime_task, "airtime_task", 3072, NULL, 5, &airtime_task_handle);
+
     // start MQTT
     mqtt_app_start(mqtt_topic_status, MQTT_STATUS_OFF, strlen(MQTT_STATUS_OFF), 0, 1);
+
+#if CONFIG_X3D_SCHEDULER
+    xTaskCreate(scheduler_task, "scheduler_task", 2048, NULL, 5, NULL);
+#endif
 }
@@ -24,7 +24,7 @@ static const char *TAG = "MQTT";
 esp_mqtt_client_handle_t client = NULL;
 
 extern void mqtt_connected(void);
-extern void mqtt_data(char *topic, char *data);
+extern void mqtt_data(const char *topic, int topic_len, const char *data, int data_len);
 
 static void log_error_if_nonzero(const char *message, int error_code)
 {
@@ -39,6 +39,12 @@ int mqtt_publish(const char *topic, const char *data, int len, int qos, int reta
     return esp_mqtt_client_publish(client, topic, data, len, qos, retain);
 }
 
+int mqtt_enqueue(const char *topic, const char *data, int len, int qos, int retain)
+{
+    // stored also with qos 0, the client task sends it without blocking the caller
+    return esp_mqtt_client_enqueue(client, topic, data, len, qos, retain, true);
+}
+
 int mqtt_subscribe(const char *topic, int qos)
 {
     ESP_LOGI(TAG, "Subscribe: %s", topic);
@@ -55,8 +61,6 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
 {
     ESP_LOGD(TAG, "Event dispatched from event loop base=%s, event_id=%" PRIi32 "", base, event_id);
     esp_mqtt_event_handle_t event = event_data;
-    char topic[128];
-    char data[128];
     switch ((esp_mqtt_event_id_t)event_id)
     {
     case MQTT_EVENT_CONNECTED:
@@ -75,9 +79,11 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
         ESP_LOGI(TAG, "MQTT_EVENT_PUBLISHED, msg_id=%d", event->msg_id);
         break;
     case MQTT_EVENT_DATA:
-        sprintf(topic, "%.*s", event->topic_len, event->topic);
-        sprintf(data, "%.*s", event->data_len, event->data);
-        mqtt_data(topic, data);
+        // commands are short, fragmented messages are dropped
+        if (event->current_data_offset == 0 && event->data_len == event->total_data_len)
+        {
+            mqtt_data(event->topic, event->topic_len, event->data, event->data_len);
+        }
         break;
     case MQTT_EVENT_ERROR:
         ESP_LOGI(TAG, "MQTT_EVENT_ERROR");
@@ -14,5 +14,6 @@
 
 void mqtt_app_start(char *lwt_topic, const char *lwt_data, int lwt_data_len, int qos, int retain);
 int mqtt_publish(const char *topic, const char *data, int len, int qos, int retain);
+int mqtt_enqueue(const char *topic, const char *data, int len, int qos, int retain);
 int mqtt_subscribe(const char *topic, int qos);
 int mqtt_subscribe_multi(const esp_mqtt_topic_t *topic_list, int size);
\ No newline at end of file
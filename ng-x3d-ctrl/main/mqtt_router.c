@@ -0,0 +1,402 @@
+/**
+ * @file mqtt_router.c
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief single pass parser of command topics and payloads into a typed command
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <string.h>
+
+#include "mqtt_router.h"
+
+// longest device type name accepted by the pair command
+#define MQTT_ROUTER_TYPE_LEN 15
+
+/// @brief Command keyword, matched on the first word of the payload
+typedef struct {
+    const char *keyword;
+    uint8_t len;
+    uint8_t scope;
+    uint8_t id;
+} mqtt_router_keyword_t;
+
+#define KEYWORD(keyword, scope, id) {keyword, sizeof(keyword) - 1, scope, id}
+
+static const mqtt_router_keyword_t mqtt_router_keywords[] = {
+    KEYWORD("reset",               MQTT_SCOPE_DEVICE,  MQTT_COMMAND_RESET),
+    KEYWORD("channel-stats",       MQTT_SCOPE_DEVICE,  MQTT_COMMAND_CHANNEL_STATS),
+    KEYWORD("trace-start",         MQTT_SCOPE_DEVICE,  MQTT_COMMAND_TRACE_START),
+    KEYWORD("trace-stop",          MQTT_SCOPE_DEVICE,  MQTT_COMMAND_TRACE_STOP),
+    KEYWORD("trace-dump",          MQTT_SCOPE_DEVICE,  MQTT_COMMAND_TRACE_DUMP),
+    KEYWORD("trace-print",         MQTT_SCOPE_DEVICE,  MQTT_COMMAND_TRACE_PRINT),
+    KEYWORD("airtime",             MQTT_SCOPE_DEVICE,  MQTT_COMMAND_AIRTIME),
+    KEYWORD("outdoor-temp",        MQTT_SCOPE_DEVICE,  MQTT_COMMAND_OUTDOOR_TEMP),
+    KEYWORD("pair",                MQTT_SCOPE_NETWORK, MQTT_COMMAND_PAIR_NET),
+    KEYWORD("device-status",       MQTT_SCOPE_NETWORK, MQTT_COMMAND_DEVICE_STATUS),
+    KEYWORD("device-status-short", MQTT_SCOPE_NETWORK, MQTT_COMMAND_DEVICE_STATUS_SHORT),
+    KEYWORD("timing-model",        MQTT_SCOPE_NETWORK, MQTT_COMMAND_TIMING_MODEL),
+    KEYWORD("device-refresh",      MQTT_SCOPE_NETWORK, MQTT_COMMAND_DEVICE_REFRESH),
+    KEYWORD("topology",            MQTT_SCOPE_NETWORK, MQTT_COMMAND_TOPOLOGY),
+    KEYWORD("pair",                MQTT_SCOPE_DEST,    MQTT_COMMAND_PAIR),
+    KEYWORD("unpair",              MQTT_SCOPE_DEST,    MQTT_COMMAND_UNPAIR),
+    KEYWORD("read",                MQTT_SCOPE_DEST,    MQTT_COMMAND_READ),
+    KEYWORD("write",               MQTT_SCOPE_DEST,    MQTT_COMMAND_WRITE),
+    KEYWORD("enable",              MQTT_SCOPE_DEST,    MQTT_COMMAND_ENABLE),
+    KEYWORD("disable",             MQTT_SCOPE_DEST,    MQTT_COMMAND_DISABLE),
+    KEYWORD("query",               MQTT_SCOPE_DEST,    MQTT_COMMAND_QUERY),
+};
+
+static const mqtt_router_keyword_t mqtt_router_modes[] = {
+    KEYWORD("day",     0, ENABLE_DAY),
+    KEYWORD("night",   0, ENABLE_NIGHT),
+    KEYWORD("defrost", 0, ENABLE_DEFROST),
+    KEYWORD("custom",  0, ENABLE_CUSTOM),
+    KEYWORD("timed",   0, ENABLE_TIMED),
+};
+
+/// @brief Input cursor, the input is never read beyond end
+typedef struct {
+    const char *pos;
+    const char *end;
+} mqtt_scan_t;
+
+static bool scan_literal(mqtt_scan_t *scan, const char *literal, size_t len)
+{
+    if ((size_t)(scan->end - scan->pos) < len || memcmp(scan->pos, literal, len) != 0)
+    {
+        return false;
+    }
+    scan->pos += len;
+    return true;
+}
+
+static bool scan_char(mqtt_scan_t *scan, char c)
+{
+    if (scan->pos == scan->end || *scan->pos != c)
+    {
+        return false;
+    }
+    scan->pos++;
+    return true;
+}
+
+/**
+ * @brief Reads a decimal number without sign
+ *
+ * @param scan input cursor
+ * @param max maximum accepted value
+ * @param value parsed value
+ * @return bool false if no digit or the value exceeds max
+ */
+static bool scan_uint(mqtt_scan_t *scan, uint32_t max, uint32_t *value)
+{
+    const char *start = scan->pos;
+    *value            = 0;
+    while (scan->pos != scan->end && *scan->pos >= '0' && *scan->pos <= '9')
+    {
+        *value = *value * 10 + (*scan->pos - '0');
+        if (*value > max)
+        {
+            return false;
+        }
+        scan->pos++;
+    }
+    return scan->pos != start;
+}
+
+/**
+ * @brief Reads a decimal number with optional sign and fraction, ex.: -4.5
+ *
+ * @param scan input cursor
+ * @param value parsed value in 0.01, further decimals are truncated
+ * @return bool false if malformed or out of range
+ */
+static bool scan_fixed(mqtt_scan_t *scan, int32_t *value)
+{
+    bool negative = scan_char(scan, '-');
+    uint32_t integer;
+    if (!scan_uint(scan, 9999, &integer))
+    {
+        return false;
+    }
+
+    uint32_t fraction = 0;
+    if (scan_char(scan, '.'))
+    {
+        int digits = 0;
+        while (scan->pos != scan->end && *scan->pos >= '0' && *scan->pos <= '9')
+        {
+            if (digits++ < 2)
+            {
+                fraction = fraction * 10 + (*scan->pos - '0');
+            }
+            scan->pos++;
+        }
+        if (digits == 0)
+        {
+            return false;
+        }
+        if (digits == 1)
+        {
+            fraction *= 10;
+        }
+    }
+
+    *value = (int32_t)(integer * 100 + fraction);
+    if (negative)
+    {
+        *value = -*value;
+    }
+    return true;
+}
+
+/**
+ * @brief Skips the separator between arguments
+ *
+ * @param scan input cursor
+ * @return bool false if there is no space
+ */
+static bool scan_space(mqtt_scan_t *scan)
+{
+    if (!scan_char(scan, ' '))
+    {
+        return false;
+    }
+    while (scan_char(scan, ' '))
+    {
+    }
+    return true;
+}
+
+/**
+ * @brief Reads a word up to the next space
+ *
+ * @param scan input cursor
+ * @param len length of the word
+ * @return const char* start of the word
+ */
+static const char *scan_word(mqtt_scan_t *scan, size_t *len)
+{
+    const char *start = scan->pos;
+    while (scan->pos != scan->end && *scan->pos != ' ')
+    {
+        scan->pos++;
+    }
+    *len = scan->pos - start;
+    return start;
+}
+
+/**
+ * @brief Checks for the end of input, trailing white space is accepted
+ *
+ * @param scan input cursor
+ * @return bool
+ */
+static bool scan_end(mqtt_scan_t *scan)
+{
+    while (scan->pos != scan->end && (*scan->pos == ' ' || *scan->pos == '\r' || *scan->pos == '\n'))
+    {
+        scan->pos++;
+    }
+    return scan->pos == scan->end;
+}
+
+static const mqtt_router_keyword_t *find_keyword(const mqtt_router_keyword_t *keywords, size_t count, uint8_t scope, const char *word, size_t len)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (keywords[i].scope == scope && keywords[i].len == len && memcmp(keywords[i].keyword, word, len) == 0)
+        {
+            return &keywords[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Parses the topic after the prefix: /cmd, /net-N/cmd or /net-N/dest/<id>[,<id>..]/cmd
+ *
+ * @param scan input cursor on the topic
+ * @param command scope, network and target mask are set
+ * @return bool false if the topic is no command topic
+ */
+static bool parse_topic(mqtt_scan_t *scan, mqtt_command_t *command)
+{
+    if (scan_literal(scan, "/cmd", 4))
+    {
+        command->scope = MQTT_SCOPE_DEVICE;
+        return scan->pos == scan->end;
+    }
+
+    uint32_t value;
+    if (!scan_literal(scan, "/net-", 5) || !scan_uint(scan, UINT8_MAX, &value))
+    {
+        return false;
+    }
+    command->network = value;
+
+    if (scan_literal(scan, "/cmd", 4))
+    {
+        command->scope = MQTT_SCOPE_NETWORK;
+        return scan->pos == scan->end;
+    }
+
+    if (!scan_literal(scan, "/dest/", 6))
+    {
+        return false;
+    }
+
+    // comma separated list of device ids, ids out of range are ignored
+    do
+    {
+        if (!scan_uint(scan, UINT16_MAX, &value))
+        {
+            return false;
+        }
+        if (value < MQTT_ROUTER_MAX_VALUES)
+        {
+            command->target_mask |= 1 << value;
+        }
+    } while (scan_char(scan, ','));
+
+    command->scope = MQTT_SCOPE_DEST;
+    return command->target_mask != 0 && scan_literal(scan, "/cmd", 4) && scan->pos == scan->end;
+}
+
+/**
+ * @brief Parses the arguments of the command
+ *
+ * @param scan input cursor after the command keyword
+ * @param command arguments are set
+ * @return bool false if the arguments are malformed
+ */
+static bool parse_arguments(mqtt_scan_t *scan, mqtt_command_t *command)
+{
+    uint32_t value;
+    size_t len;
+    const char *word;
+    const mqtt_router_keyword_t *mode;
+
+    switch (command->id)
+    {
+        case MQTT_COMMAND_OUTDOOR_TEMP:
+            return scan_space(scan) && scan_fixed(scan, &command->temp);
+
+        case MQTT_COMMAND_PAIR_NET:
+        {
+            if (!scan_space(scan))
+            {
+                return false;
+            }
+            word = scan_word(scan, &len);
+            if (len == 0 || len > MQTT_ROUTER_TYPE_LEN)
+            {
+                return false;
+            }
+            char type[MQTT_ROUTER_TYPE_LEN + 1];
+            memcpy(type, word, len);
+            type[len]            = '\0';
+            command->device_type = x3d_device_type_from_string(type);
+            return (x3d_device_features(command->device_type) & X3D_DEVICE_FEATURE_PAIRING) != 0;
+        }
+
+        case MQTT_COMMAND_READ:
+        case MQTT_COMMAND_WRITE:
+            if (!scan_space(scan) || !scan_uint(scan, UINT8_MAX, &value))
+            {
+                return false;
+            }
+            command->register_high = value;
+            if (!scan_space(scan) || !scan_uint(scan, UINT8_MAX, &value))
+            {
+                return false;
+            }
+            command->register_low = value;
+            if (command->id == MQTT_COMMAND_READ)
+            {
+                return true;
+            }
+
+            // one value for all targets or one value per target
+            while (command->value_count < MQTT_ROUTER_MAX_VALUES && scan_space(scan))
+            {
+                if (scan->pos == scan->end || *scan->pos < '0' || *scan->pos > '9')
+                {
+                    break;
+                }
+                if (!scan_uint(scan, UINT16_MAX, &value))
+                {
+                    return false;
+                }
+                command->values[command->value_count++] = value;
+            }
+            return command->value_count > 0;
+
+        case MQTT_COMMAND_ENABLE:
+            if (!scan_space(scan))
+            {
+                return false;
+            }
+            word = scan_word(scan, &len);
+            mode = find_keyword(mqtt_router_modes, sizeof(mqtt_router_modes) / sizeof(mqtt_router_modes[0]), 0, word, len);
+            if (mode == NULL)
+            {
+                return false;
+            }
+            command->mode = mode->id;
+            if (command->mode == ENABLE_CUSTOM || command->mode == ENABLE_TIMED)
+            {
+                if (!scan_space(scan) || !scan_fixed(scan, &command->temp) || command->temp <= 0)
+                {
+                    return false;
+                }
+            }
+            if (command->mode == ENABLE_TIMED)
+            {
+                if (!scan_space(scan) || !scan_uint(scan, UINT16_MAX, &value) || value == 0)
+                {
+                    return false;
+                }
+                command->time = value;
+            }
+            return true;
+
+        default:
+            // no arguments
+            return true;
+    }
+}
+
+bool mqtt_router_parse(const char *prefix, size_t prefix_len, const char *topic, size_t topic_len, const char *data, size_t data_len, mqtt_command_t *command)
+{
+    memset(command, 0, sizeof(mqtt_command_t));
+    command->mode = ENABLE_UNKNOWN;
+
+    mqtt_scan_t scan = {.pos = topic, .end = topic + topic_len};
+    if (!scan_literal(&scan, prefix, prefix_len) || !parse_topic(&scan, command))
+    {
+        return false;
+    }
+
+    size_t len;
+    scan.pos                             = data;
+    scan.end                             = data + data_len;
+    const char *word                     = scan_word(&scan, &len);
+    const mqtt_router_keyword_t *keyword = find_keyword(mqtt_router_keywords, sizeof(mqtt_router_keywords) / sizeof(mqtt_router_keywords[0]),
+            command->scope, word, len);
+    if (keyword == NULL)
+    {
+        return false;
+    }
+
+    command->id = keyword->id;
+    if (!parse_arguments(&scan, command) || !scan_end(&scan))
+    {
+        command->id = MQTT_COMMAND_NONE;
+        return false;
+    }
+    return true;
+}
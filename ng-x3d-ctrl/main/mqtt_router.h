@@ -0,0 +1,96 @@
+/**
+ * @file mqtt_router.h
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief single pass parser of command topics and payloads into a typed command
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "x3d_device.h"
+
+#define MQTT_ROUTER_MAX_VALUES 16
+
+/// @brief Topic the command was received on
+typedef enum {
+    MQTT_SCOPE_DEVICE = 0, ///< <prefix>/cmd
+    MQTT_SCOPE_NETWORK,    ///< <prefix>/net-N/cmd
+    MQTT_SCOPE_DEST,       ///< <prefix>/net-N/dest/<ids>/cmd
+} mqtt_scope_t;
+
+/// @brief Commands
+typedef enum {
+    MQTT_COMMAND_NONE = 0,
+    // device commands
+    MQTT_COMMAND_RESET,
+    MQTT_COMMAND_CHANNEL_STATS,
+    MQTT_COMMAND_TRACE_START,
+    MQTT_COMMAND_TRACE_STOP,
+    MQTT_COMMAND_TRACE_DUMP,
+    MQTT_COMMAND_TRACE_PRINT,
+    MQTT_COMMAND_AIRTIME,
+    MQTT_COMMAND_OUTDOOR_TEMP,
+    // network commands
+    MQTT_COMMAND_PAIR_NET,
+    MQTT_COMMAND_DEVICE_STATUS,
+    MQTT_COMMAND_DEVICE_STATUS_SHORT,
+    MQTT_COMMAND_TIMING_MODEL,
+    MQTT_COMMAND_DEVICE_REFRESH,
+    MQTT_COMMAND_TOPOLOGY,
+    // destination commands
+    MQTT_COMMAND_PAIR,
+    MQTT_COMMAND_UNPAIR,
+    MQTT_COMMAND_READ,
+    MQTT_COMMAND_WRITE,
+    MQTT_COMMAND_ENABLE,
+    MQTT_COMMAND_DISABLE,
+    MQTT_COMMAND_QUERY,
+} mqtt_command_id_t;
+
+// mode of the enable command
+typedef enum {
+    ENABLE_UNKNOWN = -1,
+    ENABLE_DAY = 0,
+    ENABLE_NIGHT = 1,
+    ENABLE_DEFROST = 2,
+    ENABLE_CUSTOM = 3,
+    ENABLE_TIMED = 4,
+} enable_mode_t;
+
+/// @brief Parsed command, the arguments are set depending on the command
+typedef struct {
+    mqtt_command_id_t id;
+    mqtt_scope_t scope;
+    uint8_t network;                          ///< network and destination commands
+    uint16_t target_mask;                     ///< destination commands
+    x3d_device_type_t device_type;            ///< pair on network
+    enable_mode_t mode;                       ///< enable
+    int32_t temp;                             ///< outdoor-temp, enable custom and timed, in 0.01 °C
+    uint16_t time;                            ///< enable timed, in minutes
+    uint8_t register_high;                    ///< read, write
+    uint8_t register_low;                     ///< read, write
+    uint8_t value_count;                      ///< write, at least one
+    uint16_t values[MQTT_ROUTER_MAX_VALUES];  ///< write
+} mqtt_command_t;
+
+/**
+ * @brief Parses a received topic and payload into a command.
+ * Topic and payload are not required to be terminated and are not modified.
+ *
+ * @param prefix topic prefix of the controller
+ * @param prefix_len length of the prefix
+ * @param topic received topic
+ * @param topic_len length of the topic
+ * @param data received payload
+ * @param data_len length of the payload
+ * @param command parsed command
+ * @return bool false if the topic or payload is not a valid command
+ */
+bool mqtt_router_parse(const char *prefix, size_t prefix_len, const char *topic, size_t topic_len, const char *data, size_t data_len, mqtt_command_t *command);
@@ -10,6 +10,7 @@
  */
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
 
 #include "esp_log.h"
 
@@ -20,6 +21,8 @@
 
 #include "sx1231.h"
 #include "rfm.h"
+#include "x3d_airtime.h"
+#include "x3d_trace.h"
 
 #define RFM_PIN_NUM_MISO VSPI_IOMUX_PIN_NUM_MISO
 #define RFM_PIN_NUM_MOSI VSPI_IOMUX_PIN_NUM_MOSI
@@ -35,6 +38,10 @@ static const char *TAG = "RFM";
 static QueueHandle_t rfm_evt_queue       = NULL;
 static sx1231_handle_t sx1231_handle     = NULL;
 static TaskHandle_t transmit_task_handle = NULL;
+static int16_t rfm_last_rssi             = RFM_RSSI_INVALID;
+
+// register sequences of the receive task and the processing task, single transfers are locked by sx1231.c
+static SemaphoreHandle_t rfm_lock = NULL;
 
 extern void x3d_processor(uint8_t *buffer);
 
@@ -81,10 +88,22 @@ static void rfm_process_task(void *arg)
         if (xQueueReceive(rfm_evt_queue, &io_num, portMAX_DELAY))
         {
             uint8_t buffer[65];
+            xSemaphoreTake(rfm_lock, portMAX_DELAY);
             sx1231_get_buffer(sx1231_handle, buffer);
-            ESP_ERROR_CHECK(sx1231_receive_begin(sx1231_handle));
-            if (check_message(buffer) != ESP_OK)
+
+            // the last measurement is taken during the frame, the restart of the receiver clears it
+            if (sx1231_rssi(sx1231_handle, false, &rfm_last_rssi) != ESP_OK)
+            {
+                rfm_last_rssi = RFM_RSSI_INVALID;
+            }
+            esp_err_t begin = sx1231_receive_begin(sx1231_handle);
+            xSemaphoreGive(rfm_lock);
+            ESP_ERROR_CHECK(begin);
+            esp_err_t res = check_message(buffer);
+            x3d_airtime_frame(buffer, false, res == ESP_OK);
+            if (res != ESP_OK)
             {
+                X3D_TRACE(X3D_TRACE_RX_REJECT, res == ESP_ERR_INVALID_CRC ? X3D_TRACE_REJECT_CRC : X3D_TRACE_REJECT_SIZE, buffer[0]);
                 continue;
             }
             x3d_processor(buffer);
@@ -116,6 +135,7 @@ esp_err_t rfm_init(void)
     ESP_ERROR_CHECK(spi_bus_add_device(RFM_SPI_HOST, &devcfg, &spi));
 
     ESP_ERROR_CHECK(sx1231_init(spi, &sx1231_handle));
+    rfm_lock = xSemaphoreCreateMutex();
 
     // setup the SX1231 for the X3D protocol
     ESP_ERROR_CHECK(sx1231_modulation(sx1231_handle, SX1231_DATA_MODE_PACKET, SX1231_MODULATION_FSK, SX1231_MODULATION_SHAPING_00));
@@ -150,7 +170,7 @@ esp_err_t rfm_init(void)
     gpio_install_isr_service(0);
     gpio_isr_handler_add(RFM_PIN_NUM_IRQ, rfm_isr_handler, (void *)RFM_PIN_NUM_IRQ);
     rfm_evt_queue = xQueueCreate(10, sizeof(uint32_t));
-    xTaskCreate(rfm_process_task, "rfm_process_task", 2048, NULL, 5, NULL);
+    xTaskCreate(rfm_process_task, "rfm_process_task", 4096, NULL, 5, NULL);
 
     // start in receiver mode
     return sx1231_receive_begin(sx1231_handle);
@@ -158,14 +178,39 @@ esp_err_t rfm_init(void)
 
 esp_err_t rfm_receive(void)
 {
-    return sx1231_receive_begin(sx1231_handle);
+    xSemaphoreTake(rfm_lock, portMAX_DELAY);
+    esp_err_t res = sx1231_receive_begin(sx1231_handle);
+    xSemaphoreGive(rfm_lock);
+    return res;
 }
 
 esp_err_t rfm_transfer(uint8_t *buffer, size_t size)
 {
+    xSemaphoreTake(rfm_lock, portMAX_DELAY);
     transmit_task_handle = xTaskGetCurrentTaskHandle();
     esp_err_t res        = sx1231_transmit(sx1231_handle, buffer, size);
+    xSemaphoreGive(rfm_lock);
     ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(MAX_TRANSFER_TIMEOUT));
+    xSemaphoreTake(rfm_lock, portMAX_DELAY);
     sx1231_mode(sx1231_handle, SX1231_MODE_STANDBY);
+    xSemaphoreGive(rfm_lock);
     return res;
-}
\ No newline at end of file
+}
+
+int16_t rfm_rssi(void)
+{
+    // the receive task must not read the fifo or restart the receiver during the measurement
+    int16_t rssi = RFM_RSSI_INVALID;
+    xSemaphoreTake(rfm_lock, portMAX_DELAY);
+    if (sx1231_get_mode(sx1231_handle) != SX1231_MODE_RECEIVER || sx1231_rssi(sx1231_handle, true, &rssi) != ESP_OK)
+    {
+        rssi = RFM_RSSI_INVALID;
+    }
+    xSemaphoreGive(rfm_lock);
+    return rssi;
+}
+
+int16_t rfm_packet_rssi(void)
+{
+    return rfm_last_rssi;
+}
@@ -12,6 +12,11 @@
 
 #include "esp_system.h"
 
+// returned by rfm_rssi if the radio is not listening
+#define RFM_RSSI_INVALID INT16_MIN
+
 esp_err_t rfm_init(void);
 esp_err_t rfm_receive(void);
-esp_err_t rfm_transfer(uint8_t * buffer, size_t size);
\ No newline at end of file
+esp_err_t rfm_transfer(uint8_t * buffer, size_t size);
+int16_t rfm_rssi(void);
+int16_t rfm_packet_rssi(void);
\ No newline at end of file
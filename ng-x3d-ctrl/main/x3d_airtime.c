@@ -0,0 +1,253 @@
+/**
+ * @file x3d_airtime.c
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief airtime accounting of all frames on the channel per initiator and message type
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+
+#include "esp_timer.h"
+
+#include "x3d.h"
+#include "x3d_airtime.h"
+
+// entries probed for a key before the frame is counted as overflow
+#define X3D_AIRTIME_PROBES      8
+
+// message type of the corrupt and overflow entry
+#define X3D_AIRTIME_TYPE_NONE   0xff
+
+typedef struct {
+    uint32_t device_id;
+    uint8_t msg_type;
+    bool tx;
+    bool used;
+    uint32_t frames;
+    uint32_t bytes;
+    uint64_t airtime_us;
+    uint32_t slice_us[X3D_AIRTIME_SLICES];
+} x3d_airtime_slot_t;
+
+static x3d_airtime_slot_t x3d_airtime_table[X3D_AIRTIME_ENTRIES];
+static x3d_airtime_slot_t x3d_airtime_overflow = {.device_id = X3D_AIRTIME_ID_OVERFLOW, .msg_type = X3D_AIRTIME_TYPE_NONE};
+static uint32_t x3d_airtime_evicted;
+static uint32_t x3d_airtime_overflow_frames;
+
+// current slice and the time it started, the window starts with the first frame
+static uint8_t x3d_airtime_slice;
+static int64_t x3d_airtime_slice_start_us = -1;
+static int64_t x3d_airtime_start_us;
+
+static portMUX_TYPE x3d_airtime_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static inline uint32_t x3d_airtime_window(const x3d_airtime_slot_t *slot)
+{
+    uint32_t sum = 0;
+    for (int i = 0; i < X3D_AIRTIME_SLICES; i++)
+    {
+        sum += slot->slice_us[i];
+    }
+    return sum;
+}
+
+static void x3d_airtime_clear_slice(uint8_t slice)
+{
+    for (int i = 0; i < X3D_AIRTIME_ENTRIES; i++)
+    {
+        x3d_airtime_table[i].slice_us[slice] = 0;
+    }
+    x3d_airtime_overflow.slice_us[slice] = 0;
+}
+
+/**
+ * @brief Moves the current slice to the time, slices passed without frames are cleared
+ */
+static void x3d_airtime_advance(int64_t now)
+{
+    if (x3d_airtime_slice_start_us < 0)
+    {
+        x3d_airtime_slice_start_us = now;
+        x3d_airtime_start_us       = now;
+        return;
+    }
+    int64_t slice_us = (int64_t)X3D_AIRTIME_SLICE_S * 1000000;
+    for (int i = 0; i < X3D_AIRTIME_SLICES && now - x3d_airtime_slice_start_us >= slice_us; i++)
+    {
+        x3d_airtime_slice = (x3d_airtime_slice + 1) % X3D_AIRTIME_SLICES;
+        x3d_airtime_clear_slice(x3d_airtime_slice);
+        x3d_airtime_slice_start_us += slice_us;
+    }
+    if (now - x3d_airtime_slice_start_us >= slice_us)
+    {
+        // silent for more than the window, all slices are cleared
+        x3d_airtime_slice_start_us = now - (now - x3d_airtime_slice_start_us) % slice_us;
+    }
+}
+
+/**
+ * @brief Finds the entry of a key, adds it to a free entry or replaces an entry silent for the whole window
+ */
+static x3d_airtime_slot_t *x3d_airtime_lookup(uint32_t device_id, uint8_t msg_type, bool tx)
+{
+    uint32_t key             = (device_id << 8) ^ ((uint32_t)msg_type << 1) ^ tx;
+    uint32_t index           = (key * 2654435761u) >> (32 - __builtin_ctz(X3D_AIRTIME_ENTRIES));
+    x3d_airtime_slot_t *idle = NULL;
+    for (int i = 0; i < X3D_AIRTIME_PROBES; i++)
+    {
+        x3d_airtime_slot_t *slot = &x3d_airtime_table[(index + i) & (X3D_AIRTIME_ENTRIES - 1)];
+        if (!slot->used)
+        {
+            // entries are never freed, no later probe can hold the key
+            idle = slot;
+            break;
+        }
+        if (slot->device_id == device_id && slot->msg_type == msg_type && slot->tx == tx)
+        {
+            return slot;
+        }
+        if (idle == NULL && x3d_airtime_window(slot) == 0)
+        {
+            idle = slot;
+        }
+    }
+    if (idle == NULL)
+    {
+        x3d_airtime_overflow_frames++;
+        return &x3d_airtime_overflow;
+    }
+    if (idle->used)
+    {
+        x3d_airtime_evicted++;
+    }
+    memset(idle, 0, sizeof(*idle));
+    idle->device_id = device_id;
+    idle->msg_type  = msg_type;
+    idle->tx        = tx;
+    idle->used      = true;
+    return idle;
+}
+
+uint32_t x3d_airtime_us(uint8_t length)
+{
+    // length byte and the bytes it counts
+    return (X3D_AIRTIME_OVERHEAD + 1 + length) * 8 * X3D_AIRTIME_BIT_US;
+}
+
+void x3d_airtime_frame(const uint8_t *buffer, bool tx, bool valid)
+{
+    uint8_t length     = buffer[X3D_IDX_PKT_LEN];
+    uint32_t airtime   = x3d_airtime_us(length);
+    uint32_t device_id = X3D_AIRTIME_ID_CORRUPT;
+    uint8_t msg_type   = X3D_AIRTIME_TYPE_NONE;
+    if (valid && length > X3D_IDX_NETWORK)
+    {
+        device_id = buffer[X3D_IDX_DEVICE_ID] | buffer[X3D_IDX_DEVICE_ID + 1] << 8 | buffer[X3D_IDX_DEVICE_ID + 2] << 16;
+        msg_type  = buffer[X3D_IDX_MSG_TYPE];
+    }
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&x3d_airtime_lock);
+    x3d_airtime_advance(now);
+    x3d_airtime_slot_t *slot = x3d_airtime_lookup(device_id, msg_type, tx);
+    slot->frames++;
+    slot->bytes += length + 1;
+    slot->airtime_us += airtime;
+    slot->slice_us[x3d_airtime_slice] += airtime;
+    portEXIT_CRITICAL(&x3d_airtime_lock);
+}
+
+static void x3d_airtime_copy(x3d_airtime_entry_t *entry, const x3d_airtime_slot_t *slot)
+{
+    entry->device_id  = slot->device_id;
+    entry->msg_type   = slot->msg_type;
+    entry->tx         = slot->tx;
+    entry->frames     = slot->frames;
+    entry->bytes      = slot->bytes;
+    entry->airtime_us = slot->airtime_us;
+    entry->window_us  = x3d_airtime_window(slot);
+}
+
+/**
+ * @brief Inserts an entry into the list ordered by the window airtime, the smallest one drops out of a full list
+ */
+static void x3d_airtime_insert(x3d_airtime_entry_t *entries, int *count, int max_entries, const x3d_airtime_slot_t *slot)
+{
+    uint32_t window_us = x3d_airtime_window(slot);
+    int i              = *count;
+    if (i == max_entries)
+    {
+        if (i == 0 || entries[i - 1].window_us >= window_us)
+        {
+            return;
+        }
+        i--;
+    }
+    else
+    {
+        (*count)++;
+    }
+    for (; i > 0 && entries[i - 1].window_us < window_us; i--)
+    {
+        entries[i] = entries[i - 1];
+    }
+    x3d_airtime_copy(&entries[i], slot);
+}
+
+int x3d_airtime_get(x3d_airtime_entry_t *entries, int max_entries, x3d_airtime_summary_t *summary)
+{
+    int count   = 0;
+    int64_t now = esp_timer_get_time();
+    x3d_airtime_summary_t totals = {0};
+
+    portENTER_CRITICAL(&x3d_airtime_lock);
+    if (x3d_airtime_slice_start_us >= 0)
+    {
+        x3d_airtime_advance(now);
+        int64_t window_us = (int64_t)(X3D_AIRTIME_SLICES - 1) * X3D_AIRTIME_SLICE_S * 1000000 + now - x3d_airtime_slice_start_us;
+        if (window_us > now - x3d_airtime_start_us)
+        {
+            window_us = now - x3d_airtime_start_us;
+        }
+        totals.window_s = (uint32_t)(window_us / 1000000);
+    }
+    for (int i = 0; i <= X3D_AIRTIME_ENTRIES; i++)
+    {
+        const x3d_airtime_slot_t *slot = i < X3D_AIRTIME_ENTRIES ? &x3d_airtime_table[i] : &x3d_airtime_overflow;
+        if (slot->frames == 0)
+        {
+            continue;
+        }
+        uint32_t window_us = x3d_airtime_window(slot);
+        totals.channel_us += window_us;
+        if (slot->tx)
+        {
+            totals.tx_us += window_us;
+        }
+        x3d_airtime_insert(entries, &count, max_entries, slot);
+    }
+    totals.evicted  = x3d_airtime_evicted;
+    totals.overflow = x3d_airtime_overflow_frames;
+    portEXIT_CRITICAL(&x3d_airtime_lock);
+
+    if (summary != NULL)
+    {
+        *summary = totals;
+    }
+    return count;
+}
+
+uint32_t x3d_airtime_duty(uint32_t airtime_us, uint32_t window_s)
+{
+    if (window_s == 0)
+    {
+        return 0;
+    }
+    // 1/10000 of the window in us
+    return (uint32_t)(((uint64_t)airtime_us + window_s * 50) / (window_s * 100));
+}
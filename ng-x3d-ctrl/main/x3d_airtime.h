@@ -0,0 +1,89 @@
+/**
+ * @file x3d_airtime.h
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief airtime accounting of all frames on the channel per initiator and message type
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Every received and transmitted frame is accounted to its initiator device id and message type, relays
+ * count for the initiator of the transaction. The counters are kept in a fixed hash table, an initiator
+ * without free entry replaces one which was silent for the whole window or is counted as overflow.
+ * The duty cycle is the airtime within the last hour, kept in slices of X3D_AIRTIME_SLICE_S.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// entries of the hash table, must be a power of two
+#define X3D_AIRTIME_ENTRIES             64
+
+// duty cycle window of one hour in slices
+#define X3D_AIRTIME_SLICES              6
+#define X3D_AIRTIME_SLICE_S             600
+
+// initiator of frames with crc error and of the overflow entry
+#define X3D_AIRTIME_ID_CORRUPT          0xfffffffe
+#define X3D_AIRTIME_ID_OVERFLOW         0xffffffff
+
+// frame overhead on air in bytes, preamble and sync word, and the bit time at 40 kbaud
+#define X3D_AIRTIME_OVERHEAD            8
+#define X3D_AIRTIME_BIT_US              25
+
+/// @brief Counters of an initiator and message type
+typedef struct {
+    uint32_t device_id;     ///< initiator, X3D_AIRTIME_ID_CORRUPT or X3D_AIRTIME_ID_OVERFLOW
+    uint8_t msg_type;       ///< x3d_msg_type_t, 0xff for the corrupt and overflow entry
+    bool tx;                ///< frames sent by the controller
+    uint32_t frames;
+    uint32_t bytes;         ///< frame bytes including the length byte
+    uint64_t airtime_us;    ///< overall airtime
+    uint32_t window_us;     ///< airtime within the duty cycle window
+} x3d_airtime_entry_t;
+
+/// @brief Channel totals
+typedef struct {
+    uint32_t window_s;      ///< length of the duty cycle window, shorter than an hour after start
+    uint32_t channel_us;    ///< airtime of all frames within the window
+    uint32_t tx_us;         ///< airtime of the own frames within the window
+    uint32_t evicted;       ///< entries replaced by a new initiator
+    uint32_t overflow;      ///< frames without entry, counted in the overflow entry
+} x3d_airtime_summary_t;
+
+/**
+ * @brief Returns the airtime of a frame
+ *
+ * @param length length byte of the frame
+ * @return uint32_t airtime in us
+ */
+uint32_t x3d_airtime_us(uint8_t length);
+
+/**
+ * @brief Accounts a frame, called for every received and transmitted frame
+ *
+ * @param buffer frame
+ * @param tx true if sent by the controller
+ * @param valid false if the crc of a received frame failed, it is accounted to X3D_AIRTIME_ID_CORRUPT
+ */
+void x3d_airtime_frame(const uint8_t *buffer, bool tx, bool valid);
+
+/**
+ * @brief Copies the used entries ordered by the airtime within the window
+ *
+ * @param entries target array
+ * @param max_entries size of the target array
+ * @param summary channel totals, may be NULL
+ * @return int number of entries copied
+ */
+int x3d_airtime_get(x3d_airtime_entry_t *entries, int max_entries, x3d_airtime_summary_t *summary);
+
+/**
+ * @brief Returns a duty cycle
+ *
+ * @param airtime_us airtime within the window
+ * @param window_s window length
+ * @return uint32_t duty cycle in 1/10000, 100 = 1 %
+ */
+uint32_t x3d_airtime_duty(uint32_t airtime_us, uint32_t window_s);
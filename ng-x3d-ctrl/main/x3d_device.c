@@ -8,22 +8,15 @@
  * @copyright Copyright (c) 2024
  *
  */
+#include <stddef.h>
 #include <string.h>
 #include "x3d_device.h"
 #include "x3d.h"
+#include "x3d_schema.h"
 
 #define FLAG_TO_BITFIELD(F, M)         (((F) & (M)) == (M))
 
 // using string constants instead of defines to save flash memory
-/*
-static const char JSON_ACTION[] =               "action";
-static const char JSON_NETWORK[] =              "net";
-static const char JSON_ACK[] =                  "ack";
-static const char JSON_REGISTER_HIGH[] =        "regHigh";
-static const char JSON_REGISTER_LOW[] =         "regLow";
-static const char JSON_VALUES[] =               "values";
-static const char JSON_TARGET[] =               "target";
-*/
 static const char JSON_TYPE[] =                 "type";
 
 static const char JSON_ROOM_TEMP[] =            "roomTemp";
@@ -35,6 +28,10 @@ static const char JSON_SET_POINT_NIGHT[] =      "setPointNight";
 static const char JSON_SET_POINT_DEFROST[] =    "setPointDefrost";
 static const char JSON_FLAGS[] =                "flags";
 static const char JSON_POWER[] =                "power";
+static const char JSON_SET_POINT_STATUS[] =     "setPointStatus";
+static const char JSON_ERROR_STATUS[] =         "errorStatus";
+static const char JSON_ON_OFF[] =               "onOff";
+static const char JSON_SET_POINT_NIGHT_DAY[] =  "setPointNightDay";
 
 static const char JSON_DEFROST[] =              "defrost";
 static const char JSON_TIMED[] =                "timed";
@@ -43,135 +40,471 @@ static const char JSON_HEATER_STOPPED[] =       "heaterStopped";
 static const char JSON_WINDOW_OPEN[] =          "windowOpen";
 static const char JSON_NO_TEMP_SENSOR[] =       "noTempSensor";
 static const char JSON_BATTERY_LOW[] =          "batteryLow";
+static const char JSON_STALE[] =                "stale";
+
+// names of the x3d_schema_flag_t bits
+static const char *const x3d_flag_names[] = {
+    JSON_ON_AIR,
+    JSON_ENABLED,
+    JSON_DEFROST,
+    JSON_TIMED,
+    JSON_HEATER_ON,
+    JSON_HEATER_STOPPED,
+    JSON_WINDOW_OPEN,
+    JSON_NO_TEMP_SENSOR,
+    JSON_BATTERY_LOW,
+    JSON_STALE,
+};
+
+// status registers, ordered by x3d_device_field_t
+static const x3d_device_field_desc_t x3d_device_fields[X3D_DEVICE_FIELDS] = {
+    {X3D_REG_ROOM_TEMP,             JSON_ROOM_TEMP,             X3D_DEVICE_POLL_FAST, true},
+    {X3D_REG_SETPOINT_STATUS,       JSON_SET_POINT_STATUS,      X3D_DEVICE_POLL_SLOW, true},
+    {X3D_REG_ERROR_STATUS,          JSON_ERROR_STATUS,          X3D_DEVICE_POLL_FAST, true},
+    {X3D_REG_ON_OFF,                JSON_ON_OFF,                X3D_DEVICE_POLL_FAST, true},
+    {X3D_REG_SETPOINT_DEFROST,      JSON_SET_POINT_DEFROST,     X3D_DEVICE_POLL_SLOW, false},
+    {X3D_REG_SETPOINT_NIGHT_DAY,    JSON_SET_POINT_NIGHT_DAY,   X3D_DEVICE_POLL_SLOW, false},
+    {X3D_REG_ATT_POWER,             JSON_POWER,                 X3D_DEVICE_POLL_RARE, false},
+};
+
+/*********************************************
+ * Store
+ */
+
+// store column of the values, the dirty mask of the column is set if the value changes
+#define X3D_DEVICE_STORE(S, COLUMN, FIELD, SLOT, VALUE)          \
+    do                                                           \
+    {                                                            \
+        if ((S)->FIELD[SLOT] != (VALUE))                         \
+        {                                                        \
+            (S)->FIELD[SLOT] = (VALUE);                          \
+            (S)->dirty[COLUMN] |= 1 << (SLOT);                   \
+        }                                                        \
+    } while (0)
+
+/**
+ * @brief Sets or clears the flags of a mask
+ */
+static inline void x3d_flags_update(x3d_device_store_t *store, uint8_t slot, uint16_t mask, uint16_t set)
+{
+    uint16_t flags = (store->flags[slot] & ~mask) | (set & mask);
+    X3D_DEVICE_STORE(store, X3D_DEVICE_COLUMN_FLAGS, flags, slot, flags);
+}
+
+/*********************************************
+ * RF66xx
+ */
+
+#define RF66XX_SETPOINT_FLAGS   (X3D_SCHEMA_FLAG_DEFROST | X3D_SCHEMA_FLAG_TIMED | X3D_SCHEMA_FLAG_HEATER_ON | X3D_SCHEMA_FLAG_HEATER_STOPPED)
+#define RF66XX_ERROR_FLAGS      (X3D_SCHEMA_FLAG_WINDOW_OPEN | X3D_SCHEMA_FLAG_NO_TEMP_SENSOR | X3D_SCHEMA_FLAG_BATTERY_LOW)
+
+static const x3d_device_value_desc_t x3d_rf66xx_values[] = {
+    {JSON_ROOM_TEMP,         X3D_SCHEMA_DEVICE_ROOM_TEMP,         X3D_DEVICE_VALUE_UINT16,    offsetof(x3d_device_store_t, room_temp),         1,  2, 0},
+    {JSON_POWER,             X3D_SCHEMA_DEVICE_POWER,             X3D_DEVICE_VALUE_UINT8,     offsetof(x3d_device_store_t, power),             50, 0, 0},
+    {JSON_SET_POINT,         X3D_SCHEMA_DEVICE_SET_POINT,         X3D_DEVICE_VALUE_UINT8,     offsetof(x3d_device_store_t, set_point),         5,  1, 0},
+    {JSON_SET_POINT_DAY,     X3D_SCHEMA_DEVICE_SET_POINT_DAY,     X3D_DEVICE_VALUE_UINT8,     offsetof(x3d_device_store_t, set_point_day),     5,  1, 0},
+    {JSON_SET_POINT_NIGHT,   X3D_SCHEMA_DEVICE_SET_POINT_NIGHT,   X3D_DEVICE_VALUE_UINT8,     offsetof(x3d_device_store_t, set_point_night),   5,  1, 0},
+    {JSON_SET_POINT_DEFROST, X3D_SCHEMA_DEVICE_SET_POINT_DEFROST, X3D_DEVICE_VALUE_UINT8,     offsetof(x3d_device_store_t, set_point_defrost), 5,  1, 0},
+    {JSON_ENABLED,           X3D_DEVICE_NO_SCHEMA_KEY,            X3D_DEVICE_VALUE_FLAG,      offsetof(x3d_device_store_t, flags),             1,  0, X3D_SCHEMA_FLAG_ENABLED},
+    {JSON_ON_AIR,            X3D_DEVICE_NO_SCHEMA_KEY,            X3D_DEVICE_VALUE_FLAG,      offsetof(x3d_device_store_t, flags),             1,  0, X3D_SCHEMA_FLAG_ON_AIR},
+    {JSON_FLAGS,             X3D_SCHEMA_DEVICE_FLAGS,             X3D_DEVICE_VALUE_FLAG_LIST, offsetof(x3d_device_store_t, flags),             1,  0, 0xffff & ~(X3D_SCHEMA_FLAG_ENABLED | X3D_SCHEMA_FLAG_ON_AIR)},
+};
+
+static void x3d_rf66xx_decode_room_temp(x3d_device_store_t *store, uint8_t slot, uint16_t value)
+{
+    X3D_DEVICE_STORE(store, X3D_DEVICE_COLUMN_ROOM_TEMP, room_temp, slot, value);
+}
+
+static void x3d_rf66xx_decode_setpoint_status(x3d_device_store_t *store, uint8_t slot, uint16_t value)
+{
+    X3D_DEVICE_STORE(store, X3D_DEVICE_COLUMN_SET_POINT, set_point, slot, value & 0xff);
+    uint16_t flags = (FLAG_TO_BITFIELD(value, X3D_FLAG_DEFROST) ? X3D_SCHEMA_FLAG_DEFROST : 0)
+            | (FLAG_TO_BITFIELD(value, X3D_FLAG_TIMED) ? X3D_SCHEMA_FLAG_TIMED : 0)
+            | (FLAG_TO_BITFIELD(value, X3D_FLAG_HEATER_ON) ? X3D_SCHEMA_FLAG_HEATER_ON : 0)
+            | (FLAG_TO_BITFIELD(value, X3D_FLAG_HEATER_STOPPED) ? X3D_SCHEMA_FLAG_HEATER_STOPPED : 0);
+    x3d_flags_update(store, slot, RF66XX_SETPOINT_FLAGS, flags);
+}
+
+static void x3d_rf66xx_decode_error_status(x3d_device_store_t *store, uint8_t slot, uint16_t value)
+{
+    uint16_t flags = (FLAG_TO_BITFIELD(value, X3D_FLAG_WINDOW_OPEN) ? X3D_SCHEMA_FLAG_WINDOW_OPEN : 0)
+            | (FLAG_TO_BITFIELD(value, X3D_FLAG_NO_TEMP_SENSOR) ? X3D_SCHEMA_FLAG_NO_TEMP_SENSOR : 0)
+            | (FLAG_TO_BITFIELD(value, X3D_FLAG_BATTERY_LOW) ? X3D_SCHEMA_FLAG_BATTERY_LOW : 0);
+    x3d_flags_update(store, slot, RF66XX_ERROR_FLAGS, flags);
+}
+
+static void x3d_rf66xx_decode_on_off(x3d_device_store_t *store, uint8_t slot, uint16_t value)
+{
+    x3d_flags_update(store, slot, X3D_SCHEMA_FLAG_ENABLED, FLAG_TO_BITFIELD(value, 0x0001) ? X3D_SCHEMA_FLAG_ENABLED : 0);
+}
+
+static void x3d_rf66xx_decode_setpoint_defrost(x3d_device_store_t *store, uint8_t slot, uint16_t value)
+{
+    X3D_DEVICE_STORE(store, X3D_DEVICE_COLUMN_SET_POINT_DEFROST, set_point_defrost, slot, value & 0xff);
+}
+
+static void x3d_rf66xx_decode_setpoint_night_day(x3d_device_store_t *store, uint8_t slot, uint16_t value)
+{
+    X3D_DEVICE_STORE(store, X3D_DEVICE_COLUMN_SET_POINT_NIGHT, set_point_night, slot, value & 0xff);
+    X3D_DEVICE_STORE(store, X3D_DEVICE_COLUMN_SET_POINT_DAY, set_point_day, slot, (value >> 8) & 0xff);
+}
+
+static void x3d_rf66xx_decode_att_power(x3d_device_store_t *store, uint8_t slot, uint16_t value)
+{
+    X3D_DEVICE_STORE(store, X3D_DEVICE_COLUMN_POWER, power, slot, value & 0xff);
+}
+
+static void x3d_rf66xx_write_mode_temp(x3d_device_store_t *store, uint8_t slot, uint16_t value)
+{
+    // layout of the set point status without the heater state
+    X3D_DEVICE_STORE(store, X3D_DEVICE_COLUMN_SET_POINT, set_point, slot, value & 0xff);
+    uint16_t flags = (FLAG_TO_BITFIELD(value, X3D_FLAG_DEFROST) ? X3D_SCHEMA_FLAG_DEFROST : 0)
+            | (FLAG_TO_BITFIELD(value, X3D_FLAG_TIMED) ? X3D_SCHEMA_FLAG_TIMED : 0);
+    x3d_flags_update(store, slot, X3D_SCHEMA_FLAG_DEFROST | X3D_SCHEMA_FLAG_TIMED, flags);
+}
+
+static const x3d_device_write_desc_t x3d_rf66xx_writes[] = {
+    {X3D_REG_SET_MODE_TEMP, x3d_rf66xx_write_mode_temp},
+};
+
+/*********************************************
+ * Device types, ordered by x3d_device_type_t
+ */
+
+static const x3d_device_desc_t x3d_device_descs[X3D_DEVICE_TYPES] = {
+    [X3D_DEVICE_TYPE_NONE] = {
+        .name        = "none",
+    },
+    [X3D_DEVICE_TYPE_RF66XX] = {
+        .name        = "rf66xx",
+        .features    = X3D_DEVICE_FEATURE_OUTDOOR_TEMP | X3D_DEVICE_FEATURE_TEMP_ACTOR | X3D_DEVICE_FEATURE_PAIRING,
+        .value_count = sizeof(x3d_rf66xx_values) / sizeof(x3d_rf66xx_values[0]),
+        .values      = x3d_rf66xx_values,
+        .decode      = {
+            [X3D_DEVICE_FIELD_ROOM_TEMP]          = x3d_rf66xx_decode_room_temp,
+            [X3D_DEVICE_FIELD_SETPOINT_STATUS]    = x3d_rf66xx_decode_setpoint_status,
+            [X3D_DEVICE_FIELD_ERROR_STATUS]       = x3d_rf66xx_decode_error_status,
+            [X3D_DEVICE_FIELD_ON_OFF]             = x3d_rf66xx_decode_on_off,
+            [X3D_DEVICE_FIELD_SETPOINT_DEFROST]   = x3d_rf66xx_decode_setpoint_defrost,
+            [X3D_DEVICE_FIELD_SETPOINT_NIGHT_DAY] = x3d_rf66xx_decode_setpoint_night_day,
+            [X3D_DEVICE_FIELD_ATT_POWER]          = x3d_rf66xx_decode_att_power,
+        },
+        .write_count = sizeof(x3d_rf66xx_writes) / sizeof(x3d_rf66xx_writes[0]),
+        .writes      = x3d_rf66xx_writes,
+    },
+};
+
+/*********************************************
+ * Generic device functions
+ */
+
+const x3d_device_desc_t *x3d_device_desc(x3d_device_type_t type)
+{
+    if (type == X3D_DEVICE_TYPE_NONE || type >= X3D_DEVICE_TYPES)
+    {
+        return NULL;
+    }
+    return &x3d_device_descs[type];
+}
+
+const x3d_device_field_desc_t *x3d_device_field(x3d_device_field_t field)
+{
+    return &x3d_device_fields[field];
+}
+
+int x3d_device_field_from_reg(uint16_t reg)
+{
+    for (int f = 0; f < X3D_DEVICE_FIELDS; f++)
+    {
+        if (x3d_device_fields[f].reg == reg)
+        {
+            return f;
+        }
+    }
+    return -1;
+}
 
 const char * x3d_device_type_to_string(x3d_device_type_t type)
 {
-    switch (type)
+    if (type >= X3D_DEVICE_TYPES)
     {
-        case X3D_DEVICE_TYPE_NONE: return "none";
-        case X3D_DEVICE_TYPE_RF66XX: return "rf66xx";
+        return "unknown";
     }
-    return "unknown";
+    return x3d_device_descs[type].name;
 }
 
 x3d_device_type_t x3d_device_type_from_string(const char *str)
 {
-    if (strcmp(str, "rf66xx") == 0)
+    for (int t = X3D_DEVICE_TYPE_NONE + 1; t < X3D_DEVICE_TYPES; t++)
     {
-        return X3D_DEVICE_TYPE_RF66XX;
+        if (strcmp(str, x3d_device_descs[t].name) == 0)
+        {
+            return t;
+        }
     }
     return X3D_DEVICE_TYPE_NONE;
 }
 
-bool x3d_device_from_type(x3d_device_t *device, x3d_device_type_t type)
+x3d_device_feature_t x3d_device_features(x3d_device_type_t type)
 {
-    device->type = type;
-    switch (type)
+    const x3d_device_desc_t *desc = x3d_device_desc(type);
+    return desc == NULL ? 0 : desc->features;
+}
+
+bool x3d_device_set_type(x3d_device_store_t *store, uint8_t slot, x3d_device_type_t type)
+{
+    if (x3d_device_desc(type) == NULL)
+    {
+        type = X3D_DEVICE_TYPE_NONE;
+    }
+
+    store->type[slot]              = type;
+    store->flags[slot]             = 0;
+    store->room_temp[slot]         = 0;
+    store->power[slot]             = 0;
+    store->set_point[slot]         = 0;
+    store->set_point_day[slot]     = 0;
+    store->set_point_night[slot]   = 0;
+    store->set_point_defrost[slot] = 0;
+    for (int c = 0; c < X3D_DEVICE_COLUMNS; c++)
     {
-        case X3D_DEVICE_TYPE_RF66XX:
-            device->data = calloc(1, sizeof(x3d_rf66xx_t));
+        store->dirty[c] |= 1 << slot;
+    }
+    return type != X3D_DEVICE_TYPE_NONE;
+}
+
+void x3d_device_copy(x3d_device_store_t *store, const x3d_device_store_t *source, uint8_t slot)
+{
+    X3D_DEVICE_STORE(store, X3D_DEVICE_COLUMN_TYPE, type, slot, source->type[slot]);
+    X3D_DEVICE_STORE(store, X3D_DEVICE_COLUMN_FLAGS, flags, slot, source->flags[slot]);
+    X3D_DEVICE_STORE(store, X3D_DEVICE_COLUMN_ROOM_TEMP, room_temp, slot, source->room_temp[slot]);
+    X3D_DEVICE_STORE(store, X3D_DEVICE_COLUMN_POWER, power, slot, source->power[slot]);
+    X3D_DEVICE_STORE(store, X3D_DEVICE_COLUMN_SET_POINT, set_point, slot, source->set_point[slot]);
+    X3D_DEVICE_STORE(store, X3D_DEVICE_COLUMN_SET_POINT_DAY, set_point_day, slot, source->set_point_day[slot]);
+    X3D_DEVICE_STORE(store, X3D_DEVICE_COLUMN_SET_POINT_NIGHT, set_point_night, slot, source->set_point_night[slot]);
+    X3D_DEVICE_STORE(store, X3D_DEVICE_COLUMN_SET_POINT_DEFROST, set_point_defrost, slot, source->set_point_defrost[slot]);
+}
+
+bool x3d_device_has_field(const x3d_device_store_t *store, uint8_t slot, x3d_device_field_t field)
+{
+    const x3d_device_desc_t *desc = x3d_device_desc(store->type[slot]);
+    return desc != NULL && desc->decode[field] != NULL;
+}
+
+void x3d_device_set_from_reg(x3d_device_store_t *store, uint8_t slot, int req, int ack, x3d_device_field_t field, uint16_t value)
+{
+    if (!req || !x3d_device_has_field(store, slot, field))
+    {
+        return;
+    }
+
+    x3d_device_set_flags(store, slot, X3D_SCHEMA_FLAG_ON_AIR, ack);
+    if (ack)
+    {
+        x3d_device_desc(store->type[slot])->decode[field](store, slot, value);
+    }
+}
+
+bool x3d_device_set_from_write(x3d_device_store_t *store, uint8_t slot, uint16_t reg, uint16_t value)
+{
+    const x3d_device_desc_t *desc = x3d_device_desc(store->type[slot]);
+    for (int i = 0; desc != NULL && i < desc->write_count; i++)
+    {
+        if (desc->writes[i].reg == reg)
+        {
+            desc->writes[i].decode(store, slot, value);
             return true;
-        default:
-            if (device->data != NULL)
-            {
-                free(device->data);
-            }
-            device->data = NULL;
+        }
+    }
+    return false;
+}
+
+bool x3d_device_fields_read(const x3d_device_store_t *store, uint8_t slot, const uint32_t *read_time)
+{
+    for (int f = 0; f < X3D_DEVICE_FIELDS; f++)
+    {
+        if (x3d_device_has_field(store, slot, f) && read_time[f] == 0)
+        {
             return false;
+        }
     }
+    return true;
 }
 
-cJSON * x3d_rf66xx_to_json(x3d_rf66xx_t *device)
+void x3d_device_apply_register(x3d_device_store_t *store, uint32_t (*read_time)[X3D_DEVICE_FIELDS], uint32_t now,
+        const x3d_standard_msg_payload_t *payload, uint16_t acked)
 {
-    cJSON *root = cJSON_CreateObject();
-    cJSON_AddStringToObject(root, JSON_TYPE, x3d_device_type_to_string(X3D_DEVICE_TYPE_RF66XX));
-    cJSON_AddNumberToObject(root, JSON_ROOM_TEMP, (double)device->room_temp / 100.0);
-    cJSON_AddNumberToObject(root, JSON_POWER, (uint16_t)device->power * 50);
-    cJSON_AddNumberToObject(root, JSON_SET_POINT, (double)device->set_point * 0.5);
-    cJSON_AddNumberToObject(root, JSON_SET_POINT_DAY, (double)device->set_point_day * 0.5);
-    cJSON_AddNumberToObject(root, JSON_SET_POINT_NIGHT, (double)device->set_point_night * 0.5);
-    cJSON_AddNumberToObject(root, JSON_SET_POINT_DEFROST, (double)device->set_point_defrost * 0.5);
-    cJSON_AddBoolToObject(root, JSON_ENABLED, device->enabled);
-    cJSON_AddBoolToObject(root, JSON_ON_AIR, device->on_air);
-    cJSON *flags = cJSON_AddArrayToObject(root, JSON_FLAGS);
-    if (device->defrost)
+    uint16_t reg = payload->reg_high << 8 | payload->reg_low;
+    int field    = x3d_device_field_from_reg(reg);
+    for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
     {
-        cJSON_AddItemToArray(flags, cJSON_CreateString(JSON_DEFROST));
+        if ((acked & (1 << i)) == 0)
+        {
+            continue;
+        }
+        if (field >= 0 && x3d_device_has_field(store, i, field))
+        {
+            x3d_device_set_from_reg(store, i, 1, 1, field, payload->data[i]);
+            if (read_time != NULL)
+            {
+                read_time[i][field] = now;
+                if (x3d_device_fields_read(store, i, read_time[i]))
+                {
+                    x3d_device_set_flags(store, i, X3D_SCHEMA_FLAG_STALE, false);
+                }
+            }
+        }
+        else if ((payload->action & X3D_REGISTER_ACTION_MASK) == X3D_REGISTER_ACTION_WRITE)
+        {
+            x3d_device_set_from_write(store, i, reg, payload->data[i]);
+        }
     }
-    if (device->timed)
+}
+
+/**
+ * @brief Reads the raw value of a value descriptor
+ */
+static uint16_t x3d_device_raw_value(const x3d_device_store_t *store, uint8_t slot, const x3d_device_value_desc_t *value)
+{
+    const uint8_t *column = (const uint8_t *)store + value->offset;
+    switch (value->type)
     {
-        cJSON_AddItemToArray(flags, cJSON_CreateString(JSON_TIMED));
+        case X3D_DEVICE_VALUE_UINT8:
+            return column[slot];
+        case X3D_DEVICE_VALUE_UINT16:
+            return ((const uint16_t *)column)[slot];
+        default:
+            return ((const uint16_t *)column)[slot] & value->mask;
     }
-    if (device->heater_on)
+}
+
+bool x3d_device_get_value(const x3d_device_store_t *store, uint8_t slot, uint8_t schema_key, uint16_t *value)
+{
+    const x3d_device_desc_t *desc = x3d_device_desc(store->type[slot]);
+    if (desc == NULL)
     {
-        cJSON_AddItemToArray(flags, cJSON_CreateString(JSON_HEATER_ON));
+        return false;
     }
-    if (device->heater_stopped)
+
+    for (int i = 0; i < desc->value_count; i++)
     {
-        cJSON_AddItemToArray(flags, cJSON_CreateString(JSON_HEATER_STOPPED));
+        if (desc->values[i].schema_key == schema_key)
+        {
+            *value = x3d_device_raw_value(store, slot, &desc->values[i]);
+            return true;
+        }
     }
-    if (device->window_open)
+    return false;
+}
+
+uint16_t x3d_device_flags(const x3d_device_store_t *store, uint8_t slot)
+{
+    if (x3d_device_desc(store->type[slot]) == NULL)
     {
-        cJSON_AddItemToArray(flags, cJSON_CreateString(JSON_WINDOW_OPEN));
+        return 0;
     }
-    if (device->no_temp_sensor)
+    return store->flags[slot];
+}
+
+void x3d_device_set_flags(x3d_device_store_t *store, uint8_t slot, uint16_t mask, bool set)
+{
+    if (x3d_device_desc(store->type[slot]) == NULL)
     {
-        cJSON_AddItemToArray(flags, cJSON_CreateString(JSON_NO_TEMP_SENSOR));
+        return;
     }
-    if (device->battery_low)
+    x3d_flags_update(store, slot, mask, set ? mask : 0);
+}
+
+uint16_t x3d_device_dirty(const x3d_device_store_t *store)
+{
+    uint16_t dirty = 0;
+    for (int c = 0; c < X3D_DEVICE_COLUMNS; c++)
     {
-        cJSON_AddItemToArray(flags, cJSON_CreateString(JSON_BATTERY_LOW));
+        dirty |= store->dirty[c];
     }
+    return dirty;
+}
 
-    return root;
+void x3d_device_clean(x3d_device_store_t *store, uint16_t mask)
+{
+    for (int c = 0; c < X3D_DEVICE_COLUMNS; c++)
+    {
+        store->dirty[c] &= ~mask;
+    }
 }
 
-void x3d_rf66xx_set_from_reg(x3d_rf66xx_t *device, int req, int ack, uint16_t reg, uint16_t data)
+void x3d_device_to_json(const x3d_device_store_t *store, uint8_t slot, json_writer_t *writer, const char *key)
 {
-    if (!req)
+    const x3d_device_desc_t *desc = x3d_device_desc(store->type[slot]);
+    if (desc == NULL)
     {
         return;
     }
 
-    if (!ack)
+    json_writer_object_begin(writer, key);
+    json_writer_string(writer, JSON_TYPE, desc->name);
+    for (int i = 0; i < desc->value_count; i++)
+    {
+        const x3d_device_value_desc_t *value = &desc->values[i];
+        uint16_t raw                         = x3d_device_raw_value(store, slot, value);
+        switch (value->type)
+        {
+            case X3D_DEVICE_VALUE_UINT8:
+            case X3D_DEVICE_VALUE_UINT16:
+                if (value->decimals == 0)
+                {
+                    json_writer_int(writer, value->key, (int32_t)raw * value->scale);
+                }
+                else
+                {
+                    json_writer_fixed(writer, value->key, (int32_t)raw * value->scale, value->decimals);
+                }
+                break;
+            case X3D_DEVICE_VALUE_FLAG:
+                json_writer_bool(writer, value->key, raw != 0);
+                break;
+            case X3D_DEVICE_VALUE_FLAG_LIST:
+                json_writer_array_begin(writer, value->key);
+                for (int b = 0; b < sizeof(x3d_flag_names) / sizeof(x3d_flag_names[0]); b++)
+                {
+                    if (raw & (1 << b))
+                    {
+                        json_writer_string(writer, NULL, x3d_flag_names[b]);
+                    }
+                }
+                json_writer_array_end(writer);
+                break;
+        }
+    }
+    json_writer_object_end(writer);
+}
+
+void x3d_device_to_cbor(const x3d_device_store_t *store, uint8_t slot, cbor_writer_t *writer)
+{
+    const x3d_device_desc_t *desc = x3d_device_desc(store->type[slot]);
+    if (desc == NULL)
     {
-        device->on_air = 0;
         return;
     }
 
-    device->on_air = 1;
-    switch (reg)
-    {
-    case X3D_REG_ATT_POWER:
-        device->power = data & 0xff;
-        break;
-    case X3D_REG_ROOM_TEMP:
-        device->room_temp = data;
-        break;
-    case X3D_REG_SETPOINT_STATUS:
-        device->set_point      = data & 0xff;
-        uint16_t flags         = data & 0xff00;
-        device->defrost        = FLAG_TO_BITFIELD(flags, X3D_FLAG_DEFROST);
-        device->timed          = FLAG_TO_BITFIELD(flags, X3D_FLAG_TIMED);
-        device->heater_on      = FLAG_TO_BITFIELD(flags, X3D_FLAG_HEATER_ON);
-        device->heater_stopped = FLAG_TO_BITFIELD(flags, X3D_FLAG_HEATER_STOPPED);
-        break;
-    case X3D_REG_ERROR_STATUS:
-        device->window_open    = FLAG_TO_BITFIELD(data, X3D_FLAG_WINDOW_OPEN);
-        device->no_temp_sensor = FLAG_TO_BITFIELD(data, X3D_FLAG_NO_TEMP_SENSOR);
-        device->battery_low    = FLAG_TO_BITFIELD(data, X3D_FLAG_BATTERY_LOW);
-        break;
-    case X3D_REG_ON_OFF:
-        device->enabled = FLAG_TO_BITFIELD(data, 0x0001);
-        break;
-    case X3D_REG_MODE_TIME:
-        break;
-    case X3D_REG_SETPOINT_DEFROST:
-        device->set_point_defrost = data & 0xff;
-        break;
-    case X3D_REG_SETPOINT_NIGHT_DAY:
-        device->set_point_night = data & 0xff;
-        device->set_point_day   = (data >> 8) & 0xff;
-        break;
-    }
-}
\ No newline at end of file
+    int count = 1;
+    for (int i = 0; i < desc->value_count; i++)
+    {
+        count += desc->values[i].schema_key != X3D_DEVICE_NO_SCHEMA_KEY;
+    }
+
+    // the flags are written as one bit mask including the json only flag values
+    cbor_writer_map(writer, count);
+    cbor_writer_uint(writer, X3D_SCHEMA_DEVICE_TYPE);
+    cbor_writer_uint(writer, store->type[slot]);
+    for (int i = 0; i < desc->value_count; i++)
+    {
+        const x3d_device_value_desc_t *value = &desc->values[i];
+        if (value->schema_key == X3D_DEVICE_NO_SCHEMA_KEY)
+        {
+            continue;
+        }
+        cbor_writer_uint(writer, value->schema_key);
+        cbor_writer_uint(writer, value->type == X3D_DEVICE_VALUE_FLAG_LIST ? x3d_device_flags(store, slot) : x3d_device_raw_value(store, slot, value));
+    }
+}
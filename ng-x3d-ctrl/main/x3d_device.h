@@ -7,17 +7,26 @@
  *
  * @copyright Copyright (c) 2024
  *
+ * Every device type is described by a x3d_device_desc_t, the generic functions decode, poll and serialize
+ * the device data from the descriptor. A new type is added by its store columns, descriptor and value table.
+ *
+ * The devices of a network are kept in a static x3d_device_store_t with one array per value indexed by the
+ * device slot, a device is addressed by the store and its slot.
  */
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <inttypes.h>
-#include "cJSON.h"
+#include "x3d.h"
+#include "json_writer.h"
+#include "cbor_writer.h"
 
 // Type of X3D device
 typedef enum __attribute__ ((__packed__)) {
     X3D_DEVICE_TYPE_NONE = 0,
     X3D_DEVICE_TYPE_RF66XX = 1,
+    X3D_DEVICE_TYPES,
 } x3d_device_type_t;
 _Static_assert(sizeof(x3d_device_type_t) == 1); // make shure it's 1 byte long, coule be extended if device types overflow 255
 
@@ -25,41 +34,131 @@ _Static_assert(sizeof(x3d_device_type_t) == 1); // make shure it's 1 byte long,
 typedef enum {
     X3D_DEVICE_FEATURE_OUTDOOR_TEMP = 0x01,
     X3D_DEVICE_FEATURE_TEMP_ACTOR =  0x02,
+    X3D_DEVICE_FEATURE_PAIRING = 0x04, // joins a network by the pairing transaction
 } x3d_device_feature_t;
 
-// list of fatures per device
-static const x3d_device_feature_t x3d_device_feature_list[] = {
-    // X3D_DEVICE_TYPE_NONE
-    0,
-    // X3D_DEVICE_TYPE_RF66XX
-    X3D_DEVICE_FEATURE_OUTDOOR_TEMP | X3D_DEVICE_FEATURE_TEMP_ACTOR,
-};
-
-// Device data type
-typedef struct
-{
-    x3d_device_type_t type;
-    void *data;
-} x3d_device_t;
-
-typedef struct
-{
-    uint16_t room_temp;
-    uint8_t power;
-    uint8_t set_point;
-    uint8_t set_point_day;
-    uint8_t set_point_night;
-    uint8_t set_point_defrost;
-    int on_air : 1;
-    int enabled : 1;
-    int defrost : 1;
-    int timed : 1;
-    int heater_on : 1;
-    int heater_stopped : 1;
-    int window_open : 1;
-    int no_temp_sensor : 1;
-    int battery_low : 1;
-} x3d_rf66xx_t;
+// status fields, one per status register, the same register has the same field on all device types
+typedef enum {
+    X3D_DEVICE_FIELD_ROOM_TEMP = 0,
+    X3D_DEVICE_FIELD_SETPOINT_STATUS,
+    X3D_DEVICE_FIELD_ERROR_STATUS,
+    X3D_DEVICE_FIELD_ON_OFF,
+    X3D_DEVICE_FIELD_SETPOINT_DEFROST,
+    X3D_DEVICE_FIELD_SETPOINT_NIGHT_DAY,
+    X3D_DEVICE_FIELD_ATT_POWER,
+    X3D_DEVICE_FIELDS,
+} x3d_device_field_t;
+
+// read interval class of a status field
+typedef enum {
+    X3D_DEVICE_POLL_FAST = 0,
+    X3D_DEVICE_POLL_SLOW,
+    X3D_DEVICE_POLL_RARE,
+    X3D_DEVICE_POLL_CLASSES,
+} x3d_device_poll_t;
+
+/// @brief Status register
+typedef struct {
+    uint16_t reg;
+    const char *key;            ///< json key of the field
+    x3d_device_poll_t poll;     ///< read interval class of the scheduler
+    bool short_status;          ///< read by device-status-short
+} x3d_device_field_desc_t;
+
+/// @brief Encoding of a device value
+typedef enum {
+    X3D_DEVICE_VALUE_UINT8 = 0, ///< uint8_t column, json raw * scale with decimals
+    X3D_DEVICE_VALUE_UINT16,    ///< uint16_t column, json raw * scale with decimals
+    X3D_DEVICE_VALUE_FLAG,      ///< one bit of the flags, json bool
+    X3D_DEVICE_VALUE_FLAG_LIST, ///< bits of the flags, json array of the set flag names
+} x3d_device_value_type_t;
+
+// columns of the device store, each has a dirty mask
+typedef enum {
+    X3D_DEVICE_COLUMN_TYPE = 0,
+    X3D_DEVICE_COLUMN_FLAGS,
+    X3D_DEVICE_COLUMN_ROOM_TEMP,
+    X3D_DEVICE_COLUMN_POWER,
+    X3D_DEVICE_COLUMN_SET_POINT,
+    X3D_DEVICE_COLUMN_SET_POINT_DAY,
+    X3D_DEVICE_COLUMN_SET_POINT_NIGHT,
+    X3D_DEVICE_COLUMN_SET_POINT_DEFROST,
+    X3D_DEVICE_COLUMNS,
+} x3d_device_column_t;
+
+/// @brief Device state of a network, the columns are indexed by the device slot
+typedef struct {
+    x3d_device_type_t type[X3D_MAX_NET_DEVICES];
+    uint16_t flags[X3D_MAX_NET_DEVICES];             ///< x3d_schema_flag_t
+    uint16_t room_temp[X3D_MAX_NET_DEVICES];
+    uint8_t power[X3D_MAX_NET_DEVICES];
+    uint8_t set_point[X3D_MAX_NET_DEVICES];
+    uint8_t set_point_day[X3D_MAX_NET_DEVICES];
+    uint8_t set_point_night[X3D_MAX_NET_DEVICES];
+    uint8_t set_point_defrost[X3D_MAX_NET_DEVICES];
+    uint16_t dirty[X3D_DEVICE_COLUMNS];             ///< slots changed since the last publish per column
+} x3d_device_store_t;
+
+// size of the persistent part of the store, without the dirty masks
+#define X3D_DEVICE_STORE_DATA_SIZE      offsetof(x3d_device_store_t, dirty)
+
+// value not part of the cbor map
+#define X3D_DEVICE_NO_SCHEMA_KEY 0xff
+
+/// @brief Value of the device data
+typedef struct {
+    const char *key;                ///< json key
+    uint8_t schema_key;             ///< cbor map key x3d_schema_device_key_t or X3D_DEVICE_NO_SCHEMA_KEY
+    x3d_device_value_type_t type;
+    uint8_t offset;                 ///< offset of the column in x3d_device_store_t
+    uint8_t scale;                  ///< json value is raw * scale
+    uint8_t decimals;               ///< json fixed point decimals
+    uint16_t mask;                  ///< x3d_schema_flag_t bits of flag values
+} x3d_device_value_desc_t;
+
+/// @brief Decodes a status register value into the store columns of a slot
+typedef void (*x3d_device_decode_t)(x3d_device_store_t *store, uint8_t slot, uint16_t value);
+
+/// @brief Written register without status field, the written value is decoded into the store
+typedef struct {
+    uint16_t reg;
+    x3d_device_decode_t decode;
+} x3d_device_write_desc_t;
+
+/// @brief Descriptor of a device type
+typedef struct {
+    const char *name;
+    x3d_device_feature_t features;
+    uint8_t value_count;
+    const x3d_device_value_desc_t *values;          ///< serialized values in order
+    x3d_device_decode_t decode[X3D_DEVICE_FIELDS];  ///< decoder per status field, NULL if not supported
+    uint8_t write_count;
+    const x3d_device_write_desc_t *writes;          ///< written registers mirrored without a status read
+} x3d_device_desc_t;
+
+/**
+ * @brief Returns the descriptor of a device type
+ *
+ * @param type device type
+ * @return const x3d_device_desc_t* NULL for X3D_DEVICE_TYPE_NONE and unknown types
+ */
+const x3d_device_desc_t *x3d_device_desc(x3d_device_type_t type);
+
+/**
+ * @brief Returns the descriptor of a status field
+ *
+ * @param field status field
+ * @return const x3d_device_field_desc_t*
+ */
+const x3d_device_field_desc_t *x3d_device_field(x3d_device_field_t field);
+
+/**
+ * @brief Returns the status field of a register
+ *
+ * @param reg register
+ * @return int x3d_device_field_t, -1 if the register is no status register
+ */
+int x3d_device_field_from_reg(uint16_t reg);
 
 /**
  * @brief convert type to string
@@ -78,29 +177,150 @@ const char * x3d_device_type_to_string(x3d_device_type_t type);
 x3d_device_type_t x3d_device_type_from_string(const char *str);
 
 /**
- * @brief sets device type struct from type
+ * @brief Returns the features of a device type
  *
- * @param device pointer to target struct
- * @param type type of device
+ * @param type device type
+ * @return x3d_device_feature_t
+ */
+x3d_device_feature_t x3d_device_features(x3d_device_type_t type);
+
+/**
+ * @brief Sets the type of a slot and clears its values, all columns of the slot are marked dirty
+ *
+ * @param store device store
+ * @param slot device slot
+ * @param type type of device, X3D_DEVICE_TYPE_NONE to remove the device
  * @return bool true if device is valisd
  */
-bool x3d_device_from_type(x3d_device_t *device, x3d_device_type_t type);
+bool x3d_device_set_type(x3d_device_store_t *store, uint8_t slot, x3d_device_type_t type);
 
 /**
- * @brief Converts x3d_rf66xx_t device to json object
+ * @brief Copies the values of a slot to another store, the changed columns are marked dirty
  *
- * @param device pointer to target struct
- * @return cJSON*
+ * @param store target store
+ * @param source source store
+ * @param slot device slot
  */
-cJSON * x3d_rf66xx_to_json(x3d_rf66xx_t *device);
+void x3d_device_copy(x3d_device_store_t *store, const x3d_device_store_t *source, uint8_t slot);
 
 /**
- * @brief Sets rf66xx data from reg
+ * @brief Checks if the device type has a status field
  *
- * @param device pointer to target struct
+ * @param store device store
+ * @param slot device slot
+ * @param field status field
+ * @return bool
+ */
+bool x3d_device_has_field(const x3d_device_store_t *store, uint8_t slot, x3d_device_field_t field);
+
+/**
+ * @brief Sets the device values from a status register read
+ *
+ * @param store device store
+ * @param slot device slot
  * @param req is device requested (target)
  * @param ack has device respond (target_ack)
- * @param reg register
- * @param data data
+ * @param field status field of the register
+ * @param value register value
+ */
+void x3d_device_set_from_reg(x3d_device_store_t *store, uint8_t slot, int req, int ack, x3d_device_field_t field, uint16_t value);
+
+/**
+ * @brief Sets the device values from a register write the device acknowledged, for registers without status field
+ *
+ * @param store device store
+ * @param slot device slot
+ * @param reg written register
+ * @param value written value
+ * @return bool false if the device type does not mirror the register
+ */
+bool x3d_device_set_from_write(x3d_device_store_t *store, uint8_t slot, uint16_t reg, uint16_t value);
+
+/**
+ * @brief Checks if all status fields of the device type were read
+ *
+ * @param store device store
+ * @param slot device slot
+ * @param read_time read time per status field of the slot, 0 if not read
+ * @return bool
+ */
+bool x3d_device_fields_read(const x3d_device_store_t *store, uint8_t slot, const uint32_t *read_time);
+
+/**
+ * @brief Mirrors a register read or write of another initiator into the store.
+ * Status registers refresh the field like an own read, written registers without status field are
+ * decoded by the device type if supported.
+ *
+ * @param store device store
+ * @param read_time read time per slot and status field, NULL if not tracked
+ * @param now read time to set
+ * @param payload merged payload of the transaction
+ * @param acked slots acknowledged
+ */
+void x3d_device_apply_register(x3d_device_store_t *store, uint32_t (*read_time)[X3D_DEVICE_FIELDS], uint32_t now,
+        const x3d_standard_msg_payload_t *payload, uint16_t acked);
+
+/**
+ * @brief Returns a raw value of the device
+ *
+ * @param store device store
+ * @param slot device slot
+ * @param schema_key x3d_schema_device_key_t of the value
+ * @param value raw value
+ * @return bool false if the device type has no such value
+ */
+bool x3d_device_get_value(const x3d_device_store_t *store, uint8_t slot, uint8_t schema_key, uint16_t *value);
+
+/**
+ * @brief Returns the x3d_schema_flag_t flags of the device, 0 if there is no device
+ *
+ * @param store device store
+ * @param slot device slot
+ * @return uint16_t
+ */
+uint16_t x3d_device_flags(const x3d_device_store_t *store, uint8_t slot);
+
+/**
+ * @brief Sets or clears x3d_schema_flag_t flags of the device
+ *
+ * @param store device store
+ * @param slot device slot
+ * @param mask flags
+ * @param set true to set, false to clear
+ */
+void x3d_device_set_flags(x3d_device_store_t *store, uint8_t slot, uint16_t mask, bool set);
+
+/**
+ * @brief Returns the slots with a changed column since the last publish
+ *
+ * @param store device store
+ * @return uint16_t slot mask
+ */
+uint16_t x3d_device_dirty(const x3d_device_store_t *store);
+
+/**
+ * @brief Clears the dirty bits of published slots
+ *
+ * @param store device store
+ * @param mask slot mask
+ */
+void x3d_device_clean(x3d_device_store_t *store, uint16_t mask);
+
+/**
+ * @brief Writes the device as json object
+ *
+ * @param store device store
+ * @param slot device slot
+ * @param writer pointer to json writer
+ * @param key key in the parent object, NULL for root
+ */
+void x3d_device_to_json(const x3d_device_store_t *store, uint8_t slot, json_writer_t *writer, const char *key);
+
+/**
+ * @brief Writes the device as cbor map, see x3d_schema.h
+ *
+ * @param store device store
+ * @param slot device slot
+ * @param writer pointer to cbor writer
  */
-void x3d_rf66xx_set_from_reg(x3d_rf66xx_t *device, int req, int ack, uint16_t reg, uint16_t data);
+void x3d_device_to_cbor(const x3d_device_store_t *store, uint8_t slot, cbor_writer_t *writer);
@@ -16,7 +16,11 @@
 
 #include "rfm.h"
 #include "x3d.h"
+#include "x3d_airtime.h"
 #include "x3d_handler.h"
+#include "x3d_timing.h"
+#include "x3d_topology.h"
+#include "x3d_trace.h"
 
 #define X3D_RETRY_COUNT_DEFAULT           3
 #define X3D_RETRY_COUNT_PAIR              5
@@ -24,12 +28,96 @@
 #define X3D_PER_DEVICE_WAIT_SLOTS_DEFAULT 3
 #define X3D_PER_DEVICE_WAIT_SLOTS_PAIR    4
 
+// pairing
+#define X3D_PAIR_OPEN_WAIT_MS             5000 // maximum wait for the pin of a device in pairing
+#define X3D_PAIR_MAX_PINS                 4    // distinct pins tracked of devices in pairing at the same time
+
+// message counters are persisted in blocks, the step must stay below X3D_MSG_ID_WINDOW
+#define X3D_COUNTER_RESERVE               16
+
+// number of foreign initiators tracked for replay detection
+#define X3D_INITIATORS                    8
+
+// window sensors tracked to drop the repeats of a frame
+#define X3D_SENSORS                       8
+#define X3D_SENSOR_REPEAT_MS              1000 // repeats follow within this time, a later frame with the same number is new
+
+// foreign register transactions merged at the same time
+#define X3D_FOREIGN_TRANSACTIONS          2
+
+// re-query of targets which did not acknowledge
+#define X3D_REQUERY_ATTEMPTS              2   // follow-up transactions after the first one
+#define X3D_REQUERY_BACKOFF_MS            100 // wait before the first follow-up, doubled each attempt
+
+// listen before talk
+#define X3D_LBT_RSSI_THRESHOLD            -95  // dBm, a carrier above is treated as foreign transmission
+#define X3D_LBT_HOLD_SLOTS                3    // slots the air is kept busy after a foreign relay frame
+#define X3D_LBT_BACKOFF_SLOTS             2    // slots to wait on a busy carrier without decoded frame
+#define X3D_LBT_MAX_DEFER_MS              3000 // transmit anyway after this time
+
 uint32_t x3d_device_id;
 uint8_t x3d_buffer[64];
 uint8_t x3d_msg_no  = 1;
 uint16_t x3d_msg_id = 1;
 TickType_t x3d_last_rx_ts;
 
+// end of the foreign mesh exchange estimated from the received frames
+static TickType_t x3d_busy_until_ts;
+
+// set while the own transaction is on air or waits for responses
+static volatile bool x3d_tx_active = false;
+
+// completion of the own transaction, set by the processor if all targets acknowledged
+static volatile bool x3d_complete = false;
+static TickType_t x3d_tx_end_ts;
+static TickType_t x3d_complete_ts;
+static TaskHandle_t x3d_wait_task = NULL;
+
+static x3d_channel_stats_t x3d_channel_stats = {0};
+
+// persisted upper bound of the message id and the store callback
+static uint16_t x3d_reserved_msg_id;
+static x3d_counter_store_t x3d_counter_store = NULL;
+
+/// @brief Last decrypted message id of a foreign initiator
+typedef struct {
+    uint32_t device_id;
+    uint16_t msg_id;
+    TickType_t last_ts;
+} x3d_initiator_t;
+
+static x3d_initiator_t x3d_initiators[X3D_INITIATORS];
+
+// last frame of a window sensor
+typedef struct {
+    uint32_t device_id;
+    uint8_t msg_no;
+    TickType_t last_ts;
+} x3d_sensor_t;
+
+static x3d_sensor_t x3d_sensors[X3D_SENSORS];
+static x3d_window_cb_t x3d_window_cb = NULL;
+
+// merged frames of a foreign register transaction
+typedef struct {
+    uint8_t buffer[64];
+    uint16_t reported;      ///< targets already reported
+    TickType_t last_ts;
+} x3d_foreign_t;
+
+static x3d_foreign_t x3d_foreign[X3D_FOREIGN_TRANSACTIONS];
+static x3d_foreign_cb_t x3d_foreign_cb = NULL;
+
+// merged result of a register transaction and its re-queries
+static x3d_standard_msg_payload_t x3d_result;
+
+// pins received on the open pairing message, the first one is kept in the message
+static uint16_t x3d_pair_pins[X3D_PAIR_MAX_PINS];
+static uint8_t x3d_pair_pin_count = 0;
+
+// slot acknowledge of the pinned confirmation, 0 in the open phase
+static uint16_t x3d_pair_ack_mask = 0;
+
 static inline int no_of_devices(uint16_t mask)
 {
     return __builtin_popcount(mask);
@@ -40,11 +128,291 @@ static inline int get_lowest_zerobit(uint16_t value)
     return __builtin_ctz(~value);
 }
 
+/**
+ * @brief Returns the merged acknowledge mask of the own message.
+ * Standard messages acknowledge in the register ack field, others in the transferred field.
+ *
+ * @param payload_index index of the payload
+ * @return uint16_t acknowledge mask
+ */
+static uint16_t x3d_merged_ack(uint8_t payload_index)
+{
+    if (x3d_buffer[X3D_IDX_MSG_TYPE] == X3D_MSG_TYPE_STANDARD && payload_index + X3D_OFF_REGISTER_ACK + 1 < x3d_buffer[0])
+    {
+        return x3d_buffer[payload_index + X3D_OFF_REGISTER_ACK] | x3d_buffer[payload_index + X3D_OFF_REGISTER_ACK + 1] << 8;
+    }
+    return x3d_get_retrans_ack(x3d_buffer, payload_index);
+}
+
+/**
+ * @brief Estimates how long a foreign exchange occupies the air from a received frame.
+ * Initiator frames count down to zero before the mesh devices start to relay, so the air is busy
+ * for the remaining count plus the response slots of all devices in the transfer mask.
+ * Relay frames and frames without response keep the air busy for a few slots only.
+ *
+ * @param buffer received message
+ * @return TickType_t busy time from now
+ */
+static TickType_t x3d_foreign_busy_ticks(uint8_t *buffer)
+{
+    uint8_t payload_index = (buffer[X3D_IDX_HEADER_LEN] & X3D_HEADER_LENGTH_MASK) + X3D_IDX_HEADER_LEN;
+    if (buffer[X3D_IDX_MSG_TYPE] == X3D_MSG_TYPE_SENSOR ||
+            (buffer[X3D_IDX_HEADER_LEN] & X3D_HEADER_FLAG_NO_RESPONSE) ||
+            payload_index + X3D_OFF_RETRANS_ACK_SLOT >= buffer[X3D_IDX_PKT_LEN])
+    {
+        return pdMS_TO_TICKS(X3D_LBT_HOLD_SLOTS * X3D_MSG_DELAY_MS);
+    }
+
+    uint8_t count = buffer[payload_index];
+    if ((count & 0xf0) != 0)
+    {
+        // relay frame, higher nibble is the response counter
+        return pdMS_TO_TICKS(X3D_LBT_HOLD_SLOTS * X3D_MSG_DELAY_MS);
+    }
+
+    uint16_t transfer = buffer[payload_index + X3D_OFF_RETRANS_SLOT] | buffer[payload_index + X3D_OFF_RETRANS_SLOT + 1] << 8;
+    int slots         = (count & 0x0f) + 1 + (no_of_devices(transfer) + 1) * X3D_PER_DEVICE_WAIT_SLOTS_DEFAULT;
+    return pdMS_TO_TICKS(slots * X3D_MSG_DELAY_MS);
+}
+
+/**
+ * @brief Tracks foreign traffic for listen before talk.
+ *
+ * @param buffer received message
+ */
+static void x3d_track_foreign(uint8_t *buffer)
+{
+    x3d_channel_stats.foreign_frames++;
+    if (x3d_tx_active)
+    {
+        x3d_channel_stats.collisions++;
+    }
+
+    TickType_t busy_until = x3d_last_rx_ts + x3d_foreign_busy_ticks(buffer);
+    if ((int32_t)(busy_until - x3d_busy_until_ts) > 0)
+    {
+        x3d_busy_until_ts = busy_until;
+    }
+}
+
+/**
+ * @brief Merges a frame of a foreign register transaction and reports the targets acknowledged since the last frame.
+ * A transaction is identified by its header, a new one replaces the least recently seen transaction.
+ *
+ * @param buffer received message
+ */
+static void x3d_foreign_merge(uint8_t *buffer)
+{
+    uint8_t payload_index = (buffer[X3D_IDX_HEADER_LEN] & X3D_HEADER_LENGTH_MASK) + X3D_IDX_HEADER_LEN;
+    uint8_t length        = buffer[X3D_IDX_PKT_LEN];
+    if (x3d_foreign_cb == NULL || buffer[X3D_IDX_MSG_TYPE] != X3D_MSG_TYPE_STANDARD || length >= sizeof(x3d_foreign[0].buffer)
+            || payload_index + X3D_OFF_REGISTER_ACK + 1 >= length)
+    {
+        return;
+    }
+
+    x3d_foreign_t *entry = &x3d_foreign[0];
+    bool found           = false;
+    for (int i = 0; i < X3D_FOREIGN_TRANSACTIONS; i++)
+    {
+        if (x3d_foreign[i].buffer[X3D_IDX_PKT_LEN] == length && memcmp(x3d_foreign[i].buffer, buffer, payload_index) == 0)
+        {
+            entry = &x3d_foreign[i];
+            found = true;
+            break;
+        }
+        // replace the least recently seen transaction
+        if ((int32_t)(x3d_foreign[i].last_ts - entry->last_ts) < 0)
+        {
+            entry = &x3d_foreign[i];
+        }
+    }
+    entry->last_ts = x3d_last_rx_ts;
+
+    if (!found)
+    {
+        memset(entry->buffer, 0, sizeof(entry->buffer));
+        memcpy(entry->buffer, buffer, length + 1);
+        entry->reported = 0;
+    }
+    else if (entry->buffer[payload_index] < buffer[payload_index])
+    {
+        // same merge as for the own transaction, the relays only add bits
+        entry->buffer[payload_index] = buffer[payload_index];
+        for (uint8_t i = payload_index + 1; i < length; i++)
+        {
+            entry->buffer[i] |= buffer[i];
+        }
+    }
+    else
+    {
+        return;
+    }
+
+    x3d_standard_msg_payload_t *payload = (x3d_standard_msg_payload_t *)&entry->buffer[payload_index + 1];
+    uint8_t action                      = payload->action & X3D_REGISTER_ACTION_MASK;
+    if (action != X3D_REGISTER_ACTION_READ && action != X3D_REGISTER_ACTION_WRITE)
+    {
+        return;
+    }
+    uint16_t acked = payload->target_ack & payload->target & ~entry->reported;
+    if (acked != 0)
+    {
+        entry->reported |= acked;
+        x3d_foreign_cb(buffer[X3D_IDX_NETWORK] & 0x7f, payload, acked);
+    }
+}
+
+/**
+ * @brief Signals the waiting task that the own transaction is complete
+ */
+static void x3d_set_complete(void)
+{
+    x3d_complete_ts = x3d_last_rx_ts;
+    x3d_complete    = true;
+    if (x3d_wait_task != NULL)
+    {
+        xTaskNotifyGive(x3d_wait_task);
+    }
+}
+
+/**
+ * @brief Collects the pins of the responses to the open pairing message.
+ * Each device in pairing writes its pin into the same field, so the pins are taken from the received frames
+ * before merging, also from frames with an already seen retry count. The first pin completes the open phase.
+ *
+ * @param buffer received message
+ * @param payload_index index of the payload
+ */
+static void x3d_pair_capture(uint8_t *buffer, uint8_t payload_index)
+{
+    if (x3d_pair_ack_mask != 0 || payload_index + X3D_OFF_PAIR_PIN + 1 >= buffer[0])
+    {
+        return;
+    }
+
+    uint16_t pin = x3d_get_pairing_pin(buffer, payload_index);
+    if (pin == 0)
+    {
+        return;
+    }
+    for (int i = 0; i < x3d_pair_pin_count; i++)
+    {
+        if (x3d_pair_pins[i] == pin)
+        {
+            return;
+        }
+    }
+    if (x3d_pair_pin_count < X3D_PAIR_MAX_PINS)
+    {
+        x3d_pair_pins[x3d_pair_pin_count++] = pin;
+    }
+    if (!x3d_complete)
+    {
+        x3d_set_complete();
+    }
+}
+
+/**
+ * @brief Checks the message id of a received frame against the last one of its initiator.
+ * Frames of the own device are only valid with the current message id, older ones are relays of previous transactions.
+ * Frames of foreign initiators are stale if the id is below the last seen one.
+ *
+ * @param buffer received message
+ * @return bool false if the frame is stale or replayed
+ */
+static bool x3d_check_msg_id(uint8_t *buffer)
+{
+    uint16_t enc_msg_id;
+    if (x3d_get_msg_id(buffer, &enc_msg_id) != 0)
+    {
+        return true;
+    }
+
+    uint32_t device_id = x3d_get_device_id(buffer);
+    uint16_t msg_id    = x3d_dec_msg_id(enc_msg_id, device_id);
+    if (device_id == x3d_device_id)
+    {
+        return msg_id == x3d_msg_id;
+    }
+
+    x3d_initiator_t *entry = &x3d_initiators[0];
+    for (int i = 0; i < X3D_INITIATORS; i++)
+    {
+        if (x3d_initiators[i].device_id == device_id)
+        {
+            entry = &x3d_initiators[i];
+            break;
+        }
+        // replace the least recently seen initiator
+        if ((int32_t)(x3d_initiators[i].last_ts - entry->last_ts) < 0)
+        {
+            entry = &x3d_initiators[i];
+        }
+    }
+
+    if (entry->device_id == device_id && (int16_t)(msg_id - entry->msg_id) < 0)
+    {
+        return false;
+    }
+
+    entry->device_id = device_id;
+    entry->msg_id    = msg_id;
+    entry->last_ts   = x3d_last_rx_ts;
+    return true;
+}
+
+/**
+ * @brief Reports a window event of a sensor frame, repeats with the same message number are dropped.
+ *
+ * @param buffer received message
+ */
+static void x3d_sensor_frame(uint8_t *buffer)
+{
+    x3d_window_state_t state = x3d_get_window_state(buffer);
+    if (state == X3D_WINDOW_NONE || x3d_window_cb == NULL)
+    {
+        return;
+    }
+
+    uint32_t device_id  = x3d_get_device_id(buffer);
+    x3d_sensor_t *entry = &x3d_sensors[0];
+    for (int i = 0; i < X3D_SENSORS; i++)
+    {
+        if (x3d_sensors[i].device_id == device_id)
+        {
+            entry = &x3d_sensors[i];
+            break;
+        }
+        // replace the least recently seen sensor
+        if ((int32_t)(x3d_sensors[i].last_ts - entry->last_ts) < 0)
+        {
+            entry = &x3d_sensors[i];
+        }
+    }
+
+    bool repeat = entry->device_id == device_id && entry->msg_no == buffer[X3D_IDX_MSG_NO]
+            && x3d_last_rx_ts - entry->last_ts < pdMS_TO_TICKS(X3D_SENSOR_REPEAT_MS);
+    entry->device_id = device_id;
+    entry->msg_no    = buffer[X3D_IDX_MSG_NO];
+    entry->last_ts   = x3d_last_rx_ts;
+    if (!repeat)
+    {
+        x3d_window_cb(device_id, state == X3D_WINDOW_OPENED, rfm_packet_rssi());
+    }
+}
+
 void x3d_processor(uint8_t *buffer)
 {
     // store last rx time to check if air is free.
     x3d_last_rx_ts = xTaskGetTickCount();
 
+    // sensor frames are unsolicited, report them before the own transaction is checked
+    if (buffer[X3D_IDX_MSG_TYPE] == X3D_MSG_TYPE_SENSOR)
+    {
+        x3d_sensor_frame(buffer);
+    }
+
     //ESP_LOG_BUFFER_HEX_LEVEL(TAG, buffer, buffer[0], ESP_LOG_INFO);
     /*
      * It is possible to make all checks by hand:
@@ -58,9 +426,25 @@ void x3d_processor(uint8_t *buffer)
     // get length of the request message header
     uint8_t check_length = (x3d_buffer[X3D_IDX_HEADER_LEN] & X3D_HEADER_LENGTH_MASK) + X3D_IDX_HEADER_LEN;
 
-    // if header does not match, ignore
-    if (memcmp(x3d_buffer, buffer, check_length) != 0)
+    // if header does not match, it is foreign traffic, relays of older transactions also keep the air busy
+    bool foreign = memcmp(x3d_buffer, buffer, check_length) != 0;
+    if (foreign)
+    {
+        x3d_track_foreign(buffer);
+    }
+
+    // drop relays of older transactions and replayed frames before merging and decoding
+    if (!x3d_check_msg_id(buffer))
     {
+        x3d_channel_stats.stale_frames++;
+        X3D_TRACE(X3D_TRACE_RX_REJECT, X3D_TRACE_REJECT_REPLAY, buffer[X3D_IDX_PKT_LEN]);
+        return;
+    }
+
+    if (foreign)
+    {
+        X3D_TRACE(X3D_TRACE_RX_REJECT, X3D_TRACE_REJECT_HEADER, buffer[X3D_IDX_PKT_LEN]);
+        x3d_foreign_merge(buffer);
         return;
     }
 
@@ -79,20 +463,67 @@ void x3d_processor(uint8_t *buffer)
     // payload index is the end of the header check
     uint8_t payload_index = check_length;
 
+    // every relay shows which frames its device received, also if the content is already merged
+    x3d_topology_frame(buffer, rfm_packet_rssi());
+
+    bool pairing = x3d_buffer[X3D_IDX_MSG_TYPE] == X3D_MSG_TYPE_PAIRING;
+    if (pairing)
+    {
+        x3d_pair_capture(buffer, payload_index);
+    }
+
     // check if retry count lower than the received
     if (x3d_buffer[payload_index] >= buffer[payload_index])
     {
+        X3D_TRACE(X3D_TRACE_RX_REJECT, X3D_TRACE_REJECT_STALE, buffer[payload_index]);
         return;
     }
 
     // update retry count
     x3d_buffer[payload_index] = buffer[payload_index];
 
+    // the mesh relays the own message, keep the air busy until it's quiet
+    x3d_busy_until_ts = x3d_last_rx_ts + pdMS_TO_TICKS(X3D_LBT_HOLD_SLOTS * X3D_MSG_DELAY_MS);
+
     // step over retry count, walk to the end
-    for (payload_index++; payload_index < x3d_buffer[0]; payload_index++)
+    uint16_t prev_ack = x3d_merged_ack(payload_index);
+    for (uint8_t i = payload_index + 1; i < x3d_buffer[0]; i++)
     {
         // orwise bytes to the buffer
-        x3d_buffer[payload_index] |= buffer[payload_index];
+        x3d_buffer[i] |= buffer[i];
+    }
+    X3D_TRACE(X3D_TRACE_RX_ACCEPT, buffer[payload_index], x3d_get_retrans_ack(x3d_buffer, payload_index));
+    uint16_t merged_ack = x3d_merged_ack(payload_index);
+    if (merged_ack != prev_ack)
+    {
+        X3D_TRACE(X3D_TRACE_ACK, 0, merged_ack);
+    }
+
+    if (pairing)
+    {
+        // the or of overlapping pins addresses no device, keep the first one
+        if (x3d_pair_ack_mask == 0 && x3d_pair_pin_count > 0)
+        {
+            x3d_buffer[payload_index + X3D_OFF_PAIR_PIN]     = x3d_pair_pins[0] & 0xff;
+            x3d_buffer[payload_index + X3D_OFF_PAIR_PIN + 1] = x3d_pair_pins[0] >> 8;
+        }
+        else if (!x3d_complete && x3d_pair_ack_mask != 0
+                && (x3d_get_retrans_ack(x3d_buffer, payload_index) & x3d_pair_ack_mask) == x3d_pair_ack_mask)
+        {
+            x3d_set_complete();
+        }
+        return;
+    }
+
+    // check if all targets have acknowledged to finish the response window early
+    if (!x3d_complete && x3d_buffer[X3D_IDX_MSG_TYPE] == X3D_MSG_TYPE_STANDARD && payload_index + X3D_OFF_REGISTER_ACK + 1 < x3d_buffer[0])
+    {
+        uint16_t target = x3d_buffer[payload_index + X3D_OFF_REGISTER_TARGET] | x3d_buffer[payload_index + X3D_OFF_REGISTER_TARGET + 1] << 8;
+        uint16_t ack    = x3d_merged_ack(payload_index);
+        if (target != 0 && (ack & target) == target)
+        {
+            x3d_set_complete();
+        }
     }
 }
 
@@ -101,31 +532,180 @@ void x3d_set_device_id(uint32_t device_id)
     x3d_device_id = device_id;
 }
 
+void x3d_set_counters(uint8_t msg_no, uint16_t msg_id, x3d_counter_store_t store)
+{
+    x3d_msg_no          = msg_no;
+    x3d_msg_id          = msg_id;
+    // the persisted block is used up, the first message reserves the next one
+    x3d_reserved_msg_id = msg_id;
+    x3d_counter_store   = store;
+}
+
+void x3d_set_window_callback(x3d_window_cb_t callback)
+{
+    x3d_window_cb = callback;
+}
+
+void x3d_set_foreign_callback(x3d_foreign_cb_t callback)
+{
+    x3d_foreign_cb = callback;
+}
+
+void x3d_get_channel_stats(x3d_channel_stats_t *stats)
+{
+    *stats             = x3d_channel_stats;
+    stats->last_rx_age = pdTICKS_TO_MS(xTaskGetTickCount() - x3d_last_rx_ts);
+}
+
 uint8_t x3d_prepare_message(uint8_t network, x3d_msg_type_t msg_type, uint8_t flags, uint8_t status, uint8_t *ext_header, int ext_header_len)
 {
     x3d_init_message(x3d_buffer, x3d_device_id, 0x80 | network);
-    return x3d_prepare_message_header(x3d_buffer, &x3d_msg_no, msg_type, flags, status, ext_header, ext_header_len, x3d_enc_msg_id(&x3d_msg_id, x3d_device_id));
+    uint8_t payload_index = x3d_prepare_message_header(x3d_buffer, &x3d_msg_no, msg_type, flags, status, ext_header, ext_header_len, x3d_enc_msg_id(&x3d_msg_id, x3d_device_id));
+
+    // reserve the next block of message ids before the persisted one is reached
+    if (x3d_counter_store != NULL && (int16_t)(x3d_msg_id - x3d_reserved_msg_id) >= 0)
+    {
+        x3d_reserved_msg_id = x3d_msg_id + X3D_COUNTER_RESERVE;
+        x3d_counter_store(x3d_msg_no + X3D_COUNTER_RESERVE, x3d_reserved_msg_id);
+    }
+    return payload_index;
+}
+
+/**
+ * @brief Waits until no foreign exchange is on air.
+ * The busy time is estimated from the received frames, if no frame is decoded the carrier is sensed by RSSI.
+ */
+void x3d_wait_free_air(void)
+{
+    TickType_t start = xTaskGetTickCount();
+    bool deferred    = false;
+
+    x3d_channel_stats.transmissions++;
+    for (;;)
+    {
+        TickType_t now = xTaskGetTickCount();
+        int32_t wait   = (int32_t)(x3d_busy_until_ts - now);
+        if (wait <= 0)
+        {
+            int16_t rssi = rfm_rssi();
+            if (rssi == RFM_RSSI_INVALID || rssi < X3D_LBT_RSSI_THRESHOLD)
+            {
+                break;
+            }
+            x3d_channel_stats.rssi_busy++;
+            wait = pdMS_TO_TICKS(X3D_LBT_BACKOFF_SLOTS * X3D_MSG_DELAY_MS);
+        }
+
+        if (now - start + wait > pdMS_TO_TICKS(X3D_LBT_MAX_DEFER_MS))
+        {
+            x3d_channel_stats.forced++;
+            break;
+        }
+
+        deferred = true;
+        x3d_channel_stats.deferrals++;
+        vTaskDelay(wait);
+    }
+
+    if (deferred)
+    {
+        uint32_t deferred_ms = pdTICKS_TO_MS(xTaskGetTickCount() - start);
+        x3d_channel_stats.deferred_transmissions++;
+        x3d_channel_stats.deferred_ms += deferred_ms;
+        X3D_TRACE(X3D_TRACE_DEFER, 0, deferred_ms);
+    }
 }
 
 void x3d_transmit(void)
 {
-    // TODO: check x3d_last_rx_ts for free air
+    x3d_wait_free_air();
+    x3d_complete  = false;
+    x3d_tx_active = true;
+
+    uint8_t payload_index     = (x3d_buffer[X3D_IDX_HEADER_LEN] & X3D_HEADER_LENGTH_MASK) + X3D_IDX_HEADER_LEN;
     TickType_t last_send_time = xTaskGetTickCount();
     do
     {
         x3d_set_crc(x3d_buffer);
         vTaskDelayUntil(&last_send_time, pdMS_TO_TICKS(X3D_MSG_DELAY_MS));
+        X3D_TRACE(X3D_TRACE_TX_START, x3d_buffer[payload_index], x3d_buffer[X3D_IDX_MSG_NO]);
         rfm_transfer(x3d_buffer, x3d_buffer[0]);
+        x3d_airtime_frame(x3d_buffer, true, true);
+        X3D_TRACE(X3D_TRACE_TX_END, x3d_buffer[payload_index], x3d_buffer[X3D_IDX_MSG_NO]);
     } while (x3d_dec_retry(x3d_buffer) > 0);
     rfm_receive();
+    x3d_tx_end_ts = xTaskGetTickCount();
+}
+
+/**
+ * @brief Waits for the responses of the transmitted message and releases the air.
+ * Returns early if all targets of a standard message have acknowledged.
+ *
+ * @param wait_ms maximum time to wait after the end of transmission
+ * @return bool true if all targets acknowledged
+ */
+bool x3d_wait_responses(uint32_t wait_ms)
+{
+    x3d_wait_task       = xTaskGetCurrentTaskHandle();
+    TickType_t deadline = x3d_tx_end_ts + pdMS_TO_TICKS(wait_ms);
+    while (!x3d_complete)
+    {
+        int32_t remaining = (int32_t)(deadline - xTaskGetTickCount());
+        if (remaining <= 0)
+        {
+            break;
+        }
+        ulTaskNotifyTake(pdTRUE, remaining);
+    }
+    x3d_wait_task = NULL;
+    x3d_tx_active = false;
+    X3D_TRACE(X3D_TRACE_COMPLETE, x3d_complete ? X3D_TRACE_COMPLETE_ACK : X3D_TRACE_COMPLETE_TIMEOUT,
+            x3d_merged_ack((x3d_buffer[X3D_IDX_HEADER_LEN] & X3D_HEADER_LENGTH_MASK) + X3D_IDX_HEADER_LEN));
+    return x3d_complete;
+}
+
+/**
+ * @brief Transmits the prepared standard message and waits for the responses.
+ * The response timeout is taken from the observed timing model and the result is fed back.
+ *
+ * @param network network number
+ * @param target target device mask
+ * @param default_wait_ms fixed timeout used until the model has enough samples
+ * @return bool true if all targets acknowledged
+ */
+bool x3d_transceive(uint8_t network, uint16_t target, uint32_t default_wait_ms)
+{
+    uint32_t wait_ms = x3d_timing_wait_ms(network, target, default_wait_ms);
+
+    // transfer buffer
+    x3d_transmit();
+
+    // wait to process responses
+    bool complete = x3d_wait_responses(wait_ms);
+    x3d_timing_sample(network, target, complete, complete ? pdTICKS_TO_MS(x3d_complete_ts - x3d_tx_end_ts) : wait_ms);
+    return complete;
 }
 
 /***********************************************
  * X3D pairing message handler
  */
 
+/**
+ * @brief Reports a pairing phase to the progress callback
+ */
+static void x3d_pairing_report(x3d_pairing_data_t *data, x3d_pairing_progress_t *progress, x3d_pairing_phase_t phase, TickType_t start)
+{
+    progress->phase      = phase;
+    progress->elapsed_ms = pdTICKS_TO_MS(xTaskGetTickCount() - start);
+    if (data->progress != NULL)
+    {
+        data->progress(progress);
+    }
+}
+
 int x3d_pairing_proc(x3d_pairing_data_t *data)
 {
+    TickType_t start      = xTaskGetTickCount();
     uint8_t ext_header[]  = {0x98, X3D_HEADER_EXT_NONE};
     uint8_t payload_index = x3d_prepare_message(data->network, X3D_MSG_TYPE_PAIRING, 0, 0x85, ext_header, sizeof(ext_header));
 
@@ -142,35 +722,58 @@ int x3d_pairing_proc(x3d_pairing_data_t *data)
         target_slot |= 0x10;
     }
 
+    x3d_pairing_progress_t progress = {.network = data->network, .slot = target_device_no};
+    x3d_pair_pin_count              = 0;
+    x3d_pair_ack_mask               = 0;
+
     x3d_set_message_retrans(x3d_buffer, payload_index, X3D_RETRY_COUNT_PAIR - 1, data->transfer);
     x3d_set_pairing_data(x3d_buffer, payload_index, target_slot, 0, X3D_PAIR_STATE_OPEN);
+    X3D_TRACE(X3D_TRACE_BEGIN, X3D_TRACE_ACTION_PAIR, ack_mask);
 
     // transfer buffer
     x3d_transmit();
+    x3d_pairing_report(data, &progress, X3D_PAIRING_OPEN, start);
 
-    // wait to process responses
-    vTaskDelay(pdMS_TO_TICKS(5000));
+    // wait for the first pin, the processor completes the open phase on it
+    x3d_wait_responses(X3D_PAIR_OPEN_WAIT_MS);
 
-    uint16_t pin = x3d_get_pairing_pin(x3d_buffer, payload_index);
-    if (pin != 0)
+    // let the relays of the open message fade out, they may carry the pins of further devices in pairing
+    int32_t quiet;
+    while ((quiet = (int32_t)(x3d_busy_until_ts - xTaskGetTickCount())) > 0)
     {
-        payload_index = x3d_prepare_message(data->network, X3D_MSG_TYPE_PAIRING, 0, 0x85, ext_header, sizeof(ext_header));
+        vTaskDelay(quiet);
+    }
+
+    if (x3d_pair_pin_count > 0)
+    {
+        progress.pin  = x3d_pair_pins[0];
+        progress.pins = x3d_pair_pin_count;
+        x3d_pairing_report(data, &progress, X3D_PAIRING_PIN, start);
+
+        // the pin addresses one device, further devices in pairing stay open for the next pairing
+        x3d_pair_ack_mask = ack_mask;
+        payload_index     = x3d_prepare_message(data->network, X3D_MSG_TYPE_PAIRING, 0, 0x85, ext_header, sizeof(ext_header));
         x3d_set_message_retrans(x3d_buffer, payload_index, X3D_RETRY_COUNT_PAIR - 1, data->transfer);
-        x3d_set_pairing_data(x3d_buffer, payload_index, target_slot, pin, X3D_PAIR_STATE_PINNED);
+        x3d_set_pairing_data(x3d_buffer, payload_index, target_slot, progress.pin, X3D_PAIR_STATE_PINNED);
+        X3D_TRACE(X3D_TRACE_BEGIN, X3D_TRACE_ACTION_PAIR, ack_mask);
 
         // transfer buffer
         x3d_transmit();
+        x3d_pairing_report(data, &progress, X3D_PAIRING_PINNED, start);
 
-        // wait to process responses
-        vTaskDelay(pdMS_TO_TICKS((no_of_devices(data->transfer) + 1) * X3D_PER_DEVICE_WAIT_SLOTS_PAIR * X3D_MSG_DELAY_MS));
+        // wait to process responses, returns on the acknowledge of the new device
+        x3d_wait_responses((no_of_devices(data->transfer) + 1) * X3D_PER_DEVICE_WAIT_SLOTS_PAIR * X3D_MSG_DELAY_MS);
+        x3d_pair_ack_mask = 0;
 
         if ((x3d_get_retrans_ack(x3d_buffer, payload_index) & ack_mask) == ack_mask)
         {
             // update device mask
             data->transfer = data->transfer | ack_mask;
+            x3d_pairing_report(data, &progress, X3D_PAIRING_DONE, start);
             return target_device_no;
         }
     }
+    x3d_pairing_report(data, &progress, X3D_PAIRING_FAILED, start);
     return -1;
 }
 
@@ -185,55 +788,108 @@ void x3d_unpairing_proc(x3d_unpairing_data_t *data)
     x3d_set_message_retrans(x3d_buffer, payload_index, X3D_RETRY_COUNT_DEFAULT - 1, data->transfer);
 
     x3d_set_unpair_device(x3d_buffer, payload_index, data->target);
+    X3D_TRACE(X3D_TRACE_BEGIN, X3D_TRACE_ACTION_UNPAIR, data->target);
 
     // transfer buffer
     x3d_transmit();
 
     // wait to process responses
-    vTaskDelay(pdMS_TO_TICKS(no_of_devices(data->transfer) * X3D_PER_DEVICE_WAIT_SLOTS_DEFAULT * X3D_MSG_DELAY_MS));
+    x3d_wait_responses(x3d_topology_wait_ms(data->network, data->transfer, no_of_devices(data->transfer) * X3D_PER_DEVICE_WAIT_SLOTS_DEFAULT * X3D_MSG_DELAY_MS));
 
     // remove device from transfer mask
     data->transfer &= ~(data->target);
 }
 
 /***********************************************
- * X3D register read handler
+ * X3D register read and write handler
  */
 
-x3d_standard_msg_payload_t *x3d_reading_proc(x3d_read_data_t *data)
+/**
+ * @brief Merges the payload of the last transaction into the result.
+ * The first transaction initializes the result, re-queries only add the slots of newly acknowledged targets.
+ *
+ * @param payload_index index of the payload
+ * @param attempt number of the transaction
+ * @return uint16_t mask of targets still missing
+ */
+static uint16_t x3d_merge_result(uint8_t payload_index, uint8_t attempt)
 {
-    uint8_t ext_header[]  = {0x98, X3D_HEADER_EXT_NONE};
-    uint8_t payload_index = x3d_prepare_message(data->network, X3D_MSG_TYPE_STANDARD, 0, 0x05, ext_header, sizeof(ext_header));
-    x3d_set_message_retrans(x3d_buffer, payload_index, X3D_RETRY_COUNT_DEFAULT - 1, data->transfer);
-    x3d_set_register_read(x3d_buffer, payload_index, data->target, data->register_high, data->register_low);
+    x3d_standard_msg_payload_t *payload = (x3d_standard_msg_payload_t *)&x3d_buffer[payload_index + 1];
+    if (attempt == 0)
+    {
+        memcpy(&x3d_result, payload, sizeof(x3d_result));
+    }
+    else
+    {
+        uint16_t acked = payload->target_ack & ~x3d_result.target_ack;
+        for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+        {
+            if (acked & (1 << i))
+            {
+                x3d_result.data[i] = payload->data[i];
+            }
+        }
+        x3d_result.retransmited |= payload->retransmited;
+        x3d_result.target_ack |= acked;
+    }
+    return x3d_result.target & ~x3d_result.target_ack;
+}
 
-    // transfer buffer
-    x3d_transmit();
+/**
+ * @brief Executes a register read or write and re-queries the targets which did not acknowledge.
+ * Follow-ups keep the transfer mask so the mesh still relays, they are capped and backed off.
+ *
+ * @param network network number
+ * @param transfer transfer device mask
+ * @param target target device mask
+ * @param register_high register high address
+ * @param register_low register low address
+ * @param values values to write, NULL to read
+ * @return x3d_standard_msg_payload_t * merged result
+ */
+static x3d_standard_msg_payload_t *x3d_register_proc(uint8_t network, uint16_t transfer, uint16_t target, uint8_t register_high, uint8_t register_low, uint16_t *values)
+{
+    uint8_t ext_header[] = {0x98, X3D_HEADER_EXT_NONE};
+    uint16_t missing     = target;
+    for (uint8_t attempt = 0;; attempt++)
+    {
+        uint8_t payload_index = x3d_prepare_message(network, X3D_MSG_TYPE_STANDARD, 0, 0x05, ext_header, sizeof(ext_header));
+        uint8_t retry_count   = x3d_timing_retry_count(network, target, x3d_topology_retry_count(network, transfer, X3D_RETRY_COUNT_DEFAULT));
+        x3d_set_message_retrans(x3d_buffer, payload_index, retry_count - 1, transfer);
+        if (values != NULL)
+        {
+            x3d_set_register_write(x3d_buffer, payload_index, missing, register_high, register_low, values);
+            X3D_TRACE(X3D_TRACE_BEGIN, X3D_TRACE_ACTION_WRITE, missing);
+        }
+        else
+        {
+            x3d_set_register_read(x3d_buffer, payload_index, missing, register_high, register_low);
+            X3D_TRACE(X3D_TRACE_BEGIN, X3D_TRACE_ACTION_READ, missing);
+        }
 
-    // wait to process responses
-    vTaskDelay(pdMS_TO_TICKS(no_of_devices(data->transfer) * X3D_PER_DEVICE_WAIT_SLOTS_DEFAULT * X3D_MSG_DELAY_MS));
+        // a re-query only addresses the targets still missing, the timing model stays keyed by the whole target
+        // so the subsets do not take own entries
+        x3d_transceive(network, target, x3d_topology_wait_ms(network, transfer, no_of_devices(transfer) * X3D_PER_DEVICE_WAIT_SLOTS_DEFAULT * X3D_MSG_DELAY_MS));
+
+        missing = x3d_merge_result(payload_index, attempt);
+        if (missing == 0 || attempt >= X3D_REQUERY_ATTEMPTS)
+        {
+            break;
+        }
+        vTaskDelay(pdMS_TO_TICKS(X3D_REQUERY_BACKOFF_MS << attempt));
+    }
 
-    return (x3d_standard_msg_payload_t *)&x3d_buffer[payload_index + 1];
+    return &x3d_result;
 }
 
-/***********************************************
- * X3D register write handler
- */
+x3d_standard_msg_payload_t *x3d_reading_proc(x3d_read_data_t *data)
+{
+    return x3d_register_proc(data->network, data->transfer, data->target, data->register_high, data->register_low, NULL);
+}
 
 x3d_standard_msg_payload_t *x3d_writing_proc(x3d_write_data_t *data)
 {
-    uint8_t ext_header[]  = {0x98, X3D_HEADER_EXT_NONE};
-    uint8_t payload_index = x3d_prepare_message(data->network, X3D_MSG_TYPE_STANDARD, 0, 0x05, ext_header, sizeof(ext_header));
-    x3d_set_message_retrans(x3d_buffer, payload_index, X3D_RETRY_COUNT_DEFAULT - 1, data->transfer);
-    x3d_set_register_write(x3d_buffer, payload_index, data->target, data->register_high, data->register_low, data->values);
-
-    // transfer buffer
-    x3d_transmit();
-
-    // wait to process responses
-    vTaskDelay(pdMS_TO_TICKS(no_of_devices(data->transfer) * X3D_PER_DEVICE_WAIT_SLOTS_DEFAULT * X3D_MSG_DELAY_MS));
-
-    return (x3d_standard_msg_payload_t *)&x3d_buffer[payload_index + 1];
+    return x3d_register_proc(data->network, data->transfer, data->target, data->register_high, data->register_low, data->values);
 }
 
 /***********************************************
@@ -244,12 +900,10 @@ void x3d_temp_proc(x3d_temp_data_t *data)
 {
     uint8_t ext_header[]  = {0x98, X3D_HEADER_EXT_TEMP, data->outdoor, data->temp & 0xff, (data->temp >> 8) & 0xff};
     uint8_t payload_index = x3d_prepare_message(data->network, X3D_MSG_TYPE_STANDARD, 0, 0x05, ext_header, sizeof(ext_header));
-    x3d_set_message_retrans(x3d_buffer, payload_index, X3D_RETRY_COUNT_TEMP - 1, data->transfer);
+    uint8_t retry_count   = x3d_timing_retry_count(data->network, data->target, X3D_RETRY_COUNT_TEMP);
+    x3d_set_message_retrans(x3d_buffer, payload_index, retry_count - 1, data->transfer);
     x3d_set_ping_device(x3d_buffer, payload_index, data->target);
+    X3D_TRACE(X3D_TRACE_BEGIN, X3D_TRACE_ACTION_TEMP, data->target);
 
-    // transfer buffer
-    x3d_transmit();
-
-    // wait to process responses
-    vTaskDelay(pdMS_TO_TICKS(no_of_devices(data->transfer) * X3D_PER_DEVICE_WAIT_SLOTS_DEFAULT * X3D_MSG_DELAY_MS));
+    x3d_transceive(data->network, data->target, x3d_topology_wait_ms(data->network, data->transfer, no_of_devices(data->transfer) * X3D_PER_DEVICE_WAIT_SLOTS_DEFAULT * X3D_MSG_DELAY_MS));
 }
\ No newline at end of file
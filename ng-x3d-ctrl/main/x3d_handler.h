@@ -11,14 +11,46 @@
 
 #pragma once
 
+#include <stdbool.h>
+
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "x3d.h"
 
+// phases of the pairing process
+typedef enum {
+    X3D_PAIRING_OPEN = 0,   ///< open pairing message sent
+    X3D_PAIRING_PIN,        ///< pin of a device in pairing received
+    X3D_PAIRING_PINNED,     ///< pinned confirmation sent
+    X3D_PAIRING_DONE,       ///< device acknowledged the pinned confirmation
+    X3D_PAIRING_FAILED,     ///< no pin or no acknowledge received
+} x3d_pairing_phase_t;
+
+/// @brief Progress of the pairing process
+typedef struct {
+    x3d_pairing_phase_t phase;
+    uint8_t network;
+    uint8_t slot;           ///< slot of the new device
+    uint16_t pin;           ///< pin of the paired device, 0 until received
+    uint8_t pins;           ///< number of devices in pairing which responded with a pin
+    uint32_t elapsed_ms;    ///< time since the start of the pairing
+} x3d_pairing_progress_t;
+
+/// @brief Callback on each phase of the pairing process, called from the processing task
+typedef void (*x3d_pairing_progress_cb_t)(const x3d_pairing_progress_t *progress);
+
+/// @brief Callback on a window sensor event, called from the receive task, must not block
+typedef void (*x3d_window_cb_t)(uint32_t device_id, bool open, int16_t rssi);
+
+/// @brief Callback on targets of a foreign register transaction which acknowledged, called from the receive task with the network
+/// number without the flag bit of the header, must not block
+typedef void (*x3d_foreign_cb_t)(uint8_t network, const x3d_standard_msg_payload_t *payload, uint16_t acked);
+
 /// @brief Task processing data for pairing
 typedef struct {
     uint8_t network;
     uint16_t transfer;
+    x3d_pairing_progress_cb_t progress; ///< optional progress callback
 } x3d_pairing_data_t;
 
 /// @brief Task processing data for unpairing
@@ -56,6 +88,23 @@ typedef struct {
     uint16_t temp;
 } x3d_temp_data_t;
 
+/// @brief Channel occupancy and listen before talk statistics
+typedef struct {
+    uint32_t transmissions;          ///< number of transactions started
+    uint32_t deferred_transmissions; ///< transactions which had to wait for free air
+    uint32_t deferrals;              ///< number of backoff steps
+    uint32_t deferred_ms;            ///< overall time waited for free air
+    uint32_t forced;                 ///< transactions sent after max defer time
+    uint32_t rssi_busy;              ///< busy carrier detected without decoded frame
+    uint32_t foreign_frames;         ///< frames received not belonging to own transaction
+    uint32_t collisions;             ///< foreign frames received during own transaction
+    uint32_t last_rx_age;            ///< time since last received frame in ms
+    uint32_t stale_frames;           ///< frames dropped due to old or replayed message id
+} x3d_channel_stats_t;
+
+/// @brief Callback to persist the reserved message number and message id
+typedef void (*x3d_counter_store_t)(uint8_t msg_no, uint16_t msg_id);
+
 /**
  * @brief Sets the device id for x3d processing
  *
@@ -63,6 +112,44 @@ typedef struct {
  */
 void x3d_set_device_id(uint32_t device_id);
 
+/**
+ * @brief Restores the persisted message counters.
+ * The counters are reserved in blocks, the store callback is executed on every new block, so the flash is not written per message.
+ * The first block is reserved with the first message, the flash is not written at boot.
+ * The callback runs in the sending task, which needs the stack for the flash write.
+ * After a restart the message id continues at the reserved value which is within the accepted window of the actors.
+ *
+ * @param msg_no persisted message number
+ * @param msg_id persisted message id
+ * @param store callback to persist the reserved counters, can be NULL
+ */
+void x3d_set_counters(uint8_t msg_no, uint16_t msg_id, x3d_counter_store_t store);
+
+/**
+ * @brief Sets the callback of window sensor events.
+ * Sensor frames are classified by the processor as soon as they are received, independent of an own transaction.
+ * The repeats of a frame carry the same message number and are reported once.
+ *
+ * @param callback event callback, NULL to disable
+ */
+void x3d_set_window_callback(x3d_window_cb_t callback);
+
+/**
+ * @brief Sets the callback of foreign register transactions.
+ * Register reads and writes of other initiators (Tydom, thermostats) are merged from their frames like the own ones,
+ * each target is reported once as soon as a merged frame carries its acknowledge.
+ *
+ * @param callback result callback, NULL to disable
+ */
+void x3d_set_foreign_callback(x3d_foreign_cb_t callback);
+
+/**
+ * @brief Returns the channel occupancy statistics
+ *
+ * @param stats pointer to target struct
+ */
+void x3d_get_channel_stats(x3d_channel_stats_t *stats);
+
 /**
  * @brief Execute pairing process
  *
@@ -79,18 +166,18 @@ int x3d_pairing_proc(x3d_pairing_data_t *data);
 void x3d_unpairing_proc(x3d_unpairing_data_t *data);
 
 /**
- * @brief Execute the register read process
+ * @brief Execute the register read process, targets which did not acknowledge are re-queried
  *
  * @param data pointer to x3d_read_data_t
- * @return x3d_standard_msg_payload_t * do not free the pointer it's pointing to the static x3d processing buffer
+ * @return x3d_standard_msg_payload_t * do not free the pointer it's pointing to the static merged result
  */
 x3d_standard_msg_payload_t * x3d_reading_proc(x3d_read_data_t *data);
 
 /**
- * @brief Execute the register write process
+ * @brief Execute the register write process, targets which did not acknowledge are written again
  *
  * @param data pointer to x3d_write_data_t
- * @return x3d_standard_msg_payload_t * do not free the pointer it's pointing to the static x3d processing buffer
+ * @return x3d_standard_msg_payload_t * do not free the pointer it's pointing to the static merged result
  */
 x3d_standard_msg_payload_t * x3d_writing_proc(x3d_write_data_t *data);
 
@@ -0,0 +1,147 @@
+/**
+ * @file x3d_payload.c
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief encoding of the published device status and result payloads as JSON or CBOR
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "json_writer.h"
+#include "cbor_writer.h"
+#include "x3d_payload.h"
+
+// using string constants instead of defines to save flash memory
+static const char JSON_ACTION[] =               "action";
+static const char JSON_NETWORK[] =              "net";
+static const char JSON_ACK[] =                  "ack";
+static const char JSON_REGISTER_HIGH[] =        "regHigh";
+static const char JSON_REGISTER_LOW[] =         "regLow";
+static const char JSON_VALUES[] =               "values";
+
+static const char JSON_STATUS[] =               "status";
+static const char JSON_AGE[] =                  "age";
+
+static const char RESULT_ACTION_READ[] =        "read";
+static const char RESULT_ACTION_WRITE[] =       "write";
+
+int x3d_payload_device_json(const x3d_device_store_t *store, uint8_t slot, char *buffer, size_t size)
+{
+    if (x3d_device_desc(store->type[slot]) == NULL)
+    {
+        return 0;
+    }
+
+    json_writer_t writer;
+    json_writer_init(&writer, buffer, size);
+    x3d_device_to_json(store, slot, &writer, NULL);
+    return json_writer_length(&writer);
+}
+
+int x3d_payload_device_cbor(const x3d_device_store_t *store, uint8_t slot, uint8_t *buffer, size_t size)
+{
+    if (x3d_device_desc(store->type[slot]) == NULL)
+    {
+        return 0;
+    }
+
+    cbor_writer_t writer;
+    cbor_writer_init(&writer, buffer, size);
+    x3d_device_to_cbor(store, slot, &writer);
+    return cbor_writer_length(&writer);
+}
+
+int x3d_payload_result_json(x3d_schema_action_t action, uint8_t network, x3d_standard_msg_payload_t *payload, char *buffer, size_t size)
+{
+    json_writer_t writer;
+    json_writer_init(&writer, buffer, size);
+
+    int data_slots = ((payload->action & 0xf0) >> 4) + 1;
+    json_writer_object_begin(&writer, NULL);
+    json_writer_string(&writer, JSON_ACTION, action == X3D_SCHEMA_ACTION_WRITE ? RESULT_ACTION_WRITE : RESULT_ACTION_READ);
+    json_writer_int(&writer, JSON_NETWORK, network);
+    json_writer_int(&writer, JSON_ACK, payload->target_ack);
+    json_writer_int(&writer, JSON_REGISTER_HIGH, payload->reg_high);
+    json_writer_int(&writer, JSON_REGISTER_LOW, payload->reg_low);
+    json_writer_array_begin(&writer, JSON_VALUES);
+    for (int i = 0; i < data_slots; i++)
+    {
+        json_writer_int(&writer, NULL, payload->data[i]);
+    }
+    json_writer_array_end(&writer);
+    json_writer_object_end(&writer);
+    return json_writer_length(&writer);
+}
+
+int x3d_payload_result_cbor(x3d_schema_action_t action, uint8_t network, x3d_standard_msg_payload_t *payload, uint8_t *buffer, size_t size)
+{
+    cbor_writer_t writer;
+    cbor_writer_init(&writer, buffer, size);
+
+    int data_slots = ((payload->action & 0xf0) >> 4) + 1;
+    cbor_writer_map(&writer, X3D_SCHEMA_RESULT_KEYS);
+    cbor_writer_uint(&writer, X3D_SCHEMA_RESULT_ACTION);
+    cbor_writer_uint(&writer, action);
+    cbor_writer_uint(&writer, X3D_SCHEMA_RESULT_NETWORK);
+    cbor_writer_uint(&writer, network);
+    cbor_writer_uint(&writer, X3D_SCHEMA_RESULT_ACK);
+    cbor_writer_uint(&writer, payload->target_ack);
+    cbor_writer_uint(&writer, X3D_SCHEMA_RESULT_REG_HIGH);
+    cbor_writer_uint(&writer, payload->reg_high);
+    cbor_writer_uint(&writer, X3D_SCHEMA_RESULT_REG_LOW);
+    cbor_writer_uint(&writer, payload->reg_low);
+    cbor_writer_uint(&writer, X3D_SCHEMA_RESULT_VALUES);
+    cbor_writer_array(&writer, data_slots);
+    for (int i = 0; i < data_slots; i++)
+    {
+        cbor_writer_uint(&writer, payload->data[i]);
+    }
+    return cbor_writer_length(&writer);
+}
+
+int x3d_payload_query_json(const x3d_device_store_t *store, uint8_t slot, const int32_t *age, char *buffer, size_t size)
+{
+    if (x3d_device_desc(store->type[slot]) == NULL)
+    {
+        return 0;
+    }
+
+    json_writer_t writer;
+    json_writer_init(&writer, buffer, size);
+    json_writer_object_begin(&writer, NULL);
+    x3d_device_to_json(store, slot, &writer, JSON_STATUS);
+    json_writer_object_begin(&writer, JSON_AGE);
+    for (int i = 0; i < X3D_DEVICE_FIELDS; i++)
+    {
+        if (x3d_device_has_field(store, slot, i))
+        {
+            json_writer_int(&writer, x3d_device_field(i)->key, age[i]);
+        }
+    }
+    json_writer_object_end(&writer);
+    json_writer_object_end(&writer);
+    return json_writer_length(&writer);
+}
+
+int x3d_payload_query_cbor(const x3d_device_store_t *store, uint8_t slot, const int32_t *age, uint8_t *buffer, size_t size)
+{
+    if (x3d_device_desc(store->type[slot]) == NULL)
+    {
+        return 0;
+    }
+
+    // fields not supported by the device type are -1 like not read fields
+    cbor_writer_t writer;
+    cbor_writer_init(&writer, buffer, size);
+    cbor_writer_map(&writer, X3D_SCHEMA_QUERY_KEYS);
+    cbor_writer_uint(&writer, X3D_SCHEMA_QUERY_STATUS);
+    x3d_device_to_cbor(store, slot, &writer);
+    cbor_writer_uint(&writer, X3D_SCHEMA_QUERY_AGE);
+    cbor_writer_array(&writer, X3D_DEVICE_FIELDS);
+    for (int i = 0; i < X3D_DEVICE_FIELDS; i++)
+    {
+        cbor_writer_int(&writer, x3d_device_has_field(store, slot, i) ? age[i] : -1);
+    }
+    return cbor_writer_length(&writer);
+}
@@ -0,0 +1,88 @@
+/**
+ * @file x3d_payload.h
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief encoding of the published device status and result payloads as JSON or CBOR
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "x3d.h"
+#include "x3d_device.h"
+#include "x3d_schema.h"
+
+/**
+ * @brief Encodes the device status as json object
+ *
+ * @param store device store
+ * @param slot device slot
+ * @param buffer output buffer
+ * @param size size of the output buffer
+ * @return int length of the output, 0 if there is no device, -1 if the buffer was too small
+ */
+int x3d_payload_device_json(const x3d_device_store_t *store, uint8_t slot, char *buffer, size_t size);
+
+/**
+ * @brief Encodes the device status as cbor map, see x3d_schema.h
+ *
+ * @param store device store
+ * @param slot device slot
+ * @param buffer output buffer
+ * @param size size of the output buffer
+ * @return int length of the output, 0 if there is no device, -1 if the buffer was too small
+ */
+int x3d_payload_device_cbor(const x3d_device_store_t *store, uint8_t slot, uint8_t *buffer, size_t size);
+
+/**
+ * @brief Encodes the result of a register read or write as json object
+ *
+ * @param action result action
+ * @param network network number
+ * @param payload merged payload of the transaction
+ * @param buffer output buffer
+ * @param size size of the output buffer
+ * @return int length of the output, -1 if the buffer was too small
+ */
+int x3d_payload_result_json(x3d_schema_action_t action, uint8_t network, x3d_standard_msg_payload_t *payload, char *buffer, size_t size);
+
+/**
+ * @brief Encodes the result of a register read or write as cbor map, see x3d_schema.h
+ *
+ * @param action result action
+ * @param network network number
+ * @param payload merged payload of the transaction
+ * @param buffer output buffer
+ * @param size size of the output buffer
+ * @return int length of the output, -1 if the buffer was too small
+ */
+int x3d_payload_result_cbor(x3d_schema_action_t action, uint8_t network, x3d_standard_msg_payload_t *payload, uint8_t *buffer, size_t size);
+
+/**
+ * @brief Encodes the cached device status with the age of the status fields as json object
+ *
+ * @param store device store
+ * @param slot device slot
+ * @param age age of the status fields in s, -1 if never read, ordered by x3d_device_field_t
+ * @param buffer output buffer
+ * @param size size of the output buffer
+ * @return int length of the output, 0 if there is no device, -1 if the buffer was too small
+ */
+int x3d_payload_query_json(const x3d_device_store_t *store, uint8_t slot, const int32_t *age, char *buffer, size_t size);
+
+/**
+ * @brief Encodes the cached device status with the age of the status fields as cbor map, see x3d_schema.h
+ *
+ * @param store device store
+ * @param slot device slot
+ * @param age age of the status fields in s, -1 if never read, ordered by x3d_device_field_t
+ * @param buffer output buffer
+ * @param size size of the output buffer
+ * @return int length of the output, 0 if there is no device, -1 if the buffer was too small
+ */
+int x3d_payload_query_cbor(const x3d_device_store_t *store, uint8_t slot, const int32_t *age, uint8_t *buffer, size_t size);
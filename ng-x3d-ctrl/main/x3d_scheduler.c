@@ -0,0 +1,198 @@
+/**
+ * @file x3d_scheduler.c
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief planning of background status reads per register interval within a radio time budget
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <string.h>
+
+#include "x3d.h"
+#include "x3d_scheduler.h"
+
+// radio time of a register read until the first sweep is measured
+#define X3D_SCHEDULER_DEFAULT_READ_MS   1000
+
+// EWMA weight 1/4 of the read cost
+#define X3D_SCHEDULER_EWMA_SHIFT        2
+
+typedef struct {
+    uint8_t network;
+    uint32_t last_refill;   // time of the last budget refill in s, 0 if unused
+    uint64_t budget;        // remaining budget in ms * window_s, keeps the fraction of the refill
+    x3d_scheduler_stats_t stats;
+} x3d_scheduler_entry_t;
+
+static x3d_scheduler_entry_t x3d_scheduler_entries[X3D_SCHEDULER_NETWORKS];
+static uint32_t x3d_scheduler_interval[X3D_DEVICE_FIELDS];
+static uint8_t x3d_scheduler_order[X3D_DEVICE_FIELDS];
+static uint32_t x3d_scheduler_budget_ms = 0;
+static uint32_t x3d_scheduler_window_s  = 1;
+
+/**
+ * @brief Looks up the entry of a network, a free entry is assigned on first use
+ *
+ * @param network network number
+ * @return x3d_scheduler_entry_t* entry or NULL if all entries are used
+ */
+static x3d_scheduler_entry_t *x3d_scheduler_find(uint8_t network)
+{
+    for (int i = 0; i < X3D_SCHEDULER_NETWORKS; i++)
+    {
+        x3d_scheduler_entry_t *entry = &x3d_scheduler_entries[i];
+        if (entry->last_refill != 0 && entry->network == network)
+        {
+            return entry;
+        }
+    }
+    for (int i = 0; i < X3D_SCHEDULER_NETWORKS; i++)
+    {
+        x3d_scheduler_entry_t *entry = &x3d_scheduler_entries[i];
+        if (entry->last_refill == 0)
+        {
+            entry->network            = network;
+            entry->budget             = (uint64_t)x3d_scheduler_budget_ms * x3d_scheduler_window_s;
+            entry->stats.read_cost_ms = X3D_SCHEDULER_DEFAULT_READ_MS;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Adds the budget of the time since the last refill, limited to one window
+ *
+ * @param entry scheduler entry
+ * @param now current time in s
+ */
+static void x3d_scheduler_refill(x3d_scheduler_entry_t *entry, uint32_t now)
+{
+    uint64_t max = (uint64_t)x3d_scheduler_budget_ms * x3d_scheduler_window_s;
+    if (entry->last_refill != 0 && now > entry->last_refill)
+    {
+        entry->budget += (uint64_t)(now - entry->last_refill) * x3d_scheduler_budget_ms;
+    }
+    if (entry->budget > max)
+    {
+        entry->budget = max;
+    }
+    entry->last_refill     = now;
+    entry->stats.budget_ms = entry->budget / x3d_scheduler_window_s;
+}
+
+void x3d_scheduler_init(const uint32_t *interval_s, uint32_t budget_ms, uint32_t window_s)
+{
+    memset(x3d_scheduler_entries, 0, sizeof(x3d_scheduler_entries));
+    for (int f = 0; f < X3D_DEVICE_FIELDS; f++)
+    {
+        x3d_scheduler_interval[f] = interval_s[x3d_device_field(f)->poll];
+    }
+    x3d_scheduler_budget_ms = budget_ms;
+    x3d_scheduler_window_s  = window_s > 0 ? window_s : 1;
+
+    // fields sorted by interval, the often read fields get the budget first
+    for (int i = 0; i < X3D_DEVICE_FIELDS; i++)
+    {
+        int j = i;
+        for (; j > 0 && x3d_scheduler_interval[x3d_scheduler_order[j - 1]] > x3d_scheduler_interval[i]; j--)
+        {
+            x3d_scheduler_order[j] = x3d_scheduler_order[j - 1];
+        }
+        x3d_scheduler_order[j] = i;
+    }
+}
+
+uint8_t x3d_scheduler_due(const x3d_device_store_t *store, uint16_t mask, const uint32_t (*read_time)[X3D_DEVICE_FIELDS], uint32_t now)
+{
+    uint8_t due = 0;
+    for (int f = 0; f < X3D_DEVICE_FIELDS; f++)
+    {
+        if (x3d_scheduler_interval[f] == 0)
+        {
+            continue;
+        }
+        for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+        {
+            if ((mask & (1 << i)) && x3d_device_has_field(store, i, f)
+                    && (read_time[i][f] == 0 || now - read_time[i][f] >= x3d_scheduler_interval[f]))
+            {
+                due |= 1 << f;
+                break;
+            }
+        }
+    }
+    return due;
+}
+
+uint8_t x3d_scheduler_plan(uint8_t network, uint8_t due, uint32_t now)
+{
+    x3d_scheduler_entry_t *entry = x3d_scheduler_find(network);
+    if (entry == NULL)
+    {
+        return 0;
+    }
+    x3d_scheduler_refill(entry, now);
+
+    uint8_t plan    = 0;
+    uint8_t pending = 0;
+    uint32_t cost   = 0;
+    for (int i = 0; i < X3D_DEVICE_FIELDS; i++)
+    {
+        uint8_t field = 1 << x3d_scheduler_order[i];
+        if ((due & field) == 0)
+        {
+            continue;
+        }
+        if (cost + entry->stats.read_cost_ms <= entry->stats.budget_ms)
+        {
+            cost += entry->stats.read_cost_ms;
+            plan |= field;
+        }
+        else
+        {
+            pending++;
+        }
+    }
+    entry->stats.pending = pending;
+    return plan;
+}
+
+void x3d_scheduler_account(uint8_t network, int reads, uint32_t radio_ms)
+{
+    x3d_scheduler_entry_t *entry = x3d_scheduler_find(network);
+    if (entry == NULL)
+    {
+        return;
+    }
+
+    uint64_t charge        = (uint64_t)radio_ms * x3d_scheduler_window_s;
+    entry->budget          = entry->budget > charge ? entry->budget - charge : 0;
+    entry->stats.budget_ms = entry->budget / x3d_scheduler_window_s;
+    entry->stats.sweeps++;
+    entry->stats.reads += reads;
+    entry->stats.radio_ms += radio_ms;
+
+    if (reads > 0)
+    {
+        int32_t sample            = radio_ms / reads;
+        int32_t cost              = entry->stats.read_cost_ms;
+        entry->stats.read_cost_ms = cost + (sample - cost) / (1 << X3D_SCHEDULER_EWMA_SHIFT);
+    }
+}
+
+bool x3d_scheduler_get_stats(uint8_t network, x3d_scheduler_stats_t *stats)
+{
+    for (int i = 0; i < X3D_SCHEDULER_NETWORKS; i++)
+    {
+        x3d_scheduler_entry_t *entry = &x3d_scheduler_entries[i];
+        if (entry->last_refill != 0 && entry->network == network)
+        {
+            *stats = entry->stats;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,78 @@
+/**
+ * @file x3d_scheduler.h
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief planning of background status reads per register interval within a radio time budget
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "x3d_device.h"
+
+// number of tracked networks
+#define X3D_SCHEDULER_NETWORKS          2
+
+/// @brief Statistics of the background status reads of a network
+typedef struct {
+    uint32_t sweeps;        ///< number of sweeps
+    uint32_t reads;         ///< register reads with radio transfer
+    uint32_t radio_ms;      ///< radio time used by the sweeps
+    uint32_t budget_ms;     ///< remaining radio time budget
+    uint32_t read_cost_ms;  ///< estimated radio time of a register read
+    uint8_t pending;        ///< due registers held back by the budget at the last plan
+} x3d_scheduler_stats_t;
+
+/**
+ * @brief Sets the read interval of the poll classes and the radio time budget
+ *
+ * @param interval_s read interval per x3d_device_poll_t in s, 0 disables the class
+ * @param budget_ms radio time per network and window
+ * @param window_s budget window in s
+ */
+void x3d_scheduler_init(const uint32_t *interval_s, uint32_t budget_ms, uint32_t window_s);
+
+/**
+ * @brief Returns the status fields outdated on at least one device supporting the field
+ *
+ * @param store device store of the network
+ * @param mask device mask
+ * @param read_time time of the last read per device and field, 0 if not read
+ * @param now current time in s
+ * @return uint8_t field bit mask
+ */
+uint8_t x3d_scheduler_due(const x3d_device_store_t *store, uint16_t mask, const uint32_t (*read_time)[X3D_DEVICE_FIELDS], uint32_t now);
+
+/**
+ * @brief Selects the due fields to read in one sweep, the fields with the shortest interval first,
+ * as long as the estimated radio time fits into the remaining budget
+ *
+ * @param network network number
+ * @param due field bit mask of x3d_scheduler_due
+ * @param now current time in s
+ * @return uint8_t field bit mask to read
+ */
+uint8_t x3d_scheduler_plan(uint8_t network, uint8_t due, uint32_t now);
+
+/**
+ * @brief Charges a finished sweep to the budget and updates the read cost estimation
+ *
+ * @param network network number
+ * @param reads register reads with radio transfer
+ * @param radio_ms radio time of the sweep
+ */
+void x3d_scheduler_account(uint8_t network, int reads, uint32_t radio_ms);
+
+/**
+ * @brief Copies the statistics of a network
+ *
+ * @param network network number
+ * @param stats target
+ * @return bool false if the network has no scheduled reads yet
+ */
+bool x3d_scheduler_get_stats(uint8_t network, x3d_scheduler_stats_t *stats);
@@ -0,0 +1,82 @@
+/**
+ * @file x3d_schema.h
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief CBOR payload schema of device status and results, shared with the host decoder
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+/**
+ * Device status is a map with integer keys, values are the raw register values of the device data.
+ * The keys depend on the device type, rf66xx:
+ *
+ * { 0: type, 1: roomTemp [0.01 °C], 2: power [50 W], 3: setPoint [0.5 °C], 4: setPointDay [0.5 °C],
+ *   5: setPointNight [0.5 °C], 6: setPointDefrost [0.5 °C], 7: flags }
+ *
+ * window:
+ *
+ * { 0: type, 7: flags }
+ *
+ * Result is a map with integer keys of x3d_standard_msg_payload_t:
+ *
+ * { 0: action, 1: net, 2: ack, 3: regHigh, 4: regLow, 5: [values] }
+ *
+ * Query response is a map of the device status and the age of the status fields in s, -1 if never read:
+ *
+ * { 0: { device status }, 1: [roomTemp, setPointStatus, errorStatus, onOff, setPointDefrost, setPointNightDay, power] }
+ */
+
+/// @brief Map keys of the device status
+typedef enum {
+    X3D_SCHEMA_DEVICE_TYPE = 0,          ///< x3d_device_type_t
+    X3D_SCHEMA_DEVICE_ROOM_TEMP,         ///< room temperature in 0.01 °C
+    X3D_SCHEMA_DEVICE_POWER,             ///< attached power in 50 W
+    X3D_SCHEMA_DEVICE_SET_POINT,         ///< current set point in 0.5 °C
+    X3D_SCHEMA_DEVICE_SET_POINT_DAY,     ///< day set point in 0.5 °C
+    X3D_SCHEMA_DEVICE_SET_POINT_NIGHT,   ///< night set point in 0.5 °C
+    X3D_SCHEMA_DEVICE_SET_POINT_DEFROST, ///< defrost set point in 0.5 °C
+    X3D_SCHEMA_DEVICE_FLAGS,             ///< x3d_schema_flag_t bit mask
+    X3D_SCHEMA_DEVICE_KEYS,
+} x3d_schema_device_key_t;
+
+/// @brief Bits of the device status flags
+typedef enum {
+    X3D_SCHEMA_FLAG_ON_AIR         = 0x0001,
+    X3D_SCHEMA_FLAG_ENABLED        = 0x0002,
+    X3D_SCHEMA_FLAG_DEFROST        = 0x0004,
+    X3D_SCHEMA_FLAG_TIMED          = 0x0008,
+    X3D_SCHEMA_FLAG_HEATER_ON      = 0x0010,
+    X3D_SCHEMA_FLAG_HEATER_STOPPED = 0x0020,
+    X3D_SCHEMA_FLAG_WINDOW_OPEN    = 0x0040,
+    X3D_SCHEMA_FLAG_NO_TEMP_SENSOR = 0x0080,
+    X3D_SCHEMA_FLAG_BATTERY_LOW    = 0x0100,
+    X3D_SCHEMA_FLAG_STALE          = 0x0200, ///< restored after reboot, not read yet
+} x3d_schema_flag_t;
+
+/// @brief Map keys of the read and write result
+typedef enum {
+    X3D_SCHEMA_RESULT_ACTION = 0, ///< x3d_schema_action_t
+    X3D_SCHEMA_RESULT_NETWORK,    ///< network number
+    X3D_SCHEMA_RESULT_ACK,        ///< acknowledge mask
+    X3D_SCHEMA_RESULT_REG_HIGH,   ///< register high number
+    X3D_SCHEMA_RESULT_REG_LOW,    ///< register low number
+    X3D_SCHEMA_RESULT_VALUES,     ///< array of register values, one per data slot
+    X3D_SCHEMA_RESULT_KEYS,
+} x3d_schema_result_key_t;
+
+/// @brief Result actions
+typedef enum {
+    X3D_SCHEMA_ACTION_READ = 0,
+    X3D_SCHEMA_ACTION_WRITE,
+} x3d_schema_action_t;
+
+/// @brief Map keys of the query response
+typedef enum {
+    X3D_SCHEMA_QUERY_STATUS = 0, ///< device status map
+    X3D_SCHEMA_QUERY_AGE,        ///< array of field ages in s, ordered by x3d_device_field_t
+    X3D_SCHEMA_QUERY_KEYS,
+} x3d_schema_query_key_t;
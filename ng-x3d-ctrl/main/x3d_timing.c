@@ -0,0 +1,266 @@
+/**
+ * @file x3d_timing.c
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief online estimation of the mesh response time per network and target mask
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <string.h>
+
+#include "x3d.h"
+#include "x3d_timing.h"
+
+// histogram buckets are one message slot wide
+#define X3D_TIMING_BUCKET_MS            X3D_MSG_DELAY_MS
+#define X3D_TIMING_BUCKETS              64
+#define X3D_TIMING_BUCKET_MAX           255
+
+// samples required before the model replaces the default timeout
+#define X3D_TIMING_MIN_SAMPLES          4
+
+// slots added to the percentile as safety margin
+#define X3D_TIMING_MARGIN_SLOTS         2
+
+// timeout limits
+#define X3D_TIMING_MIN_WAIT_MS          (2 * X3D_MSG_DELAY_MS)
+#define X3D_TIMING_MAX_WAIT_MS          3000
+
+// miss rate in 1/256, above these the transmission count is raised
+#define X3D_TIMING_MISS_RATE_ONE        256
+#define X3D_TIMING_MISS_RATE_LOW        32
+#define X3D_TIMING_MISS_RATE_HIGH       96
+#define X3D_TIMING_RETRY_COUNT_MAX      5
+
+// EWMA weight 1/8, values in 1/16 ms
+#define X3D_TIMING_EWMA_SHIFT           3
+#define X3D_TIMING_EWMA_FIXED           4
+
+typedef struct {
+    uint8_t network;
+    uint16_t target;
+    uint16_t samples;
+    uint16_t misses;
+    uint8_t miss_streak;
+    uint16_t miss_rate;     // EWMA of misses in 1/256
+    uint32_t ewma;          // EWMA of completion time in 1/16 ms
+    uint32_t last_use;
+    uint32_t wait_ms;       // last timeout handed out
+    uint8_t retry_count;    // last transmission count handed out
+    uint8_t histogram[X3D_TIMING_BUCKETS];
+} x3d_timing_entry_t;
+
+static x3d_timing_entry_t x3d_timing_entries[X3D_TIMING_ENTRIES];
+static uint32_t x3d_timing_use_counter = 0;
+
+/**
+ * @brief Looks up the entry of network and target, optional the least recently used is replaced
+ *
+ * @param network network number
+ * @param target target device mask
+ * @param create replace the least recently used entry if not found
+ * @return x3d_timing_entry_t* entry or NULL
+ */
+static x3d_timing_entry_t *x3d_timing_find(uint8_t network, uint16_t target, bool create)
+{
+    x3d_timing_entry_t *lru = &x3d_timing_entries[0];
+    for (int i = 0; i < X3D_TIMING_ENTRIES; i++)
+    {
+        x3d_timing_entry_t *entry = &x3d_timing_entries[i];
+        if (entry->target == target && entry->network == network)
+        {
+            entry->last_use = ++x3d_timing_use_counter;
+            return entry;
+        }
+        if (entry->last_use < lru->last_use)
+        {
+            lru = entry;
+        }
+    }
+
+    if (!create || target == 0)
+    {
+        return NULL;
+    }
+
+    memset(lru, 0, sizeof(x3d_timing_entry_t));
+    lru->network  = network;
+    lru->target   = target;
+    lru->last_use = ++x3d_timing_use_counter;
+    return lru;
+}
+
+/**
+ * @brief Calculates the upper bound of the given percentile from the histogram
+ *
+ * @param entry timing entry
+ * @param percent percentile 1..100
+ * @return uint32_t time in ms
+ */
+static uint32_t x3d_timing_percentile(x3d_timing_entry_t *entry, int percent)
+{
+    uint32_t total = 0;
+    for (int i = 0; i < X3D_TIMING_BUCKETS; i++)
+    {
+        total += entry->histogram[i];
+    }
+
+    uint32_t rank = (total * percent + 99) / 100;
+    uint32_t sum  = 0;
+    for (int i = 0; i < X3D_TIMING_BUCKETS; i++)
+    {
+        sum += entry->histogram[i];
+        if (sum >= rank && sum > 0)
+        {
+            return (i + 1) * X3D_TIMING_BUCKET_MS;
+        }
+    }
+    return X3D_TIMING_BUCKETS * X3D_TIMING_BUCKET_MS;
+}
+
+static uint32_t x3d_timing_entry_wait(x3d_timing_entry_t *entry, uint32_t default_ms)
+{
+    uint32_t wait = default_ms;
+    if (entry != NULL && entry->samples >= X3D_TIMING_MIN_SAMPLES)
+    {
+        wait = x3d_timing_percentile(entry, 95) + X3D_TIMING_MARGIN_SLOTS * X3D_MSG_DELAY_MS;
+    }
+
+    // back off on consecutive timeouts, a weak relay needs more time than observed
+    if (entry != NULL && entry->miss_streak > 0)
+    {
+        uint32_t boost = entry->miss_streak > 2 ? 2 : entry->miss_streak;
+        wait           = (wait > default_ms ? wait : default_ms) << boost;
+    }
+
+    if (wait < X3D_TIMING_MIN_WAIT_MS)
+    {
+        wait = X3D_TIMING_MIN_WAIT_MS;
+    }
+    if (wait > X3D_TIMING_MAX_WAIT_MS)
+    {
+        wait = X3D_TIMING_MAX_WAIT_MS;
+    }
+    return wait;
+}
+
+static uint8_t x3d_timing_entry_retry_count(x3d_timing_entry_t *entry, uint8_t default_count)
+{
+    if (entry == NULL)
+    {
+        return default_count;
+    }
+
+    uint8_t count = default_count;
+    if (entry->miss_rate > X3D_TIMING_MISS_RATE_HIGH)
+    {
+        count += 2;
+    }
+    else if (entry->miss_rate > X3D_TIMING_MISS_RATE_LOW)
+    {
+        count += 1;
+    }
+    return count > X3D_TIMING_RETRY_COUNT_MAX ? X3D_TIMING_RETRY_COUNT_MAX : count;
+}
+
+uint32_t x3d_timing_wait_ms(uint8_t network, uint16_t target, uint32_t default_ms)
+{
+    x3d_timing_entry_t *entry = x3d_timing_find(network, target, true);
+    uint32_t wait             = x3d_timing_entry_wait(entry, default_ms);
+    if (entry != NULL)
+    {
+        entry->wait_ms = wait;
+    }
+    return wait;
+}
+
+uint8_t x3d_timing_retry_count(uint8_t network, uint16_t target, uint8_t default_count)
+{
+    x3d_timing_entry_t *entry = x3d_timing_find(network, target, true);
+    uint8_t count             = x3d_timing_entry_retry_count(entry, default_count);
+    if (entry != NULL)
+    {
+        entry->retry_count = count;
+    }
+    return count;
+}
+
+void x3d_timing_sample(uint8_t network, uint16_t target, bool complete, uint32_t elapsed_ms)
+{
+    x3d_timing_entry_t *entry = x3d_timing_find(network, target, true);
+    if (entry == NULL)
+    {
+        return;
+    }
+
+    uint16_t miss    = complete ? 0 : X3D_TIMING_MISS_RATE_ONE;
+    entry->miss_rate = entry->miss_rate - (entry->miss_rate >> X3D_TIMING_EWMA_SHIFT) + (miss >> X3D_TIMING_EWMA_SHIFT);
+    if (!complete)
+    {
+        entry->misses++;
+        if (entry->miss_streak < UINT8_MAX)
+        {
+            entry->miss_streak++;
+        }
+        return;
+    }
+    entry->miss_streak = 0;
+
+    uint32_t value = elapsed_ms << X3D_TIMING_EWMA_FIXED;
+    if (entry->samples == 0)
+    {
+        entry->ewma = value;
+    }
+    else
+    {
+        entry->ewma = entry->ewma - (entry->ewma >> X3D_TIMING_EWMA_SHIFT) + (value >> X3D_TIMING_EWMA_SHIFT);
+    }
+    if (entry->samples < UINT16_MAX)
+    {
+        entry->samples++;
+    }
+
+    int bucket = elapsed_ms / X3D_TIMING_BUCKET_MS;
+    if (bucket >= X3D_TIMING_BUCKETS)
+    {
+        bucket = X3D_TIMING_BUCKETS - 1;
+    }
+
+    // halve all buckets on overflow, so the histogram follows changes of the mesh
+    if (entry->histogram[bucket] == X3D_TIMING_BUCKET_MAX)
+    {
+        for (int i = 0; i < X3D_TIMING_BUCKETS; i++)
+        {
+            entry->histogram[i] >>= 1;
+        }
+    }
+    entry->histogram[bucket]++;
+}
+
+int x3d_timing_get_models(uint8_t network, x3d_timing_model_t *models, int max_models)
+{
+    int count = 0;
+    for (int i = 0; i < X3D_TIMING_ENTRIES && count < max_models; i++)
+    {
+        x3d_timing_entry_t *entry = &x3d_timing_entries[i];
+        if (entry->target == 0 || entry->network != network)
+        {
+            continue;
+        }
+
+        models[count] = (x3d_timing_model_t){
+                .network     = entry->network,
+                .target      = entry->target,
+                .samples     = entry->samples,
+                .misses      = entry->misses,
+                .ewma_ms     = entry->ewma >> X3D_TIMING_EWMA_FIXED,
+                .p95_ms      = entry->samples > 0 ? x3d_timing_percentile(entry, 95) : 0,
+                .wait_ms     = entry->wait_ms,
+                .retry_count = entry->retry_count,
+        };
+        count++;
+    }
+    return count;
+}
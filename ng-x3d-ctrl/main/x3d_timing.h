@@ -0,0 +1,69 @@
+/**
+ * @file x3d_timing.h
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief online estimation of the mesh response time per network and target mask
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// number of tracked network/target combinations
+#define X3D_TIMING_ENTRIES              8
+
+/// @brief Observed timing model of a network and target mask
+typedef struct {
+    uint8_t network;
+    uint16_t target;
+    uint16_t samples;     ///< number of completed transactions
+    uint16_t misses;      ///< number of transactions without full acknowledge
+    uint32_t ewma_ms;     ///< smoothed time from end of transmission to full acknowledge
+    uint32_t p95_ms;      ///< 95th percentile of the time to full acknowledge
+    uint32_t wait_ms;     ///< last response timeout derived from the model
+    uint8_t retry_count;  ///< last transmission count derived from the model
+} x3d_timing_model_t;
+
+/**
+ * @brief Returns the response timeout for a transaction
+ *
+ * @param network network number
+ * @param target target device mask
+ * @param default_ms fixed timeout used until enough samples are observed
+ * @return uint32_t timeout in ms
+ */
+uint32_t x3d_timing_wait_ms(uint8_t network, uint16_t target, uint32_t default_ms);
+
+/**
+ * @brief Returns the number of message transmissions for a transaction
+ *
+ * @param network network number
+ * @param target target device mask
+ * @param default_count fixed count used on a reliable network
+ * @return uint8_t transmission count
+ */
+uint8_t x3d_timing_retry_count(uint8_t network, uint16_t target, uint8_t default_count);
+
+/**
+ * @brief Adds an observed transaction to the model
+ *
+ * @param network network number
+ * @param target target device mask
+ * @param complete true if all targets acknowledged
+ * @param elapsed_ms time from end of transmission to full acknowledge, or the timeout
+ */
+void x3d_timing_sample(uint8_t network, uint16_t target, bool complete, uint32_t elapsed_ms);
+
+/**
+ * @brief Copies the observed models of a network
+ *
+ * @param network network number
+ * @param models target array
+ * @param max_models size of the target array
+ * @return int number of models copied
+ */
+int x3d_timing_get_models(uint8_t network, x3d_timing_model_t *models, int max_models);
@@ -0,0 +1,459 @@
+/**
+ * @file x3d_topology.c
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief online inference of the mesh topology from the relay frames of the own transactions
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <string.h>
+
+#include "rfm.h"
+#include "x3d.h"
+#include "x3d_topology.h"
+
+// relay frames of one transaction kept for the inference
+#define X3D_TOPOLOGY_RELAYS             64
+
+// samples of a link before it counts for the depth and the transmission count
+#define X3D_TOPOLOGY_MIN_SAMPLES        4
+
+// link rates in 1/256, a link with a rate above counts for the depth
+#define X3D_TOPOLOGY_RATE_ONE           256
+#define X3D_TOPOLOGY_RATE_GOOD          128
+
+// a row is republished if a rate moves to another 1/8 step or the RSSI by 2 dBm
+#define X3D_TOPOLOGY_RATE_LEVEL_SHIFT   5
+#define X3D_TOPOLOGY_RSSI_LEVEL_SHIFT   1
+
+// EWMA weight 1/8, RSSI in 1/16 dBm
+#define X3D_TOPOLOGY_EWMA_SHIFT         3
+#define X3D_TOPOLOGY_RSSI_FIXED         4
+
+// response slots per device and transmission count limits
+#define X3D_TOPOLOGY_SLOTS_MAX          6
+#define X3D_TOPOLOGY_RETRY_MIN          2
+#define X3D_TOPOLOGY_RETRY_MAX          5
+
+// accepted probability in 1/256 that no transmission of the countdown reaches the mesh
+#define X3D_TOPOLOGY_LOSS_TARGET        4
+
+/// @brief Link matrix of a network, written by the receive path only
+typedef struct {
+    uint8_t network;                                                // 0 if unused
+    uint16_t hears[X3D_MAX_NET_DEVICES][X3D_MAX_NET_DEVICES];       // rate a device hears another one
+    uint8_t hears_samples[X3D_MAX_NET_DEVICES][X3D_MAX_NET_DEVICES];
+    uint16_t station[X3D_MAX_NET_DEVICES];                          // rate the controller hears a device
+    uint8_t station_samples[X3D_MAX_NET_DEVICES];
+    int16_t rssi[X3D_MAX_NET_DEVICES];                              // 0 if never heard
+    uint8_t version[X3D_MAX_NET_DEVICES];                           // incremented on visible changes of a row
+} x3d_topology_net_t;
+
+/// @brief Publish state of a network, written by the reader only
+typedef struct {
+    uint8_t version[X3D_MAX_NET_DEVICES];
+    uint8_t depth[X3D_MAX_NET_DEVICES];
+} x3d_topology_published_t;
+
+/// @brief Relay frame of the current transaction
+typedef struct {
+    uint8_t slot;
+    uint16_t mask;
+} x3d_topology_relay_t;
+
+/// @brief Inference state of the current transaction
+typedef struct {
+    x3d_topology_net_t *net;
+    uint8_t msg_no;
+    uint8_t max_round;
+    uint16_t transfer;                          // devices asked to relay
+    uint16_t heard;                             // devices with a received relay
+    uint16_t carried;                           // bits carried by the received relays
+    uint8_t counted[X3D_MAX_NET_DEVICES];       // response rounds accounted for the controller link
+    int8_t last[X3D_MAX_NET_DEVICES];           // index of the last relay of a device, -1 if none
+    uint8_t count;
+    x3d_topology_relay_t relays[X3D_TOPOLOGY_RELAYS];
+} x3d_topology_transaction_t;
+
+static x3d_topology_net_t x3d_topology_nets[X3D_TOPOLOGY_NETWORKS];
+static x3d_topology_published_t x3d_topology_published[X3D_TOPOLOGY_NETWORKS];
+static x3d_topology_transaction_t x3d_topology_tx;
+
+static x3d_topology_net_t *x3d_topology_find(uint8_t network, bool create)
+{
+    for (int i = 0; i < X3D_TOPOLOGY_NETWORKS; i++)
+    {
+        if (x3d_topology_nets[i].network == network)
+        {
+            return &x3d_topology_nets[i];
+        }
+    }
+    for (int i = 0; create && i < X3D_TOPOLOGY_NETWORKS; i++)
+    {
+        if (x3d_topology_nets[i].network == 0)
+        {
+            memset(x3d_topology_published[i].depth, X3D_TOPOLOGY_DEPTH_UNKNOWN, X3D_MAX_NET_DEVICES);
+            x3d_topology_nets[i].network = network;
+            return &x3d_topology_nets[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Adds a sample to a rate
+ *
+ * @return bool true if the published value changed
+ */
+static bool x3d_topology_sample(uint16_t *rate, uint8_t *samples, bool hit)
+{
+    uint16_t before = *rate >> X3D_TOPOLOGY_RATE_LEVEL_SHIFT;
+    uint16_t value  = hit ? X3D_TOPOLOGY_RATE_ONE : 0;
+    if (*samples == 0)
+    {
+        *rate = value;
+    }
+    else
+    {
+        *rate = *rate - (*rate >> X3D_TOPOLOGY_EWMA_SHIFT) + (value >> X3D_TOPOLOGY_EWMA_SHIFT);
+    }
+
+    bool first = *samples == 0;
+    if (*samples < UINT8_MAX)
+    {
+        (*samples)++;
+    }
+    return first || (*rate >> X3D_TOPOLOGY_RATE_LEVEL_SHIFT) != before;
+}
+
+static void x3d_topology_link(x3d_topology_net_t *net, uint8_t slot, uint8_t from, bool hit)
+{
+    if (x3d_topology_sample(&net->hears[slot][from], &net->hears_samples[slot][from], hit))
+    {
+        net->version[slot]++;
+    }
+}
+
+static void x3d_topology_station(x3d_topology_net_t *net, uint8_t slot, bool hit)
+{
+    if (x3d_topology_sample(&net->station[slot], &net->station_samples[slot], hit))
+    {
+        net->version[slot]++;
+    }
+}
+
+/**
+ * @brief Accounts the response rounds of all devices up to the given one, rounds without received relay are misses
+ */
+static void x3d_topology_rounds(uint8_t round)
+{
+    x3d_topology_transaction_t *tx = &x3d_topology_tx;
+    for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+    {
+        for (; (tx->transfer & (1 << i)) && tx->counted[i] < round; tx->counted[i]++)
+        {
+            x3d_topology_station(tx->net, i, false);
+        }
+    }
+}
+
+/**
+ * @brief Closes the current transaction and starts the next one
+ */
+static void x3d_topology_begin(x3d_topology_net_t *net, const uint8_t *buffer, uint8_t payload_index)
+{
+    x3d_topology_transaction_t *tx = &x3d_topology_tx;
+    if (tx->net != NULL)
+    {
+        x3d_topology_rounds(tx->max_round);
+    }
+
+    tx->net       = net;
+    tx->msg_no    = buffer[X3D_IDX_MSG_NO];
+    tx->max_round = 0;
+    tx->transfer  = buffer[payload_index + X3D_OFF_RETRANS_SLOT] | buffer[payload_index + X3D_OFF_RETRANS_SLOT + 1] << 8;
+    tx->heard     = 0;
+    tx->carried   = 0;
+    tx->count     = 0;
+    memset(tx->counted, 0, sizeof(tx->counted));
+    memset(tx->last, -1, sizeof(tx->last));
+}
+
+/**
+ * @brief Infers the links of a relaying device from the relays received since its previous one.
+ * The device merged every frame it received, a frame with a bit missing in its mask was not received.
+ * A bit only one frame carried proves that frame was received, other frames stay without sample.
+ */
+static void x3d_topology_infer(uint8_t slot, uint16_t mask)
+{
+    x3d_topology_transaction_t *tx = &x3d_topology_tx;
+    int from       = tx->last[slot] + 1;
+    uint16_t known = (tx->last[slot] >= 0 ? tx->relays[tx->last[slot]].mask : 0) | 1 << slot;
+
+    uint16_t once  = 0;
+    uint16_t twice = 0;
+    for (int i = from; i < tx->count; i++)
+    {
+        uint16_t bits = tx->relays[i].mask & ~known;
+        twice |= once & bits;
+        once |= bits;
+    }
+
+    for (int i = from; i < tx->count; i++)
+    {
+        uint8_t other = tx->relays[i].slot;
+        if (other == slot)
+        {
+            continue;
+        }
+        if (tx->relays[i].mask & ~mask)
+        {
+            x3d_topology_link(tx->net, slot, other, false);
+        }
+        else if (tx->relays[i].mask & ~known & ~twice)
+        {
+            x3d_topology_link(tx->net, slot, other, true);
+        }
+    }
+
+    // answers of devices the controller does not hear arrive through this relay
+    uint16_t hidden = mask & ~known & ~tx->carried & ~tx->heard;
+    for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+    {
+        if (hidden & (1 << i))
+        {
+            x3d_topology_link(tx->net, slot, i, true);
+        }
+    }
+}
+
+void x3d_topology_frame(const uint8_t *buffer, int16_t rssi)
+{
+    uint8_t payload_index = (buffer[X3D_IDX_HEADER_LEN] & X3D_HEADER_LENGTH_MASK) + X3D_IDX_HEADER_LEN;
+    if (buffer[X3D_IDX_MSG_TYPE] != X3D_MSG_TYPE_STANDARD || payload_index + X3D_OFF_RETRANS_ACK_SLOT + 1 >= buffer[X3D_IDX_PKT_LEN])
+    {
+        return;
+    }
+
+    // initiator frames count down with a zero high nibble, relays carry the response round and the sender
+    uint8_t round = buffer[payload_index] >> 4;
+    uint8_t slot  = buffer[payload_index] & 0x0f;
+    if (round == 0)
+    {
+        return;
+    }
+
+    x3d_topology_transaction_t *tx = &x3d_topology_tx;
+    x3d_topology_net_t *net        = x3d_topology_find(buffer[X3D_IDX_NETWORK] & 0x7f, true);
+    if (net == NULL)
+    {
+        return;
+    }
+    if (tx->net != net || tx->msg_no != buffer[X3D_IDX_MSG_NO])
+    {
+        x3d_topology_begin(net, buffer, payload_index);
+    }
+
+    // the controller link counts one sample per device and response round
+    if (round > tx->max_round)
+    {
+        x3d_topology_rounds(round - 1);
+        tx->max_round = round;
+    }
+    if ((tx->transfer & (1 << slot)) && tx->counted[slot] < round)
+    {
+        x3d_topology_station(net, slot, true);
+        tx->counted[slot] = round;
+    }
+
+    if (rssi != RFM_RSSI_INVALID)
+    {
+        int16_t value = rssi << X3D_TOPOLOGY_RSSI_FIXED;
+        int16_t level = net->rssi[slot] >> (X3D_TOPOLOGY_RSSI_FIXED + X3D_TOPOLOGY_RSSI_LEVEL_SHIFT);
+        net->rssi[slot] = net->rssi[slot] == 0 ? value : net->rssi[slot] - (net->rssi[slot] >> X3D_TOPOLOGY_EWMA_SHIFT) + (value >> X3D_TOPOLOGY_EWMA_SHIFT);
+        if (net->rssi[slot] >> (X3D_TOPOLOGY_RSSI_FIXED + X3D_TOPOLOGY_RSSI_LEVEL_SHIFT) != level)
+        {
+            net->version[slot]++;
+        }
+    }
+
+    uint16_t mask = buffer[payload_index + X3D_OFF_RETRANS_ACK_SLOT] | buffer[payload_index + X3D_OFF_RETRANS_ACK_SLOT + 1] << 8;
+    x3d_topology_infer(slot, mask);
+    if (tx->count < X3D_TOPOLOGY_RELAYS)
+    {
+        tx->relays[tx->count] = (x3d_topology_relay_t){.slot = slot, .mask = mask};
+        tx->last[slot]        = tx->count++;
+    }
+    tx->heard |= 1 << slot;
+    tx->carried |= mask;
+}
+
+static bool x3d_topology_good(uint16_t rate, uint8_t samples)
+{
+    return samples >= X3D_TOPOLOGY_MIN_SAMPLES && rate > X3D_TOPOLOGY_RATE_GOOD;
+}
+
+/**
+ * @brief Calculates the hops of all devices from the controller, links are taken as symmetric
+ */
+static void x3d_topology_depths(const x3d_topology_net_t *net, uint8_t *depth)
+{
+    memset(depth, X3D_TOPOLOGY_DEPTH_UNKNOWN, X3D_MAX_NET_DEVICES);
+    uint16_t level = 0;
+    for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+    {
+        if (x3d_topology_good(net->station[i], net->station_samples[i]))
+        {
+            depth[i] = 1;
+            level |= 1 << i;
+        }
+    }
+
+    for (uint8_t hops = 2; level != 0; hops++)
+    {
+        uint16_t next = 0;
+        for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+        {
+            for (int j = 0; depth[i] == X3D_TOPOLOGY_DEPTH_UNKNOWN && j < X3D_MAX_NET_DEVICES; j++)
+            {
+                if ((level & (1 << j)) && (x3d_topology_good(net->hears[i][j], net->hears_samples[i][j])
+                        || x3d_topology_good(net->hears[j][i], net->hears_samples[j][i])))
+                {
+                    depth[i] = hops;
+                    next |= 1 << i;
+                }
+            }
+        }
+        level = next;
+    }
+}
+
+static int8_t x3d_topology_percent(uint16_t rate, uint8_t samples)
+{
+    return samples == 0 ? X3D_TOPOLOGY_RATE_UNKNOWN : (rate * 100 + X3D_TOPOLOGY_RATE_ONE / 2) / X3D_TOPOLOGY_RATE_ONE;
+}
+
+uint16_t x3d_topology_changed(uint8_t network)
+{
+    x3d_topology_net_t *net = x3d_topology_find(network, false);
+    if (net == NULL)
+    {
+        return 0;
+    }
+
+    x3d_topology_published_t *published = &x3d_topology_published[net - x3d_topology_nets];
+    uint8_t depth[X3D_MAX_NET_DEVICES];
+    x3d_topology_depths(net, depth);
+
+    uint16_t changed = 0;
+    for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+    {
+        if (net->version[i] != published->version[i] || depth[i] != published->depth[i])
+        {
+            changed |= 1 << i;
+        }
+    }
+    return changed;
+}
+
+bool x3d_topology_get_row(uint8_t network, uint8_t slot, x3d_topology_row_t *row)
+{
+    x3d_topology_net_t *net = x3d_topology_find(network, false);
+    if (net == NULL || slot >= X3D_MAX_NET_DEVICES)
+    {
+        return false;
+    }
+
+    x3d_topology_published_t *published = &x3d_topology_published[net - x3d_topology_nets];
+    uint8_t depth[X3D_MAX_NET_DEVICES];
+    x3d_topology_depths(net, depth);
+
+    row->slot    = slot;
+    row->depth   = depth[slot];
+    row->rssi    = (net->rssi[slot] + (1 << (X3D_TOPOLOGY_RSSI_FIXED - 1))) >> X3D_TOPOLOGY_RSSI_FIXED;
+    row->station = x3d_topology_percent(net->station[slot], net->station_samples[slot]);
+    for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+    {
+        row->hears[i] = x3d_topology_percent(net->hears[slot][i], net->hears_samples[slot][i]);
+    }
+    if (net->rssi[slot] == 0)
+    {
+        row->rssi = 0;
+    }
+
+    published->version[slot] = net->version[slot];
+    published->depth[slot]   = depth[slot];
+    return true;
+}
+
+uint8_t x3d_topology_depth(uint8_t network, uint16_t transfer)
+{
+    x3d_topology_net_t *net = x3d_topology_find(network, false);
+    if (net == NULL)
+    {
+        return 0;
+    }
+
+    uint8_t depth[X3D_MAX_NET_DEVICES];
+    x3d_topology_depths(net, depth);
+
+    // devices without known path did not answer for a while, they do not extend the wait
+    uint8_t max = 0;
+    for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+    {
+        if ((transfer & (1 << i)) && depth[i] != X3D_TOPOLOGY_DEPTH_UNKNOWN && depth[i] > max)
+        {
+            max = depth[i];
+        }
+    }
+    return max;
+}
+
+uint32_t x3d_topology_wait_ms(uint8_t network, uint16_t transfer, uint32_t default_ms)
+{
+    uint8_t depth = x3d_topology_depth(network, transfer);
+    if (depth == 0)
+    {
+        return default_ms;
+    }
+
+    // every hop takes one more relay round, one round margin
+    uint32_t slots = depth + 1 < X3D_TOPOLOGY_SLOTS_MAX ? depth + 1 : X3D_TOPOLOGY_SLOTS_MAX;
+    return __builtin_popcount(transfer) * slots * X3D_MSG_DELAY_MS;
+}
+
+uint8_t x3d_topology_retry_count(uint8_t network, uint16_t transfer, uint8_t default_count)
+{
+    x3d_topology_net_t *net = x3d_topology_find(network, false);
+    if (net == NULL)
+    {
+        return default_count;
+    }
+
+    // the message enters the mesh over the best controller link, the mesh relays it to the others
+    uint16_t best = 0;
+    bool known    = false;
+    for (int i = 0; i < X3D_MAX_NET_DEVICES; i++)
+    {
+        if ((transfer & (1 << i)) && net->station_samples[i] >= X3D_TOPOLOGY_MIN_SAMPLES)
+        {
+            known = true;
+            best  = net->station[i] > best ? net->station[i] : best;
+        }
+    }
+    if (!known)
+    {
+        return default_count;
+    }
+
+    uint32_t loss = X3D_TOPOLOGY_RATE_ONE;
+    uint8_t count = 0;
+    while (loss > X3D_TOPOLOGY_LOSS_TARGET && count < X3D_TOPOLOGY_RETRY_MAX)
+    {
+        loss = loss * (X3D_TOPOLOGY_RATE_ONE - best) / X3D_TOPOLOGY_RATE_ONE;
+        count++;
+    }
+    return count < X3D_TOPOLOGY_RETRY_MIN ? X3D_TOPOLOGY_RETRY_MIN : count;
+}
@@ -0,0 +1,96 @@
+/**
+ * @file x3d_topology.h
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief online inference of the mesh topology from the relay frames of the own transactions
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Every relay frame carries the slot of the relaying device in the low nibble of the counting byte and the
+ * transferred mask of all answers the device has merged so far. A device which received a frame has merged
+ * its whole mask, so a relay not containing a bit of a frame sent since its previous relay missed that frame.
+ * A bit which only one frame in between carried proves the frame was received. Devices the controller never
+ * hears are attached to the first relay which carries their bit, a hidden chain of devices is seen as one hop.
+ *
+ * The controller link of a device is the share of the response rounds its relay was received, with the RSSI.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "x3d.h"
+
+// number of networks with own link matrix
+#define X3D_TOPOLOGY_NETWORKS           2
+
+// depth of devices without known path
+#define X3D_TOPOLOGY_DEPTH_UNKNOWN      0xff
+
+// rate of a link without samples
+#define X3D_TOPOLOGY_RATE_UNKNOWN       -1
+
+/// @brief Links of one device
+typedef struct {
+    uint8_t slot;
+    uint8_t depth;                          ///< hops from the controller, X3D_TOPOLOGY_DEPTH_UNKNOWN if not connected
+    int8_t rssi;                            ///< smoothed RSSI of its relays at the controller in dBm, 0 if never heard
+    int8_t station;                         ///< rate the controller hears the device in %, X3D_TOPOLOGY_RATE_UNKNOWN without samples
+    int8_t hears[X3D_MAX_NET_DEVICES];      ///< rate the device hears the other devices in %, X3D_TOPOLOGY_RATE_UNKNOWN without samples
+} x3d_topology_row_t;
+
+/**
+ * @brief Adds a received frame of the own transaction, called by the processor for every relay also if already merged
+ *
+ * @param buffer received message
+ * @param rssi RSSI of the message in dBm, RFM_RSSI_INVALID if not measured
+ */
+void x3d_topology_frame(const uint8_t *buffer, int16_t rssi);
+
+/**
+ * @brief Returns the devices with changed links or depth since their last x3d_topology_get_row
+ *
+ * @param network network number
+ * @return uint16_t slot mask
+ */
+uint16_t x3d_topology_changed(uint8_t network);
+
+/**
+ * @brief Copies the links of a device and marks them as published
+ *
+ * @param network network number
+ * @param slot device slot
+ * @param row target row
+ * @return bool false if the network has no observed frames
+ */
+bool x3d_topology_get_row(uint8_t network, uint8_t slot, x3d_topology_row_t *row);
+
+/**
+ * @brief Returns the hops from the controller to the farthest device of the mask
+ *
+ * @param network network number
+ * @param transfer device mask
+ * @return uint8_t depth, 0 if not enough samples, devices without known path are left out
+ */
+uint8_t x3d_topology_depth(uint8_t network, uint16_t transfer);
+
+/**
+ * @brief Returns the response timeout derived from the mesh depth, one response slot per device and hop
+ *
+ * @param network network number
+ * @param transfer transfer device mask
+ * @param default_ms fixed timeout used until the depth is known
+ * @return uint32_t timeout in ms
+ */
+uint32_t x3d_topology_wait_ms(uint8_t network, uint16_t transfer, uint32_t default_ms);
+
+/**
+ * @brief Returns the number of message transmissions derived from the best controller link of the mask
+ *
+ * @param network network number
+ * @param transfer transfer device mask
+ * @param default_count fixed count used until the links are known
+ * @return uint8_t transmission count
+ */
+uint8_t x3d_topology_retry_count(uint8_t network, uint16_t transfer, uint8_t default_count);
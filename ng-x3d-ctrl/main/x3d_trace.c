@@ -0,0 +1,212 @@
+/**
+ * @file x3d_trace.c
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief ring buffered transaction trace with Chrome trace JSON export
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_timer.h"
+
+#include "x3d_trace.h"
+
+#define X3D_TRACE_PID     1
+#define X3D_TRACE_TID_TX  1
+#define X3D_TRACE_TID_RX  2
+#define X3D_TRACE_LINE    224
+
+#ifdef CONFIG_X3D_TRACE
+
+_Static_assert((CONFIG_X3D_TRACE_ENTRIES & (CONFIG_X3D_TRACE_ENTRIES - 1)) == 0, "CONFIG_X3D_TRACE_ENTRIES must be a power of two");
+
+#define X3D_TRACE_MASK (CONFIG_X3D_TRACE_ENTRIES - 1)
+
+volatile bool x3d_trace_enabled = false;
+
+static x3d_trace_entry_t x3d_trace_entries[CONFIG_X3D_TRACE_ENTRIES];
+static uint32_t x3d_trace_head = 0;
+
+static const char *x3d_trace_action_names[] = {"pair", "unpair", "read", "write", "temp"};
+static const char *x3d_trace_reject_names[] = {"header", "stale", "crc", "size", "replay"};
+static const char *x3d_trace_cause_names[]  = {"ack", "timeout"};
+
+void x3d_trace_record(uint8_t event, uint8_t arg, uint16_t value)
+{
+    // the rx and the transaction task are writing, reserve the slot atomic
+    uint32_t index           = __atomic_fetch_add(&x3d_trace_head, 1, __ATOMIC_RELAXED) & X3D_TRACE_MASK;
+    x3d_trace_entry_t *entry = &x3d_trace_entries[index];
+    entry->ts                = (uint32_t)esp_timer_get_time();
+    entry->event             = event;
+    entry->arg               = arg;
+    entry->value             = value;
+}
+
+bool x3d_trace_enable(bool enable)
+{
+    x3d_trace_enabled = enable;
+    return true;
+}
+
+bool x3d_trace_is_enabled(void)
+{
+    return x3d_trace_enabled;
+}
+
+void x3d_trace_clear(void)
+{
+    __atomic_store_n(&x3d_trace_head, 0, __ATOMIC_RELAXED);
+}
+
+static const char *x3d_trace_name(const char **names, size_t count, uint8_t index)
+{
+    return index < count ? names[index] : "unknown";
+}
+
+/**
+ * @brief Formats a single trace entry as Chrome trace event
+ *
+ * @param line output buffer
+ * @param size size of the output buffer
+ * @param entry trace entry
+ * @param ts timestamp relative to the oldest entry in us
+ * @param tx_end_ts relative timestamp of the last transmission end
+ * @param action action of the running transaction
+ * @return int length of the event, 0 if the entry produces no event
+ */
+static int x3d_trace_format(char *line, size_t size, const x3d_trace_entry_t *entry, uint32_t ts, uint32_t tx_end_ts, uint8_t action)
+{
+    const char *action_name = x3d_trace_name(x3d_trace_action_names, sizeof(x3d_trace_action_names) / sizeof(char *), action);
+    switch (entry->event)
+    {
+        case X3D_TRACE_BEGIN:
+            return snprintf(line, size, "{\"name\":\"%s\",\"ph\":\"B\",\"pid\":%d,\"tid\":%d,\"ts\":%lu,\"args\":{\"target\":%u}}",
+                    action_name, X3D_TRACE_PID, X3D_TRACE_TID_TX, (unsigned long)ts, entry->value);
+        case X3D_TRACE_DEFER:
+        {
+            uint32_t dur = entry->value * 1000U;
+            return snprintf(line, size, "{\"name\":\"defer\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%lu,\"dur\":%lu}",
+                    X3D_TRACE_PID, X3D_TRACE_TID_TX, (unsigned long)(ts > dur ? ts - dur : 0), (unsigned long)dur);
+        }
+        case X3D_TRACE_TX_START:
+            return snprintf(line, size, "{\"name\":\"tx\",\"ph\":\"B\",\"pid\":%d,\"tid\":%d,\"ts\":%lu,\"args\":{\"retry\":%u,\"msgNo\":%u}}",
+                    X3D_TRACE_PID, X3D_TRACE_TID_TX, (unsigned long)ts, entry->arg, entry->value);
+        case X3D_TRACE_TX_END:
+            return snprintf(line, size, "{\"name\":\"tx\",\"ph\":\"E\",\"pid\":%d,\"tid\":%d,\"ts\":%lu}",
+                    X3D_TRACE_PID, X3D_TRACE_TID_TX, (unsigned long)ts);
+        case X3D_TRACE_RX_ACCEPT:
+            // higher nibble is the response round, lower nibble the relaying device
+            return snprintf(line, size, "{\"name\":\"rx\",\"ph\":\"i\",\"s\":\"t\",\"pid\":%d,\"tid\":%d,\"ts\":%lu,\"args\":{\"round\":%u,\"device\":%u,\"transferred\":%u,\"hopLatencyUs\":%lu}}",
+                    X3D_TRACE_PID, X3D_TRACE_TID_RX, (unsigned long)ts, entry->arg >> 4, entry->arg & 0x0f, entry->value, (unsigned long)(ts - tx_end_ts));
+        case X3D_TRACE_RX_REJECT:
+            return snprintf(line, size, "{\"name\":\"reject\",\"ph\":\"i\",\"s\":\"t\",\"pid\":%d,\"tid\":%d,\"ts\":%lu,\"args\":{\"reason\":\"%s\",\"value\":%u}}",
+                    X3D_TRACE_PID, X3D_TRACE_TID_RX, (unsigned long)ts,
+                    x3d_trace_name(x3d_trace_reject_names, sizeof(x3d_trace_reject_names) / sizeof(char *), entry->arg), entry->value);
+        case X3D_TRACE_ACK:
+            return snprintf(line, size, "{\"name\":\"ack\",\"ph\":\"C\",\"pid\":%d,\"ts\":%lu,\"args\":{\"mask\":%u}}",
+                    X3D_TRACE_PID, (unsigned long)ts, entry->value);
+        case X3D_TRACE_COMPLETE:
+            return snprintf(line, size, "{\"name\":\"%s\",\"ph\":\"E\",\"pid\":%d,\"tid\":%d,\"ts\":%lu,\"args\":{\"cause\":\"%s\",\"ack\":%u}}",
+                    action_name, X3D_TRACE_PID, X3D_TRACE_TID_TX, (unsigned long)ts,
+                    x3d_trace_name(x3d_trace_cause_names, sizeof(x3d_trace_cause_names) / sizeof(char *), entry->arg), entry->value);
+        default:
+            return 0;
+    }
+}
+
+static size_t x3d_trace_emit(x3d_trace_write_t write, void *ctx, const char *data, int len)
+{
+    if (len <= 0)
+    {
+        return 0;
+    }
+    if (len >= X3D_TRACE_LINE)
+    {
+        len = X3D_TRACE_LINE - 1;
+    }
+    write(ctx, data, len);
+    return len;
+}
+
+size_t x3d_trace_export(x3d_trace_write_t write, void *ctx)
+{
+    bool enabled      = x3d_trace_enabled;
+    x3d_trace_enabled = false;
+
+    char line[X3D_TRACE_LINE];
+    size_t total = 0;
+    int len      = snprintf(line, sizeof(line),
+            "{\"traceEvents\":[{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"tx\"}},"
+            "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"rx\"}}",
+            X3D_TRACE_PID, X3D_TRACE_TID_TX, X3D_TRACE_PID, X3D_TRACE_TID_RX);
+    total += x3d_trace_emit(write, ctx, line, len);
+
+    uint32_t head  = __atomic_load_n(&x3d_trace_head, __ATOMIC_RELAXED);
+    uint32_t count = head > CONFIG_X3D_TRACE_ENTRIES ? CONFIG_X3D_TRACE_ENTRIES : head;
+    uint32_t first = x3d_trace_entries[(head - count) & X3D_TRACE_MASK].ts;
+
+    uint32_t tx_end_ts = 0;
+    uint8_t action     = 0;
+    for (uint32_t i = head - count; i != head; i++)
+    {
+        const x3d_trace_entry_t *entry = &x3d_trace_entries[i & X3D_TRACE_MASK];
+
+        // relative to the oldest entry, takes care of the 32bit timer overflow
+        uint32_t ts = entry->ts - first;
+        if (entry->event == X3D_TRACE_BEGIN)
+        {
+            action = entry->arg;
+        }
+
+        line[0] = ',';
+        len     = x3d_trace_format(&line[1], sizeof(line) - 1, entry, ts, tx_end_ts, action);
+        if (len > 0)
+        {
+            total += x3d_trace_emit(write, ctx, line, len + 1);
+        }
+
+        if (entry->event == X3D_TRACE_TX_END)
+        {
+            tx_end_ts = ts;
+        }
+    }
+
+    len = snprintf(line, sizeof(line), "],\"displayTimeUnit\":\"ms\"}");
+    total += x3d_trace_emit(write, ctx, line, len);
+
+    x3d_trace_enabled = enabled;
+    return total;
+}
+
+#else
+
+void x3d_trace_record(uint8_t event, uint8_t arg, uint16_t value)
+{
+}
+
+bool x3d_trace_enable(bool enable)
+{
+    return false;
+}
+
+bool x3d_trace_is_enabled(void)
+{
+    return false;
+}
+
+void x3d_trace_clear(void)
+{
+}
+
+size_t x3d_trace_export(x3d_trace_write_t write, void *ctx)
+{
+    static const char empty[] = "{\"traceEvents\":[]}";
+    write(ctx, empty, sizeof(empty) - 1);
+    return sizeof(empty) - 1;
+}
+
+#endif
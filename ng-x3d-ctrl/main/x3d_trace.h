@@ -0,0 +1,130 @@
+/**
+ * @file x3d_trace.h
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief ring buffered transaction trace with Chrome trace JSON export
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+/// @brief Trace event types
+typedef enum {
+    X3D_TRACE_BEGIN = 0,     ///< transaction start, arg = action, value = target mask
+    X3D_TRACE_DEFER,         ///< listen before talk, value = waited ms
+    X3D_TRACE_TX_START,      ///< frame transmission start, arg = retry count, value = message number
+    X3D_TRACE_TX_END,        ///< frame transmission end, arg = retry count, value = message number
+    X3D_TRACE_RX_ACCEPT,     ///< own frame merged, arg = counting byte, value = transferred mask
+    X3D_TRACE_RX_REJECT,     ///< frame dropped, arg = reason, value = frame length, counting byte if stale
+    X3D_TRACE_ACK,           ///< merged acknowledge mask changed, value = acknowledge mask
+    X3D_TRACE_COMPLETE,      ///< transaction end, arg = cause, value = acknowledge mask
+} x3d_trace_event_t;
+
+/// @brief Transaction actions
+typedef enum {
+    X3D_TRACE_ACTION_PAIR = 0,
+    X3D_TRACE_ACTION_UNPAIR,
+    X3D_TRACE_ACTION_READ,
+    X3D_TRACE_ACTION_WRITE,
+    X3D_TRACE_ACTION_TEMP,
+} x3d_trace_action_t;
+
+/// @brief Reasons for rejected frames
+typedef enum {
+    X3D_TRACE_REJECT_HEADER = 0, ///< foreign header
+    X3D_TRACE_REJECT_STALE,      ///< counting byte not newer than the merged one
+    X3D_TRACE_REJECT_CRC,        ///< CRC mismatch
+    X3D_TRACE_REJECT_SIZE,       ///< length too short
+    X3D_TRACE_REJECT_REPLAY,     ///< old or replayed message id
+} x3d_trace_reject_t;
+
+/// @brief Transaction completion causes
+typedef enum {
+    X3D_TRACE_COMPLETE_ACK = 0, ///< all targets acknowledged
+    X3D_TRACE_COMPLETE_TIMEOUT, ///< response window expired
+} x3d_trace_cause_t;
+
+/// @brief Trace ring buffer entry
+typedef struct {
+    uint32_t ts;    ///< timestamp in us
+    uint8_t event;  ///< x3d_trace_event_t
+    uint8_t arg;    ///< event specific argument
+    uint16_t value; ///< event specific value
+} x3d_trace_entry_t;
+
+/// @brief Export output callback
+typedef void (*x3d_trace_write_t)(void *ctx, const char *data, size_t len);
+
+#ifdef CONFIG_X3D_TRACE
+
+extern volatile bool x3d_trace_enabled;
+
+#define X3D_TRACE(event, arg, value)                   \
+    do                                                 \
+    {                                                  \
+        if (x3d_trace_enabled)                         \
+        {                                              \
+            x3d_trace_record((event), (arg), (value)); \
+        }                                              \
+    } while (0)
+
+#else
+
+// keeps the arguments type checked and used, the call is removed as dead code
+#define X3D_TRACE(event, arg, value)                   \
+    do                                                 \
+    {                                                  \
+        if (0)                                         \
+        {                                              \
+            x3d_trace_record((event), (arg), (value)); \
+        }                                              \
+    } while (0)
+
+#endif
+
+/**
+ * @brief Appends an event to the trace ring buffer, use the X3D_TRACE macro
+ *
+ * @param event x3d_trace_event_t
+ * @param arg event specific argument
+ * @param value event specific value
+ */
+void x3d_trace_record(uint8_t event, uint8_t arg, uint16_t value);
+
+/**
+ * @brief Enables or disables recording
+ *
+ * @param enable
+ * @return bool false if tracing is not compiled in
+ */
+bool x3d_trace_enable(bool enable);
+
+/**
+ * @brief Returns if recording is enabled
+ *
+ * @return bool false if tracing is not compiled in
+ */
+bool x3d_trace_is_enabled(void);
+
+/**
+ * @brief Clears the trace ring buffer
+ */
+void x3d_trace_clear(void);
+
+/**
+ * @brief Exports the trace ring buffer as Chrome trace JSON.
+ * Recording is paused during export, so two runs produce the same output.
+ *
+ * @param write output callback, called for every event
+ * @param ctx callback context
+ * @return size_t number of written bytes
+ */
+size_t x3d_trace_export(x3d_trace_write_t write, void *ctx);
@@ -0,0 +1,773 @@
+/**
+ * @file x3d-capture.c
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief command line tool for capture files
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "x3d.h"
+#include "x3d_capture.h"
+#include "x3d_crc.h"
+#include "x3d_dedup.h"
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s command ...\n"
+            "  import capture [text]         append frames of a text file or stdin, lines of the x3d-raw-monitor\n"
+            "                                hex log or 'time_us rssi hex' of raw-decode\n"
+            "  dump capture [from_s [to_s]]  print the records of a time range\n"
+            "  info capture                  records, time range and index of the capture\n"
+            "  slice capture out from_s to_s copy the records of a time range to a new capture\n"
+            "  bench capture records         write, index and slice a synthetic capture\n"
+            "  diag capture                  classify and correct the frames with crc error, counters per source\n"
+            "  crcbench frames               inject errors into synthetic frames and check the classification\n"
+            "  dedup capture [expire_ms]     collapse the repeated and relayed frames into messages\n"
+            "  dedupbench frames             collapse interleaved synthetic messages, lookup cost per frame\n", name);
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t seconds_to_us(const char *arg)
+{
+    return (uint64_t)(strtod(arg, NULL) * 1000000);
+}
+
+/**
+ * @brief Opens a capture and loads or builds its index side file
+ */
+static int open_indexed(x3d_capture_reader_t *reader, const char *path)
+{
+    if (x3d_capture_open(reader, path) != 0)
+    {
+        perror(path);
+        return -1;
+    }
+    char index_path[1024];
+    snprintf(index_path, sizeof(index_path), "%s.idx", path);
+    if (x3d_capture_index(reader, index_path, true) != 0)
+    {
+        perror(index_path);
+        x3d_capture_close(reader);
+        return -1;
+    }
+    return 0;
+}
+
+static bool crc_valid(const uint8_t *frame, uint8_t length)
+{
+    if (length < X3D_MIN_HEADER_SIZE || frame[X3D_IDX_PKT_LEN] > length)
+    {
+        return false;
+    }
+    uint8_t copy[X3D_CAPTURE_FRAME_MAX];
+    memcpy(copy, frame, length);
+    x3d_set_crc(copy);
+    return memcmp(copy, frame, frame[X3D_IDX_PKT_LEN]) == 0;
+}
+
+static int import(const char *path, const char *text)
+{
+    FILE *in = text != NULL ? fopen(text, "r") : stdin;
+    if (in == NULL)
+    {
+        perror(text);
+        return 1;
+    }
+    x3d_capture_writer_t writer;
+    if (x3d_capture_writer_open(&writer, path, true) != 0)
+    {
+        perror(path);
+        return 1;
+    }
+
+    // a frame of the monitor log may span several lines of 16 bytes
+    uint8_t frame[X3D_CAPTURE_FRAME_MAX];
+    int length = 0;
+    x3d_capture_record_t record;
+    char line[512];
+    while (fgets(line, sizeof(line), in) != NULL)
+    {
+        char level, tag[32];
+        unsigned long ms;
+        uint64_t time_us;
+        int rssi, pos = 0;
+        if (sscanf(line, "%c (%lu) %31[^:]: %n", &level, &ms, tag, &pos) == 3 && pos > 0)
+        {
+            if (length == 0)
+            {
+                record.time_us = ms * 1000ULL;
+                record.rssi    = X3D_CAPTURE_RSSI_NONE;
+            }
+        }
+        else if (sscanf(line, "%" SCNu64 " %d %n", &time_us, &rssi, &pos) == 2 && pos > 0)
+        {
+            length         = 0;
+            record.time_us = time_us;
+            record.rssi    = rssi;
+        }
+        else
+        {
+            continue;
+        }
+
+        unsigned int byte;
+        int n;
+        while (length < X3D_CAPTURE_FRAME_MAX && sscanf(&line[pos], " %2x%n", &byte, &n) == 1)
+        {
+            frame[length++] = byte;
+            pos += n;
+        }
+        if (length == 0 || length < frame[X3D_IDX_PKT_LEN])
+        {
+            continue; // continued on the next line
+        }
+
+        // receivers only pass frames with valid crc, the check is repeated for frames of other tools
+        record.fei_hz = 0;
+        record.flags  = X3D_CAPTURE_FLAG_CRC_CHECKED | (crc_valid(frame, length) ? X3D_CAPTURE_FLAG_CRC_OK : 0);
+        record.length = length;
+        record.frame  = frame;
+        if (x3d_capture_write(&writer, &record) != 0)
+        {
+            perror(path);
+            return 1;
+        }
+        length = 0;
+    }
+    if (in != stdin)
+    {
+        fclose(in);
+    }
+    fprintf(stderr, "%" PRIu32 " records appended\n", writer.records);
+    return x3d_capture_writer_close(&writer) == 0 ? 0 : 1;
+}
+
+static int dump(const char *path, uint64_t from_us, uint64_t to_us)
+{
+    x3d_capture_reader_t reader;
+    if (open_indexed(&reader, path) != 0)
+    {
+        return 1;
+    }
+    size_t offset = x3d_capture_seek(&reader, from_us);
+    x3d_capture_record_t record;
+    while (x3d_capture_next(&reader, &offset, &record) && record.time_us < to_us)
+    {
+        printf("%" PRIu64 ".%06" PRIu64 " %4d dBm %+6" PRId32 " Hz %s%s ", record.time_us / 1000000, record.time_us % 1000000,
+                record.rssi, record.fei_hz, record.flags & X3D_CAPTURE_FLAG_TX ? "tx" : "rx",
+                !(record.flags & X3D_CAPTURE_FLAG_CRC_CHECKED) ? "    " : record.flags & X3D_CAPTURE_FLAG_CRC_OK ? " ok " : " crc");
+        for (int i = 0; i < record.length; i++)
+        {
+            printf("%02x", record.frame[i]);
+        }
+        printf("\n");
+    }
+    x3d_capture_close(&reader);
+    return 0;
+}
+
+static int info(const char *path)
+{
+    uint64_t start = now_ns();
+    x3d_capture_reader_t reader;
+    if (open_indexed(&reader, path) != 0)
+    {
+        return 1;
+    }
+    uint64_t ns = now_ns() - start;
+
+    printf("%s: %zu bytes, %" PRIu32 " records, %" PRIu32 " index entries, opened in %.1f ms\n",
+            path, reader.size, reader.records, reader.index_count, ns / 1e6);
+    if (reader.end != reader.size)
+    {
+        printf("%zu bytes of a truncated record at the end\n", reader.size - reader.end);
+    }
+    if (reader.index_count > 0)
+    {
+        // the time of the last record is behind the last index entry
+        x3d_capture_record_t record;
+        size_t offset = reader.index[reader.index_count - 1].offset;
+        uint64_t last = 0;
+        while (x3d_capture_next(&reader, &offset, &record))
+        {
+            last = record.time_us;
+        }
+        printf("time %.6f s to %.6f s\n", reader.index[0].time_us / 1e6, last / 1e6);
+    }
+    x3d_capture_close(&reader);
+    return 0;
+}
+
+static int slice(const char *path, const char *out, uint64_t from_us, uint64_t to_us)
+{
+    uint64_t start = now_ns();
+    x3d_capture_reader_t reader;
+    if (open_indexed(&reader, path) != 0)
+    {
+        return 1;
+    }
+    int records = x3d_capture_slice(&reader, from_us, to_us, out);
+    x3d_capture_close(&reader);
+    if (records < 0)
+    {
+        perror(out);
+        return 1;
+    }
+    printf("%d records sliced in %.1f ms\n", records, (now_ns() - start) / 1e6);
+    return 0;
+}
+
+/**
+ * @brief Writes a synthetic capture of relay bursts, then indexes and slices it
+ */
+static int bench(const char *path, uint32_t records)
+{
+    char index_path[1024];
+    snprintf(index_path, sizeof(index_path), "%s.idx", path);
+    remove(path);
+    remove(index_path);
+
+    uint8_t frame[40] = {sizeof(frame), 0xff, 0x02, 0x01, 0x0c, 0x56, 0x34, 0x12, 0x84, 0x05, 0x98, 0x00};
+    x3d_capture_record_t record = {.frame = frame, .length = sizeof(frame), .flags = X3D_CAPTURE_FLAG_CRC_CHECKED};
+    x3d_capture_writer_t writer;
+    uint64_t start = now_ns();
+    if (x3d_capture_writer_open(&writer, path, false) != 0)
+    {
+        perror(path);
+        return 1;
+    }
+    uint64_t time_us = 0;
+    for (uint32_t i = 0; i < records; i++)
+    {
+        // bursts of 8 frames 20 ms apart every 10 s
+        time_us += i % 8 == 0 ? 10000000 : 20000;
+        record.time_us = time_us;
+        record.rssi    = -60 - i % 30;
+        record.fei_hz  = (int32_t)(i % 41) * 61 - 1220;
+        frame[2]       = i;
+        x3d_set_crc(frame);
+        record.flags |= X3D_CAPTURE_FLAG_CRC_OK;
+        if (x3d_capture_write(&writer, &record) != 0)
+        {
+            perror(path);
+            return 1;
+        }
+    }
+    x3d_capture_writer_close(&writer);
+    uint64_t write_ns = now_ns() - start;
+
+    x3d_capture_reader_t reader;
+    start = now_ns();
+    if (x3d_capture_open(&reader, path) != 0 || x3d_capture_index(&reader, index_path, true) != 0)
+    {
+        perror(path);
+        return 1;
+    }
+    uint64_t index_ns = now_ns() - start;
+    x3d_capture_close(&reader);
+
+    start = now_ns();
+    if (x3d_capture_open(&reader, path) != 0 || x3d_capture_index(&reader, index_path, true) != 0)
+    {
+        perror(path);
+        return 1;
+    }
+    uint64_t load_ns = now_ns() - start;
+
+    // one hour from the middle
+    char out[1024];
+    snprintf(out, sizeof(out), "%s.slice", path);
+    uint64_t from_us = time_us / 2;
+    start            = now_ns();
+    int sliced       = x3d_capture_slice(&reader, from_us, from_us + 3600000000ULL, out);
+    uint64_t slice_ns = now_ns() - start;
+
+    // read back the slice
+    x3d_capture_reader_t part;
+    size_t offset = 0;
+    int count     = 0;
+    if (sliced < 0 || x3d_capture_open(&part, out) != 0)
+    {
+        perror(out);
+        return 1;
+    }
+    while (x3d_capture_next(&part, &offset, &record))
+    {
+        if (record.time_us < from_us || record.time_us >= from_us + 3600000000ULL || !crc_valid(record.frame, record.length))
+        {
+            printf("record %d of the slice is wrong\n", count);
+            return 1;
+        }
+        count++;
+    }
+    x3d_capture_close(&part);
+    remove(out);
+
+    printf("%" PRIu32 " records, %.1f MB, %.1f h\n", records, reader.size / 1e6, time_us / 3.6e9);
+    printf("write %8.1f ms, %5.1f Mrecords/s\n", write_ns / 1e6, records * 1e3 / write_ns);
+    printf("index %8.1f ms scan, %.1f ms load of the side file\n", index_ns / 1e6, load_ns / 1e6);
+    printf("slice %8.1f ms for %d records of one hour, %s\n", slice_ns / 1e6, sliced, count == sliced ? "read back identical" : "read back mismatch");
+    x3d_capture_close(&reader);
+    return count == sliced ? 0 : 1;
+}
+
+static void print_crc_source(const x3d_crc_source_t *source, const char *name)
+{
+    printf("%-8s", name);
+    for (int i = 0; i < X3D_CRC_CLASSES; i++)
+    {
+        printf(" %8" PRIu32, source->count[i]);
+    }
+    printf("\n");
+}
+
+static int diag(const char *path)
+{
+    x3d_capture_reader_t reader;
+    if (x3d_capture_open(&reader, path) != 0)
+    {
+        perror(path);
+        return 1;
+    }
+
+    x3d_crc_stats_t stats = {0};
+    x3d_crc_result_t result;
+    x3d_capture_record_t record;
+    size_t offset = 0;
+    while (x3d_capture_next(&reader, &offset, &record))
+    {
+        if (record.flags & X3D_CAPTURE_FLAG_TX || record.length == 0)
+        {
+            continue;
+        }
+        uint8_t frame[X3D_CAPTURE_FRAME_MAX];
+        memcpy(frame, record.frame, record.length);
+        if (x3d_crc_check(frame, record.length, &result) != X3D_CRC_OK)
+        {
+            printf("%" PRIu64 ".%06" PRIu64 " %4d dBm %-13s syndrome 0x%04x", record.time_us / 1000000, record.time_us % 1000000,
+                    record.rssi, x3d_crc_class_name(result.error), result.syndrome);
+            if (result.corrected && result.bit >= 0)
+            {
+                printf(" bit %d burst %d", result.bit, result.burst);
+            }
+            else if (result.corrected)
+            {
+                printf(" length %d", frame[X3D_IDX_PKT_LEN]);
+            }
+            printf("\n");
+        }
+        x3d_crc_stats_add(&stats, frame, &result);
+    }
+    x3d_capture_close(&reader);
+
+    printf("source  ");
+    for (int i = 0; i < X3D_CRC_CLASSES; i++)
+    {
+        printf(" %8.8s", x3d_crc_class_name(i));
+    }
+    printf("\n");
+    for (int i = 0; i < stats.used; i++)
+    {
+        char name[16];
+        snprintf(name, sizeof(name), "%06" PRIx32, stats.sources[i].device_id);
+        print_crc_source(&stats.sources[i], name);
+    }
+    print_crc_source(&stats.unknown, "unknown");
+    return 0;
+}
+
+static uint32_t crc_random = 2463534242U;
+
+static uint32_t crc_rand(void)
+{
+    // xorshift32
+    crc_random ^= crc_random << 13;
+    crc_random ^= crc_random >> 17;
+    crc_random ^= crc_random << 5;
+    return crc_random;
+}
+
+/**
+ * @brief Injects errors of every class into synthetic frames and counts the correct classifications
+ */
+static int crcbench(uint32_t frames)
+{
+    static const char *const kinds[] = {"bit", "burst", "length", "truncated", "random"};
+    uint32_t correct[5] = {0}, total[5] = {0};
+    uint64_t ns = 0;
+    for (uint32_t n = 0; n < frames; n++)
+    {
+        // standard frame with register payload and random data, one spare byte as read from the radio
+        uint8_t frame[X3D_CRC_FRAME_MAX + 1];
+        uint8_t length = 24 + crc_rand() % (X3D_CRC_FRAME_MAX - 24 + 1);
+        for (int i = 0; i < length; i++)
+        {
+            frame[i] = crc_rand();
+        }
+        frame[X3D_IDX_PKT_LEN]    = length;
+        frame[X3D_IDX_HEADER_LEN] = 0x0c;
+        x3d_set_crc(frame);
+        uint8_t valid[X3D_CRC_FRAME_MAX + 1];
+        memcpy(valid, frame, sizeof(frame));
+
+        int kind    = n % 5;
+        int bits    = (length - 1) * 8;
+        size_t size = length + 1;
+        x3d_crc_class_t expected;
+        switch (kind)
+        {
+        case 0:
+        {
+            int bit = 8 + crc_rand() % bits;
+            frame[bit / 8] ^= 0x80 >> (bit % 8);
+            expected = X3D_CRC_BIT;
+            break;
+        }
+        case 1:
+        {
+            // first and last bit of the burst flipped
+            int burst   = 2 + crc_rand() % (X3D_CRC_BURST_MAX - 1);
+            int pattern = 1 | 1 << (burst - 1) | (crc_rand() & ((1 << burst) - 1));
+            int bit     = 8 + crc_rand() % (bits - burst + 1);
+            for (int i = 0; i < burst; i++)
+            {
+                if (pattern & (1 << i))
+                {
+                    frame[(bit + i) / 8] ^= 0x80 >> ((bit + i) % 8);
+                }
+            }
+            expected = X3D_CRC_BURST;
+            break;
+        }
+        case 2:
+            // the radio reads the frame up to the corrupted length byte
+            frame[X3D_IDX_PKT_LEN] = length + 1 + crc_rand() % (X3D_CRC_FRAME_MAX - length + 1);
+            size                   = frame[X3D_IDX_PKT_LEN] + 1;
+            expected               = X3D_CRC_LENGTH;
+            break;
+        case 3:
+            // tail cut off into the header
+            frame[X3D_IDX_PKT_LEN] = X3D_CRC_SIZE + 1 + crc_rand() % 16;
+            size                   = frame[X3D_IDX_PKT_LEN] + 1;
+            expected               = X3D_CRC_TRUNCATED;
+            break;
+        default:
+            for (int i = 0; i < 8; i++)
+            {
+                int bit = 8 + crc_rand() % bits;
+                frame[bit / 8] ^= 0x80 >> (bit % 8);
+            }
+            expected = X3D_CRC_UNCORRECTABLE;
+            break;
+        }
+        if (memcmp(frame, valid, length) == 0)
+        {
+            // the random flips cancelled out
+            n--;
+            continue;
+        }
+
+        x3d_crc_result_t result;
+        uint64_t start = now_ns();
+        x3d_crc_class_t error = x3d_crc_check(frame, size, &result);
+        ns += now_ns() - start;
+
+        total[kind]++;
+        if (error == expected && (!result.corrected || memcmp(frame, valid, length) == 0))
+        {
+            correct[kind]++;
+        }
+    }
+
+    // a frame with another error class matches a length or burst syndrome by chance, random errors at the
+    // rate of the burst patterns over all syndromes
+    bool ok = true;
+    for (int i = 0; i < 5; i++)
+    {
+        printf("%-10s %8" PRIu32 " of %8" PRIu32 " classified correctly\n", kinds[i], correct[i], total[i]);
+        ok = ok && (uint64_t)correct[i] * 1000 >= (uint64_t)total[i] * (i < 4 ? 999 : 900);
+    }
+    printf("%.0f ns per frame\n", (double)ns / frames);
+    return ok ? 0 : 1;
+}
+
+static void print_dedup_event(const x3d_dedup_event_t *event)
+{
+    printf("%" PRIu32 ".%03" PRIu32 " %06" PRIx32 " net %02x type %u no %3u %3u frames %4d dBm %5" PRIu32 " ms\n",
+            event->first_ms / 1000, event->first_ms % 1000, event->device_id, event->network, event->msg_type,
+            event->msg_no, event->repeats, event->rssi, event->last_ms - event->first_ms);
+}
+
+static int compare_dedup_event(const void *a, const void *b)
+{
+    const x3d_dedup_event_t *x = a, *y = b;
+    return x->first_ms < y->first_ms ? -1 : x->first_ms > y->first_ms;
+}
+
+/**
+ * @brief Prints the flushed events in order of their first frame
+ */
+static void print_dedup_events(x3d_dedup_event_t *events, int count)
+{
+    qsort(events, count, sizeof(*events), compare_dedup_event);
+    for (int i = 0; i < count; i++)
+    {
+        print_dedup_event(&events[i]);
+    }
+}
+
+static int dedup(const char *path, uint32_t expire_ms)
+{
+    x3d_capture_reader_t reader;
+    if (x3d_capture_open(&reader, path) != 0)
+    {
+        perror(path);
+        return 1;
+    }
+
+    static x3d_dedup_t cache;
+    x3d_dedup_init(&cache, expire_ms);
+    x3d_dedup_event_t events[X3D_DEDUP_ENTRIES];
+    x3d_capture_record_t record;
+    size_t offset    = 0;
+    uint32_t frames  = 0, messages = 0;
+    uint32_t last_ms = 0;
+    while (x3d_capture_next(&reader, &offset, &record))
+    {
+        // the own frames and the ones with crc error do not belong to a message
+        if (record.flags & X3D_CAPTURE_FLAG_TX || (record.flags & X3D_CAPTURE_FLAG_CRC_CHECKED && !(record.flags & X3D_CAPTURE_FLAG_CRC_OK)) ||
+            record.length <= X3D_IDX_NETWORK)
+        {
+            continue;
+        }
+        last_ms = (uint32_t)(record.time_us / 1000);
+        print_dedup_events(events, x3d_dedup_flush(&cache, last_ms, events, X3D_DEDUP_ENTRIES));
+        frames++;
+        messages += x3d_dedup_frame(&cache, record.frame, record.rssi, last_ms, NULL);
+    }
+    x3d_capture_close(&reader);
+
+    print_dedup_events(events, x3d_dedup_flush(&cache, last_ms + expire_ms, events, X3D_DEDUP_ENTRIES));
+    printf("%" PRIu32 " frames, %" PRIu32 " messages, %" PRIu32 " evicted, %" PRIu32 " dropped\n", frames, messages,
+            cache.evicted, cache.dropped);
+    return 0;
+}
+
+/**
+ * @brief Fills every entry of the cache with distinct messages and checks that one flush hands out all of them
+ */
+static bool dedup_full_table(void)
+{
+    static x3d_dedup_t cache;
+    x3d_dedup_init(&cache, X3D_DEDUP_EXPIRE_MS);
+    uint8_t frame[16] = {0};
+    frame[X3D_IDX_PKT_LEN]    = sizeof(frame);
+    frame[X3D_IDX_MSG_TYPE]   = X3D_MSG_TYPE_STANDARD;
+    frame[X3D_IDX_HEADER_LEN] = 0x0c;
+    frame[X3D_IDX_NETWORK]    = 0x84;
+    int used = 0;
+    for (uint32_t device_id = 0x100000; used < X3D_DEDUP_ENTRIES && device_id < 0x110000; device_id++)
+    {
+        frame[X3D_IDX_DEVICE_ID]     = device_id;
+        frame[X3D_IDX_DEVICE_ID + 1] = device_id >> 8;
+        frame[X3D_IDX_DEVICE_ID + 2] = device_id >> 16;
+        // a frame finding its probe range full would replace an event, it is left out
+        x3d_dedup_t before = cache;
+        x3d_dedup_frame(&cache, frame, -60, 0, NULL);
+        if (cache.evicted != 0)
+        {
+            cache = before;
+            continue;
+        }
+        used++;
+    }
+    x3d_dedup_event_t events[X3D_DEDUP_ENTRIES];
+    int count = x3d_dedup_flush(&cache, X3D_DEDUP_EXPIRE_MS, events, X3D_DEDUP_ENTRIES);
+    int left  = 0;
+    for (int i = 0; i < X3D_DEDUP_ENTRIES; i++)
+    {
+        left += cache.entries[i].repeats != 0;
+    }
+    printf("full table: %d entries used, %d flushed, %d left\n", used, count, left);
+    return used == X3D_DEDUP_ENTRIES && count == X3D_DEDUP_ENTRIES && left == 0;
+}
+
+// messages sent at the same time, like initiators and relays interleaved on the channel
+#define DEDUP_BENCH_ACTIVE  4
+#define DEDUP_BENCH_DEVICES 40
+
+/**
+ * @brief Sends interleaved synthetic messages of 2 to 5 repeats and up to 8 relays through the cache and
+ * checks that every message is collapsed into one event with its best RSSI
+ */
+static int dedupbench(uint32_t frames)
+{
+    typedef struct {
+        uint8_t frame[16];
+        int remaining;
+        int best;
+    } message_t;
+    message_t active[DEDUP_BENCH_ACTIVE] = {0};
+    uint8_t msg_no[DEDUP_BENCH_DEVICES] = {0};
+
+    static x3d_dedup_t cache;
+    x3d_dedup_init(&cache, X3D_DEDUP_EXPIRE_MS);
+    x3d_dedup_event_t events[X3D_DEDUP_ENTRIES];
+    uint32_t now_ms = 0, messages = 0, started = 0, collapsed = 0, repeats = 0;
+    int64_t best_sent = 0, best_seen = 0;
+    uint64_t ns = 0;
+    for (uint32_t n = 0; n < frames; n++)
+    {
+        message_t *message = &active[crc_rand() % DEDUP_BENCH_ACTIVE];
+        if (message->remaining == 0)
+        {
+            int device = crc_rand() % DEDUP_BENCH_DEVICES;
+            uint32_t device_id = 0x100000 + device * 0x1235;
+            memset(message->frame, 0, sizeof(message->frame));
+            message->frame[X3D_IDX_PKT_LEN]        = sizeof(message->frame);
+            message->frame[X3D_IDX_MSG_NO]         = msg_no[device]++;
+            message->frame[X3D_IDX_MSG_TYPE]       = X3D_MSG_TYPE_STANDARD;
+            message->frame[X3D_IDX_HEADER_LEN]     = 0x0c;
+            message->frame[X3D_IDX_DEVICE_ID]      = device_id;
+            message->frame[X3D_IDX_DEVICE_ID + 1]  = device_id >> 8;
+            message->frame[X3D_IDX_DEVICE_ID + 2]  = device_id >> 16;
+            message->frame[X3D_IDX_NETWORK]        = 0x84 + device % 2;
+            message->remaining = 2 + crc_rand() % 4 + crc_rand() % 9;
+            message->best      = INT16_MIN;
+            messages++;
+        }
+        int16_t rssi = -40 - crc_rand() % 60;
+        if (rssi > message->best)
+        {
+            message->best = rssi;
+        }
+        if (--message->remaining == 0)
+        {
+            best_sent += message->best;
+        }
+
+        // 20 ms per frame, the expired events are collected every 100 ms
+        now_ms += 20;
+        if (now_ms % 100 == 0)
+        {
+            int count = x3d_dedup_flush(&cache, now_ms, events, X3D_DEDUP_ENTRIES);
+            for (int i = 0; i < count; i++)
+            {
+                collapsed++;
+                repeats += events[i].repeats;
+                best_seen += events[i].rssi;
+            }
+        }
+
+        uint64_t start = now_ns();
+        started += x3d_dedup_frame(&cache, message->frame, rssi, now_ms, NULL);
+        ns += now_ns() - start;
+    }
+
+    // the messages still sending are left out of the comparison
+    for (int i = 0; i < DEDUP_BENCH_ACTIVE; i++)
+    {
+        if (active[i].remaining != 0)
+        {
+            messages--;
+        }
+    }
+    x3d_dedup_t open = cache;
+    uint32_t pending = 0;
+    for (int i = 0; i < X3D_DEDUP_ENTRIES; i++)
+    {
+        pending += open.entries[i].repeats != 0;
+    }
+    int count = x3d_dedup_flush(&cache, now_ms + X3D_DEDUP_EXPIRE_MS, events, X3D_DEDUP_ENTRIES);
+    for (int i = 0; i < count; i++)
+    {
+        bool sending = false;
+        for (int j = 0; j < DEDUP_BENCH_ACTIVE; j++)
+        {
+            const uint8_t *frame = active[j].frame;
+            sending |= active[j].remaining != 0 && events[i].msg_no == frame[X3D_IDX_MSG_NO] &&
+                       events[i].device_id == (uint32_t)(frame[X3D_IDX_DEVICE_ID] | frame[X3D_IDX_DEVICE_ID + 1] << 8 | frame[X3D_IDX_DEVICE_ID + 2] << 16);
+        }
+        if (!sending)
+        {
+            collapsed++;
+            repeats += events[i].repeats;
+            best_seen += events[i].rssi;
+        }
+    }
+
+    // a full probe range at the load of the benchmark replaces an event now and then, it is split into two
+    uint32_t lost = cache.evicted + cache.dropped;
+    bool ok       = lost == 0 ? collapsed == messages && best_seen == best_sent : (uint64_t)lost * 1000 <= messages;
+    printf("%" PRIu32 " frames, %" PRIu32 " messages, %" PRIu32 " events with %" PRIu32 " frames, %" PRIu32 " pending at the end\n",
+            frames, messages, collapsed, repeats, pending);
+    printf("%" PRIu32 " evicted, %" PRIu32 " dropped, best rssi %s\n", cache.evicted, cache.dropped,
+            best_seen == best_sent ? "kept" : lost != 0 ? "split by replaced events" : "mismatch");
+    printf("%.1f ns per frame\n", (double)ns / frames);
+    ok &= dedup_full_table();
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    const char *command = argv[1];
+    const char *path    = argv[2];
+    if (strcmp(command, "import") == 0)
+    {
+        return import(path, argc > 3 ? argv[3] : NULL);
+    }
+    if (strcmp(command, "dump") == 0)
+    {
+        return dump(path, argc > 3 ? seconds_to_us(argv[3]) : 0, argc > 4 ? seconds_to_us(argv[4]) : UINT64_MAX);
+    }
+    if (strcmp(command, "info") == 0)
+    {
+        return info(path);
+    }
+    if (strcmp(command, "slice") == 0 && argc == 6)
+    {
+        return slice(path, argv[3], seconds_to_us(argv[4]), seconds_to_us(argv[5]));
+    }
+    if (strcmp(command, "bench") == 0 && argc == 4)
+    {
+        return bench(path, strtoul(argv[3], NULL, 0));
+    }
+    if (strcmp(command, "diag") == 0)
+    {
+        return diag(path);
+    }
+    if (strcmp(command, "crcbench") == 0)
+    {
+        return crcbench(strtoul(argv[2], NULL, 0));
+    }
+    if (strcmp(command, "dedup") == 0)
+    {
+        return dedup(path, argc > 3 ? strtoul(argv[3], NULL, 0) : X3D_DEDUP_EXPIRE_MS);
+    }
+    if (strcmp(command, "dedupbench") == 0)
+    {
+        return dedupbench(strtoul(argv[2], NULL, 0));
+    }
+    usage(argv[0]);
+    return 1;
+}
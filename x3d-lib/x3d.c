@@ -331,4 +331,37 @@ uint16_t x3d_dec_msg_id(uint16_t encMsgId, uint32_t deviceId)
         encMsgId = apply_sbox(encMsgId ^ xor_key, i % 13);
     }
     return encMsgId;
-}
\ No newline at end of file
+}
+
+int x3d_get_msg_id(uint8_t* buffer, uint16_t* encMsgId)
+{
+    uint8_t headerLength = buffer[X3D_IDX_HEADER_LEN] & X3D_HEADER_LENGTH_MASK;
+    if ((buffer[X3D_IDX_MSG_TYPE] != X3D_MSG_TYPE_STANDARD && buffer[X3D_IDX_MSG_TYPE] != X3D_MSG_TYPE_PAIRING) ||
+        headerLength < X3D_MIN_HEADER_SIZE + sizeof(uint16_t) ||
+        headerLength + X3D_IDX_HEADER_LEN > buffer[X3D_IDX_PKT_LEN])
+    {
+        return -1;
+    }
+    // message id in front of the header checksum
+    read_le_u16(encMsgId, buffer, headerLength + X3D_IDX_HEADER_LEN - 2 * sizeof(uint16_t));
+    return 0;
+}
+
+uint32_t x3d_get_device_id(uint8_t* buffer)
+{
+    return buffer[X3D_IDX_DEVICE_ID] | buffer[X3D_IDX_DEVICE_ID + 1] << 8 | buffer[X3D_IDX_DEVICE_ID + 2] << 16;
+}
+
+x3d_window_state_t x3d_get_window_state(uint8_t* buffer)
+{
+    uint8_t status = buffer[X3D_IDX_NETWORK + X3D_OFF_HEADER_STATUS];
+    // the startup message of the Tydom 1.0 has the same status bit with the extension 0x8a 0x00
+    if (buffer[X3D_IDX_MSG_TYPE] != X3D_MSG_TYPE_SENSOR ||
+        buffer[X3D_IDX_PKT_LEN] < X3D_IDX_NETWORK + X3D_OFF_HEADER_EXT + 1 + X3D_CRC_SIZE ||
+        buffer[X3D_IDX_NETWORK + X3D_OFF_HEADER_EXT + 1] != X3D_HEADER_EXT_EMPTY_BYTE ||
+        (status & X3D_SENSOR_STATUS_WINDOW) == 0)
+    {
+        return X3D_WINDOW_NONE;
+    }
+    return (status & X3D_SENSOR_STATUS_WINDOW_OPEN) ? X3D_WINDOW_OPENED : X3D_WINDOW_CLOSED;
+}
@@ -71,6 +71,8 @@
 #define X3D_REGISTER_ACTION_READ            0x1
 #define X3D_REGISTER_ACTION_NONE            0x8
 #define X3D_REGISTER_ACTION_WRITE           0x9
+// the action is in the low nibble, the high nibble holds the highest data slot
+#define X3D_REGISTER_ACTION_MASK            0x0f
 
 #define X3D_CRC_SIZE                        sizeof(uint16_t)
 
@@ -81,6 +83,9 @@
 // Header len byte + header chksum i16
 #define X3D_HEADER_CKSUM_DROP_LEN           3
 
+// target devices accept message ids up to this distance above the last one
+#define X3D_MSG_ID_WINDOW                   32
+
 // 0x16 0x11 Flags
 #define X3D_FLAG_DEFROST                    0x0200
 #define X3D_FLAG_TIMED                      0x0800
@@ -108,6 +113,10 @@
 #define X3D_REG_ON_TIME_LSB                 0x1910
 #define X3D_REG_ON_TIME_MSB                 0x1990
 
+// header status byte of sensor messages, window sensors send 0x41 on open and 0x01 on close with the extension 0x82 0x01
+#define X3D_SENSOR_STATUS_WINDOW            0x01
+#define X3D_SENSOR_STATUS_WINDOW_OPEN       0x40
+
 #define X3D_REG_H(R)                        (((R) >> 8) & 0xff)
 #define X3D_REG_L(R)                        ((R) & 0xff)
 
@@ -126,6 +135,13 @@ typedef enum {
     X3D_PAIR_STATE_PINNED = 0xe5,
 } x3d_pair_state_t;
 
+// window state of a sensor message
+typedef enum {
+    X3D_WINDOW_NONE = -1,
+    X3D_WINDOW_CLOSED = 0,
+    X3D_WINDOW_OPENED = 1,
+} x3d_window_state_t;
+
 // payload stuct of standard message
 typedef struct __attribute__((__packed__)) {
     uint16_t retransmit;
@@ -295,3 +311,28 @@ uint16_t x3d_enc_msg_id(uint16_t *pMsgId, uint32_t deviceId);
  * @return uint16_t decrypted message id
  */
 uint16_t x3d_dec_msg_id(uint16_t encMsgId, uint32_t deviceId);
+
+/**
+ * @brief returns the encrypted message id of standard and pairing messages, it's placed in front of the header checksum
+ *
+ * @param buffer pointer to the message buffer
+ * @param encMsgId pointer to the encrypted message id
+ * @return int 0 if the message contains a message id, otherwise -1
+ */
+int x3d_get_msg_id(uint8_t* buffer, uint16_t* encMsgId);
+
+/**
+ * @brief returns the 24bit device id of the initiating device
+ *
+ * @param buffer pointer to the message buffer
+ * @return uint32_t device id
+ */
+uint32_t x3d_get_device_id(uint8_t* buffer);
+
+/**
+ * @brief returns the window state of a sensor message
+ *
+ * @param buffer pointer to the message buffer
+ * @return x3d_window_state_t X3D_WINDOW_NONE if it is no window sensor message or the status carries no window state
+ */
+x3d_window_state_t x3d_get_window_state(uint8_t* buffer);
@@ -0,0 +1,95 @@
+/**
+ * @file x3d_capture.c
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief encoding of the capture file records
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <string.h>
+
+#include "x3d_capture.h"
+
+static inline void write_le(uint8_t *buffer, uint32_t val, int size)
+{
+    for (int i = 0; i < size; i++)
+    {
+        buffer[i] = val >> (8 * i);
+    }
+}
+
+static inline uint32_t read_le(const uint8_t *buffer, int size)
+{
+    uint32_t val = 0;
+    for (int i = size - 1; i >= 0; i--)
+    {
+        val = val << 8 | buffer[i];
+    }
+    return val;
+}
+
+size_t x3d_capture_file_header(uint8_t *buffer)
+{
+    write_le(&buffer[0], X3D_CAPTURE_PCAP_MAGIC, 4);
+    write_le(&buffer[4], 2, 2);     // version major
+    write_le(&buffer[6], 4, 2);     // version minor
+    write_le(&buffer[8], 0, 4);     // time zone
+    write_le(&buffer[12], 0, 4);    // accuracy
+    write_le(&buffer[16], X3D_CAPTURE_META_SIZE + X3D_CAPTURE_FRAME_MAX, 4);
+    write_le(&buffer[20], X3D_CAPTURE_LINKTYPE, 4);
+    return X3D_CAPTURE_FILE_HEADER_SIZE;
+}
+
+bool x3d_capture_check_header(const uint8_t *data, size_t size)
+{
+    return size >= X3D_CAPTURE_FILE_HEADER_SIZE && read_le(&data[0], 4) == X3D_CAPTURE_PCAP_MAGIC
+        && read_le(&data[4], 2) == 2 && read_le(&data[20], 4) == X3D_CAPTURE_LINKTYPE;
+}
+
+size_t x3d_capture_encode(uint8_t *buffer, const x3d_capture_record_t *record)
+{
+    uint32_t length = X3D_CAPTURE_META_SIZE + record->length;
+    write_le(&buffer[0], record->time_us / 1000000, 4);
+    write_le(&buffer[4], record->time_us % 1000000, 4);
+    write_le(&buffer[8], length, 4);
+    write_le(&buffer[12], length, 4);
+
+    uint8_t *meta = &buffer[X3D_CAPTURE_RECORD_HEADER_SIZE];
+    meta[0]       = X3D_CAPTURE_META_VERSION;
+    meta[1]       = X3D_CAPTURE_META_SIZE;
+    meta[2]       = record->flags;
+    meta[3]       = record->rssi;
+    write_le(&meta[4], record->fei_hz, 4);
+    memcpy(&meta[X3D_CAPTURE_META_SIZE], record->frame, record->length);
+    return X3D_CAPTURE_RECORD_HEADER_SIZE + length;
+}
+
+size_t x3d_capture_decode(const uint8_t *data, size_t size, x3d_capture_record_t *record)
+{
+    if (size < X3D_CAPTURE_RECORD_HEADER_SIZE)
+    {
+        return 0;
+    }
+    uint32_t length = read_le(&data[8], 4);
+    if (length > size - X3D_CAPTURE_RECORD_HEADER_SIZE)
+    {
+        return 0;
+    }
+
+    // records of a newer metadata version keep the known fields in front
+    const uint8_t *meta = &data[X3D_CAPTURE_RECORD_HEADER_SIZE];
+    if (length < X3D_CAPTURE_META_SIZE || meta[1] < X3D_CAPTURE_META_SIZE || meta[1] > length
+            || length - meta[1] > X3D_CAPTURE_FRAME_MAX)
+    {
+        return 0;
+    }
+    record->time_us = (uint64_t)read_le(&data[0], 4) * 1000000 + read_le(&data[4], 4);
+    record->flags   = meta[2];
+    record->rssi    = meta[3];
+    record->fei_hz  = read_le(&meta[4], 4);
+    record->length  = length - meta[1];
+    record->frame   = &meta[meta[1]];
+    return X3D_CAPTURE_RECORD_HEADER_SIZE + length;
+}
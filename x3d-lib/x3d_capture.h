@@ -0,0 +1,206 @@
+/**
+ * @file x3d_capture.h
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief capture file of raw X3D frames with receive time and radio metadata
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * A capture is a classic little endian pcap file with microsecond timestamps and the link type
+ * DLT_USER0 (147), Wireshark opens it as is, x3d_capture.lua decodes the metadata. The packet data
+ * of every record is the metadata header followed by the frame bytes:
+ *
+ *   uint8 version, uint8 header length, uint8 flags, int8 rssi in dBm, int32 frequency error in Hz
+ *
+ * Records are only ever appended, a truncated last record of an interrupted writer is cut off when
+ * the file is opened for appending again.
+ *
+ * The reader maps the file and returns records pointing into the mapping. An index with the offset
+ * of every X3D_CAPTURE_INDEX_INTERVAL record is kept in a side file <capture>.idx, it is extended
+ * on open if records were appended since. Seek and slice by time use a binary search over the index,
+ * the timestamps of a capture have to be ascending.
+ *
+ * x3d_capture_file_header, x3d_capture_encode and x3d_capture_decode have no dependencies, the
+ * file functions need POSIX.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define X3D_CAPTURE_PCAP_MAGIC          0xa1b2c3d4
+#define X3D_CAPTURE_LINKTYPE            147     // DLT_USER0
+#define X3D_CAPTURE_FILE_HEADER_SIZE    24
+#define X3D_CAPTURE_RECORD_HEADER_SIZE  16
+#define X3D_CAPTURE_META_VERSION        1
+#define X3D_CAPTURE_META_SIZE           8
+#define X3D_CAPTURE_FRAME_MAX           255
+#define X3D_CAPTURE_RECORD_MAX          (X3D_CAPTURE_RECORD_HEADER_SIZE + X3D_CAPTURE_META_SIZE + X3D_CAPTURE_FRAME_MAX)
+
+// rssi of a record without measurement
+#define X3D_CAPTURE_RSSI_NONE           INT8_MIN
+
+// records per index entry
+#define X3D_CAPTURE_INDEX_INTERVAL      256
+
+/// @brief Record flags
+typedef enum {
+    X3D_CAPTURE_FLAG_CRC_CHECKED = 0x01,    ///< crc of the frame was checked by the receiver
+    X3D_CAPTURE_FLAG_CRC_OK = 0x02,         ///< crc of the frame is valid
+    X3D_CAPTURE_FLAG_TX = 0x04,             ///< frame was sent by the capturing station
+} x3d_capture_flag_t;
+
+/// @brief Record of a capture, frame points into the caller buffer or the mapped file
+typedef struct {
+    uint64_t time_us;
+    int32_t fei_hz;
+    int8_t rssi;
+    uint8_t flags;      ///< x3d_capture_flag_t
+    uint8_t length;
+    const uint8_t *frame;
+} x3d_capture_record_t;
+
+/// @brief Index entry
+typedef struct {
+    uint64_t time_us;
+    uint64_t offset;
+} x3d_capture_index_entry_t;
+
+/// @brief Appending writer
+typedef struct {
+    FILE *file;
+    uint32_t records;   ///< records written by this writer
+} x3d_capture_writer_t;
+
+/// @brief Reader of a mapped capture
+typedef struct {
+    const uint8_t *data;
+    size_t size;        ///< mapped size
+    size_t end;         ///< end of the last complete record
+    uint32_t records;   ///< complete records, valid after x3d_capture_index
+    x3d_capture_index_entry_t *index;
+    uint32_t index_count;
+} x3d_capture_reader_t;
+
+/**
+ * @brief Writes the pcap file header
+ *
+ * @param buffer target of X3D_CAPTURE_FILE_HEADER_SIZE bytes
+ * @return size_t X3D_CAPTURE_FILE_HEADER_SIZE
+ */
+size_t x3d_capture_file_header(uint8_t *buffer);
+
+/**
+ * @brief Checks the pcap file header
+ *
+ * @param data file data
+ * @param size file size
+ * @return bool false if the file is no capture of this format
+ */
+bool x3d_capture_check_header(const uint8_t *data, size_t size);
+
+/**
+ * @brief Encodes a record
+ *
+ * @param buffer target of X3D_CAPTURE_RECORD_MAX bytes
+ * @param record record
+ * @return size_t record size
+ */
+size_t x3d_capture_encode(uint8_t *buffer, const x3d_capture_record_t *record);
+
+/**
+ * @brief Decodes a record, the frame points into data
+ *
+ * @param data record data
+ * @param size available bytes
+ * @param record decoded record
+ * @return size_t record size, 0 if the record is truncated or invalid
+ */
+size_t x3d_capture_decode(const uint8_t *data, size_t size, x3d_capture_record_t *record);
+
+/**
+ * @brief Opens a capture for writing
+ *
+ * @param writer writer
+ * @param path file path
+ * @param append append to an existing capture, a truncated last record is cut off
+ * @return int 0 on success, -1 with errno set on error
+ */
+int x3d_capture_writer_open(x3d_capture_writer_t *writer, const char *path, bool append);
+
+/**
+ * @brief Appends a record
+ *
+ * @param writer writer
+ * @param record record
+ * @return int 0 on success, -1 on error
+ */
+int x3d_capture_write(x3d_capture_writer_t *writer, const x3d_capture_record_t *record);
+
+/**
+ * @brief Flushes and closes the capture
+ *
+ * @param writer writer
+ * @return int 0 on success, -1 on error
+ */
+int x3d_capture_writer_close(x3d_capture_writer_t *writer);
+
+/**
+ * @brief Maps a capture, no record is read yet
+ *
+ * @param reader reader
+ * @param path file path
+ * @return int 0 on success, -1 with errno set on error, EINVAL if the file is no capture
+ */
+int x3d_capture_open(x3d_capture_reader_t *reader, const char *path);
+
+/**
+ * @brief Unmaps the capture and frees the index
+ *
+ * @param reader reader
+ */
+void x3d_capture_close(x3d_capture_reader_t *reader);
+
+/**
+ * @brief Loads the index of the side file and extends it by the records appended since,
+ * the index is built by a scan of the file if the side file is missing or invalid
+ *
+ * @param reader reader
+ * @param index_path side file, NULL to skip the side file
+ * @param save write the side file if it was created or extended
+ * @return int 0 on success, -1 on error
+ */
+int x3d_capture_index(x3d_capture_reader_t *reader, const char *index_path, bool save);
+
+/**
+ * @brief Returns the offset of the first record at or after a time, needs the index
+ *
+ * @param reader reader
+ * @param time_us time
+ * @return size_t record offset, reader->end if there is no such record
+ */
+size_t x3d_capture_seek(const x3d_capture_reader_t *reader, uint64_t time_us);
+
+/**
+ * @brief Decodes the record at an offset and advances the offset
+ *
+ * @param reader reader
+ * @param offset record offset, 0 to start with the first record
+ * @param record decoded record
+ * @return bool false at the end of the capture
+ */
+bool x3d_capture_next(const x3d_capture_reader_t *reader, size_t *offset, x3d_capture_record_t *record);
+
+/**
+ * @brief Writes the records of a time range to a new capture, the records are copied as one block
+ *
+ * @param reader reader with index
+ * @param from_us first time included
+ * @param to_us first time excluded
+ * @param path target file
+ * @return int number of records, -1 on error
+ */
+int x3d_capture_slice(const x3d_capture_reader_t *reader, uint64_t from_us, uint64_t to_us, const char *path);
@@ -0,0 +1,51 @@
+-- Wireshark dissector of X3D capture files, see x3d_capture.h
+--
+-- Copy to the Wireshark plugin folder or run: wireshark -X lua_script:x3d_capture.lua capture.pcap
+
+local x3d = Proto("x3d", "X3D raw frame")
+
+local f_version = ProtoField.uint8("x3d.meta.version", "Version")
+local f_length = ProtoField.uint8("x3d.meta.length", "Header length")
+local f_flags = ProtoField.uint8("x3d.meta.flags", "Flags", base.HEX)
+local f_crc_checked = ProtoField.bool("x3d.meta.crc_checked", "CRC checked", 8, nil, 0x01)
+local f_crc_ok = ProtoField.bool("x3d.meta.crc_ok", "CRC ok", 8, nil, 0x02)
+local f_tx = ProtoField.bool("x3d.meta.tx", "Transmitted", 8, nil, 0x04)
+local f_rssi = ProtoField.int8("x3d.meta.rssi", "RSSI (dBm)")
+local f_fei = ProtoField.int32("x3d.meta.fei", "Frequency error (Hz)")
+local f_frame_len = ProtoField.uint8("x3d.len", "Length")
+local f_addr = ProtoField.uint8("x3d.addr", "Address", base.HEX)
+local f_msg_no = ProtoField.uint8("x3d.msg_no", "Message number")
+local f_frame = ProtoField.bytes("x3d.frame", "Frame")
+
+x3d.fields = { f_version, f_length, f_flags, f_crc_checked, f_crc_ok, f_tx, f_rssi, f_fei,
+    f_frame_len, f_addr, f_msg_no, f_frame }
+
+function x3d.dissector(buffer, pinfo, tree)
+    pinfo.cols.protocol = "X3D"
+    local header_len = buffer(1, 1):uint()
+    local subtree = tree:add(x3d, buffer(), "X3D")
+
+    local meta = subtree:add(buffer(0, header_len), "Capture metadata")
+    meta:add(f_version, buffer(0, 1))
+    meta:add(f_length, buffer(1, 1))
+    local flag_item = meta:add(f_flags, buffer(2, 1))
+    flag_item:add(f_crc_checked, buffer(2, 1))
+    flag_item:add(f_crc_ok, buffer(2, 1))
+    flag_item:add(f_tx, buffer(2, 1))
+    meta:add(f_rssi, buffer(3, 1))
+    meta:add_le(f_fei, buffer(4, 4))
+
+    local frame = buffer(header_len)
+    local item = subtree:add(f_frame, frame)
+    if frame:len() >= 3 then
+        item:add(f_frame_len, frame(0, 1))
+        item:add(f_addr, frame(1, 1))
+        item:add(f_msg_no, frame(2, 1))
+    end
+
+    local direction = bit.band(buffer(2, 1):uint(), 0x04) ~= 0 and "tx" or "rx"
+    local crc = bit.band(buffer(2, 1):uint(), 0x03) == 0x01 and " crc error" or ""
+    pinfo.cols.info = string.format("%s %d bytes %d dBm%s", direction, frame:len(), buffer(3, 1):int(), crc)
+end
+
+DissectorTable.get("wtap_encap"):add(wtap.USER0, x3d)
@@ -0,0 +1,384 @@
+/**
+ * @file x3d_capture_file.c
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief writer and mapped reader of capture files with index side file
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "x3d_capture.h"
+
+// index side file, host byte order, a file of another host fails the magic check and is rebuilt
+#define X3D_CAPTURE_INDEX_MAGIC         0x49443358  // "X3DI"
+#define X3D_CAPTURE_INDEX_VERSION       1
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t interval;
+    uint32_t count;     ///< index entries
+    uint32_t records;   ///< records up to end
+    uint64_t end;       ///< end of the last indexed record
+} x3d_capture_index_header_t;
+
+#define X3D_CAPTURE_WRITE_BUFFER        65536
+#define X3D_CAPTURE_INDEX_GROW          1024
+
+static char *x3d_capture_index_path(const char *path)
+{
+    char *index_path = malloc(strlen(path) + 5);
+    if (index_path != NULL)
+    {
+        strcpy(index_path, path);
+        strcat(index_path, ".idx");
+    }
+    return index_path;
+}
+
+int x3d_capture_writer_open(x3d_capture_writer_t *writer, const char *path, bool append)
+{
+    memset(writer, 0, sizeof(*writer));
+
+    size_t end = 0;
+    if (append)
+    {
+        x3d_capture_reader_t reader;
+        if (x3d_capture_open(&reader, path) == 0)
+        {
+            char *index_path = x3d_capture_index_path(path);
+            int res          = x3d_capture_index(&reader, index_path, false);
+            end              = reader.end;
+            free(index_path);
+            x3d_capture_close(&reader);
+            if (res != 0)
+            {
+                return -1;
+            }
+        }
+        else if (errno != ENOENT)
+        {
+            return -1;
+        }
+    }
+
+    writer->file = fopen(path, end > 0 ? "r+b" : "wb");
+    if (writer->file == NULL)
+    {
+        return -1;
+    }
+    setvbuf(writer->file, NULL, _IOFBF, X3D_CAPTURE_WRITE_BUFFER);
+
+    if (end > 0)
+    {
+        // cut off a truncated record of an interrupted writer
+        if (ftruncate(fileno(writer->file), end) != 0 || fseek(writer->file, end, SEEK_SET) != 0)
+        {
+            fclose(writer->file);
+            writer->file = NULL;
+            return -1;
+        }
+        return 0;
+    }
+
+    uint8_t header[X3D_CAPTURE_FILE_HEADER_SIZE];
+    size_t length = x3d_capture_file_header(header);
+    if (fwrite(header, 1, length, writer->file) != length)
+    {
+        fclose(writer->file);
+        writer->file = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int x3d_capture_write(x3d_capture_writer_t *writer, const x3d_capture_record_t *record)
+{
+    uint8_t buffer[X3D_CAPTURE_RECORD_MAX];
+    size_t length = x3d_capture_encode(buffer, record);
+    if (fwrite(buffer, 1, length, writer->file) != length)
+    {
+        return -1;
+    }
+    writer->records++;
+    return 0;
+}
+
+int x3d_capture_writer_close(x3d_capture_writer_t *writer)
+{
+    int res      = fclose(writer->file);
+    writer->file = NULL;
+    return res == 0 ? 0 : -1;
+}
+
+int x3d_capture_open(x3d_capture_reader_t *reader, const char *path)
+{
+    memset(reader, 0, sizeof(*reader));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    if (st.st_size < X3D_CAPTURE_FILE_HEADER_SIZE)
+    {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return -1;
+    }
+    if (!x3d_capture_check_header(data, st.st_size))
+    {
+        munmap(data, st.st_size);
+        errno = EINVAL;
+        return -1;
+    }
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+    reader->data = data;
+    reader->size = st.st_size;
+    reader->end  = st.st_size;
+    return 0;
+}
+
+void x3d_capture_close(x3d_capture_reader_t *reader)
+{
+    if (reader->data != NULL)
+    {
+        munmap((void *)reader->data, reader->size);
+    }
+    free(reader->index);
+    memset(reader, 0, sizeof(*reader));
+}
+
+/**
+ * @brief Loads a valid side file into the reader
+ *
+ * @return bool false if the side file is missing or does not match the capture
+ */
+static bool x3d_capture_index_load(x3d_capture_reader_t *reader, const char *index_path)
+{
+    FILE *f = fopen(index_path, "rb");
+    if (f == NULL)
+    {
+        return false;
+    }
+
+    x3d_capture_index_header_t header;
+    bool valid = fread(&header, sizeof(header), 1, f) == 1 && header.magic == X3D_CAPTURE_INDEX_MAGIC
+                 && header.version == X3D_CAPTURE_INDEX_VERSION && header.interval == X3D_CAPTURE_INDEX_INTERVAL
+                 && header.end <= reader->size && header.count > 0
+                 && header.count == (header.records + X3D_CAPTURE_INDEX_INTERVAL - 1) / X3D_CAPTURE_INDEX_INTERVAL;
+    if (valid)
+    {
+        // capacity in steps of X3D_CAPTURE_INDEX_GROW as allocated by x3d_capture_index
+        uint32_t capacity = (header.count + X3D_CAPTURE_INDEX_GROW - 1) / X3D_CAPTURE_INDEX_GROW * X3D_CAPTURE_INDEX_GROW;
+        reader->index     = malloc(capacity * sizeof(x3d_capture_index_entry_t));
+        valid             = reader->index != NULL && fread(reader->index, sizeof(x3d_capture_index_entry_t), header.count, f) == header.count;
+    }
+    fclose(f);
+
+    // the last entry has to point to the same record, otherwise the capture was replaced
+    x3d_capture_record_t record;
+    if (valid)
+    {
+        x3d_capture_index_entry_t *last = &reader->index[header.count - 1];
+        valid = last->offset < header.end
+                && x3d_capture_decode(&reader->data[last->offset], header.end - last->offset, &record) > 0
+                && record.time_us == last->time_us;
+    }
+    if (!valid)
+    {
+        free(reader->index);
+        reader->index = NULL;
+        return false;
+    }
+    reader->index_count = header.count;
+    reader->records     = header.records;
+    reader->end         = header.end;
+    return true;
+}
+
+static int x3d_capture_index_save(const x3d_capture_reader_t *reader, const char *index_path)
+{
+    x3d_capture_index_header_t header = {
+        .magic    = X3D_CAPTURE_INDEX_MAGIC,
+        .version  = X3D_CAPTURE_INDEX_VERSION,
+        .interval = X3D_CAPTURE_INDEX_INTERVAL,
+        .count    = reader->index_count,
+        .records  = reader->records,
+        .end      = reader->end,
+    };
+    FILE *f = fopen(index_path, "wb");
+    if (f == NULL)
+    {
+        return -1;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1
+              && fwrite(reader->index, sizeof(x3d_capture_index_entry_t), reader->index_count, f) == reader->index_count;
+    return fclose(f) == 0 && ok ? 0 : -1;
+}
+
+int x3d_capture_index(x3d_capture_reader_t *reader, const char *index_path, bool save)
+{
+    bool loaded = index_path != NULL && x3d_capture_index_load(reader, index_path);
+    if (!loaded)
+    {
+        free(reader->index);
+        reader->index       = NULL;
+        reader->index_count = 0;
+        reader->records     = 0;
+        reader->end         = X3D_CAPTURE_FILE_HEADER_SIZE;
+    }
+
+    // scan the records behind the indexed part, only the record headers are touched
+    uint32_t records = reader->records;
+    uint32_t count   = reader->index_count;
+    size_t offset    = reader->end;
+    x3d_capture_record_t record;
+    size_t length;
+    while ((length = x3d_capture_decode(&reader->data[offset], reader->size - offset, &record)) > 0)
+    {
+        if (records % X3D_CAPTURE_INDEX_INTERVAL == 0)
+        {
+            if (count % X3D_CAPTURE_INDEX_GROW == 0)
+            {
+                x3d_capture_index_entry_t *index = realloc(reader->index, (count + X3D_CAPTURE_INDEX_GROW) * sizeof(x3d_capture_index_entry_t));
+                if (index == NULL)
+                {
+                    return -1;
+                }
+                reader->index = index;
+            }
+            reader->index[count].time_us = record.time_us;
+            reader->index[count].offset  = offset;
+            count++;
+        }
+        records++;
+        offset += length;
+    }
+
+    bool changed        = records != reader->records || !loaded;
+    reader->records     = records;
+    reader->index_count = count;
+    reader->end         = offset;
+    if (save && changed && index_path != NULL && count > 0)
+    {
+        return x3d_capture_index_save(reader, index_path);
+    }
+    return 0;
+}
+
+/**
+ * @brief Finds the first record at or after a time
+ *
+ * @param reader reader with index
+ * @param time_us time
+ * @param number record number of the result
+ * @return size_t record offset or reader->end
+ */
+static size_t x3d_capture_locate(const x3d_capture_reader_t *reader, uint64_t time_us, uint32_t *number)
+{
+    if (reader->index_count == 0 || reader->index[0].time_us >= time_us)
+    {
+        *number = 0;
+        return reader->index_count > 0 ? reader->index[0].offset : reader->end;
+    }
+
+    // last entry before the time, the record is behind it and before the next entry
+    uint32_t low  = 0;
+    uint32_t high = reader->index_count - 1;
+    while (low < high)
+    {
+        uint32_t mid = (low + high + 1) / 2;
+        if (reader->index[mid].time_us < time_us)
+        {
+            low = mid;
+        }
+        else
+        {
+            high = mid - 1;
+        }
+    }
+
+    *number       = low * X3D_CAPTURE_INDEX_INTERVAL;
+    size_t offset = reader->index[low].offset;
+    x3d_capture_record_t record;
+    size_t length;
+    while (offset < reader->end && (length = x3d_capture_decode(&reader->data[offset], reader->end - offset, &record)) > 0
+            && record.time_us < time_us)
+    {
+        offset += length;
+        (*number)++;
+    }
+    return offset;
+}
+
+size_t x3d_capture_seek(const x3d_capture_reader_t *reader, uint64_t time_us)
+{
+    uint32_t number;
+    return x3d_capture_locate(reader, time_us, &number);
+}
+
+bool x3d_capture_next(const x3d_capture_reader_t *reader, size_t *offset, x3d_capture_record_t *record)
+{
+    if (*offset < X3D_CAPTURE_FILE_HEADER_SIZE)
+    {
+        *offset = X3D_CAPTURE_FILE_HEADER_SIZE;
+    }
+    if (*offset >= reader->end)
+    {
+        return false;
+    }
+    size_t length = x3d_capture_decode(&reader->data[*offset], reader->end - *offset, record);
+    *offset += length;
+    return length > 0;
+}
+
+int x3d_capture_slice(const x3d_capture_reader_t *reader, uint64_t from_us, uint64_t to_us, const char *path)
+{
+    uint32_t first, last;
+    size_t begin = x3d_capture_locate(reader, from_us, &first);
+    size_t end   = x3d_capture_locate(reader, to_us, &last);
+    if (end < begin)
+    {
+        end  = begin;
+        last = first;
+    }
+
+    FILE *f = fopen(path, "wb");
+    if (f == NULL)
+    {
+        return -1;
+    }
+    uint8_t header[X3D_CAPTURE_FILE_HEADER_SIZE];
+    size_t length = x3d_capture_file_header(header);
+    bool ok       = fwrite(header, 1, length, f) == length
+                    && fwrite(&reader->data[begin], 1, end - begin, f) == end - begin;
+    if (fclose(f) != 0 || !ok)
+    {
+        return -1;
+    }
+    return last - first;
+}
@@ -0,0 +1,232 @@
+/**
+ * @file x3d_crc.c
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief classification and correction of frames with crc error
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <string.h>
+
+#ifdef CONFIG_IDF_TARGET
+#include "esp_crc.h"
+#endif
+
+#include "x3d.h"
+#include "x3d_crc.h"
+
+// x^16 + x^12 + x^5 + 1 without the x^16 term
+#define X3D_CRC_POLY    0x1021
+
+static const char *const x3d_crc_class_names[X3D_CRC_CLASSES] = {
+    "ok", "length", "truncated", "bit", "burst", "uncorrectable",
+};
+
+static uint16_t x3d_crc_update(uint16_t crc, const uint8_t *data, size_t length)
+{
+#ifdef CONFIG_IDF_TARGET
+    return ~esp_crc16_be(~crc, data, length);
+#else
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int j = 0; j < 8; j++)
+        {
+            crc = crc & 0x8000 ? (crc << 1) ^ X3D_CRC_POLY : crc << 1;
+        }
+    }
+    return crc;
+#endif
+}
+
+/**
+ * @brief Crc over the frame with the length byte replaced, 0 if the crc at the end matches
+ */
+static uint16_t x3d_crc_syndrome(const uint8_t *buffer, uint8_t length)
+{
+    return x3d_crc_update(x3d_crc_update(0, &length, 1), &buffer[1], length - 1);
+}
+
+/**
+ * @brief Checks if the header and the first payload byte fit in front of the crc
+ */
+static bool x3d_crc_header_fits(const uint8_t *buffer, uint8_t length)
+{
+    uint8_t payload_index = (buffer[X3D_IDX_HEADER_LEN] & X3D_HEADER_LENGTH_MASK) + X3D_IDX_HEADER_LEN;
+    return length > X3D_IDX_NETWORK + X3D_CRC_SIZE && payload_index < length - X3D_CRC_SIZE;
+}
+
+/**
+ * @brief Flips the bits of a burst
+ */
+static void x3d_crc_flip(uint8_t *buffer, uint8_t length, uint16_t pattern, int position)
+{
+    for (int i = 0; i < 16; i++)
+    {
+        if (pattern & (1 << i))
+        {
+            int bit = position + i;
+            buffer[length - 1 - bit / 8] ^= 1 << (bit % 8);
+        }
+    }
+}
+
+/**
+ * @brief Multiplies by x^-1 mod g(x), the inverse exists as g(x) has the constant term
+ */
+static inline uint16_t x3d_crc_shift(uint16_t t)
+{
+    return t & 1 ? ((t ^ X3D_CRC_POLY) >> 1) | 0x8000 : t >> 1;
+}
+
+/**
+ * @brief Locates the shortest burst matching the syndrome.
+ * The crc register holds the frame times x^16, so the syndrome of a burst b(x) ending at bit d from
+ * the end of the frame is b(x) * x^(d+16) mod g(x). Multiplying the syndrome with x^-1 step by step
+ * reveals b(x) at the position of the burst.
+ * The length byte is excluded, a flipped length bit changes the received length.
+ *
+ * @param syndrome syndrome of the frame
+ * @param length frame length
+ * @param position lowest bit of the burst counted from the end of the frame
+ * @return uint16_t burst pattern, 0 if none or not unique
+ */
+static uint16_t x3d_crc_locate(uint16_t syndrome, uint8_t length, int *position)
+{
+    int bits           = (length - 1) * 8;
+    uint16_t pattern   = 0;
+    int pattern_length = X3D_CRC_BURST_MAX + 1;
+    bool unique        = false;
+    uint16_t t         = syndrome;
+    for (int d = -16; d < bits; d++)
+    {
+        if (d < 0)
+        {
+            t = x3d_crc_shift(t);
+            continue;
+        }
+        if ((t & 1) && t < (1 << X3D_CRC_BURST_MAX))
+        {
+            int burst = 32 - __builtin_clz(t);
+            if (d + burst <= bits)
+            {
+                if (burst < pattern_length)
+                {
+                    pattern        = t;
+                    pattern_length = burst;
+                    *position      = d;
+                    unique         = true;
+                }
+                else if (burst == pattern_length)
+                {
+                    unique = false;
+                }
+            }
+        }
+        t = x3d_crc_shift(t);
+    }
+    return unique ? pattern : 0;
+}
+
+x3d_crc_class_t x3d_crc_check(uint8_t *buffer, size_t size, x3d_crc_result_t *result)
+{
+    x3d_crc_result_t local;
+    if (result == NULL)
+    {
+        result = &local;
+    }
+    memset(result, 0, sizeof(*result));
+    result->bit = -1;
+
+    uint8_t length = buffer[X3D_IDX_PKT_LEN];
+    if (size > X3D_CRC_FRAME_MAX + 1)
+    {
+        size = X3D_CRC_FRAME_MAX + 1;
+    }
+    bool complete = length > X3D_CRC_SIZE && length <= size;
+    if (complete && (result->syndrome = x3d_crc_syndrome(buffer, length)) == 0)
+    {
+        result->error = X3D_CRC_OK;
+        return X3D_CRC_OK;
+    }
+
+    // a corrupted length byte, the frame is valid at another length within the received bytes
+    for (size_t other = X3D_CRC_SIZE + 1; other <= size && other <= X3D_CRC_FRAME_MAX; other++)
+    {
+        if (other != length && x3d_crc_header_fits(buffer, other) && x3d_crc_syndrome(buffer, other) == 0)
+        {
+            buffer[X3D_IDX_PKT_LEN] = other;
+            result->error           = X3D_CRC_LENGTH;
+            result->corrected       = true;
+            return X3D_CRC_LENGTH;
+        }
+    }
+    if (length <= X3D_CRC_SIZE)
+    {
+        result->error = X3D_CRC_LENGTH;
+        return X3D_CRC_LENGTH;
+    }
+
+    int position     = 0;
+    uint16_t pattern = complete ? x3d_crc_locate(result->syndrome, length, &position) : 0;
+    if (pattern != 0)
+    {
+        x3d_crc_flip(buffer, length, pattern, position);
+    }
+
+    // bytes missing or a length byte too small for the header, unless a flipped header bit was corrected
+    if (!x3d_crc_header_fits(buffer, length) || !complete)
+    {
+        if (pattern != 0)
+        {
+            x3d_crc_flip(buffer, length, pattern, position);
+        }
+        result->error = X3D_CRC_TRUNCATED;
+        return X3D_CRC_TRUNCATED;
+    }
+    if (pattern == 0)
+    {
+        result->error = X3D_CRC_UNCORRECTABLE;
+        return X3D_CRC_UNCORRECTABLE;
+    }
+
+    int first         = position + 31 - __builtin_clz(pattern);
+    result->bit       = (length - 1 - first / 8) * 8 + 7 - first % 8;
+    result->burst     = 32 - __builtin_clz(pattern);
+    result->error     = result->burst == 1 ? X3D_CRC_BIT : X3D_CRC_BURST;
+    result->corrected = true;
+    return result->error;
+}
+
+const char *x3d_crc_class_name(x3d_crc_class_t error)
+{
+    return error < X3D_CRC_CLASSES ? x3d_crc_class_names[error] : "?";
+}
+
+void x3d_crc_stats_add(x3d_crc_stats_t *stats, const uint8_t *buffer, const x3d_crc_result_t *result)
+{
+    x3d_crc_source_t *source = &stats->unknown;
+    if (buffer[X3D_IDX_PKT_LEN] > X3D_IDX_NETWORK)
+    {
+        uint32_t device_id = buffer[X3D_IDX_DEVICE_ID] | buffer[X3D_IDX_DEVICE_ID + 1] << 8 | buffer[X3D_IDX_DEVICE_ID + 2] << 16;
+        for (int i = 0; i < stats->used; i++)
+        {
+            if (stats->sources[i].device_id == device_id)
+            {
+                source = &stats->sources[i];
+                break;
+            }
+        }
+
+        // only frames with valid crc add sources, the device id of the others may be corrupted
+        if (source == &stats->unknown && (result->error == X3D_CRC_OK || result->corrected) && stats->used < X3D_CRC_SOURCES)
+        {
+            source = &stats->sources[stats->used++];
+            memset(source, 0, sizeof(*source));
+            source->device_id = device_id;
+        }
+    }
+    source->count[result->error]++;
+}
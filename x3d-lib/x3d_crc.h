@@ -0,0 +1,94 @@
+/**
+ * @file x3d_crc.h
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief classification and correction of frames with crc error
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * The X3D crc is CRC-16/XMODEM over the frame including its length byte, the crc over the whole
+ * frame with the received crc is the syndrome, it only depends on the error pattern. A single bit
+ * flip or a short burst is located by walking the syndrome backwards through the frame, a burst is
+ * only corrected if it is the unique shortest one. Bursts are limited to X3D_CRC_BURST_MAX bits,
+ * longer bursts would match most random syndromes of a 64 byte frame.
+ *
+ * A corrupted length byte is found by checking the crc at the other possible lengths, a length byte
+ * smaller than the frame cuts off its tail, this is only detected if the header does not fit.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// longest corrected burst in bits
+#define X3D_CRC_BURST_MAX   4
+
+// sources with own counters, further sources are counted as unknown
+#define X3D_CRC_SOURCES     16
+
+// largest frame of the radio including the length byte
+#define X3D_CRC_FRAME_MAX   64
+
+/// @brief Error classes
+typedef enum {
+    X3D_CRC_OK = 0,         ///< crc valid
+    X3D_CRC_LENGTH,         ///< length byte corrupted, corrected if the crc matches at another length
+    X3D_CRC_TRUNCATED,      ///< tail of the frame missing
+    X3D_CRC_BIT,            ///< single bit flip, corrected
+    X3D_CRC_BURST,          ///< burst of up to X3D_CRC_BURST_MAX bits, corrected
+    X3D_CRC_UNCORRECTABLE,  ///< more errors than the syndrome can locate
+    X3D_CRC_CLASSES,
+} x3d_crc_class_t;
+
+/// @brief Result of the classification
+typedef struct {
+    x3d_crc_class_t error;
+    bool corrected;     ///< the buffer holds the corrected frame
+    uint16_t syndrome;  ///< crc over the received frame, 0 if valid
+    int16_t bit;        ///< first corrected bit, counted from the start of the frame msb first, -1 if none
+    uint8_t burst;      ///< corrected bits from the first to the last flipped one
+} x3d_crc_result_t;
+
+/// @brief Counters of one source, indexed by x3d_crc_class_t
+typedef struct {
+    uint32_t device_id;
+    uint32_t count[X3D_CRC_CLASSES];
+} x3d_crc_source_t;
+
+/// @brief Counters per source.
+/// Sources are added by valid or corrected frames, frames which are not correctable are counted
+/// for the source of their device id if it is known, otherwise as unknown.
+typedef struct {
+    x3d_crc_source_t sources[X3D_CRC_SOURCES];
+    uint8_t used;
+    x3d_crc_source_t unknown;
+} x3d_crc_stats_t;
+
+/**
+ * @brief Checks the crc of a received frame, classifies the error and corrects it if possible
+ *
+ * @param buffer frame, starting with the length byte, corrected in place
+ * @param size received bytes in the buffer, may be more than the length byte
+ * @param result classification, may be NULL
+ * @return x3d_crc_class_t error class
+ */
+x3d_crc_class_t x3d_crc_check(uint8_t *buffer, size_t size, x3d_crc_result_t *result);
+
+/**
+ * @brief Returns the name of an error class
+ *
+ * @param error error class
+ * @return const char* name without spaces
+ */
+const char *x3d_crc_class_name(x3d_crc_class_t error);
+
+/**
+ * @brief Counts a checked frame
+ *
+ * @param stats counters
+ * @param buffer frame after x3d_crc_check
+ * @param result result of x3d_crc_check
+ */
+void x3d_crc_stats_add(x3d_crc_stats_t *stats, const uint8_t *buffer, const x3d_crc_result_t *result);
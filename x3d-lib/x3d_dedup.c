@@ -0,0 +1,156 @@
+/**
+ * @file x3d_dedup.c
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief collapsing of repeated and relayed frames into one logical message
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <string.h>
+
+#include "x3d.h"
+#include "x3d_dedup.h"
+
+#define X3D_DEDUP_MASK      (X3D_DEDUP_ENTRIES - 1)
+
+static inline uint32_t x3d_dedup_hash(uint32_t device_id, uint8_t network, uint8_t msg_no, uint8_t msg_type)
+{
+    // device id in the low 24 bits, the other fields spread over the word
+    uint32_t key = (device_id | (uint32_t)msg_no << 24) ^ ((uint32_t)network << 8 | msg_type) * 0x85ebca6bu;
+    return (key * 2654435761u) >> (32 - __builtin_ctz(X3D_DEDUP_ENTRIES));
+}
+
+static inline bool x3d_dedup_expired(const x3d_dedup_t *cache, const x3d_dedup_event_t *entry, uint32_t now_ms)
+{
+    return now_ms - entry->last_ms >= cache->expire_ms;
+}
+
+/**
+ * @brief Removes an entry and moves the following entries of the probe chain into the gap,
+ * the walk ends at a free entry or after one round through a full table
+ */
+static void x3d_dedup_remove(x3d_dedup_t *cache, uint32_t index)
+{
+    uint32_t hole = index;
+    for (uint32_t i = (index + 1) & X3D_DEDUP_MASK; i != index && cache->entries[i].repeats != 0; i = (i + 1) & X3D_DEDUP_MASK)
+    {
+        const x3d_dedup_event_t *entry = &cache->entries[i];
+        uint32_t home = x3d_dedup_hash(entry->device_id, entry->network, entry->msg_no, entry->msg_type);
+        // the entry may move back if the gap is not in front of its home
+        if (((i - home) & X3D_DEDUP_MASK) >= ((i - hole) & X3D_DEDUP_MASK))
+        {
+            cache->entries[hole] = *entry;
+            hole                 = i;
+        }
+    }
+    cache->entries[hole].repeats = 0;
+}
+
+void x3d_dedup_init(x3d_dedup_t *cache, uint32_t expire_ms)
+{
+    memset(cache, 0, sizeof(*cache));
+    cache->expire_ms = expire_ms;
+}
+
+bool x3d_dedup_frame(x3d_dedup_t *cache, const uint8_t *buffer, int16_t rssi, uint32_t now_ms, x3d_dedup_event_t **event)
+{
+    if (event != NULL)
+    {
+        *event = NULL;
+    }
+    if (buffer[X3D_IDX_PKT_LEN] <= X3D_IDX_NETWORK)
+    {
+        return true;
+    }
+    uint32_t device_id = buffer[X3D_IDX_DEVICE_ID] | buffer[X3D_IDX_DEVICE_ID + 1] << 8 | buffer[X3D_IDX_DEVICE_ID + 2] << 16;
+    uint8_t network    = buffer[X3D_IDX_NETWORK];
+    uint8_t msg_no     = buffer[X3D_IDX_MSG_NO];
+    uint8_t msg_type   = buffer[X3D_IDX_MSG_TYPE];
+    uint32_t index     = x3d_dedup_hash(device_id, network, msg_no, msg_type);
+
+    x3d_dedup_event_t *entry   = NULL;
+    x3d_dedup_event_t *expired = NULL;
+    x3d_dedup_event_t *oldest  = NULL;
+    for (int i = 0; i < X3D_DEDUP_PROBES; i++)
+    {
+        x3d_dedup_event_t *probe = &cache->entries[(index + i) & X3D_DEDUP_MASK];
+        if (probe->repeats == 0)
+        {
+            // the end of the probe chain, no later entry holds the key
+            entry = probe;
+            break;
+        }
+        if (probe->device_id == device_id && probe->msg_no == msg_no && probe->network == network && probe->msg_type == msg_type)
+        {
+            if (!x3d_dedup_expired(cache, probe, now_ms))
+            {
+                if (probe->repeats < UINT8_MAX)
+                {
+                    probe->repeats++;
+                }
+                if (rssi > probe->rssi)
+                {
+                    probe->rssi = rssi;
+                }
+                probe->last_ms = now_ms;
+                if (event != NULL)
+                {
+                    *event = probe;
+                }
+                return false;
+            }
+            // the message number wrapped, the old event is replaced in place
+            expired = probe;
+            break;
+        }
+        if (expired == NULL && x3d_dedup_expired(cache, probe, now_ms))
+        {
+            expired = probe;
+        }
+        if (oldest == NULL || now_ms - probe->last_ms > now_ms - oldest->last_ms)
+        {
+            oldest = probe;
+        }
+    }
+    if (entry == NULL && expired != NULL)
+    {
+        entry = expired;
+        cache->dropped++;
+    }
+    else if (entry == NULL)
+    {
+        entry = oldest;
+        cache->evicted++;
+    }
+
+    entry->device_id = device_id;
+    entry->network   = network;
+    entry->msg_no    = msg_no;
+    entry->msg_type  = msg_type;
+    entry->repeats   = 1;
+    entry->rssi      = rssi;
+    entry->first_ms  = now_ms;
+    entry->last_ms   = now_ms;
+    if (event != NULL)
+    {
+        *event = entry;
+    }
+    return true;
+}
+
+int x3d_dedup_flush(x3d_dedup_t *cache, uint32_t now_ms, x3d_dedup_event_t *events, int max_events)
+{
+    int count = 0;
+    for (uint32_t i = 0; i < X3D_DEDUP_ENTRIES && count < max_events; i++)
+    {
+        // the removal moves a following entry into the index, it is checked again
+        while (cache->entries[i].repeats != 0 && x3d_dedup_expired(cache, &cache->entries[i], now_ms) && count < max_events)
+        {
+            events[count++] = cache->entries[i];
+            x3d_dedup_remove(cache, i);
+        }
+    }
+    return count;
+}
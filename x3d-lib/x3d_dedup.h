@@ -0,0 +1,82 @@
+/**
+ * @file x3d_dedup.h
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief collapsing of repeated and relayed frames into one logical message
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * An initiator sends every message several times with a counting nibble, the devices of the network
+ * relay it with the header of the initiator. All these frames share device id, network, message number
+ * and message type, they are collapsed into one event with the repeat count and the best RSSI.
+ *
+ * The events are kept in a fixed hash table with linear probing. An event expires X3D_DEDUP_EXPIRE_MS
+ * after its last frame, a later frame with the same key starts a new event. Expired events are handed
+ * out and removed by x3d_dedup_flush, a frame finding no free entry within X3D_DEDUP_PROBES replaces
+ * the oldest event of its probe range.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// entries of the hash table, must be a power of two
+#define X3D_DEDUP_ENTRIES       64
+
+// entries probed for a key
+#define X3D_DEDUP_PROBES        8
+
+// default expiry after the last frame, longer than the relay rounds of a transaction
+#define X3D_DEDUP_EXPIRE_MS     2000
+
+/// @brief Logical message
+typedef struct {
+    uint32_t device_id;
+    uint8_t network;
+    uint8_t msg_no;
+    uint8_t msg_type;
+    uint8_t repeats;    ///< received frames, saturating at 255, 0 if the entry is free
+    int16_t rssi;       ///< best RSSI of the frames in dBm
+    uint32_t first_ms;  ///< time of the first frame
+    uint32_t last_ms;   ///< time of the last frame
+} x3d_dedup_event_t;
+
+/// @brief Cache of the recent messages
+typedef struct {
+    x3d_dedup_event_t entries[X3D_DEDUP_ENTRIES];
+    uint32_t expire_ms;
+    uint32_t evicted;   ///< events replaced before they expired
+    uint32_t dropped;   ///< expired events replaced before they were flushed
+} x3d_dedup_t;
+
+/**
+ * @brief Clears the cache
+ *
+ * @param cache cache
+ * @param expire_ms expiry after the last frame of an event
+ */
+void x3d_dedup_init(x3d_dedup_t *cache, uint32_t expire_ms);
+
+/**
+ * @brief Adds a received frame with valid crc
+ *
+ * @param cache cache
+ * @param buffer frame
+ * @param rssi RSSI of the frame in dBm
+ * @param now_ms time of reception, may wrap
+ * @param event event of the frame, NULL if the frame is too short for the key, may be NULL
+ * @return bool true if the frame starts a new event, also for frames too short for the key
+ */
+bool x3d_dedup_frame(x3d_dedup_t *cache, const uint8_t *buffer, int16_t rssi, uint32_t now_ms, x3d_dedup_event_t **event);
+
+/**
+ * @brief Copies the expired events and removes them from the cache
+ *
+ * @param cache cache
+ * @param now_ms current time
+ * @param events target array
+ * @param max_events size of the target array, further expired events stay in the cache
+ * @return int number of events copied
+ */
+int x3d_dedup_flush(x3d_dedup_t *cache, uint32_t now_ms, x3d_dedup_event_t *events, int max_events);
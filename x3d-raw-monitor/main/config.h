@@ -16,3 +16,8 @@
 #define RFM_PIN_NUM_CS                     VSPI_IOMUX_PIN_NUM_CS
 #define RFM_PIN_NUM_IRQ                    GPIO_NUM_4
 #define RFM_SPI_HOST                       SPI3_HOST
+
+// keep frames with crc error in the DIAG log stream, classify and correct them, 0 drops them
+#define RFM_DIAGNOSTICS                    1
+// interval of the error counters per source in the DIAG log stream
+#define RFM_DIAGNOSTICS_REPORT_MS          60000
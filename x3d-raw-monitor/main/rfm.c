@@ -8,6 +8,9 @@
  * @copyright Copyright (c) 2023
  *
  */
+#include <inttypes.h>
+#include <string.h>
+
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
 
@@ -20,6 +23,7 @@
 
 #include "sx1231.h"
 #include "rfm.h"
+#include "x3d_crc.h"
 #include "config.h"
 
 static const char *TAG = "RFM";
@@ -52,6 +56,65 @@ esp_err_t check_message(uint8_t* buffer)
     return ESP_OK;
 }
 
+#if RFM_DIAGNOSTICS
+static const char *DIAG_TAG = "DIAG";
+
+static x3d_crc_stats_t rfm_crc_stats;
+static TickType_t rfm_report_ticks = 0;
+
+static void rfm_log_source(const x3d_crc_source_t *source, uint32_t device_id)
+{
+    ESP_LOGI(DIAG_TAG, "source 0x%06" PRIx32 " ok %" PRIu32 " length %" PRIu32 " truncated %" PRIu32 " bit %" PRIu32
+        " burst %" PRIu32 " uncorrectable %" PRIu32, device_id,
+        source->count[X3D_CRC_OK], source->count[X3D_CRC_LENGTH], source->count[X3D_CRC_TRUNCATED],
+        source->count[X3D_CRC_BIT], source->count[X3D_CRC_BURST], source->count[X3D_CRC_UNCORRECTABLE]);
+}
+
+/**
+ * @brief Logs the error counters per source since start, the unknown source counts the frames with corrupted device id
+ */
+static void rfm_report(void)
+{
+    TickType_t now = xTaskGetTickCount();
+    if (now - rfm_report_ticks < pdMS_TO_TICKS(RFM_DIAGNOSTICS_REPORT_MS))
+    {
+        return;
+    }
+    rfm_report_ticks = now;
+    for (int i = 0; i < rfm_crc_stats.used; i++)
+    {
+        rfm_log_source(&rfm_crc_stats.sources[i], rfm_crc_stats.sources[i].device_id);
+    }
+    rfm_log_source(&rfm_crc_stats.unknown, 0);
+}
+
+/**
+ * @brief Classifies the received frame and corrects it if possible.
+ * Frames with crc error are logged as received to the DIAG stream, so they can be told apart from the valid ones.
+ *
+ * @param buffer received frame, corrected in place
+ * @return bool true if the frame is valid or corrected
+ */
+static bool rfm_diagnose(uint8_t* buffer)
+{
+    uint8_t received[65];
+    memcpy(received, buffer, sizeof(received));
+
+    // the radio reads the length byte and the announced bytes
+    x3d_crc_result_t result;
+    x3d_crc_check(buffer, received[0] + 1, &result);
+    x3d_crc_stats_add(&rfm_crc_stats, buffer, &result);
+    if (result.error != X3D_CRC_OK)
+    {
+        ESP_LOGW(DIAG_TAG, "rx error %s syndrome 0x%04x bit %d burst %d%s", x3d_crc_class_name(result.error),
+            result.syndrome, result.bit, result.burst, result.corrected ? " corrected" : "");
+        ESP_LOG_BUFFER_HEX_LEVEL(DIAG_TAG, received, received[0], ESP_LOG_WARN);
+    }
+    rfm_report();
+    return result.error == X3D_CRC_OK || result.corrected;
+}
+#endif
+
 static void rfm_process_task(void* arg)
 {
     uint32_t io_num;
@@ -62,7 +125,11 @@ static void rfm_process_task(void* arg)
             uint8_t buffer[65];
             sx1231_get_buffer(sx1231_handle, buffer);
             ESP_ERROR_CHECK(sx1231_receive_begin(sx1231_handle));
+#if RFM_DIAGNOSTICS
+            if (!rfm_diagnose(buffer))
+#else
             if (check_message(buffer) != ESP_OK)
+#endif
             {
                 continue;
             }
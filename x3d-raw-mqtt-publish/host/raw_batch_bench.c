@@ -0,0 +1,368 @@
+/**
+ * @file raw_batch_bench.c
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief host benchmark of the batching raw publisher driven by recorded frame bursts
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Replays a recording in virtual time against a blocking mqtt publish of the given latency, once with
+ * one message per frame as published from the receive task before and once with the double buffer
+ * of raw_publisher.c. Afterwards the recording is batched and decoded with raw_batch.c in a loop to
+ * measure the throughput and check the round trip.
+ */
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "raw_batch.h"
+
+#define BENCH_MAX_FRAMES    4096
+#define BENCH_MIN_FRAMES    2000000
+
+typedef struct {
+    uint64_t time_us;
+    int8_t rssi;
+    uint8_t length;
+    uint8_t data[RAW_BATCH_FRAME_MAX];
+} bench_frame_t;
+
+typedef struct {
+    int messages;
+    int lost;
+    uint64_t bytes;
+    uint64_t latency_sum;   ///< receive until publish done, sum over the published frames
+    uint64_t latency_max;
+} bench_result_t;
+
+static bench_frame_t frames[BENCH_MAX_FRAMES];
+static int frame_count = 0;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int load_recording(const char *name)
+{
+    FILE *f = fopen(name, "r");
+    if (f == NULL)
+    {
+        perror(name);
+        return -1;
+    }
+
+    char line[256];
+    while (fgets(line, sizeof(line), f) != NULL && frame_count < BENCH_MAX_FRAMES)
+    {
+        uint64_t time_us;
+        int rssi, pos;
+        if (line[0] == '#' || sscanf(line, "%" SCNu64 " %d %n", &time_us, &rssi, &pos) != 2)
+        {
+            continue;
+        }
+        bench_frame_t *frame = &frames[frame_count];
+        frame->time_us       = time_us;
+        frame->rssi          = rssi;
+        frame->length        = 0;
+        unsigned int byte;
+        while (frame->length < RAW_BATCH_FRAME_MAX && sscanf(&line[pos], "%2x", &byte) == 1)
+        {
+            frame->data[frame->length++] = byte;
+            pos += 2;
+        }
+        frame_count += frame->length > 0;
+    }
+    fclose(f);
+    return frame_count;
+}
+
+static void account(bench_result_t *result, uint64_t done, uint64_t time_us)
+{
+    uint64_t latency = done - time_us;
+    result->latency_sum += latency;
+    if (latency > result->latency_max)
+    {
+        result->latency_max = latency;
+    }
+}
+
+/**
+ * @brief One message per frame from the receive task, the fifo holds one more frame while the task publishes
+ */
+static void replay_per_frame(uint64_t publish_us, bench_result_t *result)
+{
+    uint64_t busy_until = 0;
+    int held            = -1;
+    for (int i = 0; i < frame_count; i++)
+    {
+        uint64_t t = frames[i].time_us;
+        if (held >= 0 && busy_until <= t)
+        {
+            busy_until += publish_us;
+            account(result, busy_until, frames[held].time_us);
+            result->messages++;
+            result->bytes += frames[held].length;
+            held = -1;
+        }
+        if (busy_until <= t)
+        {
+            busy_until = t + publish_us;
+            account(result, busy_until, t);
+            result->messages++;
+            result->bytes += frames[i].length;
+        }
+        else if (held < 0)
+        {
+            held = i;
+        }
+        else
+        {
+            result->lost++;
+        }
+    }
+    if (held >= 0)
+    {
+        account(result, busy_until + publish_us, frames[held].time_us);
+        result->messages++;
+        result->bytes += frames[held].length;
+    }
+}
+
+// state of the double buffer, the same policy as raw_publisher.c in virtual time
+typedef struct {
+    raw_batch_t fill;
+    int index[UINT8_MAX];   ///< frame index per record of the fill buffer
+    bool ready;             ///< other buffer is published
+    uint64_t ready_until;   ///< publish of the other buffer is done
+    uint64_t free_since;    ///< publisher idle since
+    uint64_t publish_us;
+    uint64_t max_age_us;
+    bench_result_t *result;
+    FILE *out;              ///< receives the published messages if not NULL
+} bench_publisher_t;
+
+static void publisher_swap(bench_publisher_t *p, uint64_t t)
+{
+    p->ready       = true;
+    p->ready_until = t + p->publish_us;
+    p->result->messages++;
+    uint16_t length = raw_batch_finish(&p->fill, p->result->messages, 0);
+    p->result->bytes += length;
+    if (p->out != NULL)
+    {
+        fwrite(p->fill.data, 1, length, p->out);
+    }
+    for (int i = 0; i < p->fill.count; i++)
+    {
+        account(p->result, p->ready_until, frames[p->index[i]].time_us);
+    }
+    raw_batch_reset(&p->fill);
+}
+
+static bool publisher_append(bench_publisher_t *p, int i)
+{
+    bench_frame_t *frame = &frames[i];
+    if (!raw_batch_append(&p->fill, frame->time_us, frame->rssi, frame->data, frame->length))
+    {
+        return false;
+    }
+    p->index[p->fill.count - 1] = i;
+    return true;
+}
+
+static void publisher_advance(bench_publisher_t *p, uint64_t t)
+{
+    for (;;)
+    {
+        if (p->ready)
+        {
+            if (p->ready_until > t)
+            {
+                return;
+            }
+            p->ready      = false;
+            p->free_since = p->ready_until;
+        }
+        if (p->fill.count == 0)
+        {
+            return;
+        }
+        uint64_t start = p->fill.base_us + p->max_age_us;
+        if (raw_batch_full(&p->fill) || start < p->free_since)
+        {
+            start = p->free_since;
+        }
+        if (start > t)
+        {
+            return;
+        }
+        publisher_swap(p, start);
+    }
+}
+
+static void replay_batched(uint64_t publish_us, uint64_t max_age_us, uint16_t size, FILE *out, bench_result_t *result)
+{
+    static uint8_t buffer[UINT16_MAX];
+    bench_publisher_t p = {.publish_us = publish_us, .max_age_us = max_age_us, .result = result, .out = out};
+    raw_batch_init(&p.fill, buffer, size);
+
+    for (int i = 0; i < frame_count; i++)
+    {
+        uint64_t t = frames[i].time_us;
+        publisher_advance(&p, t);
+        if (!publisher_append(&p, i))
+        {
+            if (p.ready)
+            {
+                result->lost++;
+                continue;
+            }
+            publisher_swap(&p, t);
+            publisher_append(&p, i);
+        }
+        if (raw_batch_full(&p.fill) && !p.ready)
+        {
+            publisher_swap(&p, t);
+        }
+    }
+    publisher_advance(&p, UINT64_MAX - max_age_us);
+}
+
+static void print_result(const char *name, const bench_result_t *result)
+{
+    int published = frame_count - result->lost;
+    printf("%-10s %5d messages, %7" PRIu64 " bytes, %4d lost, latency mean %6.1f ms max %6.1f ms\n",
+            name, result->messages, result->bytes, result->lost,
+            published > 0 ? (double)result->latency_sum / published / 1000 : 0, (double)result->latency_max / 1000);
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [options] [recording]\n"
+            "  -s size             batch buffer size, default 1024\n"
+            "  -a ms               maximum batch age, default 250\n"
+            "  -l ms               latency of a blocking publish, default 30\n"
+            "  -o file             write the batched messages for raw-decode\n"
+            "recording: lines of receive time in us, rssi in dBm and frame in hex, default bursts.txt\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    int size       = 1024;
+    int max_age_ms = 250;
+    int publish_ms = 30;
+    FILE *out      = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:a:l:o:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 's': size = atoi(optarg); break;
+            case 'a': max_age_ms = atoi(optarg); break;
+            case 'l': publish_ms = atoi(optarg); break;
+            case 'o':
+                out = fopen(optarg, "wb");
+                if (out == NULL)
+                {
+                    perror(optarg);
+                    return 1;
+                }
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (size < RAW_BATCH_MIN_SIZE || size > UINT16_MAX)
+    {
+        fprintf(stderr, "batch size %d out of range %d..%d\n", size, RAW_BATCH_MIN_SIZE, UINT16_MAX);
+        return 1;
+    }
+    const char *recording = optind < argc ? argv[optind] : "bursts.txt";
+    if (load_recording(recording) <= 0)
+    {
+        fprintf(stderr, "%s: no frames\n", recording);
+        return 1;
+    }
+
+    uint64_t duration = frames[frame_count - 1].time_us - frames[0].time_us;
+    printf("%d frames over %.1f s, publish latency %d ms, batch %d bytes, max age %d ms\n",
+            frame_count, (double)duration / 1000000, publish_ms, size, max_age_ms);
+
+    bench_result_t per_frame = {0}, batched = {0};
+    replay_per_frame(publish_ms * 1000ULL, &per_frame);
+    replay_batched(publish_ms * 1000ULL, max_age_ms * 1000ULL, size, out, &batched);
+    if (out != NULL)
+    {
+        fclose(out);
+    }
+    print_result("per frame", &per_frame);
+    print_result("batched", &batched);
+
+    // throughput of encode and decode, every batch is decoded and compared
+    static uint8_t buffer[UINT16_MAX];
+    raw_batch_t batch;
+    raw_batch_init(&batch, buffer, size);
+    uint64_t encoded = 0, messages = 0, bytes = 0, start = now_ns();
+    uint16_t sequence = 0;
+    int first         = 0;
+    while (encoded < BENCH_MIN_FRAMES)
+    {
+        for (int i = 0; i <= frame_count; i++)
+        {
+            bench_frame_t *frame = &frames[i % frame_count];
+            if (i < frame_count && raw_batch_append(&batch, frame->time_us, frame->rssi, frame->data, frame->length))
+            {
+                continue;
+            }
+
+            uint16_t length = raw_batch_finish(&batch, sequence++, 0);
+            raw_batch_header_t header;
+            raw_batch_record_t record;
+            size_t offset = 0;
+            int index     = first;
+            if (!raw_batch_parse(buffer, length, &header))
+            {
+                printf("batch %u not parsed\n", sequence - 1);
+                return 1;
+            }
+            while (raw_batch_next(buffer, &header, &offset, &record))
+            {
+                bench_frame_t *expected = &frames[index++];
+                if (record.time_us != expected->time_us || record.rssi != expected->rssi
+                        || record.length != expected->length || memcmp(record.frame, expected->data, record.length) != 0)
+                {
+                    printf("frame %d round trip mismatch\n", index - 1);
+                    return 1;
+                }
+            }
+            if (index - first != header.count)
+            {
+                printf("batch %u has %d of %u frames\n", header.sequence, index - first, header.count);
+                return 1;
+            }
+            encoded += header.count;
+            bytes += length;
+            messages++;
+            first = index;
+            raw_batch_reset(&batch);
+
+            if (i < frame_count)
+            {
+                raw_batch_append(&batch, frame->time_us, frame->rssi, frame->data, frame->length);
+            }
+        }
+        first = 0;
+    }
+    uint64_t ns = now_ns() - start;
+    printf("throughput %.1f Mframes/s, %.1f MB/s, %.1f frames and %.0f bytes per message, round trip identical\n",
+            (double)encoded * 1000 / ns, (double)bytes * 1000 / ns, (double)encoded / messages, (double)bytes / messages);
+    return 0;
+}
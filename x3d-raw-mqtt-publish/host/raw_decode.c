@@ -0,0 +1,122 @@
+/**
+ * @file raw_decode.c
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief host decoder of the raw batch messages
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * Reads back to back batch messages, e.g. of mosquitto_sub -N, and prints one line per frame:
+ * receive time in us, rssi in dBm and the frame in hex. The output is a recording for raw-batch-bench.
+ */
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "raw_batch.h"
+
+#define DECODE_BUFFER_SIZE  65536
+
+static int decode_stream(FILE *f, const char *name, int verbose)
+{
+    static uint8_t buffer[DECODE_BUFFER_SIZE];
+    size_t length  = 0;
+    int batches    = 0;
+    int frames     = 0;
+    int dropped    = 0;
+    int gaps       = 0;
+    int last_seq   = -1;
+
+    for (;;)
+    {
+        size_t n = fread(&buffer[length], 1, sizeof(buffer) - length, f);
+        length += n;
+
+        size_t pos = 0;
+        raw_batch_header_t header;
+        while (raw_batch_parse(&buffer[pos], length - pos, &header))
+        {
+            if (last_seq >= 0 && header.sequence != (uint16_t)(last_seq + 1))
+            {
+                gaps++;
+            }
+            last_seq = header.sequence;
+            dropped += header.dropped;
+            if (verbose)
+            {
+                printf("# batch %u, %u frames, %u dropped\n", header.sequence, header.count, header.dropped);
+            }
+
+            size_t offset = 0;
+            raw_batch_record_t record;
+            int count     = 0;
+            while (raw_batch_next(&buffer[pos], &header, &offset, &record))
+            {
+                printf("%" PRIu64 " %d ", record.time_us, record.rssi);
+                for (int i = 0; i < record.length; i++)
+                {
+                    printf("%02x", record.frame[i]);
+                }
+                printf("\n");
+                count++;
+            }
+            if (count != header.count)
+            {
+                fprintf(stderr, "%s: batch %u has %d of %u frames\n", name, header.sequence, count, header.count);
+            }
+            frames += count;
+            batches++;
+            pos += header.length;
+        }
+
+        memmove(buffer, &buffer[pos], length - pos);
+        length -= pos;
+        if (n == 0)
+        {
+            break;
+        }
+        if (length == sizeof(buffer) || (length >= RAW_BATCH_HEADER_SIZE && buffer[0] != RAW_BATCH_MAGIC))
+        {
+            fprintf(stderr, "%s: no batch message at the current position\n", name);
+            return 1;
+        }
+    }
+
+    if (length > 0)
+    {
+        fprintf(stderr, "%s: %zu bytes of a truncated batch\n", name, length);
+    }
+    fprintf(stderr, "%s: %d batches, %d frames, %d dropped on the device, %d sequence gaps\n", name, batches, frames, dropped, gaps);
+    return length > 0;
+}
+
+int main(int argc, char **argv)
+{
+    int verbose = 0;
+    int arg     = 1;
+    if (arg < argc && strcmp(argv[arg], "-v") == 0)
+    {
+        verbose = 1;
+        arg++;
+    }
+    if (arg == argc)
+    {
+        return decode_stream(stdin, "stdin", verbose);
+    }
+
+    int rc = 0;
+    for (; arg < argc; arg++)
+    {
+        FILE *f = fopen(argv[arg], "rb");
+        if (f == NULL)
+        {
+            perror(argv[arg]);
+            return 1;
+        }
+        rc |= decode_stream(f, argv[arg], verbose);
+        fclose(f);
+    }
+    return rc;
+}
@@ -0,0 +1,436 @@
+/**
+ * @file raw_log_test.c
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief host test of the raw log against a file backed NOR flash emulator
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * The emulator maps a file as flash area. A write only clears bits, a write setting a bit is counted as
+ * violation, an erase sets a sector to 0xff and is counted per sector. A power cut after a number of
+ * programmed bytes stops the write or erase in the middle and fails all further access until the log is
+ * mounted again.
+ *
+ * The test runs a round trip with remount, fills the ring several times to check the overflow and the
+ * wear of the sectors and interrupts random appends and consumes to check that no committed record is
+ * lost or corrupted. Every record carries its sequence number and is filled from it.
+ */
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "raw_log.h"
+
+#define TEST_SECTOR_SIZE    16384
+#define TEST_SECTORS        32
+#define TEST_RECORD_MAX     8192
+
+typedef struct {
+    uint8_t *data;
+    uint32_t size;
+    uint32_t erases[TEST_SECTORS];
+    uint32_t violations;
+    int64_t budget;     ///< bytes programmed or erased until the power cut, -1 without
+    bool cut;
+} flash_file_t;
+
+static uint32_t test_random = 2463534242U;
+
+static uint32_t test_rand(void)
+{
+    // xorshift32
+    test_random ^= test_random << 13;
+    test_random ^= test_random >> 17;
+    test_random ^= test_random << 5;
+    return test_random;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief Takes bytes of the budget, returns how many can be done before the power cut
+ */
+static size_t flash_take(flash_file_t *flash, size_t length)
+{
+    if (flash->budget < 0)
+    {
+        return length;
+    }
+    if ((int64_t)length > flash->budget)
+    {
+        length     = flash->budget;
+        flash->cut = true;
+    }
+    flash->budget -= length;
+    return length;
+}
+
+static int flash_read(void *ctx, uint32_t address, void *data, size_t length)
+{
+    flash_file_t *flash = ctx;
+    if (flash->cut || address + length > flash->size)
+    {
+        return -1;
+    }
+    memcpy(data, &flash->data[address], length);
+    return 0;
+}
+
+static int flash_write(void *ctx, uint32_t address, const void *data, size_t length)
+{
+    flash_file_t *flash = ctx;
+    if (flash->cut || address + length > flash->size)
+    {
+        return -1;
+    }
+    const uint8_t *bytes = data;
+    size_t done          = flash_take(flash, length);
+    for (size_t i = 0; i < done; i++)
+    {
+        flash->violations += (bytes[i] & ~flash->data[address + i]) != 0;
+        flash->data[address + i] &= bytes[i];
+    }
+    return done == length ? 0 : -1;
+}
+
+static int flash_erase(void *ctx, uint32_t address)
+{
+    flash_file_t *flash = ctx;
+    if (flash->cut || address % TEST_SECTOR_SIZE != 0 || address >= flash->size)
+    {
+        return -1;
+    }
+    // an interrupted erase leaves the sector partly erased
+    size_t done = flash_take(flash, TEST_SECTOR_SIZE);
+    memset(&flash->data[address], 0xff, done);
+    flash->erases[address / TEST_SECTOR_SIZE]++;
+    return done == TEST_SECTOR_SIZE ? 0 : -1;
+}
+
+static int flash_open(flash_file_t *flash, raw_log_flash_t *ops, const char *path)
+{
+    memset(flash, 0, sizeof(*flash));
+    flash->size   = TEST_SECTOR_SIZE * TEST_SECTORS;
+    flash->budget = -1;
+    int fd        = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, flash->size) != 0)
+    {
+        perror(path);
+        return -1;
+    }
+    flash->data = mmap(NULL, flash->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (flash->data == MAP_FAILED)
+    {
+        perror(path);
+        return -1;
+    }
+    // a new chip is erased
+    memset(flash->data, 0xff, flash->size);
+
+    ops->read        = flash_read;
+    ops->write       = flash_write;
+    ops->erase       = flash_erase;
+    ops->ctx         = flash;
+    ops->size        = flash->size;
+    ops->sector_size = TEST_SECTOR_SIZE;
+    return 0;
+}
+
+/**
+ * @brief Fills a record from its sequence number
+ */
+static uint16_t make_record(uint8_t *data, uint32_t sequence)
+{
+    uint16_t length = 4 + (sequence * 2654435761u >> 16) % (TEST_RECORD_MAX - 4);
+    memcpy(data, &sequence, 4);
+    for (int i = 4; i < length; i++)
+    {
+        data[i] = sequence + i * 7;
+    }
+    return length;
+}
+
+/**
+ * @brief Checks a record read back, returns its sequence number or -1 if corrupted
+ */
+static int64_t check_record(const uint8_t *data, int length)
+{
+    uint8_t expected[TEST_RECORD_MAX];
+    uint32_t sequence;
+    if (length < 4)
+    {
+        return -1;
+    }
+    memcpy(&sequence, data, 4);
+    if (make_record(expected, sequence) != length || memcmp(expected, data, length) != 0)
+    {
+        return -1;
+    }
+    return sequence;
+}
+
+static int fail(const char *test, const char *message)
+{
+    printf("%-10s FAILED: %s\n", test, message);
+    return 1;
+}
+
+/**
+ * @brief Appends, reads back, consumes half and checks the remount restores the rest
+ */
+static int test_roundtrip(flash_file_t *flash, const raw_log_flash_t *ops)
+{
+    static uint8_t data[TEST_RECORD_MAX];
+    raw_log_t log;
+    if (raw_log_mount(&log, ops) != 0 || log.stats.records != 0)
+    {
+        return fail("roundtrip", "empty mount");
+    }
+    const int count = 20;
+    for (int i = 0; i < count; i++)
+    {
+        if (raw_log_append(&log, data, make_record(data, i)) != 0)
+        {
+            return fail("roundtrip", "append");
+        }
+    }
+
+    uint32_t position = log.tail;
+    uint32_t half     = log.tail;
+    int length, read  = 0;
+    while ((length = raw_log_read(&log, &position, data, sizeof(data))) > 0)
+    {
+        if (check_record(data, length) != read)
+        {
+            return fail("roundtrip", "record read back");
+        }
+        if (++read == count / 2)
+        {
+            half = position;
+        }
+    }
+    if (read != count || raw_log_consume(&log, half) != 0 || log.stats.records != count / 2)
+    {
+        return fail("roundtrip", "consume");
+    }
+
+    if (raw_log_mount(&log, ops) != 0 || log.stats.records != count / 2)
+    {
+        return fail("roundtrip", "remount");
+    }
+    position = log.tail;
+    length   = raw_log_read(&log, &position, data, sizeof(data));
+    if (check_record(data, length) != count / 2 || raw_log_append(&log, data, make_record(data, count)) != 0)
+    {
+        return fail("roundtrip", "first record after remount");
+    }
+    for (read = count / 2 + 1; (length = raw_log_read(&log, &position, data, sizeof(data))) > 0; read++)
+    {
+        if (check_record(data, length) != read)
+        {
+            return fail("roundtrip", "record after remount");
+        }
+    }
+    if (read != count + 1 || flash->violations != 0)
+    {
+        return fail("roundtrip", "append after remount");
+    }
+    printf("%-10s ok\n", "roundtrip");
+    return 0;
+}
+
+/**
+ * @brief Fills the ring ten times without consuming, the newest records survive and the sectors wear evenly
+ */
+static int test_wrap(flash_file_t *flash, const raw_log_flash_t *ops)
+{
+    static uint8_t data[TEST_RECORD_MAX];
+    raw_log_t log;
+    memset(flash->data, 0xff, flash->size);
+    memset(flash->erases, 0, sizeof(flash->erases));
+    if (raw_log_mount(&log, ops) != 0)
+    {
+        return fail("wrap", "mount");
+    }
+
+    uint32_t sequence = 0;
+    uint64_t bytes    = 0;
+    uint64_t start    = now_ns();
+    while (bytes < 10ULL * flash->size)
+    {
+        uint16_t length = make_record(data, sequence++);
+        if (raw_log_append(&log, data, length) != 0)
+        {
+            return fail("wrap", "append");
+        }
+        bytes += length;
+    }
+    uint64_t ns = now_ns() - start;
+
+    // the surviving records are the newest ones in order
+    if (raw_log_mount(&log, ops) != 0 || log.stats.records == 0)
+    {
+        return fail("wrap", "remount");
+    }
+    uint32_t records  = log.stats.records;
+    uint32_t position = log.tail;
+    int64_t expected  = sequence - records;
+    int length;
+    while ((length = raw_log_read(&log, &position, data, sizeof(data))) > 0)
+    {
+        if (check_record(data, length) != expected++)
+        {
+            return fail("wrap", "surviving records");
+        }
+    }
+    if (expected != sequence)
+    {
+        return fail("wrap", "newest record missing");
+    }
+
+    uint32_t min = UINT32_MAX, max = 0;
+    for (int i = 0; i < TEST_SECTORS; i++)
+    {
+        min = flash->erases[i] < min ? flash->erases[i] : min;
+        max = flash->erases[i] > max ? flash->erases[i] : max;
+    }
+    if (max - min > 1 || flash->violations != 0)
+    {
+        return fail("wrap", "uneven wear");
+    }
+    printf("%-10s ok, %" PRIu32 " records, %" PRIu32 " kept, erases per sector %" PRIu32 " to %" PRIu32 ", %.1f MB/s\n",
+            "wrap", sequence, records, min, max, bytes * 1e3 / ns);
+    return 0;
+}
+
+/**
+ * @brief Cuts the power in random appends, consumes and erases and checks the log after every remount
+ */
+static int test_power(flash_file_t *flash, const raw_log_flash_t *ops, int cycles)
+{
+    static uint8_t data[TEST_RECORD_MAX];
+    raw_log_t log;
+    memset(flash->data, 0xff, flash->size);
+    flash->budget = -1;
+    flash->cut    = false;
+    if (raw_log_mount(&log, ops) != 0)
+    {
+        return fail("power", "mount");
+    }
+
+    // committed records from first_kept up to next are present, consumed ones up to consumed are gone
+    uint32_t next = 0, first_kept = 0, consumed = 0;
+    int cuts      = 0;
+    for (int cycle = 0; cycle < cycles; cycle++)
+    {
+        flash->budget = test_rand() % (4 * TEST_SECTOR_SIZE);
+        flash->cut    = false;
+        for (int op = 0; !flash->cut && op < 100; op++)
+        {
+            // appends of about a third of the ring between consumes, no overflow
+            if (test_rand() % 4 != 0 && log.stats.bytes < flash->size / 3)
+            {
+                if (raw_log_append(&log, data, make_record(data, next)) == 0)
+                {
+                    next++;
+                }
+                else if (!flash->cut)
+                {
+                    return fail("power", "append");
+                }
+                continue;
+            }
+            // consume a batch of up to five records like a drain message
+            uint32_t position = log.tail;
+            int64_t last      = -1;
+            int length        = 0;
+            for (int i = 0; i < 5 && (length = raw_log_read(&log, &position, data, sizeof(data))) > 0; i++)
+            {
+                last = check_record(data, length);
+            }
+            if (length < 0 && !flash->cut)
+            {
+                return fail("power", "read");
+            }
+            if (last >= 0 && raw_log_consume(&log, position) == 0)
+            {
+                consumed = last + 1;
+            }
+        }
+        if (flash->cut)
+        {
+            cuts++;
+        }
+
+        flash->budget = -1;
+        flash->cut    = false;
+        if (raw_log_mount(&log, ops) != 0)
+        {
+            return fail("power", "mount after cut");
+        }
+        if (flash->violations != 0)
+        {
+            return fail("power", "write setting bits");
+        }
+
+        // an interrupted consume leaves its records, an interrupted append drops its record
+        uint32_t position = log.tail;
+        int64_t previous  = -1;
+        int length;
+        while ((length = raw_log_read(&log, &position, data, sizeof(data))) > 0)
+        {
+            int64_t sequence = check_record(data, length);
+            if (sequence < 0 || sequence <= previous || sequence >= next)
+            {
+                return fail("power", "corrupt or reordered record");
+            }
+            if (sequence < consumed)
+            {
+                return fail("power", "consumed record back");
+            }
+            if (previous >= first_kept && sequence != previous + 1)
+            {
+                return fail("power", "committed record lost");
+            }
+            previous = sequence;
+        }
+        if (length < 0 || (next > consumed && previous != next - 1))
+        {
+            return fail("power", "newest committed record lost");
+        }
+        first_kept = consumed;
+    }
+    printf("%-10s ok, %d cycles, %d power cuts, %" PRIu32 " records\n", "power", cycles, cuts, next);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = argc > 1 ? argv[1] : "/tmp/raw-log-flash.bin";
+    int cycles       = argc > 2 ? atoi(argv[2]) : 2000;
+    flash_file_t flash;
+    raw_log_flash_t ops;
+    if (flash_open(&flash, &ops, path) != 0)
+    {
+        return 1;
+    }
+
+    int failed = test_roundtrip(&flash, &ops);
+    failed += test_wrap(&flash, &ops);
+    failed += test_power(&flash, &ops, cycles);
+    munmap(flash.data, flash.size);
+    unlink(path);
+    return failed ? 1 : 0;
+}
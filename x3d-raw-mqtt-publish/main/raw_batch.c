@@ -0,0 +1,122 @@
+/**
+ * @file raw_batch.c
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief binary batch message of received raw frames
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <string.h>
+
+#include "raw_batch.h"
+
+static void write_le(uint8_t *data, uint64_t value, int size)
+{
+    for (int i = 0; i < size; i++)
+    {
+        data[i] = value >> (8 * i);
+    }
+}
+
+static uint64_t read_le(const uint8_t *data, int size)
+{
+    uint64_t value = 0;
+    for (int i = size - 1; i >= 0; i--)
+    {
+        value = value << 8 | data[i];
+    }
+    return value;
+}
+
+void raw_batch_init(raw_batch_t *batch, uint8_t *data, uint16_t size)
+{
+    batch->data = data;
+    batch->size = size;
+    raw_batch_reset(batch);
+}
+
+void raw_batch_reset(raw_batch_t *batch)
+{
+    batch->length  = RAW_BATCH_HEADER_SIZE;
+    batch->count   = 0;
+    batch->base_us = 0;
+}
+
+bool raw_batch_append(raw_batch_t *batch, uint64_t time_us, int8_t rssi, const uint8_t *frame, uint8_t length)
+{
+    if (batch->count == UINT8_MAX || batch->length + RAW_BATCH_RECORD_HEADER_SIZE + length > batch->size)
+    {
+        return false;
+    }
+    if (batch->count == 0)
+    {
+        batch->base_us = time_us;
+    }
+
+    uint8_t *record = &batch->data[batch->length];
+    record[0]       = length;
+    record[1]       = rssi;
+    write_le(&record[2], time_us - batch->base_us, 4);
+    memcpy(&record[RAW_BATCH_RECORD_HEADER_SIZE], frame, length);
+    batch->length += RAW_BATCH_RECORD_HEADER_SIZE + length;
+    batch->count++;
+    return true;
+}
+
+bool raw_batch_full(const raw_batch_t *batch)
+{
+    return batch->count == UINT8_MAX || batch->length + RAW_BATCH_RECORD_HEADER_SIZE + RAW_BATCH_FRAME_MAX > batch->size;
+}
+
+uint16_t raw_batch_finish(raw_batch_t *batch, uint16_t sequence, uint32_t dropped)
+{
+    uint8_t *header = batch->data;
+    header[0]       = RAW_BATCH_MAGIC;
+    header[1]       = RAW_BATCH_VERSION;
+    header[2]       = batch->count;
+    header[3]       = dropped > UINT8_MAX ? UINT8_MAX : dropped;
+    write_le(&header[4], sequence, 2);
+    write_le(&header[6], batch->length, 2);
+    write_le(&header[8], batch->base_us, 8);
+    return batch->length;
+}
+
+bool raw_batch_parse(const uint8_t *data, size_t length, raw_batch_header_t *header)
+{
+    if (length < RAW_BATCH_HEADER_SIZE || data[0] != RAW_BATCH_MAGIC || data[1] != RAW_BATCH_VERSION)
+    {
+        return false;
+    }
+    header->count    = data[2];
+    header->dropped  = data[3];
+    header->sequence = read_le(&data[4], 2);
+    header->length   = read_le(&data[6], 2);
+    header->base_us  = read_le(&data[8], 8);
+    return header->length >= RAW_BATCH_HEADER_SIZE && header->length <= length;
+}
+
+bool raw_batch_next(const uint8_t *data, const raw_batch_header_t *header, size_t *offset, raw_batch_record_t *record)
+{
+    if (*offset < RAW_BATCH_HEADER_SIZE)
+    {
+        *offset = RAW_BATCH_HEADER_SIZE;
+    }
+    if (*offset + RAW_BATCH_RECORD_HEADER_SIZE > header->length)
+    {
+        return false;
+    }
+
+    const uint8_t *raw = &data[*offset];
+    if (*offset + RAW_BATCH_RECORD_HEADER_SIZE + raw[0] > header->length)
+    {
+        return false;
+    }
+    record->length  = raw[0];
+    record->rssi    = raw[1];
+    record->time_us = header->base_us + read_le(&raw[2], 4);
+    record->frame   = &raw[RAW_BATCH_RECORD_HEADER_SIZE];
+    *offset += RAW_BATCH_RECORD_HEADER_SIZE + raw[0];
+    return true;
+}
@@ -0,0 +1,127 @@
+/**
+ * @file raw_batch.h
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief binary batch message of received raw frames
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * A batch is one MQTT message, all values are little endian:
+ *
+ *   header  magic 0xb3, version, record count, dropped frames, uint16 sequence, uint16 message length,
+ *           uint64 receive time of the first frame in us
+ *   record  uint8 frame length, int8 rssi in dBm, uint32 receive time offset to the header time in us,
+ *           frame bytes as received from the fifo
+ *
+ * The file has no platform dependencies, the host decoder and benchmark use it as is.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define RAW_BATCH_MAGIC                 0xb3
+#define RAW_BATCH_VERSION               1
+#define RAW_BATCH_HEADER_SIZE           16
+#define RAW_BATCH_RECORD_HEADER_SIZE    6
+
+// largest frame of the sx1231 fifo
+#define RAW_BATCH_FRAME_MAX             65
+
+// smallest buffer holding one frame of maximum size
+#define RAW_BATCH_MIN_SIZE              (RAW_BATCH_HEADER_SIZE + RAW_BATCH_RECORD_HEADER_SIZE + RAW_BATCH_FRAME_MAX)
+
+/// @brief Batch under construction
+typedef struct {
+    uint8_t *data;
+    uint16_t size;      ///< capacity of data
+    uint16_t length;    ///< used bytes including the header
+    uint8_t count;      ///< records
+    uint64_t base_us;   ///< receive time of the first record
+} raw_batch_t;
+
+/// @brief Decoded batch header
+typedef struct {
+    uint8_t count;
+    uint8_t dropped;    ///< frames lost since the previous batch, saturated at 255
+    uint16_t sequence;
+    uint16_t length;
+    uint64_t base_us;
+} raw_batch_header_t;
+
+/// @brief Decoded record, frame points into the message
+typedef struct {
+    uint64_t time_us;
+    int8_t rssi;
+    uint8_t length;
+    const uint8_t *frame;
+} raw_batch_record_t;
+
+/**
+ * @brief Assigns the buffer and empties the batch
+ *
+ * @param batch batch
+ * @param data buffer of at least RAW_BATCH_MIN_SIZE bytes
+ * @param size buffer size
+ */
+void raw_batch_init(raw_batch_t *batch, uint8_t *data, uint16_t size);
+
+/**
+ * @brief Removes all records
+ *
+ * @param batch batch
+ */
+void raw_batch_reset(raw_batch_t *batch);
+
+/**
+ * @brief Appends a frame
+ *
+ * @param batch batch
+ * @param time_us receive time
+ * @param rssi rssi in dBm
+ * @param frame frame bytes
+ * @param length frame length
+ * @return bool false if the frame does not fit, the batch is unchanged
+ */
+bool raw_batch_append(raw_batch_t *batch, uint64_t time_us, int8_t rssi, const uint8_t *frame, uint8_t length);
+
+/**
+ * @brief Checks if a frame of maximum size still fits
+ *
+ * @param batch batch
+ * @return bool
+ */
+bool raw_batch_full(const raw_batch_t *batch);
+
+/**
+ * @brief Writes the header, the message is data with the returned length
+ *
+ * @param batch batch
+ * @param sequence message sequence number
+ * @param dropped frames lost since the previous batch
+ * @return uint16_t message length
+ */
+uint16_t raw_batch_finish(raw_batch_t *batch, uint16_t sequence, uint32_t dropped);
+
+/**
+ * @brief Decodes and validates the header of a message
+ *
+ * @param data message
+ * @param length message length, may contain further messages behind
+ * @param header decoded header
+ * @return bool false if the message is no valid batch
+ */
+bool raw_batch_parse(const uint8_t *data, size_t length, raw_batch_header_t *header);
+
+/**
+ * @brief Decodes the next record of a parsed message
+ *
+ * @param data message
+ * @param header header of raw_batch_parse
+ * @param offset read position, 0 to start with the first record
+ * @param record decoded record
+ * @return bool false at the end of the message or on a truncated record
+ */
+bool raw_batch_next(const uint8_t *data, const raw_batch_header_t *header, size_t *offset, raw_batch_record_t *record);
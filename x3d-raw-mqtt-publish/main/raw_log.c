@@ -0,0 +1,392 @@
+/**
+ * @file raw_log.c
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief circular log of raw batches on a NOR flash area
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <string.h>
+
+#include "raw_log.h"
+
+#define RAW_LOG_LENGTH_FREE     0xffff
+
+/// @brief Record header as read from the flash
+typedef struct {
+    uint32_t address;
+    uint16_t length;
+    uint8_t state;
+    uint32_t crc;
+} raw_log_record_t;
+
+static void write_le(uint8_t *data, uint32_t value, int size)
+{
+    for (int i = 0; i < size; i++)
+    {
+        data[i] = value >> (8 * i);
+    }
+}
+
+static uint32_t read_le(const uint8_t *data, int size)
+{
+    uint32_t value = 0;
+    for (int i = size - 1; i >= 0; i--)
+    {
+        value = value << 8 | data[i];
+    }
+    return value;
+}
+
+static uint32_t raw_log_crc32(const uint8_t *data, size_t length)
+{
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= data[i];
+        for (int j = 0; j < 8; j++)
+        {
+            crc = crc & 1 ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+static inline uint32_t raw_log_record_size(uint16_t length)
+{
+    return RAW_LOG_RECORD_HEADER_SIZE + ((length + 3u) & ~3u);
+}
+
+/**
+ * @brief Returns the sector of a position, a position behind the last record of a full sector belongs to it
+ */
+static inline uint32_t raw_log_sector(const raw_log_t *log, uint32_t address)
+{
+    return (address - 1) / log->flash->sector_size;
+}
+
+static inline uint32_t raw_log_offset(const raw_log_t *log, uint32_t address)
+{
+    return address - raw_log_sector(log, address) * log->flash->sector_size;
+}
+
+static inline uint32_t raw_log_sector_start(const raw_log_t *log, uint32_t sector)
+{
+    return (sector % log->sectors) * log->flash->sector_size + RAW_LOG_SECTOR_HEADER_SIZE;
+}
+
+/**
+ * @brief Reads the header of a sector
+ *
+ * @return int 1 if the sector has a valid header, 0 if not, -1 on a flash error
+ */
+static int raw_log_read_sector(const raw_log_t *log, uint32_t sector, uint32_t *sequence)
+{
+    uint8_t header[RAW_LOG_SECTOR_HEADER_SIZE];
+    if (log->flash->read(log->flash->ctx, sector * log->flash->sector_size, header, sizeof(header)) != 0)
+    {
+        return -1;
+    }
+    *sequence = read_le(&header[4], 4);
+    return read_le(header, 4) == RAW_LOG_MAGIC;
+}
+
+/**
+ * @brief Reads a record header within a sector
+ *
+ * @return int 1 if a record starts at the address, 0 on free space or garbage up to the sector end, -1 on a flash error
+ */
+static int raw_log_read_record(const raw_log_t *log, uint32_t address, raw_log_record_t *record)
+{
+    uint32_t offset = raw_log_offset(log, address);
+    if (offset + RAW_LOG_RECORD_HEADER_SIZE > log->flash->sector_size)
+    {
+        return 0;
+    }
+    uint8_t header[RAW_LOG_RECORD_HEADER_SIZE];
+    if (log->flash->read(log->flash->ctx, address, header, sizeof(header)) != 0)
+    {
+        return -1;
+    }
+    record->address = address;
+    record->length  = read_le(header, 2);
+    record->state   = header[2];
+    record->crc     = read_le(&header[4], 4);
+    // a length cut by an interrupted write may point behind the sector
+    return record->length != RAW_LOG_LENGTH_FREE && offset + raw_log_record_size(record->length) <= log->flash->sector_size;
+}
+
+/**
+ * @brief Finds the next record from a position up to the head, crossing to the next sector at free space or garbage
+ *
+ * @return int 1 if a record was found and the position moved behind it, 0 at the head, -1 on a flash error
+ */
+static int raw_log_step(const raw_log_t *log, uint32_t *position, raw_log_record_t *record)
+{
+    while (*position != log->head)
+    {
+        int found = raw_log_read_record(log, *position, record);
+        if (found < 0)
+        {
+            return -1;
+        }
+        if (found == 0)
+        {
+            *position = raw_log_sector_start(log, raw_log_sector(log, *position) + 1);
+            continue;
+        }
+        *position += raw_log_record_size(record->length);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Moves the head to the next sector, the oldest sector is erased and its unconsumed records are counted as lost
+ */
+static int raw_log_next_sector(raw_log_t *log)
+{
+    uint32_t next = (raw_log_sector(log, log->head) + 1) % log->sectors;
+    if (log->stats.records > 0 && raw_log_sector(log, log->tail) == next)
+    {
+        raw_log_record_t record;
+        uint32_t position = log->tail;
+        while (raw_log_sector(log, position) == next && raw_log_read_record(log, position, &record) == 1)
+        {
+            if (record.state == RAW_LOG_STATE_COMMITTED)
+            {
+                log->stats.records--;
+                log->stats.bytes -= record.length;
+                log->stats.lost++;
+            }
+            position += raw_log_record_size(record.length);
+        }
+        log->tail = raw_log_sector_start(log, next + 1);
+    }
+
+    uint8_t header[RAW_LOG_SECTOR_HEADER_SIZE];
+    write_le(header, RAW_LOG_MAGIC, 4);
+    write_le(&header[4], log->head_sequence + 1, 4);
+    uint32_t address = next * log->flash->sector_size;
+    log->stats.erases++;
+    // the magic is written last, a sector with an interrupted sequence write stays invalid
+    if (log->flash->erase(log->flash->ctx, address) != 0 || log->flash->write(log->flash->ctx, address + 4, &header[4], 4) != 0 ||
+        log->flash->write(log->flash->ctx, address, header, 4) != 0)
+    {
+        return -1;
+    }
+    log->head_sequence++;
+    log->head = address + RAW_LOG_SECTOR_HEADER_SIZE;
+    if (log->stats.records == 0)
+    {
+        log->tail = log->head;
+    }
+    return 0;
+}
+
+int raw_log_mount(raw_log_t *log, const raw_log_flash_t *flash)
+{
+    memset(log, 0, sizeof(*log));
+    log->flash = flash;
+    if (flash->sector_size < 256 || flash->size % flash->sector_size != 0 || flash->size / flash->sector_size < 2)
+    {
+        return -1;
+    }
+    log->sectors = flash->size / flash->sector_size;
+
+    // the head is the sector with the highest sequence
+    uint32_t head = 0, sequence;
+    bool found    = false;
+    for (uint32_t i = 0; i < log->sectors; i++)
+    {
+        int valid = raw_log_read_sector(log, i, &sequence);
+        if (valid < 0)
+        {
+            return -1;
+        }
+        if (valid && (!found || sequence > log->head_sequence))
+        {
+            head               = i;
+            log->head_sequence = sequence;
+            found              = true;
+        }
+    }
+    if (!found)
+    {
+        // the head moves from the last sector to the first one
+        log->head = raw_log_sector_start(log, log->sectors - 1);
+        log->tail = log->head;
+        return raw_log_next_sector(log);
+    }
+
+    // the oldest sector continues the sequence backwards
+    uint32_t oldest = head;
+    for (uint32_t i = 1; i < log->sectors; i++)
+    {
+        uint32_t sector = (head + log->sectors - i) % log->sectors;
+        int valid       = raw_log_read_sector(log, sector, &sequence);
+        if (valid < 0)
+        {
+            return -1;
+        }
+        if (!valid || sequence != log->head_sequence - i)
+        {
+            break;
+        }
+        oldest = sector;
+    }
+
+    // the head is the free space of the head sector
+    raw_log_record_t record;
+    uint32_t address = raw_log_sector_start(log, head);
+    int valid;
+    while ((valid = raw_log_read_record(log, address, &record)) == 1)
+    {
+        address += raw_log_record_size(record.length);
+    }
+    if (valid < 0)
+    {
+        return -1;
+    }
+    log->head = address;
+    log->tail = raw_log_sector_start(log, oldest);
+
+    // the tail is the oldest committed record
+    uint32_t position = log->tail;
+    while ((valid = raw_log_step(log, &position, &record)) == 1)
+    {
+        if (record.state == RAW_LOG_STATE_COMMITTED)
+        {
+            if (log->stats.records == 0)
+            {
+                log->tail = record.address;
+            }
+            log->stats.records++;
+            log->stats.bytes += record.length;
+        }
+    }
+    if (valid < 0)
+    {
+        return -1;
+    }
+    if (log->stats.records == 0)
+    {
+        log->tail = log->head;
+    }
+
+    // an interrupted header write leaves garbage in front of the free space, the head starts a new sector
+    if (raw_log_offset(log, address) + RAW_LOG_RECORD_HEADER_SIZE <= flash->sector_size)
+    {
+        uint8_t free[RAW_LOG_RECORD_HEADER_SIZE];
+        if (flash->read(flash->ctx, address, free, sizeof(free)) != 0)
+        {
+            return -1;
+        }
+        for (int i = 0; i < RAW_LOG_RECORD_HEADER_SIZE; i++)
+        {
+            if (free[i] != 0xff)
+            {
+                return raw_log_next_sector(log);
+            }
+        }
+    }
+    return 0;
+}
+
+size_t raw_log_max_record(const raw_log_t *log)
+{
+    size_t max = log->flash->sector_size - RAW_LOG_SECTOR_HEADER_SIZE - RAW_LOG_RECORD_HEADER_SIZE;
+    return max < RAW_LOG_LENGTH_FREE ? max : RAW_LOG_LENGTH_FREE - 1;
+}
+
+int raw_log_append(raw_log_t *log, const void *data, uint16_t length)
+{
+    if (length > raw_log_max_record(log))
+    {
+        return -1;
+    }
+    uint32_t size = raw_log_record_size(length);
+    if (raw_log_offset(log, log->head) + size > log->flash->sector_size && raw_log_next_sector(log) != 0)
+    {
+        return -1;
+    }
+
+    // header and data first, the state commits the record
+    uint8_t header[RAW_LOG_RECORD_HEADER_SIZE];
+    write_le(header, length, 2);
+    header[2] = RAW_LOG_STATE_FREE;
+    header[3] = 0xff;
+    write_le(&header[4], raw_log_crc32(data, length), 4);
+    uint32_t address = log->head;
+    log->head += size;
+    uint8_t state = RAW_LOG_STATE_COMMITTED;
+    if (log->flash->write(log->flash->ctx, address, header, sizeof(header)) != 0 ||
+        log->flash->write(log->flash->ctx, address + RAW_LOG_RECORD_HEADER_SIZE, data, length) != 0 ||
+        log->flash->write(log->flash->ctx, address + 2, &state, 1) != 0)
+    {
+        return -1;
+    }
+    if (log->stats.records == 0)
+    {
+        log->tail = address;
+    }
+    log->stats.records++;
+    log->stats.bytes += length;
+    log->stats.appended++;
+    return 0;
+}
+
+int raw_log_read(raw_log_t *log, uint32_t *position, void *data, size_t size)
+{
+    raw_log_record_t record;
+    int found;
+    while ((found = raw_log_step(log, position, &record)) == 1)
+    {
+        if (record.state != RAW_LOG_STATE_COMMITTED)
+        {
+            continue;
+        }
+        if (record.length > size ||
+            log->flash->read(log->flash->ctx, record.address + RAW_LOG_RECORD_HEADER_SIZE, data, record.length) != 0)
+        {
+            return -1;
+        }
+        // committed records are complete, a mismatch is a flash failure and the record is skipped
+        if (raw_log_crc32(data, record.length) == record.crc)
+        {
+            return record.length;
+        }
+    }
+    return found;
+}
+
+int raw_log_consume(raw_log_t *log, uint32_t position)
+{
+    // a full ring moved the tail over the position since it was read
+    uint32_t tail_sector = raw_log_sector(log, log->tail);
+    uint32_t distance    = (raw_log_sector(log, position) + log->sectors - tail_sector) % log->sectors;
+    if (distance > (raw_log_sector(log, log->head) + log->sectors - tail_sector) % log->sectors ||
+        (distance == 0 && position < log->tail))
+    {
+        return 0;
+    }
+
+    raw_log_record_t record;
+    uint8_t state = RAW_LOG_STATE_CONSUMED;
+    while (log->tail != position && raw_log_step(log, &log->tail, &record) == 1)
+    {
+        if (record.state != RAW_LOG_STATE_COMMITTED)
+        {
+            continue;
+        }
+        if (log->flash->write(log->flash->ctx, record.address + 2, &state, 1) != 0)
+        {
+            return -1;
+        }
+        log->stats.records--;
+        log->stats.bytes -= record.length;
+    }
+    return 0;
+}
@@ -0,0 +1,113 @@
+/**
+ * @file raw_log.h
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief circular log of raw batches on a NOR flash area
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * The area is split into sectors which are written one after the other around the ring, so every
+ * sector is erased once per round. A sector starts with its header, all values are little endian:
+ *
+ *   sector  uint32 magic, uint32 sequence, incremented for every newly erased sector
+ *   record  uint16 length, uint8 state, uint8 reserved, uint32 crc32 of the data, data padded to 4 bytes
+ *
+ * The state is programmed bit by bit from 0xff, a record is committed after its data was written and
+ * consumed after it was published. Records of an interrupted write stay uncommitted and are skipped.
+ * On mount the sector with the highest sequence is the head, the oldest sector is found by walking
+ * back from it as long as the sequence decreases by one. A full ring erases its oldest sector and
+ * counts the records lost, unless they were consumed.
+ *
+ * The file has no platform dependencies, the flash is accessed through raw_log_flash_t.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define RAW_LOG_MAGIC                   0x474c3358
+#define RAW_LOG_SECTOR_HEADER_SIZE      8
+#define RAW_LOG_RECORD_HEADER_SIZE      8
+
+// record states, bits are only cleared
+#define RAW_LOG_STATE_FREE              0xff
+#define RAW_LOG_STATE_COMMITTED         0xfe
+#define RAW_LOG_STATE_CONSUMED          0xfc
+
+/// @brief Flash access, the functions return 0 on success
+typedef struct {
+    int (*read)(void *ctx, uint32_t address, void *data, size_t length);
+    int (*write)(void *ctx, uint32_t address, const void *data, size_t length);    ///< only clears bits
+    int (*erase)(void *ctx, uint32_t address);                                      ///< sets one sector to 0xff
+    void *ctx;
+    uint32_t size;          ///< area size, a multiple of the sector size
+    uint32_t sector_size;
+} raw_log_flash_t;
+
+/// @brief Counters of the log
+typedef struct {
+    uint32_t records;       ///< committed records not yet consumed
+    uint32_t bytes;         ///< data bytes of these records
+    uint32_t appended;
+    uint32_t lost;          ///< records erased before they were consumed
+    uint32_t erases;        ///< sector erases since mount
+} raw_log_stats_t;
+
+/// @brief Log state
+typedef struct {
+    const raw_log_flash_t *flash;
+    uint32_t sectors;
+    uint32_t head;          ///< write address
+    uint32_t head_sequence;
+    uint32_t tail;          ///< address of the oldest unconsumed record or the head
+    raw_log_stats_t stats;
+} raw_log_t;
+
+/**
+ * @brief Scans the area and restores head and tail, an area without valid sector is formatted
+ *
+ * @param log log state
+ * @param flash flash access, must stay valid
+ * @return int 0 on success, -1 on a flash error or an invalid geometry
+ */
+int raw_log_mount(raw_log_t *log, const raw_log_flash_t *flash);
+
+/**
+ * @brief Returns the largest record
+ *
+ * @param log mounted log
+ * @return size_t data bytes
+ */
+size_t raw_log_max_record(const raw_log_t *log);
+
+/**
+ * @brief Appends a committed record, erases the oldest sector if the ring is full
+ *
+ * @param log mounted log
+ * @param data record data
+ * @param length data length, at most raw_log_max_record
+ * @return int 0 on success, -1 on a flash error or if the record is too large
+ */
+int raw_log_append(raw_log_t *log, const void *data, uint16_t length);
+
+/**
+ * @brief Reads the next committed record without consuming it
+ *
+ * @param log mounted log
+ * @param position read position, log->tail to start with the oldest record, advanced behind the record
+ * @param data target buffer
+ * @param size size of the target buffer
+ * @return int data length, 0 at the head, -1 on a flash error or a record larger than the buffer
+ */
+int raw_log_read(raw_log_t *log, uint32_t *position, void *data, size_t size);
+
+/**
+ * @brief Marks the records from the tail up to a read position as consumed
+ *
+ * @param log mounted log
+ * @param position position returned by raw_log_read
+ * @return int 0 on success, -1 on a flash error
+ */
+int raw_log_consume(raw_log_t *log, uint32_t position);
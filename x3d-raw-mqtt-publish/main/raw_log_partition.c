@@ -0,0 +1,44 @@
+/**
+ * @file raw_log_partition.c
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief flash access of the raw log on a data partition
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "esp_partition.h"
+
+#include "raw_log_partition.h"
+
+static int raw_log_partition_read(void *ctx, uint32_t address, void *data, size_t length)
+{
+    return esp_partition_read(ctx, address, data, length) == ESP_OK ? 0 : -1;
+}
+
+static int raw_log_partition_write(void *ctx, uint32_t address, const void *data, size_t length)
+{
+    return esp_partition_write(ctx, address, data, length) == ESP_OK ? 0 : -1;
+}
+
+static int raw_log_partition_erase(void *ctx, uint32_t address)
+{
+    return esp_partition_erase_range(ctx, address, RAW_LOG_PARTITION_SECTOR_SIZE) == ESP_OK ? 0 : -1;
+}
+
+esp_err_t raw_log_partition_open(raw_log_flash_t *flash, const char *label)
+{
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    if (partition == NULL || partition->size < 2 * RAW_LOG_PARTITION_SECTOR_SIZE)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    flash->read        = raw_log_partition_read;
+    flash->write       = raw_log_partition_write;
+    flash->erase       = raw_log_partition_erase;
+    flash->ctx         = (void *)partition;
+    flash->sector_size = RAW_LOG_PARTITION_SECTOR_SIZE;
+    flash->size        = partition->size - partition->size % RAW_LOG_PARTITION_SECTOR_SIZE;
+    return ESP_OK;
+}
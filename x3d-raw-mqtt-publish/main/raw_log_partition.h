@@ -0,0 +1,27 @@
+/**
+ * @file raw_log_partition.h
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief flash access of the raw log on a data partition
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include "esp_system.h"
+
+#include "raw_log.h"
+
+// log sector of four flash sectors, holds the largest batch
+#define RAW_LOG_PARTITION_SECTOR_SIZE   16384
+
+/**
+ * @brief Binds the flash access to a data partition
+ *
+ * @param flash flash access to fill
+ * @param label partition label
+ * @return esp_err_t ESP_ERR_NOT_FOUND if the partition does not exist or is smaller than two log sectors
+ */
+esp_err_t raw_log_partition_open(raw_log_flash_t *flash, const char *label);
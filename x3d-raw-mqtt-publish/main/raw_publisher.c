@@ -0,0 +1,344 @@
+/**
+ * @file raw_publisher.c
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief batching publisher of received raw frames
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ * The receive task appends frames to the fill buffer, the publisher task sends the other one.
+ * A buffer is handed over when it can not take another frame or its first frame reached the
+ * maximum age. Frames are only dropped if the fill buffer is full while the publisher still
+ * sends the other one.
+ *
+ * Batches which can not be published while the broker is unreachable are appended to the raw log on
+ * flash. Once connected, the publisher drains the log in idle time, several stored batches back to back
+ * in one message with QoS 1. The next message is sent after the acknowledge of the previous one and the
+ * records are only consumed by the acknowledge, so a batch is lost only if the log overflows. A message
+ * sent again after a timeout or reconnect may be delivered twice.
+ */
+#include <inttypes.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "raw_batch.h"
+#include "raw_publisher.h"
+#include "mqtt.h"
+#if CONFIG_X3D_LOG
+#include "raw_log.h"
+#include "raw_log_partition.h"
+#endif
+
+static const char *TAG = "RAW";
+
+static uint8_t raw_buffers[2][CONFIG_X3D_BATCH_SIZE];
+static raw_batch_t raw_batches[2];
+static uint32_t raw_dropped[2];         // frames lost in front of the batch
+static uint8_t raw_fill = 0;            // buffer receiving frames
+static bool raw_ready = false;          // other buffer handed over to the publisher
+static uint32_t raw_dropped_pending = 0;
+static raw_publisher_stats_t raw_stats;
+static portMUX_TYPE raw_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t raw_task = NULL;
+static bool raw_connected = false;
+static int raw_acked = -1;              // msg id of the last acknowledged publish
+
+#if CONFIG_X3D_LOG
+_Static_assert(CONFIG_X3D_LOG_DRAIN_SIZE >= CONFIG_X3D_BATCH_SIZE, "a drain message holds at least one batch");
+
+static raw_log_flash_t raw_flash;
+static raw_log_t raw_log;
+static bool raw_log_mounted = false;
+static uint8_t raw_drain[CONFIG_X3D_LOG_DRAIN_SIZE];
+static int raw_drain_msg_id = -1;       // drain message waiting for its acknowledge
+static uint32_t raw_drain_end;          // log position behind its records
+static int64_t raw_drain_sent_us;
+#endif
+
+/**
+ * @brief Hands the fill buffer over to the publisher, the lock must be held
+ *
+ * @return bool false if the publisher still sends the other buffer or the fill buffer is empty
+ */
+static bool raw_publisher_swap(void)
+{
+    if (raw_ready || raw_batches[raw_fill].count == 0)
+    {
+        return false;
+    }
+    raw_ready = true;
+    raw_fill ^= 1;
+    raw_dropped[raw_fill] = raw_dropped_pending;
+    raw_dropped_pending   = 0;
+    return true;
+}
+
+void raw_publisher_add(const uint8_t *frame, uint8_t length, int8_t rssi)
+{
+    uint64_t now = esp_timer_get_time();
+    bool notify  = false;
+
+    portENTER_CRITICAL(&raw_lock);
+    raw_stats.frames++;
+    raw_batch_t *batch = &raw_batches[raw_fill];
+    if (!raw_batch_append(batch, now, rssi, frame, length))
+    {
+        notify = raw_publisher_swap();
+        batch  = &raw_batches[raw_fill];
+        if (!notify || !raw_batch_append(batch, now, rssi, frame, length))
+        {
+            raw_stats.dropped++;
+            raw_dropped_pending++;
+        }
+    }
+    if (raw_batch_full(batch))
+    {
+        notify |= raw_publisher_swap();
+    }
+    else if (batch->count == 1)
+    {
+        notify = true; // start the age timeout
+    }
+    portEXIT_CRITICAL(&raw_lock);
+
+    if (notify)
+    {
+        xTaskNotifyGive(raw_task);
+    }
+}
+
+void raw_publisher_get_stats(raw_publisher_stats_t *stats)
+{
+    portENTER_CRITICAL(&raw_lock);
+    *stats = raw_stats;
+    portEXIT_CRITICAL(&raw_lock);
+}
+
+#if CONFIG_X3D_LOG
+/**
+ * @brief Copies the log counters, the lock must be held
+ */
+static void raw_publisher_log_stats(void)
+{
+    raw_stats.backlog = raw_log.stats.records;
+    raw_stats.lost    = raw_log.stats.lost;
+}
+
+/**
+ * @brief Stores a batch which could not be published
+ */
+static void raw_publisher_store(const raw_batch_t *batch, uint16_t length)
+{
+    bool stored = raw_log_mounted && raw_log_append(&raw_log, batch->data, length) == 0;
+    if (!stored)
+    {
+        ESP_LOGW(TAG, "batch of %d frames not stored", batch->count);
+    }
+    portENTER_CRITICAL(&raw_lock);
+    raw_stats.stored += stored;
+    raw_stats.failed += !stored;
+    raw_publisher_log_stats();
+    portEXIT_CRITICAL(&raw_lock);
+}
+
+/**
+ * @brief Sends the next drain message once the previous one was acknowledged
+ *
+ * @param connected broker connection state
+ * @param acked msg id of the last acknowledge
+ * @return TickType_t time until the acknowledge timeout of the message in flight, portMAX_DELAY if none
+ */
+static TickType_t raw_publisher_drain(bool connected, int acked)
+{
+    const int64_t timeout_us = CONFIG_X3D_LOG_ACK_TIMEOUT_MS * 1000LL;
+    int64_t now              = esp_timer_get_time();
+    if (raw_drain_msg_id >= 0)
+    {
+        if (acked == raw_drain_msg_id)
+        {
+            raw_log_consume(&raw_log, raw_drain_end);
+            raw_drain_msg_id = -1;
+            portENTER_CRITICAL(&raw_lock);
+            raw_stats.drained++;
+            raw_publisher_log_stats();
+            portEXIT_CRITICAL(&raw_lock);
+        }
+        else if (connected && now - raw_drain_sent_us < timeout_us)
+        {
+            return pdMS_TO_TICKS((timeout_us - (now - raw_drain_sent_us) + 999) / 1000) + 1;
+        }
+        else
+        {
+            // the records are sent again from the tail
+            raw_drain_msg_id = -1;
+        }
+    }
+    if (!connected || !raw_log_mounted || raw_log.stats.records == 0)
+    {
+        return portMAX_DELAY;
+    }
+
+    uint32_t position = raw_log.tail;
+    size_t length     = 0;
+    for (;;)
+    {
+        uint32_t next = position;
+        int read      = raw_log_read(&raw_log, &next, &raw_drain[length], sizeof(raw_drain) - length);
+        if (read == 0)
+        {
+            // records with crc error in front of the head are consumed with the message
+            position = next;
+        }
+        if (read <= 0)
+        {
+            break;
+        }
+        length += read;
+        position = next;
+    }
+    if (length == 0)
+    {
+        // only records with crc error left
+        raw_log_consume(&raw_log, position);
+        return portMAX_DELAY;
+    }
+
+    int msg_id = mqtt_publish(CONFIG_X3D_PUBLISH_TOPIC, (const char *)raw_drain, length, 1, 0);
+    if (msg_id < 0)
+    {
+        ESP_LOGW(TAG, "backlog of %u bytes not published", (unsigned)length);
+        return pdMS_TO_TICKS(CONFIG_X3D_LOG_ACK_TIMEOUT_MS);
+    }
+    raw_drain_msg_id  = msg_id;
+    raw_drain_end     = position;
+    raw_drain_sent_us = now;
+    return pdMS_TO_TICKS(CONFIG_X3D_LOG_ACK_TIMEOUT_MS) + 1;
+}
+#endif
+
+static void raw_publisher_task(void *arg)
+{
+    const uint64_t max_age_us = CONFIG_X3D_BATCH_MAX_AGE_MS * 1000ULL;
+    uint16_t sequence         = 0;
+
+    for (;;)
+    {
+        TickType_t wait = portMAX_DELAY;
+        portENTER_CRITICAL(&raw_lock);
+        raw_batch_t *fill = &raw_batches[raw_fill];
+        if (!raw_ready && fill->count > 0)
+        {
+            uint64_t age = esp_timer_get_time() - fill->base_us;
+            if (age >= max_age_us || raw_batch_full(fill))
+            {
+                raw_publisher_swap();
+            }
+            else
+            {
+                wait = pdMS_TO_TICKS((max_age_us - age + 999) / 1000) + 1;
+            }
+        }
+        bool ready     = raw_ready;
+        uint8_t index  = raw_fill ^ 1;
+        bool connected = raw_connected;
+        int acked      = -1;
+        if (!ready)
+        {
+            // the acknowledge is only taken by the drain, a live batch leaves it for the next round
+            acked     = raw_acked;
+            raw_acked = -1;
+        }
+        portEXIT_CRITICAL(&raw_lock);
+
+        if (!ready)
+        {
+#if CONFIG_X3D_LOG
+            // the backlog is drained while no live batch is waiting
+            TickType_t drain = raw_publisher_drain(connected, acked);
+            if (drain < wait)
+            {
+                wait = drain;
+            }
+#endif
+            ulTaskNotifyTake(pdTRUE, wait);
+            continue;
+        }
+
+        // the ready buffer is owned by this task until raw_ready is cleared
+        raw_batch_t *batch = &raw_batches[index];
+        uint16_t length    = raw_batch_finish(batch, sequence++, raw_dropped[index]);
+        int msg_id         = connected ? mqtt_publish(CONFIG_X3D_PUBLISH_TOPIC, (const char *)batch->data, length, 0, 0) : -1;
+        if (msg_id < 0)
+        {
+#if CONFIG_X3D_LOG
+            raw_publisher_store(batch, length);
+#else
+            ESP_LOGW(TAG, "batch of %d frames not published", batch->count);
+            portENTER_CRITICAL(&raw_lock);
+            raw_stats.failed++;
+            portEXIT_CRITICAL(&raw_lock);
+#endif
+        }
+        raw_batch_reset(batch);
+
+        portENTER_CRITICAL(&raw_lock);
+        raw_stats.batches++;
+        raw_ready = false;
+        portEXIT_CRITICAL(&raw_lock);
+    }
+}
+
+void raw_publisher_connected(bool connected)
+{
+    portENTER_CRITICAL(&raw_lock);
+    raw_connected = connected;
+    portEXIT_CRITICAL(&raw_lock);
+    if (raw_task != NULL)
+    {
+        xTaskNotifyGive(raw_task);
+    }
+}
+
+void raw_publisher_published(int msg_id)
+{
+    portENTER_CRITICAL(&raw_lock);
+    raw_acked = msg_id;
+    portEXIT_CRITICAL(&raw_lock);
+    if (raw_task != NULL)
+    {
+        xTaskNotifyGive(raw_task);
+    }
+}
+
+esp_err_t raw_publisher_init(void)
+{
+    raw_batch_init(&raw_batches[0], raw_buffers[0], sizeof(raw_buffers[0]));
+    raw_batch_init(&raw_batches[1], raw_buffers[1], sizeof(raw_buffers[1]));
+#if CONFIG_X3D_LOG
+    if (raw_log_partition_open(&raw_flash, CONFIG_X3D_LOG_PARTITION) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "partition %s not found, batches are lost while offline", CONFIG_X3D_LOG_PARTITION);
+    }
+    else if (raw_log_mount(&raw_log, &raw_flash) != 0)
+    {
+        ESP_LOGE(TAG, "log on %s not mounted", CONFIG_X3D_LOG_PARTITION);
+    }
+    else
+    {
+        raw_log_mounted = true;
+        raw_publisher_log_stats();
+        ESP_LOGI(TAG, "log of %" PRIu32 " sectors, %" PRIu32 " batches with %" PRIu32 " bytes pending", raw_log.sectors,
+            raw_log.stats.records, raw_log.stats.bytes);
+    }
+#endif
+    if (xTaskCreate(raw_publisher_task, "raw_publisher_task", 3072, NULL, 4, &raw_task) != pdPASS)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,65 @@
+/**
+ * @file raw_publisher.h
+ * @author Sven Fabricius (sven.fabricius@livediesel.de)
+ * @brief batching publisher of received raw frames
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_system.h"
+
+/// @brief Counters of the publisher
+typedef struct {
+    uint32_t frames;    ///< frames added
+    uint32_t batches;   ///< published messages
+    uint32_t dropped;   ///< frames lost because both buffers were in use
+    uint32_t failed;    ///< batches neither accepted by the mqtt client nor stored in the log
+    uint32_t stored;    ///< batches stored in the log while the broker was unreachable
+    uint32_t drained;   ///< acknowledged messages of stored batches
+    uint32_t backlog;   ///< stored batches not yet acknowledged
+    uint32_t lost;      ///< stored batches overwritten by a full log
+} raw_publisher_stats_t;
+
+/**
+ * @brief Creates the publisher task
+ *
+ * @return esp_err_t
+ */
+esp_err_t raw_publisher_init(void);
+
+/**
+ * @brief Adds a received frame to the current batch, does not block on the network
+ *
+ * @param frame frame bytes
+ * @param length frame length
+ * @param rssi rssi in dBm
+ */
+void raw_publisher_add(const uint8_t *frame, uint8_t length, int8_t rssi);
+
+/**
+ * @brief Copies the counters
+ *
+ * @param stats target
+ */
+void raw_publisher_get_stats(raw_publisher_stats_t *stats);
+
+/**
+ * @brief Reports the broker connection state, called by the mqtt event handler
+ *
+ * @param connected true after MQTT_EVENT_CONNECTED, false after MQTT_EVENT_DISCONNECTED
+ */
+void raw_publisher_connected(bool connected);
+
+/**
+ * @brief Reports the acknowledge of a published message, called by the mqtt event handler
+ *
+ * @param msg_id msg id of MQTT_EVENT_PUBLISHED
+ */
+void raw_publisher_published(int msg_id);
@@ -20,7 +20,7 @@
 
 #include "sx1231.h"
 #include "rfm.h"
-#include "mqtt.h"
+#include "raw_publisher.h"
 
 #define RFM_PIN_NUM_MISO                   VSPI_IOMUX_PIN_NUM_MISO
 #define RFM_PIN_NUM_MOSI                   VSPI_IOMUX_PIN_NUM_MOSI
@@ -67,13 +67,15 @@ static void rfm_process_task(void* arg)
         if (xQueueReceive(rfm_evt_queue, &io_num, portMAX_DELAY))
         {
             uint8_t buffer[65];
+            int16_t rssi = 0;
             sx1231_get_buffer(sx1231_handle, buffer);
+            sx1231_rssi(sx1231_handle, false, &rssi); // the restart of the receiver clears the value
             ESP_ERROR_CHECK(sx1231_receive_begin(sx1231_handle));
             if (check_message(buffer) != ESP_OK)
             {
                 continue;
             }
-            mqtt_publish(CONFIG_X3D_PUBLISH_TOPIC, (const char *)buffer, buffer[0], 0, 0);
+            raw_publisher_add(buffer, buffer[0], rssi);
         }
     }
 }
@@ -136,6 +138,7 @@ esp_err_t rfm_init(void)
     gpio_install_isr_service(0);
     gpio_isr_handler_add(RFM_PIN_NUM_IRQ, rfm_isr_handler, (void*) RFM_PIN_NUM_IRQ);
     rfm_evt_queue = xQueueCreate(10, sizeof(uint32_t));
+    ESP_ERROR_CHECK(raw_publisher_init());
     xTaskCreate(rfm_process_task, "rfm_process_task", 2048, NULL, 5, NULL);
 
     // start in receiver mode
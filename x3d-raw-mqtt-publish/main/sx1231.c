@@ -253,6 +253,25 @@ esp_err_t sx1231_rssi_threshold(sx1231_context_t* ctx, uint8_t rssi_threshold)
     return writeReg(ctx->spi, SX1231_REG_RSSI_THRESH, rssi_threshold);
 }
 
+esp_err_t sx1231_rssi(sx1231_context_t* ctx, bool start, int16_t *rssi)
+{
+    if (start)
+    {
+        writeReg(ctx->spi, SX1231_REG_RSSI_CONFIG, SX1231_RSSI_START);
+
+        uint32_t begin = millis();
+        uint8_t timeout = 2;
+        while (((readReg(ctx->spi, SX1231_REG_RSSI_CONFIG) & SX1231_RSSI_DONE) == 0) && millis() - begin < timeout)
+            ; // wait for RssiDone
+        if (millis() - begin >= timeout)
+        {
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+    *rssi = -(int16_t)(readReg(ctx->spi, SX1231_REG_RSSI_VALUE) >> 1);
+    return ESP_OK;
+}
+
 esp_err_t sx1231_preamble(sx1231_context_t* ctx, uint16_t length)
 {
     return writeReg16(ctx->spi, SX1231_REG_PREAMBLE_MSB, length);
@@ -48,6 +48,16 @@ esp_err_t sx1231_rx_afc_bw(sx1231_handle_t handle, sx1231_dcc_cutoff_t dcc_cutof
 esp_err_t sx1231_afc_fei(sx1231_handle_t handle, bool fei_start, bool autoclear_on, bool auto_on, bool clear, bool start);
 esp_err_t sx1231_dio_mapping(sx1231_handle_t handle, sx1231_dio_pin_t pin, sx1231_dio_type_t type, sx1231_dio_mode_t mode);
 esp_err_t sx1231_rssi_threshold(sx1231_handle_t handle, uint8_t rssi_threshold);
+
+/**
+ * @brief reads the RSSI value in dBm, only valid in receiver mode
+ *
+ * @param handle SX1231 handle
+ * @param start trigger a new measurement and wait for it, otherwise return the last measured value
+ * @param rssi pointer to RSSI result in dBm
+ * @return esp_err_t
+ */
+esp_err_t sx1231_rssi(sx1231_handle_t handle, bool start, int16_t *rssi);
 esp_err_t sx1231_preamble(sx1231_handle_t handle, uint16_t length);
 esp_err_t sx1231_sync(sx1231_handle_t handle, bool sync_on, bool fifo_fill_condition, uint8_t sync_size, uint8_t sync_tol, uint8_t *sync);
 esp_err_t sx1231_packet(sx1231_handle_t handle, sx_1231_packet_format_t format, sx_1231_packet_dc_t dc_free, uint8_t payload_length, bool crc_on, bool crc_auto_clear_off, sx_1231_packet_filtering_t filtering, sx_1231_inter_packet_rx_delay_t inter_packet_rx_delay, bool auto_rx_restart, bool aes);
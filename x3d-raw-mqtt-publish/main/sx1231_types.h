@@ -40,6 +40,11 @@ typedef enum {
 	SX1231_IRQ2_FIFO_FULL = 0x80,
 } sx1231_irq_flags_2_t;
 
+typedef enum {
+	SX1231_RSSI_START = 0x01,
+	SX1231_RSSI_DONE = 0x02,
+} sx1231_rssi_config_t;
+
 typedef enum {
 	SX1231_DATA_MODE_PACKET = 0x00,
 	SX1231_DATA_MODE_CONTINUOUS = 0x40,